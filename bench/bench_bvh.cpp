@@ -0,0 +1,181 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/bvh.hpp"
+
+/*
+ * Ray tracing a height field of 2 * 512 * 512 triangles. bvh_build builds
+ * the tree, and each op is one triangle. The memory the tree uses is
+ * reported in the context, as bvh4_bytes_per_triangle and
+ * bvh8_bytes_per_triangle.
+ *
+ * rays_primary traces the rays of a 512x512 camera looking down at the
+ * field, which are coherent, and rays_random rays from random points above
+ * the field in random downward directions, which are not. Each op is one
+ * ray, so elements_per_second / 10^6 is Mrays/s. single traces the rays one
+ * at a time, and packet in packets of 4 (2x2 pixels) or 8 (4x2 pixels).
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+
+constexpr unsigned int grid = 512;
+constexpr unsigned int image = 512;
+
+float height(float x, float y)
+{
+	return 0.1f * std::sin(x * 9.f) * std::cos(y * 7.f) + 0.05f * std::sin((x + y) * 23.f);
+}
+
+std::vector<vec> make_terrain()
+{
+	std::vector<vec> out;
+	out.reserve(grid * grid * 6);
+	const float step = 1.f / grid;
+	for(unsigned int j = 0; j < grid; ++j) {
+		for(unsigned int i = 0; i < grid; ++i) {
+			const float x = i * step;
+			const float y = j * step;
+			const vec a(x, y, height(x, y));
+			const vec b(x + step, y, height(x + step, y));
+			const vec c(x, y + step, height(x, y + step));
+			const vec d(x + step, y + step, height(x + step, y + step));
+			out.push_back(a);
+			out.push_back(b);
+			out.push_back(d);
+			out.push_back(a);
+			out.push_back(d);
+			out.push_back(c);
+		}
+	}
+	return out;
+}
+
+// rays in the order of their packets, W at a time from tiles of W pixels
+template <unsigned int W>
+std::vector<velm::ray<float>> primary_rays()
+{
+	constexpr unsigned int tile_w = W == 8 ? 4 : 2;
+	constexpr unsigned int tile_h = W / tile_w;
+
+	const vec eye(0.5f, -0.3f, 0.8f);
+	const vec forward = velm::normalize(vec(0.5f, 0.5f, 0.f) - eye);
+	const vec right = velm::normalize(velm::cross(forward, vec(0.f, 0.f, 1.f)));
+	const vec up = velm::cross(right, forward);
+
+	std::vector<velm::ray<float>> out;
+	out.reserve(image * image);
+	for(unsigned int ty = 0; ty < image; ty += tile_h) {
+		for(unsigned int tx = 0; tx < image; tx += tile_w) {
+			for(unsigned int y = ty; y < ty + tile_h; ++y) {
+				for(unsigned int x = tx; x < tx + tile_w; ++x) {
+					const float sx = (x + 0.5f) / image * 2.f - 1.f;
+					const float sy = (y + 0.5f) / image * 2.f - 1.f;
+					const vec dir = forward + right * (sx * 0.7f) + up * (sy * 0.7f);
+					out.push_back({eye, dir, 0.f, 1e30f});
+				}
+			}
+		}
+	}
+	return out;
+}
+
+std::vector<velm::ray<float>> random_rays()
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> dist(0, 1);
+
+	std::vector<velm::ray<float>> out(image * image);
+	for(auto&& r : out) {
+		const vec origin(dist(rng), dist(rng), 0.3f);
+		const vec dir(dist(rng) - 0.5f, dist(rng) - 0.5f, -dist(rng));
+		r = {origin, dir, 0.f, 1e30f};
+	}
+	return out;
+}
+
+template <unsigned int W>
+std::vector<typename velm::bvh<W>::packet_type> make_packets(const std::vector<velm::ray<float>>& rays)
+{
+	std::vector<typename velm::bvh<W>::packet_type> out(rays.size() / W);
+	for(std::size_t p = 0; p < out.size(); ++p) {
+		for(unsigned int i = 0; i < W; ++i) {
+			const velm::ray<float>& r = rays[p * W + i];
+			for(unsigned int k = 0; k < 3; ++k) {
+				out[p].origin[k][i] = r.origin[k];
+				out[p].direction[k][i] = r.direction[k];
+			}
+			out[p].tmin[i] = r.tmin;
+			out[p].tmax[i] = r.tmax;
+		}
+	}
+	return out;
+}
+
+template <unsigned int W>
+void trace_case(bench::runner& r, const std::string& group, const velm::bvh<W>& tree,
+	const std::vector<velm::ray<float>>& rays)
+{
+	const std::string name = "bvh" + std::to_string(W);
+	const auto packets = make_packets<W>(rays);
+	std::vector<velm::ray_hit> hits(rays.size());
+
+	r.run(group, name + "_single", "float", 3, rays.size(), [&] {
+		for(std::size_t i = 0; i < rays.size(); ++i) {
+			hits[i] = tree.intersect(rays[i]);
+		}
+		bench::do_not_optimize(hits[0]);
+	});
+	r.run(group, name + "_packet", "float", 3, rays.size(), [&] {
+		for(std::size_t p = 0; p < packets.size(); ++p) {
+			tree.intersect(packets[p], hits.data() + p * W);
+		}
+		bench::do_not_optimize(hits[0]);
+	});
+}
+
+template <unsigned int W>
+void bvh_case(bench::runner& r, const std::vector<vec>& terrain)
+{
+	const std::string name = "bvh" + std::to_string(W);
+	const std::size_t triangles = terrain.size() / 3;
+
+	r.run("bvh_build", "velm_" + name, "float", 3, triangles, [&] {
+		velm::bvh<W> built(terrain);
+		bench::do_not_optimize(built);
+	});
+
+	const velm::bvh<W> tree(terrain);
+	r.context(name + "_bytes_per_triangle", static_cast<long long>(tree.memory_usage() / triangles));
+
+	trace_case(r, "rays_primary", tree, primary_rays<W>());
+	trace_case(r, "rays_random", tree, random_rays());
+}
+
+} // namespace
+
+void register_bvh(bench::runner& r)
+{
+	bool any = false;
+	for(const char* impl : {"velm_bvh4", "velm_bvh8"}) {
+		any = any || r.selected("bvh_build", impl, "float", 3);
+	}
+	for(const char* group : {"rays_primary", "rays_random"}) {
+		for(const char* impl : {"bvh4_single", "bvh4_packet", "bvh8_single", "bvh8_packet"}) {
+			any = any || r.selected(group, impl, "float", 3);
+		}
+	}
+	if(!any) {
+		return;
+	}
+
+	const std::vector<vec> terrain = make_terrain();
+	bvh_case<4>(r, terrain);
+	bvh_case<8>(r, terrain);
+}
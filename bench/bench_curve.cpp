@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/sort.hpp"
+
+/*
+ * Space-filling curves. curve_keys computes the Morton or Hilbert keys of
+ * points, and spatial_sort sorts points by their keys (velm_radix), against
+ * sorting (key, index) pairs with std::sort (std_sort).
+ *
+ * knn_grid shows what the sort is for: the 8 nearest neighbours of every
+ * point within the 27 cells around it in a uniform grid (about 4 points per
+ * cell), with the points in random order (unsorted) and sorted along a
+ * Morton (velm_morton) or Hilbert (velm_hilbert) curve. The grid holds
+ * indices into the points, in the order of the points, so the sort improves
+ * the locality of both. Each op is one point.
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+
+constexpr std::size_t points = std::size_t(1) << 21;
+constexpr int grid_dim = 80;
+constexpr unsigned int neighbours = 8;
+
+std::vector<vec> make_points()
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(0, 1);
+
+	std::vector<vec> out(points);
+	for(auto&& p : out) {
+		p = vec(dist(rng), dist(rng), dist(rng));
+	}
+	return out;
+}
+
+// a uniform grid over [0, 1)^3, built with a counting sort
+struct grid_index
+{
+	std::vector<std::uint32_t> start;
+	std::vector<std::uint32_t> items;
+
+	static int cell_of(float c)
+	{
+		const int i = static_cast<int>(c * grid_dim);
+		return i < 0 ? 0 : i < grid_dim ? i : grid_dim - 1;
+	}
+
+	static int cell_of(const vec& p)
+	{
+		return (cell_of(p[2]) * grid_dim + cell_of(p[1])) * grid_dim + cell_of(p[0]);
+	}
+
+	explicit grid_index(const std::vector<vec>& pts)
+		: start(grid_dim * grid_dim * grid_dim + 1, 0), items(pts.size())
+	{
+		for(auto&& p : pts) {
+			++start[cell_of(p) + 1];
+		}
+		for(std::size_t c = 1; c < start.size(); ++c) {
+			start[c] += start[c - 1];
+		}
+		std::vector<std::uint32_t> fill(start.begin(), start.end() - 1);
+		for(std::size_t i = 0; i < pts.size(); ++i) {
+			items[fill[cell_of(pts[i])]++] = static_cast<std::uint32_t>(i);
+		}
+	}
+};
+
+float knn_distance(const std::vector<vec>& pts, const grid_index& grid, std::size_t i)
+{
+	const vec p = pts[i];
+	float best[neighbours];
+	std::fill(best, best + neighbours, 1e30f);
+
+	const int cx = grid_index::cell_of(p[0]);
+	const int cy = grid_index::cell_of(p[1]);
+	const int cz = grid_index::cell_of(p[2]);
+	for(int z = std::max(cz - 1, 0); z <= std::min(cz + 1, grid_dim - 1); ++z) {
+		for(int y = std::max(cy - 1, 0); y <= std::min(cy + 1, grid_dim - 1); ++y) {
+			const int row = (z * grid_dim + y) * grid_dim;
+			const std::uint32_t first = grid.start[row + std::max(cx - 1, 0)];
+			const std::uint32_t last = grid.start[row + std::min(cx + 1, grid_dim - 1) + 1];
+			for(std::uint32_t j = first; j < last; ++j) {
+				const vec d = pts[grid.items[j]] - p;
+				float d2 = velm::dot(d, d);
+				if(d2 < best[neighbours - 1] && grid.items[j] != i) {
+					// insert into the sorted list of the best so far
+					unsigned int k = neighbours - 1;
+					for(; k > 0 && best[k - 1] > d2; --k) {
+						best[k] = best[k - 1];
+					}
+					best[k] = d2;
+				}
+			}
+		}
+	}
+	return best[neighbours - 1];
+}
+
+void knn_case(bench::runner& r, const char* impl, const std::vector<vec>& pts)
+{
+	const grid_index grid(pts);
+	r.run("knn_grid", impl, "float", 3, pts.size(), [&] {
+		float sum = 0;
+		for(std::size_t i = 0; i < pts.size(); ++i) {
+			sum += knn_distance(pts, grid, i);
+		}
+		bench::do_not_optimize(sum);
+	});
+}
+
+} // namespace
+
+void register_curve(bench::runner& r)
+{
+	const std::vector<vec> pts = make_points();
+	const vec lo(0.f);
+	const vec hi(1.f);
+	std::vector<std::uint64_t> keys(points);
+
+	r.run("curve_keys", "velm_morton", "float", 3, points, [&] {
+		velm::curve_keys(pts, lo, hi, keys.data(), velm::curve::morton);
+		bench::do_not_optimize(keys[points - 1]);
+	});
+	r.run("curve_keys", "velm_hilbert", "float", 3, points, [&] {
+		velm::curve_keys(pts, lo, hi, keys.data(), velm::curve::hilbert);
+		bench::do_not_optimize(keys[points - 1]);
+	});
+
+	std::vector<vec> sorted;
+	r.run("spatial_sort", "velm_radix", "float", 3, points, [&] {
+		sorted = pts;
+		velm::spatial_sort(sorted);
+		bench::do_not_optimize(sorted[0]);
+	});
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> pairs(points);
+	r.run("spatial_sort", "std_sort", "float", 3, points, [&] {
+		velm::curve_keys(pts, lo, hi, keys.data());
+		for(std::size_t i = 0; i < points; ++i) {
+			pairs[i] = {keys[i], static_cast<std::uint32_t>(i)};
+		}
+		std::sort(pairs.begin(), pairs.end());
+		sorted.resize(points);
+		for(std::size_t i = 0; i < points; ++i) {
+			sorted[i] = pts[pairs[i].second];
+		}
+		bench::do_not_optimize(sorted[0]);
+	});
+
+	knn_case(r, "unsorted", pts);
+	sorted = pts;
+	velm::spatial_sort(sorted, velm::curve::morton);
+	knn_case(r, "velm_morton", sorted);
+	sorted = pts;
+	velm::spatial_sort(sorted, velm::curve::hilbert);
+	knn_case(r, "velm_hilbert", sorted);
+}
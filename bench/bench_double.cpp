@@ -0,0 +1,9 @@
+#include "vector_suite.hpp"
+
+void register_double(bench::runner& r)
+{
+	bench::vector_suite<double, 2>(r, "double");
+	bench::vector_suite<double, 3>(r, "double");
+	bench::vector_suite<double, 4>(r, "double");
+	bench::vector_suite<double, 8>(r, "double");
+}
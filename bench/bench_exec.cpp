@@ -0,0 +1,98 @@
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/matrix.hpp"
+#include "velm/exec.hpp"
+#include "velm/sort.hpp"
+#include "velm/kdtree.hpp"
+
+/*
+ * Execution policies (see velm/exec.hpp): the same work run with
+ * velm::exec::seq and velm::exec::par, over 2^22 points, so the ratio of the
+ * two is the speedup of the thread pool. The number of threads it uses is
+ * reported in the context, as exec_threads.
+ *
+ * exec_normalize and exec_transform_points are batch functions, exec_bounds
+ * an exec::reduce finding the bounds of the points, exec_spatial_sort sorts
+ * the points along a Morton curve and exec_kdtree_build builds a k-d tree
+ * of them. Each op is one point.
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+
+constexpr std::size_t points = std::size_t(1) << 22;
+
+const std::pair<const char*, velm::exec::policy> policies[] = {
+	{"velm_seq", velm::exec::seq},
+	{"velm_par", velm::exec::par},
+};
+
+} // namespace
+
+void register_exec(bench::runner& r)
+{
+	bool any = false;
+	for(const char* group : {"exec_normalize", "exec_transform_points", "exec_bounds", "exec_spatial_sort", "exec_kdtree_build"}) {
+		for(auto&& p : policies) {
+			any = any || r.selected(group, p.first, "float", 3);
+		}
+	}
+	if(!any) {
+		return;
+	}
+
+	r.context("exec_threads", static_cast<long long>(velm::exec::threads(velm::exec::par)));
+
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> dist(-1, 1);
+	std::vector<vec> pts(points);
+	for(auto&& p : pts) {
+		p = vec(dist(rng), dist(rng), dist(rng));
+	}
+	std::vector<vec> out(points);
+	const velm::matrix<float, 4, 4> m = velm::translate(velm::matrix<float, 4, 4>::identity(), vec(1.f, 2.f, 3.f));
+
+	for(auto&& p : policies) {
+		const velm::exec::policy policy = p.second;
+
+		r.run("exec_normalize", p.first, "float", 3, points, [&] {
+			velm::batch::normalize(policy, pts, out);
+			bench::do_not_optimize(out[0]);
+		});
+		r.run("exec_transform_points", p.first, "float", 3, points, [&] {
+			velm::batch::transform_points(policy, m, pts, out);
+			bench::do_not_optimize(out[0]);
+		});
+
+		using box = std::pair<vec, vec>;
+		r.run("exec_bounds", p.first, "float", 3, points, [&] {
+			const box b = velm::exec::reduce(policy, pts, box(pts[0], pts[0]), [&] (std::size_t begin, std::size_t end) {
+				vec lo = pts[begin];
+				vec hi = pts[begin];
+				for(std::size_t i = begin + 1; i < end; ++i) {
+					lo = velm::min(lo, pts[i]);
+					hi = velm::max(hi, pts[i]);
+				}
+				return box(lo, hi);
+			}, [] (const box& x, const box& y) {
+				return box(velm::min(x.first, y.first), velm::max(x.second, y.second));
+			});
+			bench::do_not_optimize(b);
+		});
+
+		r.run("exec_spatial_sort", p.first, "float", 3, points, [&] {
+			out = pts;
+			bench::do_not_optimize(velm::spatial_sort(policy, out));
+		});
+		r.run("exec_kdtree_build", p.first, "float", 3, points, [&] {
+			velm::kdtree<float, 3> tree(policy, pts);
+			bench::do_not_optimize(tree);
+		});
+	}
+}
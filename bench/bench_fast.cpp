@@ -0,0 +1,82 @@
+#include <cstddef>
+
+#include "vector_suite.hpp"
+#include "velm/fast.hpp"
+
+/*
+ * velm::fast against the exact functions. length, normalize, div and
+ * div_scalar share their groups with the float suite, so they are also
+ * compared with the raw baseline; distance and inversesqrt are only run here.
+ * normalize is also run on packs of 8 vectors (velm_pack and
+ * velm_fast_pack), still timed per vector.
+ */
+
+namespace {
+
+template <unsigned int N>
+struct fast_impl : bench::velm_impl<float, N>
+{
+	static constexpr const char* name = "velm_fast";
+};
+
+template <unsigned int N>
+void fast_suite(bench::runner& r)
+{
+	using bench::map_case;
+	using exact_impl = bench::velm_impl<float, N>;
+	using vec = velm::vector<float, N>;
+
+	// both fixtures are seeded by the dimensions, so hold the same values
+	const bench::fixture<exact_impl, float> exact(N);
+	const bench::fixture<fast_impl<N>, float> fast(N);
+
+	map_case<fast_impl<N>, float, N>(r, "length", "float", fast, [] (const vec& a, const vec&, float) { return velm::fast::length(a); });
+	map_case<fast_impl<N>, float, N>(r, "normalize", "float", fast, [] (const vec& a, const vec&, float) { return velm::fast::normalize(a); });
+	map_case<fast_impl<N>, float, N>(r, "div", "float", fast, [] (const vec& a, const vec& b, float) { return velm::fast::divide(a, b); });
+	map_case<fast_impl<N>, float, N>(r, "div_scalar", "float", fast, [] (const vec& a, const vec&, float s) { return velm::fast::divide(a, s); });
+
+	map_case<exact_impl, float, N>(r, "distance", "float", exact, [] (const vec& a, const vec& b, float) { return velm::distance(a, b); });
+	map_case<fast_impl<N>, float, N>(r, "distance", "float", fast, [] (const vec& a, const vec& b, float) { return velm::fast::distance(a, b); });
+	map_case<exact_impl, float, N>(r, "inversesqrt", "float", exact, [] (const vec&, const vec& b, float) { return velm::inversesqrt(b); });
+	map_case<fast_impl<N>, float, N>(r, "inversesqrt", "float", fast, [] (const vec&, const vec& b, float) { return velm::fast::inversesqrt(b); });
+}
+
+template <unsigned int N>
+void pack_suite(bench::runner& r)
+{
+	using bench::count;
+	using packed = velm::vector<velm::pack<float, 8>, N>;
+	constexpr std::size_t packs = count / 8;
+
+	const bench::fixture<bench::velm_impl<float, N>, float> fix(N);
+	// on the stack, since new[] doesn't respect the alignment of packs before C++17
+	packed in[packs];
+	packed out[packs];
+	for(std::size_t i = 0; i < packs; ++i) {
+		in[i] = velm::gather<8>(fix.a.get() + i * 8);
+	}
+
+	r.run("normalize", "velm_pack", "float", N, count, [&] {
+		for(std::size_t i = 0; i < packs; ++i) {
+			out[i] = velm::normalize(in[i]);
+		}
+		bench::do_not_optimize(out[packs - 1]);
+	});
+	r.run("normalize", "velm_fast_pack", "float", N, count, [&] {
+		for(std::size_t i = 0; i < packs; ++i) {
+			out[i] = velm::fast::normalize(in[i]);
+		}
+		bench::do_not_optimize(out[packs - 1]);
+	});
+}
+
+} // namespace
+
+void register_fast(bench::runner& r)
+{
+	fast_suite<3>(r);
+	fast_suite<4>(r);
+	fast_suite<8>(r);
+	pack_suite<3>(r);
+	pack_suite<4>(r);
+}
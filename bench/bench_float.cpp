@@ -0,0 +1,9 @@
+#include "vector_suite.hpp"
+
+void register_float(bench::runner& r)
+{
+	bench::vector_suite<float, 2>(r, "float");
+	bench::vector_suite<float, 3>(r, "float");
+	bench::vector_suite<float, 4>(r, "float");
+	bench::vector_suite<float, 8>(r, "float");
+}
@@ -0,0 +1,143 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/spatial_grid.hpp"
+
+/*
+ * Fixed-radius neighbour search over 2^18 particles uniform in the unit
+ * cube, with a radius giving about 30 neighbours each, as in SPH. The
+ * baseline is a std::unordered_map from cell to a std::vector of particles.
+ *
+ * grid_build bins the particles, and grid_pairs finds every pair within the
+ * radius; each op is one particle. grid_update moves a particle by 1% of
+ * the radius, so few change cells, and each op is one particle.
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+
+constexpr std::size_t particles = std::size_t(1) << 18;
+
+// 4/3 pi r^3 particles = 30
+const float radius = std::cbrt(30.f * 3.f / (4.f * 3.14159265f * particles));
+
+struct cell_map
+{
+	float inv_cell;
+	std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> cells;
+
+	static std::uint64_t key(std::int64_t x, std::int64_t y, std::int64_t z)
+	{
+		const std::uint64_t m = (std::uint64_t(1) << 21) - 1;
+		return (std::uint64_t(x) & m) | (std::uint64_t(y) & m) << 21 | (std::uint64_t(z) & m) << 42;
+	}
+
+	std::int64_t cell(float c) const
+	{
+		return static_cast<std::int64_t>(std::floor(c * inv_cell));
+	}
+
+	void build(const std::vector<vec>& pts)
+	{
+		cells.clear();
+		for(std::size_t i = 0; i < pts.size(); ++i) {
+			cells[key(this->cell(pts[i][0]), this->cell(pts[i][1]), this->cell(pts[i][2]))].push_back(static_cast<std::uint32_t>(i));
+		}
+	}
+
+	std::size_t pairs(const std::vector<vec>& pts) const
+	{
+		const float r2 = radius * radius;
+		std::size_t found = 0;
+		for(std::size_t i = 0; i < pts.size(); ++i) {
+			const vec p = pts[i];
+			const std::int64_t cx = this->cell(p[0]);
+			const std::int64_t cy = this->cell(p[1]);
+			const std::int64_t cz = this->cell(p[2]);
+			for(std::int64_t z = cz - 1; z <= cz + 1; ++z) {
+				for(std::int64_t y = cy - 1; y <= cy + 1; ++y) {
+					for(std::int64_t x = cx - 1; x <= cx + 1; ++x) {
+						const auto it = cells.find(key(x, y, z));
+						if(it == cells.end()) {
+							continue;
+						}
+						for(std::uint32_t j : it->second) {
+							const vec d = pts[j] - p;
+							found += j > i && velm::dot(d, d) <= r2;
+						}
+					}
+				}
+			}
+		}
+		return found;
+	}
+};
+
+} // namespace
+
+void register_grid(bench::runner& r)
+{
+	bool any = false;
+	for(const char* group : {"grid_build", "grid_pairs"}) {
+		for(const char* impl : {"velm_spatial_grid", "unordered_map"}) {
+			any = any || r.selected(group, impl, "float", 3);
+		}
+	}
+	any = any || r.selected("grid_update", "velm_spatial_grid", "float", 3);
+	if(!any) {
+		return;
+	}
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> dist(0, 1);
+	std::vector<vec> pts(particles);
+	for(auto&& p : pts) {
+		p = vec(dist(rng), dist(rng), dist(rng));
+	}
+
+	velm::spatial_grid<float, 3> grid(radius);
+	r.run("grid_build", "velm_spatial_grid", "float", 3, particles, [&] {
+		grid.build(pts);
+		bench::do_not_optimize(grid);
+	});
+	cell_map map{1.f / radius, {}};
+	r.run("grid_build", "unordered_map", "float", 3, particles, [&] {
+		map.build(pts);
+		bench::do_not_optimize(map);
+	});
+
+	grid.build(pts);
+	map.build(pts);
+	r.run("grid_pairs", "velm_spatial_grid", "float", 3, particles, [&] {
+		std::size_t found = 0;
+		grid.for_each_pair([&] (std::uint32_t, std::uint32_t, float) {
+			++found;
+		});
+		bench::do_not_optimize(found);
+	});
+	r.run("grid_pairs", "unordered_map", "float", 3, particles, [&] {
+		bench::do_not_optimize(map.pairs(pts));
+	});
+
+	// jitter back and forth, so the particles stay put over many steps
+	std::vector<vec> step(particles);
+	std::uniform_real_distribution<float> jitter(-0.01f * radius, 0.01f * radius);
+	for(auto&& s : step) {
+		s = vec(jitter(rng), jitter(rng), jitter(rng));
+	}
+	bool forward = true;
+	r.run("grid_update", "velm_spatial_grid", "float", 3, particles, [&] {
+		for(std::size_t i = 0; i < particles; ++i) {
+			pts[i] = forward ? pts[i] + step[i] : pts[i] - step[i];
+		}
+		forward = !forward;
+		grid.update(pts);
+		bench::do_not_optimize(grid);
+	});
+}
@@ -0,0 +1,79 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/hash.hpp"
+#include "velm/flat_hash.hpp"
+
+/*
+ * A sparse voxel grid: velm::flat_hash_map (velm_flat) against
+ * std::unordered_map (std_unordered), both keyed on velm::vector<int32_t, 3>
+ * with the std::hash of hash.hpp. insert builds a map of keys voxels from
+ * empty, find looks up each voxel (all present) and find_miss as many absent
+ * ones. Each op is one key.
+ */
+
+namespace {
+
+using ivec3 = velm::vector<std::int32_t, 3>;
+
+// 2^20 keys, large enough that neither table fits in cache
+constexpr std::size_t keys = std::size_t(1) << 20;
+
+std::vector<ivec3> make_voxels(std::uint32_t seed, std::int32_t lo, std::int32_t hi)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<std::int32_t> dist(lo, hi);
+
+	std::vector<ivec3> out(keys);
+	for(auto&& v : out) {
+		v = ivec3(dist(rng), dist(rng), dist(rng));
+	}
+	return out;
+}
+
+template <typename Map>
+void map_suite(bench::runner& r, const char* impl, const std::vector<ivec3>& present, const std::vector<ivec3>& absent)
+{
+	r.run("hash_insert", impl, "int", 3, keys, [&] {
+		Map m;
+		for(std::size_t i = 0; i < keys; ++i) {
+			m[present[i]] = static_cast<std::int32_t>(i);
+		}
+		bench::do_not_optimize(m.size());
+	});
+
+	Map m;
+	for(std::size_t i = 0; i < keys; ++i) {
+		m[present[i]] = static_cast<std::int32_t>(i);
+	}
+	r.run("hash_find", impl, "int", 3, keys, [&] {
+		std::int32_t sum = 0;
+		for(auto&& k : present) {
+			sum += m.find(k)->second;
+		}
+		bench::do_not_optimize(sum);
+	});
+	r.run("hash_find_miss", impl, "int", 3, keys, [&] {
+		std::size_t found = 0;
+		for(auto&& k : absent) {
+			found += m.find(k) != m.end();
+		}
+		bench::do_not_optimize(found);
+	});
+}
+
+} // namespace
+
+void register_hash(bench::runner& r)
+{
+	// the absent keys are outside the range of the present ones
+	const std::vector<ivec3> present = make_voxels(42, -512, 511);
+	const std::vector<ivec3> absent = make_voxels(43, 1024, 2047);
+
+	map_suite<velm::flat_hash_map<ivec3, std::int32_t>>(r, "velm_flat", present, absent);
+	map_suite<std::unordered_map<ivec3, std::int32_t>>(r, "std_unordered", present, absent);
+}
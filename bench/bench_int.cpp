@@ -0,0 +1,9 @@
+#include "vector_suite.hpp"
+
+void register_int(bench::runner& r)
+{
+	bench::vector_suite<int, 2>(r, "int");
+	bench::vector_suite<int, 3>(r, "int");
+	bench::vector_suite<int, 4>(r, "int");
+	bench::vector_suite<int, 8>(r, "int");
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/kdtree.hpp"
+
+/*
+ * k-d tree queries against brute force, over uniform random points in the
+ * unit cube, for 10^6 and 10^7 points. Set VELM_BENCH_KDTREE_POINTS to raise
+ * the limit (e.g. to 100000000, which needs about 5 GB of memory) or lower
+ * it. The size is part of the group name, e.g. knn8_1e6.
+ *
+ * knn8 finds the 8 nearest neighbours and radius the points within 0.01 of
+ * random queries, and each op is one query. kdtree_build builds the tree,
+ * and each op is one point.
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+using tree_type = velm::kdtree<float, 3>;
+using neighbour = tree_type::neighbour;
+
+constexpr std::size_t k = 8;
+constexpr float radius = 0.01f;
+constexpr std::size_t queries = 1024;
+
+velm::vector_array<float, 3> make_points(std::size_t n, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> dist(0, 1);
+
+	velm::vector_array<float, 3> out(n);
+	for(unsigned int c = 0; c < 3; ++c) {
+		float* lane = out.lane(c);
+		for(std::size_t i = 0; i < n; ++i) {
+			lane[i] = dist(rng);
+		}
+	}
+	return out;
+}
+
+// distances of a block of points to q, then a heap of the best k
+std::size_t brute_knn(const velm::vector_array<float, 3>& pts, const vec& q, neighbour* out)
+{
+	const auto further = [] (const neighbour& a, const neighbour& b) {
+		return a.distance2 < b.distance2;
+	};
+	const float* x = pts.lane(0);
+	const float* y = pts.lane(1);
+	const float* z = pts.lane(2);
+
+	std::size_t count = 0;
+	float bound = std::numeric_limits<float>::infinity();
+	float d2[256];
+	for(std::size_t base = 0; base < pts.size(); base += 256) {
+		const std::size_t len = std::min<std::size_t>(256, pts.size() - base);
+		for(std::size_t i = 0; i < len; ++i) {
+			const float dx = x[base + i] - q[0];
+			const float dy = y[base + i] - q[1];
+			const float dz = z[base + i] - q[2];
+			d2[i] = dx * dx + dy * dy + dz * dz;
+		}
+		for(std::size_t i = 0; i < len; ++i) {
+			if(d2[i] < bound) {
+				if(count < k) {
+					out[count++] = {static_cast<std::uint32_t>(base + i), d2[i]};
+					std::push_heap(out, out + count, further);
+				} else {
+					std::pop_heap(out, out + count, further);
+					out[count - 1] = {static_cast<std::uint32_t>(base + i), d2[i]};
+					std::push_heap(out, out + count, further);
+				}
+				if(count == k) {
+					bound = out[0].distance2;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+std::size_t brute_radius(const velm::vector_array<float, 3>& pts, const vec& q)
+{
+	const float* x = pts.lane(0);
+	const float* y = pts.lane(1);
+	const float* z = pts.lane(2);
+	const float r2 = radius * radius;
+
+	std::size_t found = 0;
+	for(std::size_t i = 0; i < pts.size(); ++i) {
+		const float dx = x[i] - q[0];
+		const float dy = y[i] - q[1];
+		const float dz = z[i] - q[2];
+		found += (dx * dx + dy * dy + dz * dz) <= r2;
+	}
+	return found;
+}
+
+void kdtree_case(bench::runner& r, std::size_t n, const std::string& size)
+{
+	const std::string knn_group = "knn8_" + size;
+	const std::string radius_group = "radius_" + size;
+	const std::string build_group = "kdtree_build_" + size;
+	if(!r.selected(knn_group, "velm_kdtree", "float", 3) && !r.selected(knn_group, "brute_force", "float", 3)
+		&& !r.selected(radius_group, "velm_kdtree", "float", 3) && !r.selected(radius_group, "brute_force", "float", 3)
+		&& !r.selected(build_group, "velm", "float", 3)) {
+		return;
+	}
+
+	const velm::vector_array<float, 3> pts = make_points(n, 42);
+	const velm::vector_array<float, 3> qs = make_points(queries, 7);
+
+	r.run(build_group, "velm", "float", 3, n, [&] {
+		tree_type built(pts);
+		bench::do_not_optimize(built);
+	});
+
+	const tree_type tree(pts);
+	std::vector<neighbour> out(queries * k);
+
+	r.run(knn_group, "velm_kdtree", "float", 3, queries, [&] {
+		tree.batch_knn(qs, k, out.data());
+		bench::do_not_optimize(out[0]);
+	});
+	// brute force is slow, so it answers the first few queries only
+	const std::size_t brute_queries = n <= 1000000 ? 16 : 4;
+	r.run(knn_group, "brute_force", "float", 3, brute_queries, [&] {
+		for(std::size_t i = 0; i < brute_queries; ++i) {
+			brute_knn(pts, qs[i], out.data() + i * k);
+		}
+		bench::do_not_optimize(out[0]);
+	});
+
+	std::vector<neighbour> found;
+	r.run(radius_group, "velm_kdtree", "float", 3, queries, [&] {
+		std::size_t total = 0;
+		for(std::size_t i = 0; i < queries; ++i) {
+			tree.radius(qs[i], radius, found);
+			total += found.size();
+		}
+		bench::do_not_optimize(total);
+	});
+	r.run(radius_group, "brute_force", "float", 3, brute_queries, [&] {
+		std::size_t total = 0;
+		for(std::size_t i = 0; i < brute_queries; ++i) {
+			total += brute_radius(pts, qs[i]);
+		}
+		bench::do_not_optimize(total);
+	});
+}
+
+} // namespace
+
+void register_kdtree(bench::runner& r)
+{
+	std::size_t limit = 10000000;
+	if(const char* env = std::getenv("VELM_BENCH_KDTREE_POINTS")) {
+		limit = static_cast<std::size_t>(std::strtoull(env, nullptr, 10));
+	}
+
+	const struct { std::size_t n; const char* name; } sizes[] = {
+		{1000000, "1e6"},
+		{10000000, "1e7"},
+		{100000000, "1e8"},
+	};
+	for(auto&& s : sizes) {
+		if(s.n <= limit) {
+			kdtree_case(r, s.n, s.name);
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include "vector_suite.hpp"
+#include "velm/lazy.hpp"
+
+/*
+ * Lazy vs eager evaluation of a * s + b * t - c, which creates a temporary
+ * vector after every operator when evaluated eagerly.
+ */
+
+namespace {
+
+template <typename T, unsigned int N>
+void axpy_suite(bench::runner& r, const char* type)
+{
+	using bench::count;
+	using vec = velm::vector<T, N>;
+	using raw = std::array<T, N>;
+
+	const bench::fixture<bench::velm_impl<T, N>, T> fix(N);
+	const T s = fix.s;
+	const T t = T(1) / fix.s;
+
+	std::unique_ptr<raw[]> raw_a(new raw[count]);
+	std::unique_ptr<raw[]> raw_b(new raw[count]);
+	for(std::size_t i = 0; i < count; ++i) {
+		for(unsigned int k = 0; k < N; ++k) {
+			raw_a[i][k] = fix.a[i][k];
+			raw_b[i][k] = fix.b[i][k];
+		}
+	}
+
+	std::unique_ptr<raw[]> raw_out(new raw[count]);
+	r.run("axpy", "raw", type, N, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			const raw& c = raw_a[count - 1 - i];
+			for(unsigned int k = 0; k < N; ++k) {
+				raw_out[i][k] = raw_a[i][k] * s + raw_b[i][k] * t - c[k];
+			}
+		}
+		bench::do_not_optimize(raw_out[count - 1]);
+	});
+
+	std::unique_ptr<vec[]> out(new vec[count]);
+	r.run("axpy", "velm", type, N, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			out[i] = fix.a[i] * s + fix.b[i] * t - fix.a[count - 1 - i];
+		}
+		bench::do_not_optimize(out[count - 1]);
+	});
+
+	r.run("axpy", "velm_lazy", type, N, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			out[i] = velm::lazy(fix.a[i]) * s + fix.b[i] * t - fix.a[count - 1 - i];
+		}
+		bench::do_not_optimize(out[count - 1]);
+	});
+}
+
+} // namespace
+
+void register_lazy(bench::runner& r)
+{
+	axpy_suite<float, 3>(r, "float");
+	axpy_suite<float, 4>(r, "float");
+	axpy_suite<double, 3>(r, "double");
+	axpy_suite<double, 4>(r, "double");
+}
@@ -0,0 +1,119 @@
+#include <cstddef>
+#include <memory>
+#include <random>
+
+#include "vector_suite.hpp"
+#include "velm/matrix.hpp"
+
+/*
+ * 4x4 float matrix products and transforms, against loops over column-major
+ * float[16] arrays.
+ */
+
+namespace {
+
+using mat4 = velm::matrix<float, 4, 4>;
+using vec4 = velm::vector<float, 4>;
+using vec3 = velm::vector<float, 3>;
+
+struct raw_mat4
+{
+	float m[16];
+};
+
+raw_mat4 raw_mul(const raw_mat4& a, const raw_mat4& b)
+{
+	raw_mat4 out;
+	for(unsigned int c = 0; c < 4; ++c) {
+		for(unsigned int r = 0; r < 4; ++r) {
+			float sum = a.m[r] * b.m[c * 4];
+			for(unsigned int k = 1; k < 4; ++k) {
+				sum += a.m[k * 4 + r] * b.m[c * 4 + k];
+			}
+			out.m[c * 4 + r] = sum;
+		}
+	}
+	return out;
+}
+
+} // namespace
+
+void register_matrix(bench::runner& r)
+{
+	using bench::count;
+
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<float> dist(-9.f, 9.f);
+
+	std::unique_ptr<mat4[]> a(new mat4[count]);
+	std::unique_ptr<mat4[]> b(new mat4[count]);
+	std::unique_ptr<raw_mat4[]> raw_a(new raw_mat4[count]);
+	std::unique_ptr<raw_mat4[]> raw_b(new raw_mat4[count]);
+	std::unique_ptr<vec4[]> v(new vec4[count]);
+	std::unique_ptr<vec3[]> p(new vec3[count]);
+	for(std::size_t i = 0; i < count; ++i) {
+		for(unsigned int k = 0; k < 16; ++k) {
+			a[i][k / 4][k % 4] = raw_a[i].m[k] = dist(rng);
+			b[i][k / 4][k % 4] = raw_b[i].m[k] = dist(rng);
+		}
+		for(unsigned int k = 0; k < 4; ++k) {
+			v[i][k] = dist(rng);
+		}
+		p[i] = vec3(v[i][0], v[i][1], v[i][2]);
+	}
+
+	std::unique_ptr<raw_mat4[]> raw_out(new raw_mat4[count]);
+	r.run("mat4_mul", "raw", "float", 4, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			raw_out[i] = raw_mul(raw_a[i], raw_b[i]);
+		}
+		bench::do_not_optimize(raw_out[count - 1]);
+	});
+
+	std::unique_ptr<mat4[]> out(new mat4[count]);
+	r.run("mat4_mul", "velm", "float", 4, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			out[i] = a[i] * b[i];
+		}
+		bench::do_not_optimize(out[count - 1]);
+	});
+
+	// one matrix applied to every vector
+	std::unique_ptr<vec4[]> raw_vout(new vec4[count]);
+	r.run("mat4_transform", "raw", "float", 4, count, [&] {
+		const float* m = raw_a[0].m;
+		for(std::size_t i = 0; i < count; ++i) {
+			for(unsigned int k = 0; k < 4; ++k) {
+				raw_vout[i][k] = m[k] * v[i][0] + m[4 + k] * v[i][1] + m[8 + k] * v[i][2] + m[12 + k] * v[i][3];
+			}
+		}
+		bench::do_not_optimize(raw_vout[count - 1]);
+	});
+
+	std::unique_ptr<vec4[]> vout(new vec4[count]);
+	r.run("mat4_transform", "velm", "float", 4, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			vout[i] = a[0] * v[i];
+		}
+		bench::do_not_optimize(vout[count - 1]);
+	});
+
+	r.run("mat4_transform", "velm_batch", "float", 4, count, [&] {
+		velm::batch::transform(a[0], velm::batch::span<const vec4>(v.get(), count), velm::batch::span<vec4>(vout.get(), count));
+		bench::do_not_optimize(vout[count - 1]);
+	});
+
+	std::unique_ptr<vec3[]> pout(new vec3[count]);
+	r.run("mat4_transform_points", "velm", "float", 3, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			const vec4 t = a[0] * vec4(p[i][0], p[i][1], p[i][2], 1.f);
+			pout[i] = vec3(t[0], t[1], t[2]);
+		}
+		bench::do_not_optimize(pout[count - 1]);
+	});
+
+	r.run("mat4_transform_points", "velm_batch", "float", 3, count, [&] {
+		velm::batch::transform_points(a[0], velm::batch::span<const vec3>(p.get(), count), velm::batch::span<vec3>(pout.get(), count));
+		bench::do_not_optimize(pout[count - 1]);
+	});
+}
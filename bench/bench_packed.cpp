@@ -0,0 +1,78 @@
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/packed.hpp"
+
+/*
+ * Converting 2^20 vectors of float to and from storage formats (see
+ * velm/packed.hpp). Each op is one vector.
+ *
+ * velm_encode and velm_decode are velm::batch::encode and decode, which
+ * convert contiguous components as one flat loop, using F16C for half when
+ * the CPU has it. scalar converts one vector at a time, through the vector
+ * conversions of the formats, in a loop which is not recompiled for AVX2.
+ * The groups are half (vector<half, 3>), snorm16 (vector<snorm16, 3>) and
+ * oct32 (unit normals).
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+
+constexpr std::size_t count = std::size_t(1) << 20;
+
+template <typename P>
+void run_format(bench::runner& r, const char* group, const std::vector<vec>& in)
+{
+	std::vector<P> packed(count);
+	std::vector<vec> out(count);
+
+	r.run(group, "velm_encode", "float", 3, count, [&] {
+		velm::batch::encode(in, packed);
+		bench::do_not_optimize(packed[0]);
+	});
+	r.run(group, "scalar_encode", "float", 3, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			packed[i] = static_cast<P>(in[i]);
+		}
+		bench::do_not_optimize(packed[0]);
+	});
+	r.run(group, "velm_decode", "float", 3, count, [&] {
+		velm::batch::decode(packed, out);
+		bench::do_not_optimize(out[0]);
+	});
+	r.run(group, "scalar_decode", "float", 3, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			out[i] = static_cast<vec>(packed[i]);
+		}
+		bench::do_not_optimize(out[0]);
+	});
+}
+
+} // namespace
+
+void register_packed(bench::runner& r)
+{
+	bool any = false;
+	for(const char* group : {"packed_half", "packed_snorm16", "packed_oct32"}) {
+		for(const char* impl : {"velm_encode", "scalar_encode", "velm_decode", "scalar_decode"}) {
+			any = any || r.selected(group, impl, "float", 3);
+		}
+	}
+	if(!any) {
+		return;
+	}
+
+	std::mt19937 rng(25);
+	std::normal_distribution<float> dist(0, 1);
+	std::vector<vec> in(count);
+	for(auto&& p : in) {
+		p = velm::normalize(vec(dist(rng), dist(rng), dist(rng)));
+	}
+
+	run_format<velm::vector<velm::half, 3>>(r, "packed_half", in);
+	run_format<velm::vector<velm::snorm16, 3>>(r, "packed_snorm16", in);
+	run_format<velm::oct32>(r, "packed_oct32", in);
+}
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+
+#include "vector_suite.hpp"
+#include "velm/quaternion.hpp"
+
+/*
+ * Rotating vectors by quaternions, directly and through a rotation matrix,
+ * and interpolating between quaternions.
+ */
+
+namespace {
+
+using quat = velm::quaternion<float>;
+using vec3 = velm::vector<float, 3>;
+
+} // namespace
+
+void register_quaternion(bench::runner& r)
+{
+	using bench::count;
+
+	std::mt19937 rng(5);
+	std::normal_distribution<float> dist;
+
+	std::unique_ptr<quat[]> a(new quat[count]);
+	std::unique_ptr<quat[]> b(new quat[count]);
+	std::unique_ptr<vec3[]> v(new vec3[count]);
+	std::unique_ptr<float[]> t(new float[count]);
+	for(std::size_t i = 0; i < count; ++i) {
+		a[i] = velm::normalize(quat(dist(rng), dist(rng), dist(rng), dist(rng)));
+		b[i] = velm::normalize(quat(dist(rng), dist(rng), dist(rng), dist(rng)));
+		v[i] = vec3(dist(rng), dist(rng), dist(rng));
+		t[i] = std::abs(dist(rng)) / 4;
+	}
+
+	velm::batch::span<const quat> qa(a.get(), count);
+	velm::batch::span<const quat> qb(b.get(), count);
+	velm::batch::span<const vec3> vs(v.get(), count);
+	velm::batch::span<const float> ts(t.get(), count);
+
+	// each vector by its own rotation
+	std::unique_ptr<vec3[]> vout(new vec3[count]);
+	r.run("quat_rotate", "velm", "float", 3, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			vout[i] = a[i] * v[i];
+		}
+		bench::do_not_optimize(vout[count - 1]);
+	});
+
+	r.run("quat_rotate", "velm_matrix", "float", 3, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			vout[i] = velm::mat3_cast(a[i]) * v[i];
+		}
+		bench::do_not_optimize(vout[count - 1]);
+	});
+
+	r.run("quat_rotate", "velm_batch", "float", 3, count, [&] {
+		velm::batch::rotate(qa, vs, velm::batch::span<vec3>(vout.get(), count));
+		bench::do_not_optimize(vout[count - 1]);
+	});
+
+	std::unique_ptr<quat[]> qout(new quat[count]);
+	r.run("quat_mul", "velm", "float", 4, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			qout[i] = a[i] * b[i];
+		}
+		bench::do_not_optimize(qout[count - 1]);
+	});
+
+	r.run("nlerp", "velm", "float", 4, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			qout[i] = velm::nlerp(a[i], b[i], t[i]);
+		}
+		bench::do_not_optimize(qout[count - 1]);
+	});
+
+	r.run("nlerp", "velm_batch", "float", 4, count, [&] {
+		velm::batch::nlerp(qa, qb, ts, velm::batch::span<quat>(qout.get(), count));
+		bench::do_not_optimize(qout[count - 1]);
+	});
+
+	r.run("slerp", "velm", "float", 4, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			qout[i] = velm::slerp(a[i], b[i], t[i]);
+		}
+		bench::do_not_optimize(qout[count - 1]);
+	});
+
+	r.run("slerp", "velm_batch", "float", 4, count, [&] {
+		velm::batch::slerp(qa, qb, ts, velm::batch::span<quat>(qout.get(), count));
+		bench::do_not_optimize(qout[count - 1]);
+	});
+}
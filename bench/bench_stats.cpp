@@ -0,0 +1,104 @@
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/stats.hpp"
+
+/*
+ * Bounds, centroid and covariance of 2^22 points, which is bound by memory
+ * bandwidth, so each benchmark also reports gb_per_second over the 12 bytes
+ * of each point. Each op is one point.
+ *
+ * velm_stats is velm::stats over a vector_array and velm_stats_aos over a
+ * std::vector of vectors, with velm_stats_par running on the thread pool
+ * (see velm/exec.hpp). welford adds the points to a point_stats one at a
+ * time, and two_pass is the textbook loop, finding the bounds and mean in one
+ * pass over the points and the covariance in another.
+ */
+
+namespace {
+
+using vec = velm::vector<float, 3>;
+
+constexpr std::size_t points = std::size_t(1) << 22;
+constexpr std::size_t bytes = points * sizeof(vec);
+
+struct two_pass_result
+{
+	vec lo;
+	vec hi;
+	vec mean;
+	float cov[6];
+};
+
+two_pass_result two_pass(const std::vector<vec>& pts)
+{
+	two_pass_result out;
+	out.lo = pts[0];
+	out.hi = pts[0];
+	vec sum(0.f);
+	for(const vec& p : pts) {
+		out.lo = velm::min(out.lo, p);
+		out.hi = velm::max(out.hi, p);
+		sum += p;
+	}
+	out.mean = sum / float(pts.size());
+
+	float cov[6] = {};
+	for(const vec& p : pts) {
+		const vec d = p - out.mean;
+		cov[0] += d[0] * d[0];
+		cov[1] += d[0] * d[1];
+		cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1];
+		cov[4] += d[1] * d[2];
+		cov[5] += d[2] * d[2];
+	}
+	for(unsigned int i = 0; i < 6; ++i) {
+		out.cov[i] = cov[i] / float(pts.size());
+	}
+	return out;
+}
+
+} // namespace
+
+void register_stats(bench::runner& r)
+{
+	bool any = false;
+	for(const char* impl : {"velm_stats", "velm_stats_aos", "velm_stats_par", "welford", "two_pass"}) {
+		any = any || r.selected("point_stats", impl, "float", 3);
+	}
+	if(!any) {
+		return;
+	}
+
+	std::mt19937 rng(23);
+	std::normal_distribution<float> dist(0, 1);
+	std::vector<vec> pts(points);
+	velm::vector_array<float, 3> arr(points);
+	for(std::size_t i = 0; i < points; ++i) {
+		pts[i] = vec(100.f + 5.f * dist(rng), -20.f + 2.f * dist(rng), 0.5f * dist(rng));
+		arr[i] = pts[i];
+	}
+
+	r.run("point_stats", "velm_stats", "float", 3, points, bytes, [&] {
+		bench::do_not_optimize(velm::stats(arr));
+	});
+	r.run("point_stats", "velm_stats_aos", "float", 3, points, bytes, [&] {
+		bench::do_not_optimize(velm::stats(pts));
+	});
+	r.run("point_stats", "velm_stats_par", "float", 3, points, bytes, [&] {
+		bench::do_not_optimize(velm::stats(velm::exec::par, arr));
+	});
+	r.run("point_stats", "welford", "float", 3, points, bytes, [&] {
+		velm::point_stats<float, 3> s;
+		for(const vec& p : pts) {
+			s.add(p);
+		}
+		bench::do_not_optimize(s);
+	});
+	r.run("point_stats", "two_pass", "float", 3, points, bytes, [&] {
+		bench::do_not_optimize(two_pass(pts));
+	});
+}
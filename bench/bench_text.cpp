@@ -0,0 +1,74 @@
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/text.hpp"
+#include "velm/vector_array.hpp"
+
+/*
+ * Reading and writing the vertices of an OBJ file ("v x y z" per line) with
+ * velm::parse_lines and velm::format_lines (velm), against the usual
+ * std::istringstream >> and std::ostringstream << loops (iostream). Each op is
+ * one vertex.
+ */
+
+namespace {
+
+std::string make_obj()
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-100, 100);
+
+	std::ostringstream out;
+	out.precision(6);
+	for(std::size_t i = 0; i < bench::count; ++i) {
+		out << "v " << dist(rng) << ' ' << dist(rng) << ' ' << dist(rng) << '\n';
+	}
+	return out.str();
+}
+
+} // namespace
+
+void register_text(bench::runner& r)
+{
+	using bench::count;
+	using vec = velm::vector<float, 3>;
+
+	const std::string obj = make_obj();
+
+	velm::vector_array<float, 3> verts;
+	verts.reserve(count);
+	r.run("parse_obj", "velm", "float", 3, count, [&] {
+		verts.clear();
+		velm::parse_lines(obj.data(), obj.data() + obj.size(), verts, "v");
+		bench::do_not_optimize(verts.size());
+	});
+	r.run("parse_obj", "iostream", "float", 3, count, [&] {
+		verts.clear();
+		std::istringstream in(obj);
+		std::string tag;
+		vec v;
+		while(in >> tag >> v[0] >> v[1] >> v[2]) {
+			verts.push_back(v);
+		}
+		bench::do_not_optimize(verts.size());
+	});
+
+	// a float takes at most 15 characters, so a line at most 50
+	std::vector<char> buf(count * 64);
+	r.run("format_obj", "velm", "float", 3, count, [&] {
+		velm::format_result res = velm::format_lines(buf.data(), buf.data() + buf.size(), verts, "v");
+		bench::do_not_optimize(res.ptr);
+	});
+	r.run("format_obj", "iostream", "float", 3, count, [&] {
+		std::ostringstream out;
+		out.precision(9);
+		for(auto&& v : verts) {
+			out << "v " << v[0] << ' ' << v[1] << ' ' << v[2] << '\n';
+		}
+		bench::do_not_optimize(out.tellp());
+	});
+}
@@ -0,0 +1,93 @@
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "vector_suite.hpp"
+#include "velm/view.hpp"
+#include "velm/vector_array.hpp"
+
+/*
+ * Processing one attribute of interleaved vertices in place through a
+ * strided_view (velm_view), against copying it into velm::vectors and back
+ * (velm_copy), which is what had to be done without views. Each op is one
+ * vertex.
+ */
+
+namespace {
+
+struct vertex
+{
+	float pos[3];
+	float normal[3];
+	float uv[2];
+};
+
+std::vector<vertex> make_vertices()
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> dist(-1, 1);
+
+	std::vector<vertex> verts(bench::count);
+	for(auto&& v : verts) {
+		for(unsigned int k = 0; k < 3; ++k) {
+			v.pos[k] = dist(rng);
+			v.normal[k] = dist(rng);
+		}
+		v.uv[0] = dist(rng);
+		v.uv[1] = dist(rng);
+	}
+	return verts;
+}
+
+} // namespace
+
+void register_view(bench::runner& r)
+{
+	using bench::count;
+	using vec = velm::vector<float, 3>;
+
+	std::vector<vertex> verts = make_vertices();
+	std::vector<vec> staging(count);
+
+	r.run("normalize_interleaved", "velm_copy", "float", 3, count, [&] {
+		for(std::size_t i = 0; i < count; ++i) {
+			staging[i] = vec(verts[i].normal[0], verts[i].normal[1], verts[i].normal[2]);
+		}
+		for(auto&& n : staging) {
+			n = velm::normalize(n);
+		}
+		for(std::size_t i = 0; i < count; ++i) {
+			for(unsigned int k = 0; k < 3; ++k) {
+				verts[i].normal[k] = staging[i][k];
+			}
+		}
+		bench::do_not_optimize(verts[count - 1]);
+	});
+	r.run("normalize_interleaved", "velm_view", "float", 3, count, [&] {
+		velm::strided_view<float, 3> normals(verts.data(), count, sizeof(vertex), offsetof(vertex, normal));
+		velm::array_transform(normals, [] (auto&& n) { return velm::normalize(n); }, normals);
+		bench::do_not_optimize(verts[count - 1]);
+	});
+
+	r.run("translate_interleaved", "velm_copy", "float", 3, count, [&] {
+		const vec offset(1, 2, 3);
+		for(std::size_t i = 0; i < count; ++i) {
+			staging[i] = vec(verts[i].pos[0], verts[i].pos[1], verts[i].pos[2]);
+		}
+		for(auto&& p : staging) {
+			p += offset;
+		}
+		for(std::size_t i = 0; i < count; ++i) {
+			for(unsigned int k = 0; k < 3; ++k) {
+				verts[i].pos[k] = staging[i][k];
+			}
+		}
+		bench::do_not_optimize(verts[count - 1]);
+	});
+	r.run("translate_interleaved", "velm_view", "float", 3, count, [&] {
+		const vec offset(1, 2, 3);
+		velm::strided_view<float, 3> positions(verts.data(), count, sizeof(vertex), offsetof(vertex, pos));
+		velm::array_transform(positions, [] (auto&& p, auto&& o) { return p + o; }, positions, offset);
+		bench::do_not_optimize(verts[count - 1]);
+	});
+}
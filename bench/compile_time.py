@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Compile-time benchmark for velm.
+
+Generates a translation unit which instantiates velm::vector<T, N> for many
+component types T and dimensions N, and measures the compiler front end on it
+(-fsyntax-only): wall time and peak memory. Each case is also compiled with
+only the #include, so the cost of instantiating the vector types can be
+separated from the cost of parsing the headers.
+
+Cases are run with the default configuration and with swizzle members
+disabled (VELM_SWIZZLE_MEMBERS=0, see velm/base.hpp).
+
+    python3 bench/compile_time.py
+    python3 bench/compile_time.py --types=32 --dims=2,3,4 --out=compile.json
+
+Results are printed as JSON. Peak memory needs the resource module, so it is
+only reported on POSIX systems.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+try:
+	import resource
+except ImportError:
+	resource = None
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+INCLUDE = os.path.join(HERE, '..', 'include')
+
+CONFIGS = [
+	('swizzle_members', []),
+	('no_swizzle_members', ['VELM_SWIZZLE_MEMBERS=0']),
+]
+
+def generate(types, dims, instantiate):
+	lines = ['#include <velm.hpp>', '']
+	if not instantiate:
+		return '\n'.join(lines) + '\n'
+
+	# distinct types, so that nothing is shared between instantiations
+	for i in range(types):
+		lines.append('struct component%d { float value; };' % i)
+	lines.append('')
+
+	names = ['float', 'double', 'int'] + ['component%d' % i for i in range(types)]
+	for name in names:
+		for n in dims:
+			lines.append('static_assert(sizeof(velm::vector<%s, %d>) > 0, "");' % (name, n))
+	return '\n'.join(lines) + '\n'
+
+def compile_once(compiler, std, defines, path):
+	cmd = [compiler, '-std=' + std, '-fsyntax-only', '-I' + INCLUDE]
+	cmd += ['-D' + d for d in defines]
+	cmd.append(path)
+
+	start = time.perf_counter()
+	proc = subprocess.Popen(cmd, stderr=subprocess.PIPE)
+	# read everything first, so the compiler cannot block on a full pipe
+	err = proc.stderr.read().decode(errors='replace')
+	proc.stderr.close()
+	if resource is not None:
+		_, status, usage = os.wait4(proc.pid, 0)
+		elapsed = time.perf_counter() - start
+		# ru_maxrss is in kilobytes on Linux, bytes on macOS
+		scale = 1 if sys.platform == 'darwin' else 1024
+		peak = usage.ru_maxrss * scale
+		proc.returncode = status
+	else:
+		proc.wait()
+		elapsed = time.perf_counter() - start
+		peak = None
+
+	if proc.returncode != 0:
+		sys.stderr.write(' '.join(cmd) + '\n' + err)
+		sys.exit(1)
+	return elapsed, peak
+
+def measure(args, defines, source):
+	with tempfile.TemporaryDirectory() as tmp:
+		path = os.path.join(tmp, 'instantiate.cpp')
+		with open(path, 'w') as f:
+			f.write(source)
+
+		best_time = None
+		best_peak = None
+		for _ in range(args.repetitions):
+			elapsed, peak = compile_once(args.compiler, args.std, defines, path)
+			best_time = elapsed if best_time is None else min(best_time, elapsed)
+			if peak is not None:
+				best_peak = peak if best_peak is None else min(best_peak, peak)
+		return best_time, best_peak
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+	parser.add_argument('--compiler', default=os.environ.get('CXX', 'c++'))
+	parser.add_argument('--std', default='c++14')
+	parser.add_argument('--types', type=int, default=16,
+		help='number of distinct component types, in addition to float, double and int')
+	parser.add_argument('--dims', default='2,3,4',
+		help='comma-separated dimensions to instantiate for each type')
+	parser.add_argument('--define', action='append', default=[],
+		help='extra macro definition for every case, e.g. VELM_SIMD=0')
+	parser.add_argument('--repetitions', type=int, default=3)
+	parser.add_argument('--out', help='write results to this file instead of stdout')
+	args = parser.parse_args()
+
+	dims = [int(d) for d in args.dims.split(',') if d]
+	instantiations = (args.types + 3) * len(dims)
+
+	results = []
+	for name, defines in CONFIGS:
+		defines = defines + args.define
+		base_time, base_peak = measure(args, defines, generate(args.types, dims, False))
+		full_time, full_peak = measure(args, defines, generate(args.types, dims, True))
+
+		entry = {
+			'name': name,
+			'defines': defines,
+			'instantiations': instantiations,
+			'seconds': full_time,
+			'include_seconds': base_time,
+			'ms_per_instantiation': (full_time - base_time) * 1000 / instantiations,
+		}
+		if full_peak is not None:
+			entry['peak_mb'] = full_peak / (1024 * 1024)
+			entry['include_peak_mb'] = base_peak / (1024 * 1024)
+			entry['kb_per_instantiation'] = (full_peak - base_peak) / 1024 / instantiations
+		results.append(entry)
+
+	output = {
+		'context': {
+			'compiler': args.compiler,
+			'std': args.std,
+			'types': args.types,
+			'dims': dims,
+			'repetitions': args.repetitions,
+		},
+		'benchmarks': results,
+	}
+
+	text = json.dumps(output, indent=2) + '\n'
+	if args.out:
+		with open(args.out, 'w') as f:
+			f.write(text)
+	else:
+		sys.stdout.write(text)
+
+if __name__ == '__main__':
+	main()
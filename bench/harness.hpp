@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \file harness.hpp
+ * \brief minimal self-contained micro-benchmark harness
+ *
+ * Each benchmark is a function which processes a fixed number of elements per
+ * call. The runner calibrates the number of calls so that a run takes at
+ * least min_time seconds, repeats the run several times, and keeps the
+ * fastest, which is the least disturbed by the rest of the system.
+ *
+ * Results are printed as JSON:
+ *
+ *      {
+ *        "context": { "compiler": "...", "velm_simd": 1, ... },
+ *        "benchmarks": [
+ *          { "name": "add/velm/float/3", "group": "add", "impl": "velm",
+ *            "type": "float", "dimensions": 3, "iterations": 123,
+ *            "ns_per_op": 0.51, "elements_per_second": 1.9e9,
+ *            "relative_to_raw": 1.02 },
+ *          ...
+ *        ]
+ *      }
+ *
+ * An op is one vector operation (e.g. one a + b), and elements_per_second is
+ * the number of vectors processed per second. relative_to_raw is the ratio of
+ * ns_per_op to the raw std::array baseline of the same group, type and
+ * dimensions, when there is one. Benchmarks bound by memory also give the
+ * bytes they read per call, and report gb_per_second (10^9 bytes).
+ */
+
+namespace bench {
+
+/**
+ * \fn do_not_optimize
+ * \brief force a value to be computed
+ */
+template <typename T>
+inline void do_not_optimize(const T& val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(val) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &val;
+#endif
+}
+
+/**
+ * \fn clobber_memory
+ * \brief force all writes to memory to happen
+ */
+inline void clobber_memory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : : "memory");
+#endif
+}
+
+struct result
+{
+	std::string group;
+	std::string impl;
+	std::string type;
+	unsigned int dimensions;
+	std::size_t iterations;
+	double ns_per_op;
+	double elements_per_second;
+	// 0 unless the bytes per call were given
+	double bytes_per_second;
+};
+
+class runner
+{
+public: // statics
+	using clock = std::chrono::steady_clock;
+
+private: // variables
+	std::string m_filter;
+	std::vector<std::pair<std::string, std::string>> m_context;
+	double m_min_time = 0.01;
+	unsigned int m_repetitions = 3;
+	std::vector<result> m_results;
+
+private: // internal
+	template <typename F>
+	static double time_calls(F& f, std::size_t calls)
+	{
+		auto start = clock::now();
+		for(std::size_t i = 0; i < calls; ++i) {
+			f();
+			clobber_memory();
+		}
+		auto end = clock::now();
+		return std::chrono::duration<double>(end - start).count();
+	}
+
+	static void print_string(std::FILE* out, const std::string& str)
+	{
+		std::fputc('"', out);
+		for(char c : str) {
+			if(c == '"' || c == '\\') {
+				std::fputc('\\', out);
+			}
+			std::fputc(c, out);
+		}
+		std::fputc('"', out);
+	}
+
+	const result* baseline_of(const result& res) const
+	{
+		for(auto&& other : m_results) {
+			if(other.impl == "raw" && other.group == res.group
+				&& other.type == res.type && other.dimensions == res.dimensions) {
+				return &other;
+			}
+		}
+		return nullptr;
+	}
+
+public: // methods
+	void filter(std::string pattern)
+	{
+		m_filter = std::move(pattern);
+	}
+
+	// add a number to the context section of the output
+	void context(std::string key, long long value)
+	{
+		m_context.emplace_back(std::move(key), std::to_string(value));
+	}
+
+	void min_time(double seconds)
+	{
+		m_min_time = seconds;
+	}
+
+	void repetitions(unsigned int count)
+	{
+		m_repetitions = std::max(count, 1u);
+	}
+
+	static std::string full_name(const std::string& group, const std::string& impl,
+		const std::string& type, unsigned int dimensions)
+	{
+		return group + "/" + impl + "/" + type + "/" + std::to_string(dimensions);
+	}
+
+	// whether run would time this benchmark, to skip preparing data for it
+	bool selected(const std::string& group, const std::string& impl,
+		const std::string& type, unsigned int dimensions) const
+	{
+		return m_filter.empty() || full_name(group, impl, type, dimensions).find(m_filter) != std::string::npos;
+	}
+
+	/**
+	 * \fn run
+	 * \brief time a benchmark
+	 *
+	 * f is called repeatedly, and must process elements vectors per call,
+	 * and read bytes bytes of memory if given.
+	 */
+	template <typename F>
+	void run(const std::string& group, const std::string& impl, const std::string& type,
+		unsigned int dimensions, std::size_t elements, F&& f)
+	{
+		this->run(group, impl, type, dimensions, elements, 0, f);
+	}
+
+	template <typename F>
+	void run(const std::string& group, const std::string& impl, const std::string& type,
+		unsigned int dimensions, std::size_t elements, std::size_t bytes, F&& f)
+	{
+		if(!this->selected(group, impl, type, dimensions)) {
+			return;
+		}
+
+		// warm up, then grow the number of calls until it takes long enough
+		std::size_t calls = 1;
+		time_calls(f, calls);
+		while(time_calls(f, calls) < m_min_time) {
+			calls *= 2;
+		}
+
+		double best = time_calls(f, calls);
+		for(unsigned int i = 1; i < m_repetitions; ++i) {
+			best = std::min(best, time_calls(f, calls));
+		}
+
+		const double ops = double(calls) * double(elements);
+		m_results.push_back({group, impl, type, dimensions, calls,
+			best * 1e9 / ops, ops / best, double(calls) * double(bytes) / best});
+	}
+
+	void print_json(std::FILE* out) const
+	{
+		std::fprintf(out, "{\n  \"context\": {\n");
+#if defined(__clang__)
+		std::fprintf(out, "    \"compiler\": \"clang %d.%d.%d\",\n", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+		std::fprintf(out, "    \"compiler\": \"gcc %d.%d.%d\",\n", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+		std::fprintf(out, "    \"compiler\": \"msvc %d\",\n", _MSC_VER);
+#else
+		std::fprintf(out, "    \"compiler\": \"unknown\",\n");
+#endif
+		for(auto&& entry : m_context) {
+			std::fprintf(out, "    ");
+			print_string(out, entry.first);
+			std::fprintf(out, ": %s,\n", entry.second.c_str());
+		}
+		std::fprintf(out, "    \"repetitions\": %u,\n", m_repetitions);
+		std::fprintf(out, "    \"min_time\": %g\n", m_min_time);
+		std::fprintf(out, "  },\n  \"benchmarks\": [");
+
+		for(std::size_t i = 0; i < m_results.size(); ++i) {
+			const result& res = m_results[i];
+			std::fprintf(out, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+			print_string(out, full_name(res.group, res.impl, res.type, res.dimensions));
+			std::fprintf(out, ", \"group\": ");
+			print_string(out, res.group);
+			std::fprintf(out, ", \"impl\": ");
+			print_string(out, res.impl);
+			std::fprintf(out, ", \"type\": ");
+			print_string(out, res.type);
+			std::fprintf(out, ", \"dimensions\": %u, \"iterations\": %zu, \"ns_per_op\": %.6g, \"elements_per_second\": %.6g",
+				res.dimensions, res.iterations, res.ns_per_op, res.elements_per_second);
+			if(res.bytes_per_second > 0) {
+				std::fprintf(out, ", \"gb_per_second\": %.4g", res.bytes_per_second * 1e-9);
+			}
+			if(const result* base = this->baseline_of(res)) {
+				std::fprintf(out, ", \"relative_to_raw\": %.4g", res.ns_per_op / base->ns_per_op);
+			}
+			std::fprintf(out, "}");
+		}
+
+		std::fprintf(out, "\n  ]\n}\n");
+	}
+};
+
+} // namespace bench
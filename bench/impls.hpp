@@ -0,0 +1,383 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "velm.hpp"
+#include "gvec.hpp"
+
+/**
+ * \file impls.hpp
+ * \brief common interface over the vector implementations being compared
+ *
+ * Each implementation is a class template over the component type and
+ * dimensions, with a vec type and static functions for every benchmarked
+ * operation. The benchmark bodies are written once against this interface.
+ *
+ *  - raw_impl: std::array with hand-written loops, the baseline
+ *  - gvec_impl: the union in gvec.hpp. Where gvec has no equivalent (dot,
+ *    relational functions, ...), the loop a gvec user would write is used.
+ *  - velm_impl: velm::vector with ops.hpp and funcs.hpp
+ *
+ * Comparison operators are lexicographic for raw and velm. gvec's operators
+ * are benchmarked as they are, even though == is inverted there.
+ */
+
+namespace bench {
+
+// swizzle width, reversed first min(N, 4) components
+template <unsigned int N>
+using swizzle_dims = std::integral_constant<unsigned int, (N < 4 ? N : 4)>;
+
+// conversion target for each component type
+template <typename T>
+using convert_target = std::conditional_t<std::is_same<T, float>::value, double, float>;
+
+// raw {{{
+
+template <typename T, unsigned int N>
+struct raw_impl
+{
+	static constexpr const char* name = "raw";
+
+	using vec = std::array<T, N>;
+	using bvec = std::array<bool, N>;
+	using svec = std::array<T, swizzle_dims<N>::value>;
+	using cvec = std::array<convert_target<T>, N>;
+
+	template <typename F>
+	static vec map(const vec& a, const vec& b, F f)
+	{
+		vec out;
+		for(unsigned int i = 0; i < N; ++i) {
+			out[i] = f(a[i], b[i]);
+		}
+		return out;
+	}
+
+	template <typename F>
+	static bvec test(const vec& a, const vec& b, F f)
+	{
+		bvec out;
+		for(unsigned int i = 0; i < N; ++i) {
+			out[i] = f(a[i], b[i]);
+		}
+		return out;
+	}
+
+	static vec broadcast(T s)
+	{
+		vec out;
+		out.fill(s);
+		return out;
+	}
+
+	static vec components(const vec& a)
+	{
+		vec out;
+		for(unsigned int i = 0; i < N; ++i) {
+			out[i] = a[i];
+		}
+		return out;
+	}
+
+	static svec swizzle_read(const vec& a)
+	{
+		svec out;
+		for(unsigned int i = 0; i < out.size(); ++i) {
+			out[i] = a[out.size() - 1 - i];
+		}
+		return out;
+	}
+
+	static void swizzle_write(vec& a, const vec& b)
+	{
+		constexpr unsigned int k = swizzle_dims<N>::value;
+		T tmp[k];
+		for(unsigned int i = 0; i < k; ++i) {
+			tmp[i] = b[i];
+		}
+		for(unsigned int i = 0; i < k; ++i) {
+			a[k - 1 - i] = tmp[i];
+		}
+	}
+
+	static vec pos(const vec& a) { return a; }
+	static vec neg(const vec& a) { return map(a, a, [] (T x, T) { return -x; }); }
+	static vec add(const vec& a, const vec& b) { return map(a, b, [] (T x, T y) { return x + y; }); }
+	static vec sub(const vec& a, const vec& b) { return map(a, b, [] (T x, T y) { return x - y; }); }
+	static vec mul(const vec& a, const vec& b) { return map(a, b, [] (T x, T y) { return x * y; }); }
+	static vec div(const vec& a, const vec& b) { return map(a, b, [] (T x, T y) { return x / y; }); }
+	static vec add_s(const vec& a, T s) { return map(a, a, [s] (T x, T) { return x + s; }); }
+	static vec mul_s(const vec& a, T s) { return map(a, a, [s] (T x, T) { return x * s; }); }
+	static vec div_s(const vec& a, T s) { return map(a, a, [s] (T x, T) { return x / s; }); }
+
+	static void add_assign(vec& a, const vec& b) { for(unsigned int i = 0; i < N; ++i) a[i] += b[i]; }
+	static void sub_assign(vec& a, const vec& b) { for(unsigned int i = 0; i < N; ++i) a[i] -= b[i]; }
+	static void mul_assign(vec& a, const vec& b) { for(unsigned int i = 0; i < N; ++i) a[i] *= b[i]; }
+	static void div_assign(vec& a, const vec& b) { for(unsigned int i = 0; i < N; ++i) a[i] /= b[i]; }
+
+	static bool eq(const vec& a, const vec& b) { return a == b; }
+	static bool ne(const vec& a, const vec& b) { return a != b; }
+	static bool lt(const vec& a, const vec& b) { return a < b; }
+	static bool le(const vec& a, const vec& b) { return a <= b; }
+	static bool gt(const vec& a, const vec& b) { return a > b; }
+	static bool ge(const vec& a, const vec& b) { return a >= b; }
+
+	static T dot(const vec& a, const vec& b)
+	{
+		T sum = 0;
+		for(unsigned int i = 0; i < N; ++i) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+	static T length(const vec& a)
+	{
+		return std::sqrt(dot(a, a));
+	}
+
+	static vec normalize(const vec& a)
+	{
+		return div_s(a, length(a));
+	}
+
+	static bvec less_than(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x < y; }); }
+	static bvec less_than_equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x <= y; }); }
+	static bvec greater_than(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x > y; }); }
+	static bvec greater_than_equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x >= y; }); }
+	static bvec equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x == y; }); }
+	static bvec not_equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x != y; }); }
+
+	static bool any(const bvec& m)
+	{
+		bool out = false;
+		for(unsigned int i = 0; i < N; ++i) {
+			out |= m[i];
+		}
+		return out;
+	}
+
+	static bool all(const bvec& m)
+	{
+		bool out = true;
+		for(unsigned int i = 0; i < N; ++i) {
+			out &= m[i];
+		}
+		return out;
+	}
+
+	static cvec convert(const vec& a)
+	{
+		cvec out;
+		for(unsigned int i = 0; i < N; ++i) {
+			out[i] = static_cast<convert_target<T>>(a[i]);
+		}
+		return out;
+	}
+};
+
+// }}}
+// gvec {{{
+
+template <typename T, unsigned int N>
+struct gvec_impl
+{
+	static constexpr const char* name = "gvec";
+
+	using vec = gvec<T, N>;
+	using bvec = gvec<bool, N>;
+	using svec = gvec<T, swizzle_dims<N>::value>;
+	using cvec = gvec<convert_target<T>, N>;
+
+private:
+
+	template <std::size_t... Is>
+	static vec components_impl(const vec& a, std::index_sequence<Is...> /* seq */)
+	{
+		return vec(a[Is]...);
+	}
+
+	static svec swizzle_read(const vec& a, std::integral_constant<unsigned int, 2>) { return svec(a.y, a.x); }
+	static svec swizzle_read(const vec& a, std::integral_constant<unsigned int, 3>) { return svec(a.z, a.y, a.x); }
+	static svec swizzle_read(const vec& a, std::integral_constant<unsigned int, 4>) { return svec(a.w, a.z, a.y, a.x); }
+
+	static void swizzle_write(vec& a, const vec& b, std::integral_constant<unsigned int, 2>)
+	{
+		T x = b.x, y = b.y;
+		a.y = x; a.x = y;
+	}
+
+	static void swizzle_write(vec& a, const vec& b, std::integral_constant<unsigned int, 3>)
+	{
+		T x = b.x, y = b.y, z = b.z;
+		a.z = x; a.y = y; a.x = z;
+	}
+
+	static void swizzle_write(vec& a, const vec& b, std::integral_constant<unsigned int, 4>)
+	{
+		T x = b.x, y = b.y, z = b.z, w = b.w;
+		a.w = x; a.z = y; a.y = z; a.x = w;
+	}
+
+	template <typename F>
+	static bvec test(const vec& a, const vec& b, F f)
+	{
+		bvec out;
+		for(std::size_t i = 0; i < N; ++i) {
+			out[i] = f(a[i], b[i]);
+		}
+		return out;
+	}
+
+public:
+
+	static vec broadcast(T s) { return vec(s); }
+	static vec components(const vec& a) { return components_impl(a, std::make_index_sequence<N>()); }
+	static svec swizzle_read(const vec& a) { return swizzle_read(a, swizzle_dims<N>()); }
+	static void swizzle_write(vec& a, const vec& b) { swizzle_write(a, b, swizzle_dims<N>()); }
+
+	static vec pos(const vec& a) { return +a; }
+	static vec neg(const vec& a) { return -a; }
+	static vec add(const vec& a, const vec& b) { return a + b; }
+	static vec sub(const vec& a, const vec& b) { return a - b; }
+	static vec mul(const vec& a, const vec& b) { return a * b; }
+	static vec div(const vec& a, const vec& b) { return a / b; }
+	static vec add_s(const vec& a, T s) { return a + vec(s); }
+	static vec mul_s(const vec& a, T s) { return a * vec(s); }
+	static vec div_s(const vec& a, T s) { return a / vec(s); }
+
+	static void add_assign(vec& a, const vec& b) { a += b; }
+	static void sub_assign(vec& a, const vec& b) { a -= b; }
+	static void mul_assign(vec& a, const vec& b) { a *= b; }
+	static void div_assign(vec& a, const vec& b) { a /= b; }
+
+	static bool eq(const vec& a, const vec& b) { return a == b; }
+	static bool ne(const vec& a, const vec& b) { return a != b; }
+	static bool lt(const vec& a, const vec& b) { return a < b; }
+	static bool le(const vec& a, const vec& b) { return a <= b; }
+	static bool gt(const vec& a, const vec& b) { return a > b; }
+	static bool ge(const vec& a, const vec& b) { return a >= b; }
+
+	static T dot(const vec& a, const vec& b)
+	{
+		T sum = 0;
+		for(std::size_t i = 0; i < N; ++i) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+	static T length(const vec& a) { return std::sqrt(dot(a, a)); }
+	static vec normalize(const vec& a) { return a / vec(length(a)); }
+
+	static bvec less_than(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x < y; }); }
+	static bvec less_than_equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x <= y; }); }
+	static bvec greater_than(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x > y; }); }
+	static bvec greater_than_equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x >= y; }); }
+	static bvec equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x == y; }); }
+	static bvec not_equal(const vec& a, const vec& b) { return test(a, b, [] (T x, T y) { return x != y; }); }
+
+	static bool any(const bvec& m)
+	{
+		bool out = false;
+		for(std::size_t i = 0; i < N; ++i) {
+			out |= m[i];
+		}
+		return out;
+	}
+
+	static bool all(const bvec& m)
+	{
+		bool out = true;
+		for(std::size_t i = 0; i < N; ++i) {
+			out &= m[i];
+		}
+		return out;
+	}
+
+	static cvec convert(const vec& a) { return static_cast<cvec>(a); }
+};
+
+// }}}
+// velm {{{
+
+template <typename T, unsigned int N>
+struct velm_impl
+{
+	static constexpr const char* name = "velm";
+
+	using vec = velm::vector<T, N>;
+	using bvec = velm::mask<N>;
+	using svec = velm::vector<T, swizzle_dims<N>::value>;
+	using cvec = velm::vector<convert_target<T>, N>;
+
+private:
+
+	template <std::size_t... Is>
+	static vec components_impl(const vec& a, std::index_sequence<Is...> /* seq */)
+	{
+		return vec(a[Is]...);
+	}
+
+	static svec swizzle_read(const vec& a, std::integral_constant<unsigned int, 2>) { return a.yx; }
+	static svec swizzle_read(const vec& a, std::integral_constant<unsigned int, 3>) { return a.zyx; }
+	static svec swizzle_read(const vec& a, std::integral_constant<unsigned int, 4>) { return a.wzyx; }
+
+	static void swizzle_write(vec& a, const vec& b, std::integral_constant<unsigned int, 2>) { a.yx = b.xy; }
+	static void swizzle_write(vec& a, const vec& b, std::integral_constant<unsigned int, 3>) { a.zyx = b.xyz; }
+	static void swizzle_write(vec& a, const vec& b, std::integral_constant<unsigned int, 4>) { a.wzyx = b.xyzw; }
+
+public:
+
+	static vec broadcast(T s) { return vec(s); }
+	static vec components(const vec& a) { return components_impl(a, std::make_index_sequence<N>()); }
+	static svec swizzle_read(const vec& a) { return swizzle_read(a, swizzle_dims<N>()); }
+	static void swizzle_write(vec& a, const vec& b) { swizzle_write(a, b, swizzle_dims<N>()); }
+
+	static vec pos(const vec& a) { return +a; }
+	static vec neg(const vec& a) { return -a; }
+	static vec add(const vec& a, const vec& b) { return a + b; }
+	static vec sub(const vec& a, const vec& b) { return a - b; }
+	static vec mul(const vec& a, const vec& b) { return a * b; }
+	static vec div(const vec& a, const vec& b) { return a / b; }
+	static vec add_s(const vec& a, T s) { return a + s; }
+	static vec mul_s(const vec& a, T s) { return a * s; }
+	static vec div_s(const vec& a, T s) { return a / s; }
+
+	static void add_assign(vec& a, const vec& b) { a += b; }
+	static void sub_assign(vec& a, const vec& b) { a -= b; }
+	static void mul_assign(vec& a, const vec& b) { a *= b; }
+	static void div_assign(vec& a, const vec& b) { a /= b; }
+
+	static bool eq(const vec& a, const vec& b) { return a == b; }
+	static bool ne(const vec& a, const vec& b) { return a != b; }
+	static bool lt(const vec& a, const vec& b) { return a < b; }
+	static bool le(const vec& a, const vec& b) { return a <= b; }
+	static bool gt(const vec& a, const vec& b) { return a > b; }
+	static bool ge(const vec& a, const vec& b) { return a >= b; }
+
+	static T dot(const vec& a, const vec& b) { return velm::dot(a, b); }
+	static T length(const vec& a) { return velm::length(a); }
+	static vec normalize(const vec& a) { return velm::normalize(a); }
+
+	static bvec less_than(const vec& a, const vec& b) { return velm::lessThan(a, b); }
+	static bvec less_than_equal(const vec& a, const vec& b) { return velm::lessThanEqual(a, b); }
+	static bvec greater_than(const vec& a, const vec& b) { return velm::greaterThan(a, b); }
+	static bvec greater_than_equal(const vec& a, const vec& b) { return velm::greaterThanEqual(a, b); }
+	static bvec equal(const vec& a, const vec& b) { return velm::equal(a, b); }
+	static bvec not_equal(const vec& a, const vec& b) { return velm::notEqual(a, b); }
+
+	static bool any(const bvec& m) { return velm::any(m); }
+	static bool all(const bvec& m) { return velm::all(m); }
+
+	static cvec convert(const vec& a) { return cvec(a); }
+};
+
+// }}}
+
+} // namespace bench
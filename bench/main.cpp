@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "vector_suite.hpp"
+
+void register_float(bench::runner& r);
+void register_double(bench::runner& r);
+void register_int(bench::runner& r);
+void register_lazy(bench::runner& r);
+void register_matrix(bench::runner& r);
+void register_quaternion(bench::runner& r);
+void register_fast(bench::runner& r);
+void register_view(bench::runner& r);
+void register_text(bench::runner& r);
+void register_hash(bench::runner& r);
+void register_curve(bench::runner& r);
+void register_kdtree(bench::runner& r);
+void register_bvh(bench::runner& r);
+void register_grid(bench::runner& r);
+void register_exec(bench::runner& r);
+void register_stats(bench::runner& r);
+void register_packed(bench::runner& r);
+
+static void usage(const char* argv0)
+{
+	std::fprintf(stderr,
+		"usage: %s [--filter=SUBSTRING] [--min-time=SECONDS] [--repetitions=N] [--out=FILE]\n"
+		"\n"
+		"Benchmarks are named group/impl/type/dimensions, e.g. add/velm/float/3.\n"
+		"Results are written as JSON to stdout, or FILE if given.\n",
+		argv0);
+}
+
+int main(int argc, char** argv)
+{
+	bench::runner r;
+	const char* out_path = nullptr;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(std::strncmp(arg, "--filter=", 9) == 0) {
+			r.filter(arg + 9);
+		} else if(std::strncmp(arg, "--min-time=", 11) == 0) {
+			r.min_time(std::atof(arg + 11));
+		} else if(std::strncmp(arg, "--repetitions=", 14) == 0) {
+			r.repetitions(static_cast<unsigned int>(std::atoi(arg + 14)));
+		} else if(std::strncmp(arg, "--out=", 6) == 0) {
+			out_path = arg + 6;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	r.context("velm_simd", VELM_SIMD);
+	r.context("velm_batch_bytes", VELM_BATCH_BYTES);
+	// 0 = baseline, 1 = avx2, 2 = avx512 (see VELM_ISA)
+	r.context("velm_dispatch_level", static_cast<int>(velm::dispatch::active()));
+#if defined(__OPTIMIZE__)
+	r.context("optimized", 1);
+#else
+	// e.g. CMAKE_BUILD_TYPE=Debug, or -O0 with GCC and Clang
+	r.context("optimized", 0);
+#endif
+
+	register_float(r);
+	register_double(r);
+	register_int(r);
+	register_lazy(r);
+	register_matrix(r);
+	register_quaternion(r);
+	register_fast(r);
+	register_view(r);
+	register_text(r);
+	register_hash(r);
+	register_curve(r);
+	register_kdtree(r);
+	register_bvh(r);
+	register_grid(r);
+	register_exec(r);
+	register_stats(r);
+	register_packed(r);
+
+	std::FILE* out = stdout;
+	if(out_path != nullptr) {
+		out = std::fopen(out_path, "w");
+		if(out == nullptr) {
+			std::perror(out_path);
+			return 1;
+		}
+	}
+
+	r.print_json(out);
+
+	if(out != stdout) {
+		std::fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <type_traits>
+
+#include "harness.hpp"
+#include "impls.hpp"
+
+/**
+ * \file vector_suite.hpp
+ * \brief benchmarks for a single component type and dimension
+ *
+ * Every benchmark maps over count vectors from two inputs, a and b, and a
+ * scalar s, writing each result to an output buffer. Inputs are random, with
+ * b and s kept away from zero so that division is well-defined.
+ */
+
+namespace bench {
+
+constexpr std::size_t count = 1024;
+
+template <typename Impl, typename T>
+struct fixture
+{
+	using vec = typename Impl::vec;
+
+	std::unique_ptr<vec[]> a;
+	std::unique_ptr<vec[]> b;
+	T s;
+
+	explicit fixture(unsigned int dimensions)
+		: a(new vec[count]), b(new vec[count])
+	{
+		std::mt19937 rng(dimensions);
+		using dist_t = std::conditional_t<std::is_integral<T>::value,
+			std::uniform_int_distribution<T>, std::uniform_real_distribution<T>>;
+		dist_t any_val(T(-9), T(9));
+		dist_t positive(T(1), T(9));
+
+		for(std::size_t i = 0; i < count; ++i) {
+			for(unsigned int k = 0; k < dimensions; ++k) {
+				a[i][k] = any_val(rng);
+				b[i][k] = positive(rng);
+			}
+		}
+		s = positive(rng);
+	}
+};
+
+/*
+ * Time f(a[i], b[i], s) for every element. Results are written to a buffer
+ * rather than discarded, so the work can't be skipped.
+ */
+template <typename Impl, typename T, unsigned int N, typename F>
+void map_case(runner& r, const char* group, const char* type, const fixture<Impl, T>& fix, F f)
+{
+	using result_t = std::decay_t<decltype(f(fix.a[0], fix.b[0], fix.s))>;
+	std::unique_ptr<result_t[]> out(new result_t[count]);
+
+	r.run(group, Impl::name, type, N, count, [&] {
+		const auto* a = fix.a.get();
+		const auto* b = fix.b.get();
+		const T s = fix.s;
+		for(std::size_t i = 0; i < count; ++i) {
+			out[i] = f(a[i], b[i], s);
+		}
+		do_not_optimize(out[count - 1]);
+	});
+}
+
+// length and normalize only make sense for floating point components
+template <typename Impl, typename T, unsigned int N>
+void geometric_suite(runner& r, const char* type, const fixture<Impl, T>& fix, std::true_type /* floating */)
+{
+	using vec = typename Impl::vec;
+	map_case<Impl, T, N>(r, "length", type, fix, [] (const vec& a, const vec&, T) { return Impl::length(a); });
+	map_case<Impl, T, N>(r, "normalize", type, fix, [] (const vec& a, const vec&, T) { return Impl::normalize(a); });
+}
+
+template <typename Impl, typename T, unsigned int N>
+void geometric_suite(runner& /* r */, const char* /* type */, const fixture<Impl, T>& /* fix */, std::false_type /* floating */)
+{
+}
+
+/*
+ * velm::batch over the same data, reported under the same groups as the
+ * per-element loops.
+ */
+template <typename T, unsigned int N>
+void batch_suite(runner& r, const char* type, std::true_type /* floating */)
+{
+	using vec = velm::vector<T, N>;
+	const fixture<velm_impl<T, N>, T> fix(N);
+	velm::batch::span<const vec> a(fix.a.get(), count);
+	velm::batch::span<const vec> b(fix.b.get(), count);
+	std::unique_ptr<vec[]> out(new vec[count]);
+	std::unique_ptr<T[]> scalars(new T[count]);
+
+	r.run("dot", "velm_batch", type, N, count, [&] {
+		velm::batch::dot(a, b, velm::batch::span<T>(scalars.get(), count));
+		do_not_optimize(scalars[count - 1]);
+	});
+	r.run("length", "velm_batch", type, N, count, [&] {
+		velm::batch::length(a, velm::batch::span<T>(scalars.get(), count));
+		do_not_optimize(scalars[count - 1]);
+	});
+	r.run("normalize", "velm_batch", type, N, count, [&] {
+		velm::batch::normalize(a, velm::batch::span<vec>(out.get(), count));
+		do_not_optimize(out[count - 1]);
+	});
+}
+
+template <typename T, unsigned int N>
+void batch_suite(runner& /* r */, const char* /* type */, std::false_type /* floating */)
+{
+}
+
+template <typename Impl, typename T, unsigned int N>
+void impl_suite(runner& r, const char* type)
+{
+	using vec = typename Impl::vec;
+	const fixture<Impl, T> fix(N);
+
+	// construction and swizzles
+	map_case<Impl, T, N>(r, "broadcast", type, fix, [] (const vec&, const vec&, T s) { return Impl::broadcast(s); });
+	map_case<Impl, T, N>(r, "components", type, fix, [] (const vec& a, const vec&, T) { return Impl::components(a); });
+	map_case<Impl, T, N>(r, "swizzle_read", type, fix, [] (const vec& a, const vec&, T) { return Impl::swizzle_read(a); });
+	map_case<Impl, T, N>(r, "swizzle_write", type, fix, [] (vec a, const vec& b, T) { Impl::swizzle_write(a, b); return a; });
+
+	// operators
+	map_case<Impl, T, N>(r, "pos", type, fix, [] (const vec& a, const vec&, T) { return Impl::pos(a); });
+	map_case<Impl, T, N>(r, "neg", type, fix, [] (const vec& a, const vec&, T) { return Impl::neg(a); });
+	map_case<Impl, T, N>(r, "add", type, fix, [] (const vec& a, const vec& b, T) { return Impl::add(a, b); });
+	map_case<Impl, T, N>(r, "sub", type, fix, [] (const vec& a, const vec& b, T) { return Impl::sub(a, b); });
+	map_case<Impl, T, N>(r, "mul", type, fix, [] (const vec& a, const vec& b, T) { return Impl::mul(a, b); });
+	map_case<Impl, T, N>(r, "div", type, fix, [] (const vec& a, const vec& b, T) { return Impl::div(a, b); });
+	map_case<Impl, T, N>(r, "add_scalar", type, fix, [] (const vec& a, const vec&, T s) { return Impl::add_s(a, s); });
+	map_case<Impl, T, N>(r, "mul_scalar", type, fix, [] (const vec& a, const vec&, T s) { return Impl::mul_s(a, s); });
+	map_case<Impl, T, N>(r, "div_scalar", type, fix, [] (const vec& a, const vec&, T s) { return Impl::div_s(a, s); });
+	map_case<Impl, T, N>(r, "add_assign", type, fix, [] (vec a, const vec& b, T) { Impl::add_assign(a, b); return a; });
+	map_case<Impl, T, N>(r, "sub_assign", type, fix, [] (vec a, const vec& b, T) { Impl::sub_assign(a, b); return a; });
+	map_case<Impl, T, N>(r, "mul_assign", type, fix, [] (vec a, const vec& b, T) { Impl::mul_assign(a, b); return a; });
+	map_case<Impl, T, N>(r, "div_assign", type, fix, [] (vec a, const vec& b, T) { Impl::div_assign(a, b); return a; });
+	map_case<Impl, T, N>(r, "eq", type, fix, [] (const vec& a, const vec& b, T) { return Impl::eq(a, b); });
+	map_case<Impl, T, N>(r, "ne", type, fix, [] (const vec& a, const vec& b, T) { return Impl::ne(a, b); });
+	map_case<Impl, T, N>(r, "lt", type, fix, [] (const vec& a, const vec& b, T) { return Impl::lt(a, b); });
+	map_case<Impl, T, N>(r, "le", type, fix, [] (const vec& a, const vec& b, T) { return Impl::le(a, b); });
+	map_case<Impl, T, N>(r, "gt", type, fix, [] (const vec& a, const vec& b, T) { return Impl::gt(a, b); });
+	map_case<Impl, T, N>(r, "ge", type, fix, [] (const vec& a, const vec& b, T) { return Impl::ge(a, b); });
+
+	// geometric functions
+	map_case<Impl, T, N>(r, "dot", type, fix, [] (const vec& a, const vec& b, T) { return Impl::dot(a, b); });
+	geometric_suite<Impl, T, N>(r, type, fix, std::is_floating_point<T>());
+
+	// relational functions
+	map_case<Impl, T, N>(r, "lessThan", type, fix, [] (const vec& a, const vec& b, T) { return Impl::less_than(a, b); });
+	map_case<Impl, T, N>(r, "lessThanEqual", type, fix, [] (const vec& a, const vec& b, T) { return Impl::less_than_equal(a, b); });
+	map_case<Impl, T, N>(r, "greaterThan", type, fix, [] (const vec& a, const vec& b, T) { return Impl::greater_than(a, b); });
+	map_case<Impl, T, N>(r, "greaterThanEqual", type, fix, [] (const vec& a, const vec& b, T) { return Impl::greater_than_equal(a, b); });
+	map_case<Impl, T, N>(r, "equal", type, fix, [] (const vec& a, const vec& b, T) { return Impl::equal(a, b); });
+	map_case<Impl, T, N>(r, "notEqual", type, fix, [] (const vec& a, const vec& b, T) { return Impl::not_equal(a, b); });
+	map_case<Impl, T, N>(r, "any", type, fix, [] (const vec& a, const vec& b, T) { return Impl::any(Impl::less_than(a, b)); });
+	map_case<Impl, T, N>(r, "all", type, fix, [] (const vec& a, const vec& b, T) { return Impl::all(Impl::less_than(a, b)); });
+
+	// conversions
+	map_case<Impl, T, N>(r, "convert", type, fix, [] (const vec& a, const vec&, T) { return Impl::convert(a); });
+}
+
+/*
+ * Run every benchmark for each implementation with one component type and
+ * dimension.
+ */
+template <typename T, unsigned int N>
+void vector_suite(runner& r, const char* type)
+{
+	impl_suite<raw_impl<T, N>, T, N>(r, type);
+	impl_suite<gvec_impl<T, N>, T, N>(r, type);
+	impl_suite<velm_impl<T, N>, T, N>(r, type);
+	batch_suite<T, N>(r, type, std::is_floating_point<T>());
+}
+
+} // namespace bench
@@ -3,3 +3,14 @@
 #include "velm/vector.hpp"
 #include "velm/ops.hpp"
 #include "velm/funcs.hpp"
+#include "velm/mask.hpp"
+#include "velm/hash.hpp"
+#include "velm/math.hpp"
+#include "velm/fast.hpp"
+#include "velm/matrix.hpp"
+#include "velm/quaternion.hpp"
+#include "velm/view.hpp"
+#include "velm/vector_array.hpp"
+#include "velm/pack.hpp"
+#include "velm/batch.hpp"
+#include "velm/dispatch.hpp"
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+/**
+ * \file allocator.hpp
+ * \brief over-aligned allocator for component storage
+ *
+ * Containers of components (e.g. vector_array lanes) are aligned to a cache
+ * line so that every lane starts on a SIMD register boundary. C++14 has no
+ * aligned operator new, so this allocator over-allocates and stores the
+ * original pointer just before the aligned block.
+ */
+
+namespace velm { namespace utility {
+
+template <typename T, std::size_t Align = 64>
+struct aligned_allocator
+{
+	static_assert((Align & (Align - 1)) == 0, "Alignment must be a power of two");
+	static_assert(Align >= alignof(void*), "Alignment must be able to hold a pointer");
+
+	using value_type = T;
+	static constexpr std::size_t alignment = Align;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = aligned_allocator<U, Align>;
+	};
+
+	aligned_allocator() noexcept = default;
+
+	template <typename U>
+	aligned_allocator(const aligned_allocator<U, Align>& /* other */) noexcept
+	{
+	}
+
+	T* allocate(std::size_t n)
+	{
+		if(n > (std::numeric_limits<std::size_t>::max() - Align - sizeof(void*)) / sizeof(T)) {
+			throw std::bad_alloc();
+		}
+
+		void* raw = ::operator new(n * sizeof(T) + Align + sizeof(void*));
+		auto addr = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+		addr = (addr + Align - 1) & ~static_cast<std::uintptr_t>(Align - 1);
+
+		reinterpret_cast<void**>(addr)[-1] = raw;
+		return reinterpret_cast<T*>(addr);
+	}
+
+	void deallocate(T* p, std::size_t /* n */) noexcept
+	{
+		if(p != nullptr) {
+			::operator delete(reinterpret_cast<void**>(p)[-1]);
+		}
+	}
+};
+
+template <typename T, typename U, std::size_t Align>
+constexpr bool operator==(const aligned_allocator<T, Align>&, const aligned_allocator<U, Align>&) noexcept
+{
+	return true;
+}
+
+template <typename T, typename U, std::size_t Align>
+constexpr bool operator!=(const aligned_allocator<T, Align>&, const aligned_allocator<U, Align>&) noexcept
+{
+	return false;
+}
+
+} } // namespace velm::utility
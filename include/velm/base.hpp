@@ -14,8 +14,20 @@
  * vec_base requires several language extensions (e.g. anonymous structs in
  * unions). While supported by major compilers, they still issue a warning.
  * These are suppressed with pragmas.
+ *
+ * Each swizzle member is a separate type, which the compiler instantiates
+ * along with every vector type, whether the swizzle is used or not. Defining
+ * VELM_SWIZZLE_MEMBERS to 0 before including any velm header leaves out all
+ * swizzle members except x, y, z and w, which makes vector types much
+ * cheaper to compile. Swizzles are still available with
+ * v.swizzle<0, 1, 2>() (the same as v.xyz), which costs nothing unless used.
+ * bench/compile_time.py measures the difference.
  */
 
+#if !defined(VELM_SWIZZLE_MEMBERS)
+	#define VELM_SWIZZLE_MEMBERS 1
+#endif
+
 #if defined(__llvm__)
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wgnu-anonymous-struct"
@@ -39,6 +51,7 @@ struct vec_base
 			T x, y, z, w;
 		};
 
+#if VELM_SWIZZLE_MEMBERS
 		// {{{
 		ProxyGen<T, 0, 0, 0, 0> xxxx;
 		ProxyGen<T, 0, 0, 0, 1> xxxy;
@@ -379,6 +392,7 @@ struct vec_base
 		ProxyGen<T, 3, 2> wz;
 		ProxyGen<T, 3, 3> ww;
 		// }}}
+#endif
 	};
 };
 
@@ -391,6 +405,7 @@ struct vec_base<T, 3, ProxyGen>
 			T x, y, z;
 		};
 
+#if VELM_SWIZZLE_MEMBERS
 		// {{{
 		ProxyGen<T, 0, 0, 0, 0> xxxx;
 		ProxyGen<T, 0, 0, 0, 1> xxxy;
@@ -512,6 +527,7 @@ struct vec_base<T, 3, ProxyGen>
 		ProxyGen<T, 2, 1> zy;
 		ProxyGen<T, 2, 2> zz;
 		// }}}
+#endif
 	};
 };
 
@@ -524,6 +540,7 @@ struct vec_base<T, 2, ProxyGen>
 			T x, y;
 		};
 
+#if VELM_SWIZZLE_MEMBERS
 		// {{{
 		ProxyGen<T, 0, 0, 0, 0> xxxx;
 		ProxyGen<T, 0, 0, 0, 1> xxxy;
@@ -556,6 +573,7 @@ struct vec_base<T, 2, ProxyGen>
 		ProxyGen<T, 1, 0> yx;
 		ProxyGen<T, 1, 1> yy;
 		// }}}
+#endif
 	};
 };
 
@@ -568,11 +586,13 @@ struct vec_base<T, 1, ProxyGen>
 			T x;
 		};
 
+#if VELM_SWIZZLE_MEMBERS
 		// {{{
 		ProxyGen<T, 0, 0, 0, 0> xxxx;
 		ProxyGen<T, 0, 0, 0> xxx;
 		ProxyGen<T, 0, 0> xx;
 		// }}}
+#endif
 	};
 };
 
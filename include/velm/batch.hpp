@@ -0,0 +1,1129 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+#include "math.hpp"
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "vector_array.hpp"
+#include "pack.hpp"
+#include "dispatch.hpp"
+
+/**
+ * \file batch.hpp
+ * \brief funcs.hpp and math.hpp over whole ranges of vectors
+ *
+ * The functions in velm::batch apply a function from funcs.hpp or math.hpp to
+ * every element of contiguous ranges of velm::vector<T, N> (or
+ * velm::quaternion<T>), writing the results into an output range. A range is anything with data()
+ * and size() (std::vector, std::array, velm::batch::span). Arguments which are
+ * not ranges, such as the bounds of clamp or the weight of mix, are broadcast
+ * to every element.
+ *
+ *      std::vector<velm::vector<float, 3>> dirs(n), out(n);
+ *      std::vector<float> len(n);
+ *      velm::batch::length(dirs, len);
+ *      velm::batch::normalize(dirs, out);
+ *      velm::batch::normalize(dirs); // in place
+ *      velm::batch::clamp(dirs, 0.f, 1.f);
+ *
+ * Internally, length, normalize and slerp process elements in blocks of
+ * width<T> vectors: each block is gathered into a velm::vector<velm::pack<T,
+ * W>, N> (or quaternion of packs), the same function is applied, and the
+ * result is scattered back, with the remainder processed one element at a
+ * time. This lets the square root be vectorised even when errno is required
+ * (see velm::sqrt for packs), and lets slerp choose its interpolation weights
+ * without branches. The other functions are vectorised better by the compiler
+ * as a plain loop over independent elements, which the transposition only
+ * slows down.
+ *
+ * Both paths perform the same operations in the same order as the scalar
+ * functions, but results are only bit-identical if the compiler contracts
+ * multiplies and adds into FMA instructions in the same places. With
+ * -ffp-contract=fast (GCC's default in the GNU dialects), the plain loops
+ * compiled for AVX2 and AVX-512 use FMA while scalar code built for SSE2
+ * cannot, so e.g. rotate and nlerp differ from q * v and velm::nlerp in the
+ * last bit for many elements, and slerp does too when the translation unit
+ * itself is built with FMA. The error bounds are the same either way. Build
+ * with -ffp-contract=off, or set VELM_ISA=baseline in a translation unit
+ * without FMA, for identical results.
+ *
+ * transform and transform_points multiply each vector by a matrix. The matrix
+ * is copied (or, for 4x4 float matrices, loaded into registers) once before
+ * the loop, rather than being read again after every store to the output.
+ *
+ * The plain loops are also compiled for AVX2 and AVX-512, and the version
+ * used is chosen at run time (see dispatch.hpp). Blocks of packs always use
+ * the instruction set of the translation unit.
+ *
+ * Outputs may be the same range as an input (in-place), but must not
+ * otherwise overlap the inputs.
+ */
+
+#if !defined(VELM_BATCH_BYTES)
+	#if defined(__AVX512F__)
+		#define VELM_BATCH_BYTES 64
+	#else
+		#define VELM_BATCH_BYTES 32
+	#endif
+#endif
+
+namespace velm { namespace batch {
+
+/**
+ * \struct span
+ * \brief minimal contiguous range
+ *
+ * A pointer and a size, for passing raw arrays to batch functions.
+ */
+template <typename T>
+struct span
+{
+	T* ptr;
+	std::size_t count;
+
+	constexpr span(T* p, std::size_t n)
+		: ptr(p), count(n)
+	{
+	}
+
+	template <typename C>
+	constexpr span(C& c)
+		: ptr(c.data()), count(c.size())
+	{
+	}
+
+	constexpr T* data() const
+	{
+		return ptr;
+	}
+
+	constexpr std::size_t size() const
+	{
+		return count;
+	}
+
+	constexpr T& operator[](std::size_t idx) const
+	{
+		return ptr[idx];
+	}
+};
+
+/**
+ * \struct width
+ * \brief number of vectors processed per block
+ */
+template <typename T>
+struct width
+	: std::integral_constant<unsigned int, (VELM_BATCH_BYTES / sizeof(T) > 0 ? VELM_BATCH_BYTES / sizeof(T) : 1)>
+{
+};
+
+namespace detail {
+
+	template <typename C>
+	using range_detect = decltype(std::declval<C&>().data() + std::declval<C&>().size());
+
+	template <typename C>
+	using is_range = typename utility::detect<range_detect, C>::value_t;
+
+	template <typename C>
+	using range_element = std::remove_pointer_t<decltype(std::declval<C&>().data())>;
+
+	template <typename T>
+	struct is_velm_vector
+		: std::false_type
+	{
+	};
+
+	template <typename T, unsigned int N>
+	struct is_velm_vector<vector<T, N>>
+		: std::true_type
+	{
+	};
+
+	// quaternions are gathered into packs like vectors
+	template <typename T>
+	struct is_velm_vector<quaternion<T>>
+		: std::true_type
+	{
+	};
+
+	/*
+	 * Loading and storing a block of W elements as packs. Vectors use
+	 * gather/scatter from pack.hpp.
+	 */
+
+	template <unsigned int W, typename T, unsigned int N>
+	vector<pack<T, W>, N> load_block(const vector<T, N>* src)
+	{
+		return gather<W>(src);
+	}
+
+	template <unsigned int W, typename T>
+	quaternion<pack<T, W>> load_block(const quaternion<T>* src)
+	{
+		quaternion<pack<T, W>> out;
+		for(unsigned int k = 0; k < 4; ++k) {
+			for(unsigned int i = 0; i < W; ++i) {
+				out[k].lanes[i] = src[i][k];
+			}
+		}
+		return out;
+	}
+
+	template <typename V, typename R>
+	void store_block(V* dst, const R& val)
+	{
+		*dst = val;
+	}
+
+	template <typename T, unsigned int W, unsigned int N>
+	void store_block(vector<T, N>* dst, const vector<pack<T, W>, N>& val)
+	{
+		scatter(val, dst);
+	}
+
+	template <typename T, unsigned int W>
+	void store_block(quaternion<T>* dst, const quaternion<pack<T, W>>& val)
+	{
+		for(unsigned int i = 0; i < W; ++i) {
+			for(unsigned int k = 0; k < 4; ++k) {
+				dst[i][k] = val[k].lanes[i];
+			}
+		}
+	}
+
+	/*
+	 * Streams provide per-block (block<W>(i)) and per-element (elem(i))
+	 * access to an argument. Vector ranges are gathered into packs, scalar
+	 * ranges are loaded into packs, and everything else is broadcast.
+	 */
+
+	template <typename V>
+	struct vector_stream
+	{
+		V* ptr;
+
+		template <unsigned int W>
+		auto block(std::size_t idx) const
+		{
+			return load_block<W>(ptr + idx);
+		}
+
+		V& elem(std::size_t idx) const
+		{
+			return ptr[idx];
+		}
+
+		template <typename R>
+		void store(std::size_t idx, const R& val) const
+		{
+			store_block(ptr + idx, val);
+		}
+	};
+
+	template <typename T>
+	struct scalar_stream
+	{
+		T* ptr;
+
+		template <unsigned int W>
+		pack<std::remove_const_t<T>, W> block(std::size_t idx) const
+		{
+			return pack<std::remove_const_t<T>, W>::load(ptr + idx);
+		}
+
+		T& elem(std::size_t idx) const
+		{
+			return ptr[idx];
+		}
+
+		template <unsigned int W>
+		void store(std::size_t idx, const pack<T, W>& val) const
+		{
+			val.store(ptr + idx);
+		}
+
+		template <typename R>
+		void store(std::size_t idx, const R& val) const
+		{
+			ptr[idx] = val;
+		}
+	};
+
+	template <typename V>
+	struct broadcast
+	{
+		const V& val;
+
+		template <unsigned int W>
+		const V& block(std::size_t /* idx */) const
+		{
+			return val;
+		}
+
+		const V& elem(std::size_t /* idx */) const
+		{
+			return val;
+		}
+	};
+
+	template <typename C, std::enable_if_t<is_range<C>::value
+		&& is_velm_vector<std::remove_const_t<range_element<C>>>::value, int> = 0>
+	vector_stream<range_element<C>> stream(C& c)
+	{
+		return {c.data()};
+	}
+
+	template <typename C, std::enable_if_t<is_range<C>::value
+		&& !is_velm_vector<std::remove_const_t<range_element<C>>>::value, int> = 0>
+	scalar_stream<range_element<C>> stream(C& c)
+	{
+		return {c.data()};
+	}
+
+	template <typename C, std::enable_if_t<!is_range<C>::value, int> = 0>
+	broadcast<C> stream(C& c)
+	{
+		return {c};
+	}
+
+	template <typename C, std::enable_if_t<is_range<C>::value, int> = 0>
+	std::size_t size_of(const C& c)
+	{
+		return c.size();
+	}
+
+	template <typename C, std::enable_if_t<!is_range<C>::value, int> = 0>
+	std::size_t size_of(const C& /* c */)
+	{
+		return std::size_t(-1);
+	}
+
+	template <typename... Args>
+	bool sizes_match(std::size_t n, const Args&... args)
+	{
+		bool match = true;
+		(void)n;
+		(void)std::initializer_list<int>{ (match = match && (size_of(args) == std::size_t(-1) || size_of(args) == n), 0)... };
+		return match;
+	}
+
+	// ranges of scalars are their own component type
+	template <typename T>
+	struct first_value_type
+	{
+		using type = T;
+	};
+
+	template <typename T, unsigned int N>
+	struct first_value_type<vector<T, N>>
+	{
+		using type = T;
+	};
+
+	template <typename T>
+	struct first_value_type<quaternion<T>>
+	{
+		using type = T;
+	};
+
+	/*
+	 * Apply f to each element. If Packed, whole blocks go through packs
+	 * first, using the component type of the vectors in the first argument,
+	 * and the loop below only handles the remainder.
+	 */
+	template <bool Packed, typename F, typename Out, typename In, typename... Args>
+	void run(F&& f, Out& out, const In& in, const Args&... args)
+	{
+		using T = typename first_value_type<std::remove_const_t<range_element<const In>>>::type;
+		constexpr unsigned int W = width<T>::value;
+
+		const std::size_t n = in.size();
+		assert(out.size() == n);
+		assert(sizes_match(n, args...));
+
+		auto dst = stream(out);
+		auto src = stream(in);
+		auto run_streams = [&] (auto... srcs) {
+			std::size_t i = 0;
+			for(; Packed && i + W <= n; i += W) {
+				dst.store(i, f(src.template block<W>(i), srcs.template block<W>(i)...));
+			}
+			// elements are independent, and out may only alias an input at the same index
+			VELM_IVDEP
+			for(; i < n; ++i) {
+				dst.store(i, f(src.elem(i), srcs.elem(i)...));
+			}
+		};
+		auto kernel = [&] { run_streams(stream(args)...); };
+		if(Packed) {
+			// packs have the compile-time width, and measure slower when recompiled for wider registers
+			kernel();
+		} else {
+			dispatch::invoke(kernel);
+		}
+	}
+
+	/*
+	 * The matrix is copied into a local, which stores to out cannot alias, so
+	 * the compiler can keep it in registers for the whole loop.
+	 */
+	template <typename T, unsigned int R, unsigned int C>
+	void transform_range(const matrix<T, R, C>& mat, span<const vector<T, C>> in, span<vector<T, R>> out)
+	{
+		assert(in.size() == out.size());
+		dispatch::invoke([&] {
+			const matrix<T, R, C> m = mat;
+			for(std::size_t i = 0; i < in.size(); ++i) {
+				out[i] = m * in[i];
+			}
+		});
+	}
+
+	template <typename T>
+	void transform_points_range(const matrix<T, 4, 4>& mat, span<const vector<T, 3>> in, span<vector<T, 3>> out)
+	{
+		assert(in.size() == out.size());
+		dispatch::invoke([&] {
+			const matrix<T, 4, 4> m = mat;
+			for(std::size_t i = 0; i < in.size(); ++i) {
+				const vector<T, 3>& p = in[i];
+				const vector<T, 4> r = m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3];
+				out[i] = vector<T, 3>(r[0], r[1], r[2]);
+			}
+		});
+	}
+
+#if VELM_SIMD
+
+	inline void transform_range(const matrix<float, 4, 4>& mat, span<const vector<float, 4>> in, span<vector<float, 4>> out)
+	{
+		assert(in.size() == out.size());
+		dispatch::invoke([&] {
+			__m128 m[4];
+			simd::mat4_load(mat, m);
+			for(std::size_t i = 0; i < in.size(); ++i) {
+				_mm_storeu_ps(out[i].data.data(), simd::mat4_column(m, _mm_loadu_ps(in[i].data.data())));
+			}
+		});
+	}
+
+	inline void transform_points_range(const matrix<float, 4, 4>& mat, span<const vector<float, 3>> in, span<vector<float, 3>> out)
+	{
+		assert(in.size() == out.size());
+		dispatch::invoke([&] {
+			__m128 m[4];
+			simd::mat4_load(mat, m);
+			for(std::size_t i = 0; i < in.size(); ++i) {
+				const float* p = in[i].data.data();
+				__m128 r = _mm_mul_ps(m[0], _mm_set1_ps(p[0]));
+				r = _mm_add_ps(r, _mm_mul_ps(m[1], _mm_set1_ps(p[1])));
+				r = _mm_add_ps(r, _mm_mul_ps(m[2], _mm_set1_ps(p[2])));
+				r = _mm_add_ps(r, m[3]);
+
+				float* q = out[i].data.data();
+				_mm_storel_pi(reinterpret_cast<__m64*>(q), r);
+				_mm_store_ss(q + 2, _mm_movehl_ps(r, r));
+			}
+		});
+	}
+
+#endif
+
+	/*
+	 * Ranges of float or double, or of vectors of them, are contiguous
+	 * arrays of components. The math.hpp functions work on each component
+	 * separately, so these ranges go through the kernels as one flat array,
+	 * a register at a time regardless of the vector size. The kernels are
+	 * SSE-width, so recompiling them for AVX2 (see dispatch.hpp) would only
+	 * allow FMA contraction, which changes results relative to the single
+	 * vector functions, and is not done.
+	 */
+	template <typename E>
+	struct flat_traits
+	{
+		static constexpr bool value = velm::detail::is_kernel_type<E>::value;
+		using type = E;
+		static constexpr unsigned int size = 1;
+
+		static E* components(E* ptr)
+		{
+			return ptr;
+		}
+
+		static const E* components(const E* ptr)
+		{
+			return ptr;
+		}
+	};
+
+	template <typename T, unsigned int N>
+	struct flat_traits<vector<T, N>>
+	{
+		static constexpr bool value = velm::detail::is_kernel_type<T>::value
+			&& sizeof(vector<T, N>) == N * sizeof(T);
+		using type = T;
+		static constexpr unsigned int size = N;
+
+		static T* components(vector<T, N>* ptr)
+		{
+			return reinterpret_cast<T*>(ptr);
+		}
+
+		static const T* components(const vector<T, N>* ptr)
+		{
+			return reinterpret_cast<const T*>(ptr);
+		}
+	};
+
+	template <typename C, typename = void>
+	struct flat_range
+		: std::false_type
+	{
+	};
+
+	template <typename C>
+	struct flat_range<C, std::enable_if_t<is_range<C>::value>>
+		: std::integral_constant<bool, flat_traits<std::remove_const_t<range_element<C>>>::value>
+	{
+	};
+
+	template <typename C>
+	using flat_of = flat_traits<std::remove_const_t<range_element<C>>>;
+
+	// out has the same element type as in, so that it can be written as flat components
+	template <typename In, typename Out>
+	using flat_unary = std::integral_constant<bool, flat_range<In>::value
+		&& std::is_same<std::remove_const_t<range_element<const In>>, std::remove_const_t<range_element<Out>>>::value>;
+
+	// y is either a range like x, or a scalar which is broadcast to every component
+	template <typename X, typename Y, typename Out, typename = void>
+	struct flat_binary
+		: std::false_type
+	{
+	};
+
+	template <typename X, typename Y, typename Out>
+	struct flat_binary<X, Y, Out, std::enable_if_t<flat_unary<X, Out>::value && is_range<Y>::value>>
+		: std::is_same<std::remove_const_t<range_element<const X>>, std::remove_const_t<range_element<const Y>>>
+	{
+	};
+
+	template <typename X, typename Y, typename Out>
+	struct flat_binary<X, Y, Out, std::enable_if_t<flat_unary<X, Out>::value && std::is_arithmetic<Y>::value>>
+		: std::is_same<std::common_type_t<typename flat_of<X>::type, Y>, typename flat_of<X>::type>
+	{
+	};
+
+	template <typename T, typename C, std::enable_if_t<is_range<C>::value, int> = 0>
+	kernels::array_source<T> flat_source(const C& c)
+	{
+		return kernels::source(flat_of<const C>::components(c.data()));
+	}
+
+	template <typename T, typename S, std::enable_if_t<!is_range<S>::value, int> = 0>
+	kernels::scalar_source<T> flat_source(const S& val)
+	{
+		return kernels::source(static_cast<T>(val));
+	}
+
+	/*
+	 * Applies a math.hpp function object to each element, through the
+	 * kernels when the ranges are flat, and through the velm function (g)
+	 * otherwise.
+	 */
+	template <typename F, typename G, typename Out, typename In>
+	void math_range(F f, G&& /* g */, Out& out, const In& in, std::true_type /* flat */)
+	{
+		using traits = flat_of<const In>;
+		using T = typename traits::type;
+		assert(out.size() == in.size());
+		kernels::map(flat_of<Out>::components(out.data()), in.size() * traits::size, f, flat_source<T>(in));
+	}
+
+	template <typename F, typename G, typename Out, typename In>
+	void math_range(F /* f */, G&& g, Out& out, const In& in, std::false_type /* flat */)
+	{
+		run<false>(g, out, in);
+	}
+
+	template <typename F, typename G, typename Out, typename X, typename Y>
+	void math_range(F f, G&& /* g */, Out& out, const X& x, const Y& y, std::true_type /* flat */)
+	{
+		using traits = flat_of<const X>;
+		using T = typename traits::type;
+		assert(out.size() == x.size());
+		assert(sizes_match(x.size(), y));
+		kernels::map(flat_of<Out>::components(out.data()), x.size() * traits::size, f,
+			flat_source<T>(x), flat_source<T>(y));
+	}
+
+	template <typename F, typename G, typename Out, typename X, typename Y>
+	void math_range(F /* f */, G&& g, Out& out, const X& x, const Y& y, std::false_type /* flat */)
+	{
+		run<false>(g, out, x, y);
+	}
+
+	template <typename In, typename S, typename C>
+	void sincos_range(const In& in, S& s, C& c, std::true_type /* flat */)
+	{
+		using traits = flat_of<const In>;
+		assert(s.size() == in.size() && c.size() == in.size());
+		kernels::map_sincos(traits::components(in.data()), flat_of<S>::components(s.data()),
+			flat_of<C>::components(c.data()), in.size() * traits::size);
+	}
+
+	template <typename In, typename S, typename C>
+	void sincos_range(const In& in, S& s, C& c, std::false_type /* flat */)
+	{
+		assert(s.size() == in.size() && c.size() == in.size());
+		for(std::size_t i = 0; i < in.size(); ++i) {
+			velm::sincos(in.data()[i], s.data()[i], c.data()[i]);
+		}
+	}
+
+} // namespace detail
+
+// geometric {{{
+
+/**
+ * \fn length
+ * \brief length of each vector
+ *
+ * out[i] = velm::length(in[i])
+ */
+template <typename In, typename Out>
+void length(const In& in, Out&& out)
+{
+	detail::run<true>([] (auto&& v) { return velm::length(v); }, out, in);
+}
+
+/**
+ * \fn distance
+ * \brief distance between each pair of points
+ *
+ * out[i] = velm::distance(p0[i], p1[i]). p1 may be a single point.
+ */
+template <typename P0, typename P1, typename Out>
+void distance(const P0& p0, const P1& p1, Out&& out)
+{
+	detail::run<false>([] (auto&& a, auto&& b) { return velm::distance(a, b); }, out, p0, p1);
+}
+
+/**
+ * \fn dot
+ * \brief dot product of each pair of vectors
+ *
+ * out[i] = velm::dot(lhs[i], rhs[i]). rhs may be a single vector.
+ */
+template <typename L, typename R, typename Out>
+void dot(const L& lhs, const R& rhs, Out&& out)
+{
+	detail::run<false>([] (auto&& a, auto&& b) { return velm::dot(a, b); }, out, lhs, rhs);
+}
+
+/**
+ * \fn normalize
+ * \brief normalise each vector
+ *
+ * out[i] = velm::normalize(in[i]). With a single argument, the range is
+ * normalised in place.
+ */
+template <typename In, typename Out>
+void normalize(const In& in, Out&& out)
+{
+	detail::run<true>([] (auto&& v) { return velm::normalize(v); }, out, in);
+}
+
+template <typename InOut>
+void normalize(InOut&& vals)
+{
+	batch::normalize(vals, vals);
+}
+
+/**
+ * \fn reflect
+ * \brief reflect each incident vector
+ *
+ * out[i] = velm::reflect(i[i], n[i]). n may be a single normal.
+ */
+template <typename I, typename N, typename Out>
+void reflect(const I& i, const N& n, Out&& out)
+{
+	detail::run<false>([] (auto&& a, auto&& b) { return velm::reflect(a, b); }, out, i, n);
+}
+
+// }}}
+// common {{{
+
+/**
+ * \fn clamp
+ * \brief clamp each vector
+ *
+ * out[i] = velm::clamp(in[i], low, high). The bounds may be scalars,
+ * vectors or ranges. Without out, the range is clamped in place.
+ */
+template <typename In, typename L, typename H, typename Out>
+void clamp(const In& in, const L& low, const H& high, Out&& out)
+{
+	detail::run<false>([] (auto&& v, auto&& l, auto&& h) { return velm::clamp(v, l, h); }, out, in, low, high);
+}
+
+template <typename InOut, typename L, typename H>
+void clamp(InOut&& vals, const L& low, const H& high)
+{
+	batch::clamp(vals, low, high, vals);
+}
+
+/**
+ * \fn mix
+ * \brief linear blend of each pair of vectors
+ *
+ * out[i] = velm::mix(a[i], b[i], w[i]). b and w may be single values.
+ * Without out, the result is written to a.
+ */
+template <typename A, typename B, typename WB, typename Out>
+void mix(const A& a, const B& b, const WB& wb, Out&& out)
+{
+	detail::run<false>([] (auto&& x, auto&& y, auto&& w) { return velm::mix(x, y, w); }, out, a, b, wb);
+}
+
+template <typename A, typename B, typename WB>
+void mix(A&& a, const B& b, const WB& wb)
+{
+	batch::mix(a, b, wb, a);
+}
+
+// }}}
+// math {{{
+
+/*
+ * The functions of math.hpp, for ranges of scalars or vectors. Ranges of float
+ * and double (or vectors of them) are processed as flat arrays of components
+ * by the kernels of kernels.hpp, with the same results as the single value
+ * functions; other element types call the velm function on each element.
+ */
+
+/**
+ * \fn exp
+ * \brief natural exponential of each element
+ *
+ * out[i] = velm::exp(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void exp(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::exp_fn(), [] (auto&& v) { return velm::exp(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void exp(InOut&& vals)
+{
+	batch::exp(vals, vals);
+}
+
+/**
+ * \fn exp2
+ * \brief base 2 exponential of each element
+ *
+ * out[i] = velm::exp2(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void exp2(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::exp2_fn(), [] (auto&& v) { return velm::exp2(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void exp2(InOut&& vals)
+{
+	batch::exp2(vals, vals);
+}
+
+/**
+ * \fn log
+ * \brief natural logarithm of each element
+ *
+ * out[i] = velm::log(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void log(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::log_fn(), [] (auto&& v) { return velm::log(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void log(InOut&& vals)
+{
+	batch::log(vals, vals);
+}
+
+/**
+ * \fn log2
+ * \brief base 2 logarithm of each element
+ *
+ * out[i] = velm::log2(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void log2(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::log2_fn(), [] (auto&& v) { return velm::log2(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void log2(InOut&& vals)
+{
+	batch::log2(vals, vals);
+}
+
+/**
+ * \fn sqrt
+ * \brief square root of each element
+ *
+ * out[i] = velm::sqrt(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void sqrt(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::sqrt_fn(), [] (auto&& v) { return velm::sqrt(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void sqrt(InOut&& vals)
+{
+	batch::sqrt(vals, vals);
+}
+
+/**
+ * \fn inversesqrt
+ * \brief reciprocal square root of each element
+ *
+ * out[i] = velm::inversesqrt(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void inversesqrt(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::inversesqrt_fn(), [] (auto&& v) { return velm::inversesqrt(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void inversesqrt(InOut&& vals)
+{
+	batch::inversesqrt(vals, vals);
+}
+
+/**
+ * \fn sin
+ * \brief sine of each element
+ *
+ * out[i] = velm::sin(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void sin(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::sin_fn(), [] (auto&& v) { return velm::sin(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void sin(InOut&& vals)
+{
+	batch::sin(vals, vals);
+}
+
+/**
+ * \fn cos
+ * \brief cosine of each element
+ *
+ * out[i] = velm::cos(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void cos(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::cos_fn(), [] (auto&& v) { return velm::cos(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void cos(InOut&& vals)
+{
+	batch::cos(vals, vals);
+}
+
+/**
+ * \fn tan
+ * \brief tangent of each element
+ *
+ * out[i] = velm::tan(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void tan(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::tan_fn(), [] (auto&& v) { return velm::tan(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void tan(InOut&& vals)
+{
+	batch::tan(vals, vals);
+}
+
+/**
+ * \fn floor
+ * \brief floor of each element
+ *
+ * out[i] = velm::floor(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void floor(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::floor_fn(), [] (auto&& v) { return velm::floor(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void floor(InOut&& vals)
+{
+	batch::floor(vals, vals);
+}
+
+/**
+ * \fn ceil
+ * \brief ceiling of each element
+ *
+ * out[i] = velm::ceil(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void ceil(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::ceil_fn(), [] (auto&& v) { return velm::ceil(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void ceil(InOut&& vals)
+{
+	batch::ceil(vals, vals);
+}
+
+/**
+ * \fn fract
+ * \brief fractional part of each element
+ *
+ * out[i] = velm::fract(in[i]). Without out, the range is updated in place.
+ */
+template <typename In, typename Out>
+void fract(const In& in, Out&& out)
+{
+	detail::math_range(velm::detail::fract_fn(), [] (auto&& v) { return velm::fract(v); }, out, in,
+		detail::flat_unary<In, std::remove_reference_t<Out>>());
+}
+
+template <typename InOut>
+void fract(InOut&& vals)
+{
+	batch::fract(vals, vals);
+}
+
+/**
+ * \fn pow
+ * \brief power of each element
+ *
+ * out[i] = velm::pow(x[i], y[i]). y may be a single scalar or vector. Without
+ * out, the result is written to x.
+ */
+template <typename X, typename Y, typename Out>
+void pow(const X& x, const Y& y, Out&& out)
+{
+	detail::math_range(velm::detail::pow_fn(), [] (auto&& p, auto&& q) { return velm::pow(p, q); }, out, x, y,
+		detail::flat_binary<X, Y, std::remove_reference_t<Out>>());
+}
+
+template <typename X, typename Y>
+void pow(X&& x, const Y& y)
+{
+	batch::pow(x, y, x);
+}
+
+/**
+ * \fn atan2
+ * \brief arc tangent of each pair of elements
+ *
+ * out[i] = velm::atan2(y[i], x[i]). x may be a single scalar or vector.
+ * Without out, the result is written to y.
+ */
+template <typename Y, typename X, typename Out>
+void atan2(const Y& y, const X& x, Out&& out)
+{
+	detail::math_range(velm::detail::atan2_fn(), [] (auto&& p, auto&& q) { return velm::atan2(p, q); }, out, y, x,
+		detail::flat_binary<Y, X, std::remove_reference_t<Out>>());
+}
+
+template <typename Y, typename X>
+void atan2(Y&& y, const X& x)
+{
+	batch::atan2(y, x, y);
+}
+
+/**
+ * \fn mod
+ * \brief modulus of each element
+ *
+ * out[i] = velm::mod(x[i], y[i]). y may be a single scalar or vector. Without
+ * out, the result is written to x.
+ */
+template <typename X, typename Y, typename Out>
+void mod(const X& x, const Y& y, Out&& out)
+{
+	detail::math_range(velm::detail::mod_fn(), [] (auto&& p, auto&& q) { return velm::mod(p, q); }, out, x, y,
+		detail::flat_binary<X, Y, std::remove_reference_t<Out>>());
+}
+
+template <typename X, typename Y>
+void mod(X&& x, const Y& y)
+{
+	batch::mod(x, y, x);
+}
+
+/**
+ * \fn sincos
+ * \brief sine and cosine of each element
+ *
+ * s[i] = velm::sin(in[i]) and c[i] = velm::cos(in[i]), sharing the range
+ * reduction. in may be the same range as s or c.
+ */
+template <typename In, typename S, typename C>
+void sincos(const In& in, S&& s, C&& c)
+{
+	detail::sincos_range(in, s, c, std::integral_constant<bool,
+		detail::flat_unary<In, std::remove_reference_t<S>>::value
+		&& detail::flat_unary<In, std::remove_reference_t<C>>::value>());
+}
+
+/**
+ * \fn step
+ * \brief step function of each element
+ *
+ * out[i] = velm::step(edge, x[i]). edge may be a single value or a range.
+ */
+template <typename E, typename X, typename Out>
+void step(const E& edge, const X& x, Out&& out)
+{
+	detail::run<false>([] (auto&& v, auto&& e) { return velm::step(e, v); }, out, x, edge);
+}
+
+/**
+ * \fn smoothstep
+ * \brief Hermite interpolation of each element
+ *
+ * out[i] = velm::smoothstep(edge0, edge1, x[i]). The edges may be single
+ * values or ranges.
+ */
+template <typename E0, typename E1, typename X, typename Out>
+void smoothstep(const E0& edge0, const E1& edge1, const X& x, Out&& out)
+{
+	detail::run<false>([] (auto&& v, auto&& e0, auto&& e1) { return velm::smoothstep(e0, e1, v); }, out, x, edge0, edge1);
+}
+
+// }}}
+// transform {{{
+
+/**
+ * \fn transform
+ * \brief multiply each vector by a matrix
+ *
+ * out[i] = m * in[i]. in and out may be the same range when the matrix is
+ * square.
+ */
+template <typename T, unsigned int R, unsigned int C, typename In, typename Out>
+void transform(const matrix<T, R, C>& m, const In& in, Out&& out)
+{
+	detail::transform_range(m, span<const vector<T, C>>(in), span<vector<T, R>>(out));
+}
+
+/**
+ * \fn transform_points
+ * \brief apply a 4x4 transform to each 3D point
+ *
+ * out[i] is the x, y and z of m * (in[i], 1), i.e. points are translated, and
+ * there is no division by w. Without out, the range is transformed in place.
+ */
+template <typename T, typename In, typename Out>
+void transform_points(const matrix<T, 4, 4>& m, const In& in, Out&& out)
+{
+	detail::transform_points_range(m, span<const vector<T, 3>>(in), span<vector<T, 3>>(out));
+}
+
+template <typename T, typename InOut>
+void transform_points(const matrix<T, 4, 4>& m, InOut&& vals)
+{
+	batch::transform_points(m, vals, vals);
+}
+
+// }}}
+// quaternion {{{
+
+/**
+ * \fn rotate
+ * \brief rotate each vector or quaternion
+ *
+ * out[i] = q[i] * x[i], where x is a range of 3D vectors (which are rotated)
+ * or of quaternions (which are composed). q may be a single quaternion.
+ * Without out, the result is written to x.
+ */
+template <typename Q, typename X, typename Out>
+void rotate(const Q& q, const X& x, Out&& out)
+{
+	detail::run<false>([] (auto&& v, auto&& r) { return r * v; }, out, x, q);
+}
+
+template <typename Q, typename X>
+void rotate(const Q& q, X&& x)
+{
+	batch::rotate(q, x, x);
+}
+
+/**
+ * \fn nlerp
+ * \brief normalised linear interpolation of each pair of quaternions
+ *
+ * out[i] = velm::nlerp(a[i], b[i], t[i]). b and t may be single values.
+ */
+template <typename A, typename B, typename S, typename Out>
+void nlerp(const A& a, const B& b, const S& t, Out&& out)
+{
+	detail::run<false>([] (auto&& x, auto&& y, auto&& w) { return velm::nlerp(x, y, w); }, out, a, b, t);
+}
+
+/**
+ * \fn slerp
+ * \brief spherical linear interpolation of each pair of quaternions
+ *
+ * out[i] = velm::slerp(a[i], b[i], t[i]). b and t may be single values.
+ */
+template <typename A, typename B, typename S, typename Out>
+void slerp(const A& a, const B& b, const S& t, Out&& out)
+{
+	detail::run<true>([] (auto&& x, auto&& y, auto&& w) { return velm::slerp(x, y, w); }, out, a, b, t);
+}
+
+// }}}
+
+} } // namespace velm::batch
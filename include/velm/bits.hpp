@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+	#include <intrin.h>
+#endif
+
+/**
+ * \file bits.hpp
+ * \brief bit scans for masks of lanes and control bytes
+ *
+ * The arguments must not be 0.
+ */
+
+namespace velm { namespace utility {
+
+inline unsigned int count_trailing_zeros(std::uint32_t bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long idx;
+	_BitScanForward(&idx, bits);
+	return static_cast<unsigned int>(idx);
+#else
+	return static_cast<unsigned int>(__builtin_ctz(bits));
+#endif
+}
+
+inline unsigned int count_trailing_zeros(std::uint64_t bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long idx;
+	_BitScanForward64(&idx, bits);
+	return static_cast<unsigned int>(idx);
+#else
+	return static_cast<unsigned int>(__builtin_ctzll(bits));
+#endif
+}
+
+inline unsigned int count_leading_zeros(std::uint32_t bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long idx;
+	_BitScanReverse(&idx, bits);
+	return 31 - static_cast<unsigned int>(idx);
+#else
+	return static_cast<unsigned int>(__builtin_clz(bits));
+#endif
+}
+
+inline unsigned int count_leading_zeros(std::uint64_t bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long idx;
+	_BitScanReverse64(&idx, bits);
+	return 63 - static_cast<unsigned int>(idx);
+#else
+	return static_cast<unsigned int>(__builtin_clzll(bits));
+#endif
+}
+
+} } // namespace velm::utility
@@ -0,0 +1,716 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "exec.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+#include "pack.hpp"
+#include "bits.hpp"
+
+/**
+ * \file bvh.hpp
+ * \brief bounding volume hierarchy over triangles, and ray queries
+ *
+ * velm::bvh<W> is built from a triangle soup, a range of vector<float, 3>
+ * holding three vertices per triangle, and finds the closest hit of rays
+ * with the triangles, either one ray at a time or in packets of W rays:
+ *
+ *      velm::bvh<4> scene(vertices);
+ *      velm::ray_hit hit = scene.intersect(velm::ray<float>{origin, dir, 0.f, 1e30f});
+ *      if(hit.triangle != scene.npos) { ... }
+ *
+ * A packet is a velm::ray<velm::pack<float, W>>, i.e. W rays with their
+ * origins and directions stored as vectors of packs (see pack.hpp).
+ *
+ * The tree is first built as a binary tree with the surface area heuristic,
+ * evaluated over 16 bins of the triangle centroids along each axis, down to
+ * leaves of at most W triangles. It is then collapsed into W-wide nodes, by
+ * repeatedly opening the child with the largest surface area, and stored in
+ * a flat array. Each node holds the bounds of its W children as
+ * vector<pack<float, W>, 3>, so a single ray is tested against all of them
+ * at once. Leaves are stored the same way, as W triangles a lane each, and
+ * are tested with the batched Möller-Trumbore kernel, intersect_triangle.
+ *
+ * The constructor also takes an execution policy (see exec.hpp). A parallel
+ * build splits large ranges as usual and builds both halves of the binary
+ * tree at the same time, which gives the same tree as a sequential build.
+ * Collapsing it into wide nodes is sequential.
+ */
+
+namespace velm {
+
+/**
+ * \struct ray
+ * \brief ray from origin along direction, over the interval [tmin, tmax]
+ *
+ * T is float for a single ray, or pack<float, W> for a packet of W rays.
+ * direction does not need to be normalised, and t is measured in multiples
+ * of it.
+ */
+template <typename T>
+struct ray
+{
+	vector<T, 3> origin;
+	vector<T, 3> direction;
+	T tmin;
+	T tmax;
+};
+
+/**
+ * \struct ray_hit
+ * \brief closest intersection of a ray
+ *
+ * The hit point is origin + t * direction, or equally
+ * (1 - u - v) * v0 + u * v1 + v * v2 of the triangle. triangle is the index
+ * of the triangle in the range the bvh was built from, or bvh::npos if the
+ * ray missed, in which case t is the tmax of the ray.
+ */
+struct ray_hit
+{
+	float t;
+	float u;
+	float v;
+	std::uint32_t triangle;
+};
+
+/**
+ * \fn intersect_triangle
+ * \brief Möller-Trumbore ray/triangle intersection
+ *
+ * The triangle is given as its first vertex v0 and the edges e1 = v1 - v0
+ * and e2 = v2 - v0. Writes the ray parameter t and the barycentric
+ * coordinates u and v of the intersection with the plane of the triangle,
+ * and returns whether it is inside the triangle. The range of t is not
+ * checked.
+ *
+ * T may be float, or a pack to test W rays against one triangle or one ray
+ * against W triangles (with the other side broadcast), in which case the
+ * result is a pack<bool, W>. Triangles with no area never intersect.
+ */
+template <typename T>
+auto intersect_triangle(const vector<T, 3>& origin, const vector<T, 3>& direction,
+	const vector<T, 3>& v0, const vector<T, 3>& e1, const vector<T, 3>& e2, T& t, T& u, T& v)
+{
+	const vector<T, 3> p = cross(direction, e2);
+	const T det = dot(e1, p);
+	const T inv_det = T(1.f) / det;
+	const vector<T, 3> s = origin - v0;
+	u = dot(s, p) * inv_det;
+	const vector<T, 3> q = cross(s, e1);
+	v = dot(direction, q) * inv_det;
+	t = dot(e2, q) * inv_det;
+	return (det != T(0.f)) && (u >= T(0.f)) && (v >= T(0.f)) && (u + v <= T(1.f));
+}
+
+/**
+ * \struct bvh
+ * \brief W-wide bounding volume hierarchy over a triangle soup
+ */
+template <unsigned int W = 4>
+struct bvh
+{
+	static_assert(W >= 2 && W <= 16, "bvh nodes must have between 2 and 16 children");
+
+public: // statics
+
+	static constexpr auto width = W;
+	static constexpr unsigned int bins = 16;
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+	using size_type = std::size_t;
+	using packet_type = ray<pack<float, W>>;
+
+private:
+
+	using lanes = pack<float, W>;
+	using lane_vector = vector<lanes, 3>;
+
+	// references to leaves have this bit set, and otherwise refer to nodes
+	static constexpr std::uint32_t leaf_bit = 0x80000000u;
+
+	/*
+	 * Past this depth of the binary tree, ranges are split at their median
+	 * rather than with the SAH, so the depth is bounded by max_depth + 32
+	 * and traversal stacks can have a fixed size.
+	 */
+	static constexpr unsigned int max_depth = 48;
+	static constexpr unsigned int stack_size = (max_depth + 32) * (W - 1) + 1;
+	// smaller subtrees are built by the thread which split them
+	static constexpr std::size_t parallel_build_size = 16384;
+
+	struct node
+	{
+		lane_vector lo;
+		lane_vector hi;
+		std::uint32_t child[W];
+	};
+
+	struct triangle_pack
+	{
+		lane_vector v0;
+		lane_vector e1;
+		lane_vector e2;
+		std::uint32_t index[W];
+	};
+
+	struct box
+	{
+		vector<float, 3> lo = vector<float, 3>(std::numeric_limits<float>::infinity());
+		vector<float, 3> hi = vector<float, 3>(-std::numeric_limits<float>::infinity());
+
+		void grow(const vector<float, 3>& p)
+		{
+			lo = min(lo, p);
+			hi = max(hi, p);
+		}
+
+		void grow(const box& b)
+		{
+			lo = min(lo, b.lo);
+			hi = max(hi, b.hi);
+		}
+
+		float area() const
+		{
+			const vector<float, 3> d = hi - lo;
+			return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+		}
+	};
+
+	struct build_item
+	{
+		box bounds;
+		vector<float, 3> centroid;
+		std::uint32_t index;
+	};
+
+	// count is 0 for inner nodes
+	struct build_node
+	{
+		box bounds;
+		std::uint32_t left;
+		std::uint32_t right;
+		size_type begin;
+		size_type count;
+	};
+
+	std::vector<node> nodes;
+	std::vector<triangle_pack> leaves;
+	std::uint32_t root = npos;
+	size_type count = 0;
+
+	/*
+	 * Binned SAH: the cost of a split is the number of triangles on each
+	 * side times the area of its bounds. Returns the position items are
+	 * partitioned at.
+	 */
+	static size_type split_sah(build_item* items, size_type begin, size_type end, const box& centroids, unsigned int depth)
+	{
+		const size_type mid = begin + (end - begin) / 2;
+		const auto median = [&] (unsigned int axis) {
+			std::nth_element(items + begin, items + mid, items + end, [axis] (const build_item& a, const build_item& b) {
+				return a.centroid[axis] < b.centroid[axis];
+			});
+			return mid;
+		};
+
+		const vector<float, 3> extent = centroids.hi - centroids.lo;
+		unsigned int widest = 0;
+		for(unsigned int k = 1; k < 3; ++k) {
+			widest = extent[k] > extent[widest] ? k : widest;
+		}
+		if(depth >= max_depth || !(extent[widest] > 0.f)) {
+			// all centroids coincide (or the tree is too deep), any split will do
+			return median(widest);
+		}
+
+		float best_cost = std::numeric_limits<float>::infinity();
+		unsigned int best_axis = 0;
+		unsigned int best_bin = 0;
+		for(unsigned int axis = 0; axis < 3; ++axis) {
+			if(!(extent[axis] > 0.f)) {
+				continue;
+			}
+			const float scale = bins / extent[axis];
+
+			box bin_bounds[bins];
+			size_type bin_count[bins] = {};
+			for(size_type i = begin; i < end; ++i) {
+				const unsigned int b = std::min(bins - 1, static_cast<unsigned int>((items[i].centroid[axis] - centroids.lo[axis]) * scale));
+				bin_bounds[b].grow(items[i].bounds);
+				++bin_count[b];
+			}
+
+			// costs of the right sides, then sweep the left sides against them
+			float right_cost[bins];
+			box right;
+			size_type right_count = 0;
+			for(unsigned int b = bins - 1; b > 0; --b) {
+				right.grow(bin_bounds[b]);
+				right_count += bin_count[b];
+				right_cost[b] = right_count == 0 ? 0.f : right.area() * right_count;
+			}
+			box left;
+			size_type left_count = 0;
+			for(unsigned int b = 1; b < bins; ++b) {
+				left.grow(bin_bounds[b - 1]);
+				left_count += bin_count[b - 1];
+				if(left_count == 0 || left_count == end - begin) {
+					continue;
+				}
+				const float cost = left.area() * left_count + right_cost[b];
+				if(cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_bin = b;
+				}
+			}
+		}
+
+		if(!(best_cost < std::numeric_limits<float>::infinity())) {
+			return median(widest);
+		}
+
+		const float lo = centroids.lo[best_axis];
+		const float scale = bins / extent[best_axis];
+		build_item* split = std::partition(items + begin, items + end, [&] (const build_item& item) {
+			return std::min(bins - 1, static_cast<unsigned int>((item.centroid[best_axis] - lo) * scale)) < best_bin;
+		});
+		return static_cast<size_type>(split - items);
+	}
+
+	/*
+	 * Nodes are appended to out in depth first order. In parallel, the right
+	 * subtree is built into a vector of its own and appended after the left
+	 * one, so the nodes end up in the same order either way.
+	 */
+	static std::uint32_t build_binary(const exec::policy& policy, std::vector<build_node>& out, build_item* items,
+		size_type begin, size_type end, unsigned int depth)
+	{
+		box bounds;
+		box centroids;
+		for(size_type i = begin; i < end; ++i) {
+			bounds.grow(items[i].bounds);
+			centroids.grow(items[i].centroid);
+		}
+
+		const std::uint32_t idx = static_cast<std::uint32_t>(out.size());
+		out.push_back({bounds, 0, 0, begin, end - begin});
+		if(end - begin <= W) {
+			return idx;
+		}
+
+		const size_type mid = split_sah(items, begin, end, centroids, depth);
+		std::uint32_t left;
+		std::uint32_t right;
+		if(!policy.parallel || end - begin < parallel_build_size) {
+			left = build_binary(exec::seq, out, items, begin, mid, depth + 1);
+			right = build_binary(exec::seq, out, items, mid, end, depth + 1);
+		} else {
+			std::vector<build_node> rhs;
+			exec::for_each_chunk(policy.with_chunk_size(1), 2, [&] (std::size_t child, std::size_t) {
+				if(child == 0) {
+					left = build_binary(policy, out, items, begin, mid, depth + 1);
+				} else {
+					build_binary(policy, rhs, items, mid, end, depth + 1);
+				}
+			});
+			const std::uint32_t base = static_cast<std::uint32_t>(out.size());
+			for(build_node& bn : rhs) {
+				if(bn.count == 0) {
+					bn.left += base;
+					bn.right += base;
+				}
+			}
+			right = base;
+			out.insert(out.end(), rhs.begin(), rhs.end());
+		}
+		out[idx].left = left;
+		out[idx].right = right;
+		out[idx].count = 0;
+		return idx;
+	}
+
+	template <typename Range>
+	std::uint32_t emit_leaf(const Range& vertices, const build_item* items, const build_node& bn)
+	{
+		triangle_pack leaf;
+		for(unsigned int k = 0; k < 3; ++k) {
+			leaf.v0[k] = lanes(0.f);
+			leaf.e1[k] = lanes(0.f);
+			leaf.e2[k] = lanes(0.f);
+		}
+		for(unsigned int i = 0; i < W; ++i) {
+			leaf.index[i] = npos;
+		}
+		for(size_type i = 0; i < bn.count; ++i) {
+			const std::uint32_t tri = items[bn.begin + i].index;
+			const vector<float, 3> a = vertices[3 * size_type(tri)];
+			const vector<float, 3> b = vertices[3 * size_type(tri) + 1];
+			const vector<float, 3> c = vertices[3 * size_type(tri) + 2];
+			for(unsigned int k = 0; k < 3; ++k) {
+				leaf.v0[k][i] = a[k];
+				leaf.e1[k][i] = b[k] - a[k];
+				leaf.e2[k][i] = c[k] - a[k];
+			}
+			leaf.index[i] = tri;
+		}
+		leaves.push_back(leaf);
+		return leaf_bit | static_cast<std::uint32_t>(leaves.size() - 1);
+	}
+
+	// a wide node for the binary node b and the subtrees below it
+	template <typename Range>
+	std::uint32_t emit(const Range& vertices, const build_item* items, const std::vector<build_node>& binary, std::uint32_t b)
+	{
+		if(binary[b].count > 0) {
+			return this->emit_leaf(vertices, items, binary[b]);
+		}
+
+		std::uint32_t kids[W] = {binary[b].left, binary[b].right};
+		unsigned int n = 2;
+		while(n < W) {
+			// open the inner child with the largest surface area
+			unsigned int pick = W;
+			float largest = -1.f;
+			for(unsigned int i = 0; i < n; ++i) {
+				const build_node& kid = binary[kids[i]];
+				if(kid.count == 0 && kid.bounds.area() > largest) {
+					largest = kid.bounds.area();
+					pick = i;
+				}
+			}
+			if(pick == W) {
+				break;
+			}
+			const std::uint32_t opened = kids[pick];
+			kids[pick] = binary[opened].left;
+			kids[n++] = binary[opened].right;
+		}
+
+		const std::uint32_t idx = static_cast<std::uint32_t>(nodes.size());
+		nodes.emplace_back();
+		for(unsigned int k = 0; k < 3; ++k) {
+			nodes[idx].lo[k] = lanes(std::numeric_limits<float>::infinity());
+			nodes[idx].hi[k] = lanes(-std::numeric_limits<float>::infinity());
+		}
+		for(unsigned int i = 0; i < W; ++i) {
+			nodes[idx].child[i] = npos;
+		}
+
+		for(unsigned int i = 0; i < n; ++i) {
+			const box& bounds = binary[kids[i]].bounds;
+			const std::uint32_t child = this->emit(vertices, items, binary, kids[i]);
+			// emit may have moved the nodes
+			node& nd = nodes[idx];
+			for(unsigned int k = 0; k < 3; ++k) {
+				nd.lo[k][i] = bounds.lo[k];
+				nd.hi[k][i] = bounds.hi[k];
+			}
+			nd.child[i] = child;
+		}
+		return idx;
+	}
+
+	/*
+	 * Children of nd which the ray enters within [tmin, tmax], as a bit per
+	 * child, and the distances at which it enters them. As a loop over the
+	 * lanes, compilers vectorise this at -O2 but fully unroll it and leave it
+	 * scalar at -O3, so it uses SSE directly where available.
+	 */
+	static unsigned int slab_test(const node& nd, const vector<float, 3>& origin, const vector<float, 3>& inv,
+		float tmin, float tmax, float* tnear)
+	{
+		unsigned int mask = 0;
+		unsigned int i = 0;
+#if VELM_SIMD
+		for(; i + 4 <= W; i += 4) {
+			__m128 tn = _mm_set1_ps(tmin);
+			__m128 tf = _mm_set1_ps(tmax);
+			for(unsigned int k = 0; k < 3; ++k) {
+				const __m128 o = _mm_set1_ps(origin[k]);
+				const __m128 d = _mm_set1_ps(inv[k]);
+				const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nd.lo[k].lanes + i), o), d);
+				const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nd.hi[k].lanes + i), o), d);
+				tn = _mm_max_ps(tn, _mm_min_ps(t0, t1));
+				tf = _mm_min_ps(tf, _mm_max_ps(t0, t1));
+			}
+			_mm_storeu_ps(tnear + i, tn);
+			mask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tn, tf))) << i;
+		}
+#endif
+		for(; i < W; ++i) {
+			float tn = tmin;
+			float tf = tmax;
+			for(unsigned int k = 0; k < 3; ++k) {
+				const float t0 = (nd.lo[k][i] - origin[k]) * inv[k];
+				const float t1 = (nd.hi[k][i] - origin[k]) * inv[k];
+				const float near = t0 < t1 ? t0 : t1;
+				const float far = t0 > t1 ? t0 : t1;
+				tn = tn > near ? tn : near;
+				tf = tf < far ? tf : far;
+			}
+			tnear[i] = tn;
+			mask |= static_cast<unsigned int>(tn <= tf) << i;
+		}
+		return mask;
+	}
+
+	// the same for the bounds [lo, hi] against each ray of a packet
+	static unsigned int slab_test(const float (&lo)[3], const float (&hi)[3], const packet_type& rays,
+		const lane_vector& inv, const lanes& tmax, float* tnear)
+	{
+		unsigned int mask = 0;
+		unsigned int i = 0;
+#if VELM_SIMD
+		for(; i + 4 <= W; i += 4) {
+			__m128 tn = _mm_loadu_ps(rays.tmin.lanes + i);
+			__m128 tf = _mm_loadu_ps(tmax.lanes + i);
+			for(unsigned int k = 0; k < 3; ++k) {
+				const __m128 o = _mm_loadu_ps(rays.origin[k].lanes + i);
+				const __m128 d = _mm_loadu_ps(inv[k].lanes + i);
+				const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(lo[k]), o), d);
+				const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(hi[k]), o), d);
+				tn = _mm_max_ps(tn, _mm_min_ps(t0, t1));
+				tf = _mm_min_ps(tf, _mm_max_ps(t0, t1));
+			}
+			_mm_storeu_ps(tnear + i, tn);
+			mask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tn, tf))) << i;
+		}
+#endif
+		for(; i < W; ++i) {
+			float tn = rays.tmin[i];
+			float tf = tmax[i];
+			for(unsigned int k = 0; k < 3; ++k) {
+				const float t0 = (lo[k] - rays.origin[k][i]) * inv[k][i];
+				const float t1 = (hi[k] - rays.origin[k][i]) * inv[k][i];
+				const float near = t0 < t1 ? t0 : t1;
+				const float far = t0 > t1 ? t0 : t1;
+				tn = tn > near ? tn : near;
+				tf = tf < far ? tf : far;
+			}
+			tnear[i] = tn;
+			mask |= static_cast<unsigned int>(tn <= tf) << i;
+		}
+		return mask;
+	}
+
+	/*
+	 * Push the children of nd in mask onto the traversal stack, so that the
+	 * nearest (by tnear) is popped first.
+	 */
+	static void push_children(const node& nd, const float* tnear, unsigned int mask, std::uint32_t* stack, unsigned int& sp)
+	{
+		float keys[W];
+		std::uint32_t refs[W];
+		unsigned int n = 0;
+		for(; mask != 0; mask &= mask - 1) {
+			const unsigned int i = utility::count_trailing_zeros(static_cast<std::uint32_t>(mask));
+			if(nd.child[i] == npos) {
+				continue;
+			}
+			// insertion sort, furthest first
+			unsigned int j = n++;
+			for(; j > 0 && keys[j - 1] < tnear[i]; --j) {
+				keys[j] = keys[j - 1];
+				refs[j] = refs[j - 1];
+			}
+			keys[j] = tnear[i];
+			refs[j] = nd.child[i];
+		}
+		for(unsigned int i = 0; i < n; ++i) {
+			stack[sp++] = refs[i];
+		}
+	}
+
+public: // methods
+
+	bvh() = default;
+
+	/*
+	 * Build from a triangle soup: a range of vector<float, 3> (such as a
+	 * std::vector, vector_array or strided_view) holding the three vertices
+	 * of each triangle in turn.
+	 */
+	template <typename Range>
+	explicit bvh(const Range& vertices)
+		: bvh(exec::seq, vertices)
+	{
+	}
+
+	template <typename Range>
+	bvh(const exec::policy& policy, const Range& vertices)
+	{
+		assert(vertices.size() % 3 == 0);
+		count = vertices.size() / 3;
+		assert(count < leaf_bit);
+		if(count == 0) {
+			return;
+		}
+
+		std::vector<build_item> items(count);
+		exec::for_each_chunk(policy, count, [&] (std::size_t begin, std::size_t end) {
+			for(size_type i = begin; i < end; ++i) {
+				box bounds;
+				bounds.grow(vertices[3 * i]);
+				bounds.grow(vertices[3 * i + 1]);
+				bounds.grow(vertices[3 * i + 2]);
+				items[i].bounds = bounds;
+				items[i].centroid = (bounds.lo + bounds.hi) * 0.5f;
+				items[i].index = static_cast<std::uint32_t>(i);
+			}
+		});
+
+		std::vector<build_node> binary;
+		binary.reserve(2 * (count / W) + 1);
+		build_binary(policy, binary, items.data(), 0, count, 0);
+		root = this->emit(vertices, items.data(), binary, 0);
+	}
+
+	// number of triangles
+	size_type size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	// bytes used by the nodes and leaves
+	size_type memory_usage() const
+	{
+		return nodes.size() * sizeof(node) + leaves.size() * sizeof(triangle_pack);
+	}
+
+	/**
+	 * \fn intersect
+	 * \brief closest intersection of a ray with the triangles
+	 */
+	ray_hit intersect(const ray<float>& r) const
+	{
+		ray_hit out = {r.tmax, 0.f, 0.f, npos};
+		if(root == npos) {
+			return out;
+		}
+
+		const lane_vector origin(r.origin);
+		const lane_vector direction(r.direction);
+		const vector<float, 3> inv = vector<float, 3>(1.f) / r.direction;
+		const lanes tmin(r.tmin);
+
+		std::uint32_t stack[stack_size];
+		unsigned int sp = 0;
+		stack[sp++] = root;
+		while(sp > 0) {
+			const std::uint32_t ref = stack[--sp];
+
+			if(ref & leaf_bit) {
+				const triangle_pack& leaf = leaves[ref & ~leaf_bit];
+				lanes t, u, v;
+				const pack<bool, W> hit = intersect_triangle(origin, direction, leaf.v0, leaf.e1, leaf.e2, t, u, v)
+					&& (t >= tmin) && (t <= lanes(out.t));
+				for(unsigned int i = 0; i < W; ++i) {
+					if(hit[i] && t[i] <= out.t) {
+						out = {t[i], u[i], v[i], leaf.index[i]};
+					}
+				}
+				continue;
+			}
+
+			const node& nd = nodes[ref];
+			float tnear[W];
+			const unsigned int mask = slab_test(nd, r.origin, inv, r.tmin, out.t, tnear);
+			push_children(nd, tnear, mask, stack, sp);
+		}
+		return out;
+	}
+
+	/**
+	 * \fn intersect
+	 * \brief closest intersections of a packet of W rays
+	 *
+	 * The rays are traversed together, each node being fetched once for the
+	 * packet, so this only pays off for coherent rays, such as those through
+	 * neighbouring pixels. Incoherent rays are faster one at a time. Writes W
+	 * hits to out.
+	 */
+	void intersect(const packet_type& rays, ray_hit* out) const
+	{
+		lanes best_t = rays.tmax;
+		lanes best_u(0.f);
+		lanes best_v(0.f);
+		std::uint32_t best_tri[W];
+		for(unsigned int i = 0; i < W; ++i) {
+			best_tri[i] = npos;
+		}
+
+		if(root != npos) {
+			const lane_vector inv = lane_vector(lanes(1.f)) / rays.direction;
+
+			std::uint32_t stack[stack_size];
+			unsigned int sp = 0;
+			stack[sp++] = root;
+			while(sp > 0) {
+				const std::uint32_t ref = stack[--sp];
+
+				if(ref & leaf_bit) {
+					const triangle_pack& leaf = leaves[ref & ~leaf_bit];
+					for(unsigned int j = 0; j < W && leaf.index[j] != npos; ++j) {
+						const lane_vector v0(lanes(leaf.v0[0][j]), lanes(leaf.v0[1][j]), lanes(leaf.v0[2][j]));
+						const lane_vector e1(lanes(leaf.e1[0][j]), lanes(leaf.e1[1][j]), lanes(leaf.e1[2][j]));
+						const lane_vector e2(lanes(leaf.e2[0][j]), lanes(leaf.e2[1][j]), lanes(leaf.e2[2][j]));
+						lanes t, u, v;
+						const pack<bool, W> hit = intersect_triangle(rays.origin, rays.direction, v0, e1, e2, t, u, v)
+							&& (t >= rays.tmin) && (t <= best_t);
+						if(any(hit)) {
+							best_t = select(hit, t, best_t);
+							best_u = select(hit, u, best_u);
+							best_v = select(hit, v, best_v);
+							for(unsigned int i = 0; i < W; ++i) {
+								best_tri[i] = hit[i] ? leaf.index[j] : best_tri[i];
+							}
+						}
+					}
+					continue;
+				}
+
+				// each child against all rays, ordered by the nearest entry of any ray
+				const node& nd = nodes[ref];
+				float tnear_child[W];
+				unsigned int hit_children = 0;
+				for(unsigned int c = 0; c < W && nd.child[c] != npos; ++c) {
+					const float lo[3] = {nd.lo[0][c], nd.lo[1][c], nd.lo[2][c]};
+					const float hi[3] = {nd.hi[0][c], nd.hi[1][c], nd.hi[2][c]};
+					float tnear[W];
+					unsigned int mask = slab_test(lo, hi, rays, inv, best_t, tnear);
+					if(mask != 0) {
+						float nearest = std::numeric_limits<float>::infinity();
+						for(; mask != 0; mask &= mask - 1) {
+							nearest = std::min(nearest, tnear[utility::count_trailing_zeros(static_cast<std::uint32_t>(mask))]);
+						}
+						tnear_child[c] = nearest;
+						hit_children |= 1u << c;
+					}
+				}
+				push_children(nd, tnear_child, hit_children, stack, sp);
+			}
+		}
+
+		for(unsigned int i = 0; i < W; ++i) {
+			out[i] = {best_t[i], best_u[i], best_v[i], best_tri[i]};
+		}
+	}
+};
+
+} // namespace velm
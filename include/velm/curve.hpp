@@ -0,0 +1,423 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "dispatch.hpp"
+
+#if VELM_DISPATCH || defined(__BMI2__)
+	#include <immintrin.h>
+#endif
+
+/**
+ * \file curve.hpp
+ * \brief Morton and Hilbert keys of points
+ *
+ * Sorting points by their position along a space-filling curve puts points
+ * which are close in space close in memory, so neighbour queries over sorted
+ * points touch fewer cache lines (see spatial_sort in sort.hpp).
+ *
+ * morton_encode interleaves the bits of the components of a vector of 2 or 3
+ * unsigned integers into a 64 bit key (Z-order), and hilbert_encode maps it to
+ * its index along a Hilbert curve, which has no long jumps between
+ * consecutive keys but takes longer to compute:
+ *
+ *      std::uint64_t key = velm::morton_encode(velm::vector<std::uint32_t, 3>(x, y, z));
+ *      velm::vector<std::uint32_t, 3> p = velm::morton_decode<3>(key);
+ *
+ * Keys hold curve_bits<N>() bits of each component: 32 for 2 components, and
+ * 21 for 3. curve_keys computes the keys of a whole range of points, mapping
+ * them onto that grid from a bounding box first.
+ *
+ * Interleaving bits is a single instruction with BMI2 (pdep and pext), and
+ * otherwise a few shifts and masks per component. The single vector functions
+ * use BMI2 if the translation unit is built for it (e.g. -mbmi2 or
+ * -march=haswell), and curve_keys also picks it at run time where
+ * dispatch::fast_bit_deposit() is true (see dispatch.hpp).
+ */
+
+namespace velm {
+
+/**
+ * \fn curve_bits
+ * \brief bits of each component in a key
+ */
+template <unsigned int N>
+constexpr unsigned int curve_bits()
+{
+	return 64 / N < 32 ? 64 / N : 32;
+}
+
+namespace detail {
+
+	template <unsigned int N>
+	using if_curve_dims = std::enable_if_t<N == 2 || N == 3, int>;
+
+	// magic bits {{{
+
+	// insert a 0 bit after each bit
+	inline std::uint64_t spread_bits(std::uint32_t x, std::integral_constant<unsigned int, 2> /* dims */)
+	{
+		std::uint64_t v = x;
+		v = (v | (v << 16)) & 0x0000ffff0000ffff;
+		v = (v | (v << 8)) & 0x00ff00ff00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0f;
+		v = (v | (v << 2)) & 0x3333333333333333;
+		v = (v | (v << 1)) & 0x5555555555555555;
+		return v;
+	}
+
+	// insert two 0 bits after each of the low 21 bits
+	inline std::uint64_t spread_bits(std::uint32_t x, std::integral_constant<unsigned int, 3> /* dims */)
+	{
+		std::uint64_t v = x & 0x1fffff;
+		v = (v | (v << 32)) & 0x001f00000000ffff;
+		v = (v | (v << 16)) & 0x001f0000ff0000ff;
+		v = (v | (v << 8)) & 0x100f00f00f00f00f;
+		v = (v | (v << 4)) & 0x10c30c30c30c30c3;
+		v = (v | (v << 2)) & 0x1249249249249249;
+		return v;
+	}
+
+	inline std::uint32_t compact_bits(std::uint64_t v, std::integral_constant<unsigned int, 2> /* dims */)
+	{
+		v &= 0x5555555555555555;
+		v = (v | (v >> 1)) & 0x3333333333333333;
+		v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0f;
+		v = (v | (v >> 4)) & 0x00ff00ff00ff00ff;
+		v = (v | (v >> 8)) & 0x0000ffff0000ffff;
+		v = (v | (v >> 16)) & 0x00000000ffffffff;
+		return static_cast<std::uint32_t>(v);
+	}
+
+	inline std::uint32_t compact_bits(std::uint64_t v, std::integral_constant<unsigned int, 3> /* dims */)
+	{
+		v &= 0x1249249249249249;
+		v = (v | (v >> 2)) & 0x10c30c30c30c30c3;
+		v = (v | (v >> 4)) & 0x100f00f00f00f00f;
+		v = (v | (v >> 8)) & 0x001f0000ff0000ff;
+		v = (v | (v >> 16)) & 0x001f00000000ffff;
+		v = (v | (v >> 32)) & 0x00000000001fffff;
+		return static_cast<std::uint32_t>(v);
+	}
+
+	// }}}
+	// morton {{{
+
+	// the key bits of component 0; component k has these shifted by k
+	template <unsigned int N>
+	constexpr std::uint64_t morton_mask()
+	{
+		return N == 2 ? 0x5555555555555555 : 0x1249249249249249;
+	}
+
+	/*
+	 * The std::false_type versions are built for the translation unit, and
+	 * use BMI2 if it was built for that. The std::true_type versions are
+	 * only called from kernels which checked for BMI2 at run time.
+	 */
+	template <unsigned int N>
+	std::uint64_t morton_encode(const vector<std::uint32_t, N>& v, std::false_type /* bmi2 */)
+	{
+		std::uint64_t key = 0;
+		for(unsigned int k = 0; k < N; ++k) {
+#if defined(__BMI2__)
+			key |= _pdep_u64(v[k], morton_mask<N>() << k);
+#else
+			key |= spread_bits(v[k], std::integral_constant<unsigned int, N>()) << k;
+#endif
+		}
+		return key;
+	}
+
+	template <unsigned int N>
+	vector<std::uint32_t, N> morton_decode(std::uint64_t key, std::false_type /* bmi2 */)
+	{
+		vector<std::uint32_t, N> v;
+		for(unsigned int k = 0; k < N; ++k) {
+#if defined(__BMI2__)
+			v[k] = static_cast<std::uint32_t>(_pext_u64(key, morton_mask<N>() << k));
+#else
+			v[k] = compact_bits(key >> k, std::integral_constant<unsigned int, N>());
+#endif
+		}
+		return v;
+	}
+
+#if VELM_DISPATCH
+
+	template <unsigned int N>
+	__attribute__((target("bmi2"))) std::uint64_t morton_encode(const vector<std::uint32_t, N>& v, std::true_type /* bmi2 */)
+	{
+		std::uint64_t key = 0;
+		for(unsigned int k = 0; k < N; ++k) {
+			key |= _pdep_u64(v[k], morton_mask<N>() << k);
+		}
+		return key;
+	}
+
+	template <unsigned int N>
+	__attribute__((target("bmi2"))) vector<std::uint32_t, N> morton_decode(std::uint64_t key, std::true_type /* bmi2 */)
+	{
+		vector<std::uint32_t, N> v;
+		for(unsigned int k = 0; k < N; ++k) {
+			v[k] = static_cast<std::uint32_t>(_pext_u64(key, morton_mask<N>() << k));
+		}
+		return v;
+	}
+
+#endif
+
+	// }}}
+	// hilbert {{{
+
+	/*
+	 * Invert the low bits p of x0 if the bit of xi is set, or exchange them
+	 * with those of xi otherwise. The bits are random, so this is done
+	 * without branches.
+	 */
+	inline void hilbert_step(std::uint32_t& x0, std::uint32_t& xi, std::uint32_t p, bool set)
+	{
+		const std::uint32_t invert = p & (std::uint32_t(0) - std::uint32_t(set));
+		const std::uint32_t exchange = (x0 ^ xi) & p & ~invert;
+		x0 ^= invert | exchange;
+		xi ^= exchange;
+	}
+
+	/*
+	 * Skilling's conversion between coordinates and the "transposed" Hilbert
+	 * index, where bit b of the index is spread over bit b / N of the
+	 * components, most significant component first ("Programming the
+	 * Hilbert curve", AIP Conference Proceedings 707, 2004).
+	 */
+	template <unsigned int N>
+	void hilbert_transpose(std::uint32_t (&x)[N])
+	{
+		constexpr std::uint32_t top = std::uint32_t(1) << (curve_bits<N>() - 1);
+
+		for(std::uint32_t q = top; q > 1; q >>= 1) {
+			const std::uint32_t p = q - 1;
+			for(unsigned int i = 0; i < N; ++i) {
+				hilbert_step(x[0], x[i], p, (x[i] & q) != 0);
+			}
+		}
+
+		// gray code
+		for(unsigned int i = 1; i < N; ++i) {
+			x[i] ^= x[i - 1];
+		}
+		// each set bit of the last component inverts the bits below it
+		std::uint32_t t = x[N - 1];
+		t ^= t >> 1;
+		t ^= t >> 2;
+		t ^= t >> 4;
+		t ^= t >> 8;
+		t ^= t >> 16;
+		t >>= 1;
+		for(unsigned int i = 0; i < N; ++i) {
+			x[i] ^= t;
+		}
+	}
+
+	template <unsigned int N>
+	void hilbert_untranspose(std::uint32_t (&x)[N])
+	{
+		// gray decode
+		const std::uint32_t t = x[N - 1] >> 1;
+		for(unsigned int i = N - 1; i > 0; --i) {
+			x[i] ^= x[i - 1];
+		}
+		x[0] ^= t;
+
+		for(unsigned int b = 1; b < curve_bits<N>(); ++b) {
+			const std::uint32_t q = std::uint32_t(1) << b;
+			const std::uint32_t p = q - 1;
+			for(unsigned int i = N; i-- > 0; ) {
+				hilbert_step(x[0], x[i], p, (x[i] & q) != 0);
+			}
+		}
+	}
+
+	template <unsigned int N, typename BMI2>
+	std::uint64_t hilbert_encode(const vector<std::uint32_t, N>& v, BMI2 bmi2)
+	{
+		constexpr std::uint32_t mask = curve_bits<N>() == 32 ? ~std::uint32_t(0) : (std::uint32_t(1) << curve_bits<N>()) - 1;
+
+		std::uint32_t x[N];
+		for(unsigned int k = 0; k < N; ++k) {
+			x[k] = v[k] & mask;
+		}
+		hilbert_transpose(x);
+
+		// x[0] holds the most significant bit of each group of N
+		vector<std::uint32_t, N> interleave;
+		for(unsigned int k = 0; k < N; ++k) {
+			interleave[k] = x[N - 1 - k];
+		}
+		return morton_encode(interleave, bmi2);
+	}
+
+	template <unsigned int N, typename BMI2>
+	vector<std::uint32_t, N> hilbert_decode(std::uint64_t key, BMI2 bmi2)
+	{
+		const vector<std::uint32_t, N> interleave = morton_decode<N>(key, bmi2);
+		std::uint32_t x[N];
+		for(unsigned int k = 0; k < N; ++k) {
+			x[k] = interleave[N - 1 - k];
+		}
+		hilbert_untranspose(x);
+
+		vector<std::uint32_t, N> v;
+		for(unsigned int k = 0; k < N; ++k) {
+			v[k] = x[k];
+		}
+		return v;
+	}
+
+	// }}}
+
+	/*
+	 * Maps points in [lo, hi] onto the grid of keys, in double since the
+	 * grid of 2 components is finer than float.
+	 */
+	template <unsigned int N>
+	struct curve_grid
+	{
+		static constexpr double top = double((std::uint64_t(1) << curve_bits<N>()) - 1);
+
+		double offset[N];
+		double scale[N];
+
+		template <typename T>
+		curve_grid(const vector<T, N>& lo, const vector<T, N>& hi)
+		{
+			for(unsigned int k = 0; k < N; ++k) {
+				const double extent = double(hi[k]) - double(lo[k]);
+				offset[k] = double(lo[k]);
+				scale[k] = extent > 0 ? top / extent : 0;
+			}
+		}
+
+		template <typename P>
+		vector<std::uint32_t, N> operator()(const P& p) const
+		{
+			vector<std::uint32_t, N> q;
+			for(unsigned int k = 0; k < N; ++k) {
+				const double t = (double(p[k]) - offset[k]) * scale[k];
+				// NaN goes to 0
+				q[k] = !(t > 0) ? 0 : t < top ? static_cast<std::uint32_t>(t) : static_cast<std::uint32_t>(top);
+			}
+			return q;
+		}
+	};
+
+	template <unsigned int N>
+	constexpr double curve_grid<N>::top;
+
+} // namespace detail
+
+// encoding {{{
+
+/**
+ * \fn morton_encode
+ * \brief Morton (Z-order) key of a point
+ *
+ * Bit b of component k is bit b * N + k of the key. Bits of the components
+ * above curve_bits<N>() are ignored.
+ */
+template <unsigned int N, detail::if_curve_dims<N> = 0>
+std::uint64_t morton_encode(const vector<std::uint32_t, N>& v)
+{
+	return detail::morton_encode(v, std::false_type());
+}
+
+/**
+ * \fn morton_decode
+ * \brief point of a Morton key
+ */
+template <unsigned int N, detail::if_curve_dims<N> = 0>
+vector<std::uint32_t, N> morton_decode(std::uint64_t key)
+{
+	return detail::morton_decode<N>(key, std::false_type());
+}
+
+/**
+ * \fn hilbert_encode
+ * \brief index of a point along a Hilbert curve
+ *
+ * Consecutive indices are always neighbouring points, unlike Morton keys.
+ * Bits of the components above curve_bits<N>() are ignored.
+ */
+template <unsigned int N, detail::if_curve_dims<N> = 0>
+std::uint64_t hilbert_encode(const vector<std::uint32_t, N>& v)
+{
+	return detail::hilbert_encode(v, std::false_type());
+}
+
+/**
+ * \fn hilbert_decode
+ * \brief point at an index along a Hilbert curve
+ */
+template <unsigned int N, detail::if_curve_dims<N> = 0>
+vector<std::uint32_t, N> hilbert_decode(std::uint64_t key)
+{
+	return detail::hilbert_decode<N>(key, std::false_type());
+}
+
+// }}}
+// ranges {{{
+
+/**
+ * \enum curve
+ * \brief space-filling curves for curve_keys and spatial_sort
+ */
+enum class curve
+{
+	morton,
+	hilbert,
+};
+
+namespace detail {
+
+	// keys of the points [begin, end) only, so ranges can be split between threads
+	template <typename Range, unsigned int N>
+	void curve_keys(const Range& points, const curve_grid<N>& grid, std::uint64_t* keys, curve order,
+		std::size_t begin, std::size_t end)
+	{
+		dispatch::invoke_bit_deposit([&] (auto bmi2) {
+			if(order == curve::hilbert) {
+				for(std::size_t i = begin; i < end; ++i) {
+					keys[i] = detail::hilbert_encode(grid(points[i]), bmi2);
+				}
+			} else {
+				for(std::size_t i = begin; i < end; ++i) {
+					keys[i] = detail::morton_encode(grid(points[i]), bmi2);
+				}
+			}
+		});
+	}
+
+} // namespace detail
+
+/**
+ * \fn curve_keys
+ * \brief keys of a range of points along a space-filling curve
+ *
+ * points can be a vector_array, a strided_view or a std::vector of vectors
+ * of 2 or 3 components. Each point is mapped from the box [lo, hi] onto the
+ * grid of curve_bits<N>() bits per component, with points outside the box
+ * clamped to it, and its key is written to keys[i].
+ */
+template <typename Range, typename T, unsigned int N, detail::if_curve_dims<N> = 0>
+void curve_keys(const Range& points, const vector<T, N>& lo, const vector<T, N>& hi, std::uint64_t* keys,
+	curve order = curve::morton)
+{
+	detail::curve_keys(points, detail::curve_grid<N>(lo, hi), keys, order, 0, points.size());
+}
+
+// }}}
+
+} // namespace velm
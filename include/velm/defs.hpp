@@ -23,6 +23,15 @@ struct vec_base;
 template <typename T, unsigned int N>
 struct vector;
 
+template <unsigned int N>
+struct mask;
+
+namespace exec {
+
+struct policy;
+
+} // namespace exec
+
 } // namespace velm
 
 namespace std {
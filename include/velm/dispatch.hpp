@@ -0,0 +1,271 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "simd.hpp"
+
+/**
+ * \file dispatch.hpp
+ * \brief run-time instruction set selection for whole-range kernels
+ *
+ * The loops in batch.hpp and vector_array.hpp are compiled several times: once
+ * for the instruction set the translation unit is built for, and again with
+ * target attributes for AVX2 (with FMA) and AVX-512. The best version which
+ * the CPU supports is chosen when a kernel is first run, so one binary built
+ * for plain x86-64 still uses wide registers on newer hosts.
+ *
+ * The selection is made once and cached, and happens per call of a batch
+ * function, outside its loop, so loops themselves never branch on the level.
+ * Operators on single vectors (simd.hpp) are too small to dispatch, and always
+ * use the instruction set of the translation unit.
+ *
+ * Set the environment variable VELM_ISA to baseline, avx2 or avx512 to force
+ * a lower level, e.g. to compare levels in benchmarks or to reproduce results
+ * from another host. Levels the CPU does not support are ignored. Note that the
+ * AVX2 and AVX-512 kernels may contract multiplies and adds into FMA
+ * instructions (depending on -ffp-contract), so results can differ in the last
+ * bits between levels.
+ *
+ * Dispatch needs GCC or Clang on x86. VELM_DISPATCH is defined to 1 in that
+ * case, and can be defined to 0 before including any velm header to always
+ * run the baseline kernels.
+ */
+
+#if !defined(VELM_DISPATCH)
+	#if VELM_SIMD && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		#define VELM_DISPATCH 1
+	#else
+		#define VELM_DISPATCH 0
+	#endif
+#endif
+
+#if VELM_DISPATCH
+	/*
+	 * flatten inlines everything the kernel calls, so that the loop body is
+	 * compiled for the target too, rather than calling the baseline version.
+	 */
+	#define VELM_TARGET_AVX2 __attribute__((target("avx2,fma"), flatten))
+	#define VELM_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512bw,avx512dq,avx2,fma"), flatten))
+	#define VELM_TARGET_BMI2 __attribute__((target("bmi2"), flatten))
+	#define VELM_TARGET_F16C __attribute__((target("avx2,fma,f16c"), flatten))
+#endif
+
+namespace velm { namespace dispatch {
+
+/**
+ * \enum level
+ * \brief instruction set levels, in increasing order
+ */
+enum class level : int
+{
+	baseline = 0,
+	avx2 = 1,
+	avx512 = 2,
+};
+
+inline const char* name(level l)
+{
+	switch(l) {
+	case level::avx2: return "avx2";
+	case level::avx512: return "avx512";
+	default: return "baseline";
+	}
+}
+
+/**
+ * \fn parse
+ * \brief level from its name, or fallback if it is not recognised
+ *
+ * "sse2" is accepted as another name for the baseline.
+ */
+inline level parse(const char* str, level fallback)
+{
+	if(str == nullptr) {
+		return fallback;
+	} else if(std::strcmp(str, "baseline") == 0 || std::strcmp(str, "sse2") == 0) {
+		return level::baseline;
+	} else if(std::strcmp(str, "avx2") == 0) {
+		return level::avx2;
+	} else if(std::strcmp(str, "avx512") == 0) {
+		return level::avx512;
+	}
+	return fallback;
+}
+
+/**
+ * \fn supported
+ * \brief highest level supported by the CPU (and the OS)
+ */
+inline level supported()
+{
+#if VELM_DISPATCH
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+		&& __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")) {
+		return level::avx512;
+	}
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return level::avx2;
+	}
+#endif
+	return level::baseline;
+}
+
+/**
+ * \fn select
+ * \brief level to run, taking VELM_ISA into account
+ */
+inline level select()
+{
+	const level best = supported();
+	const level wanted = parse(std::getenv("VELM_ISA"), best);
+	return wanted < best ? wanted : best;
+}
+
+/**
+ * \fn active
+ * \brief level chosen for this process
+ *
+ * This is worked out on the first call, and fixed afterwards.
+ */
+inline level active()
+{
+	static const level chosen = select();
+	return chosen;
+}
+
+/**
+ * \fn fast_bit_deposit
+ * \brief whether to use the BMI2 pdep and pext instructions
+ *
+ * The bit interleaving kernels of curve.hpp use these at the avx2 level (all
+ * CPUs with AVX2 also have BMI2), so VELM_ISA=baseline turns them off too.
+ * AMD CPUs before Zen 3 run pdep and pext in microcode, taking hundreds of
+ * cycles rather than 3, and use the portable kernels instead.
+ */
+inline bool fast_bit_deposit()
+{
+#if VELM_DISPATCH
+	static const bool fast = active() >= level::avx2 && __builtin_cpu_supports("bmi2")
+		&& !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+	return fast;
+#else
+	return false;
+#endif
+}
+
+/**
+ * \fn fast_half_conversion
+ * \brief whether to use the F16C instructions to convert to and from half
+ *
+ * Like pdep and pext, these are used at the avx2 level, so VELM_ISA=baseline
+ * turns them off too.
+ */
+inline bool fast_half_conversion()
+{
+#if VELM_DISPATCH
+	static const bool fast = active() >= level::avx2 && __builtin_cpu_supports("f16c");
+	return fast;
+#else
+	return false;
+#endif
+}
+
+#if VELM_DISPATCH
+
+namespace detail {
+
+	template <typename F>
+	VELM_TARGET_BMI2 void call_bmi2(F& f)
+	{
+		f(std::true_type());
+	}
+
+	template <typename F>
+	VELM_TARGET_F16C void call_f16c(F& f)
+	{
+		f(std::true_type());
+	}
+
+	template <typename F>
+	VELM_TARGET_AVX2 void call_avx2(F& f)
+	{
+		f();
+	}
+
+	template <typename F>
+	VELM_TARGET_AVX512 void call_avx512(F& f)
+	{
+		f();
+	}
+
+} // namespace detail
+
+#endif
+
+/**
+ * \fn invoke
+ * \brief call a kernel, compiled for the active level
+ *
+ * f is usually a lambda containing the whole loop, so the loop is compiled
+ * for each level, and the level is only checked once.
+ */
+template <typename F>
+void invoke(F&& f)
+{
+#if VELM_DISPATCH
+	switch(active()) {
+	case level::avx512:
+		detail::call_avx512(f);
+		return;
+	case level::avx2:
+		detail::call_avx2(f);
+		return;
+	default:
+		break;
+	}
+#endif
+	f();
+}
+
+/**
+ * \fn invoke_bit_deposit
+ * \brief call a kernel, with or without pdep and pext
+ *
+ * f is called with std::true_type, compiled for BMI2, if fast_bit_deposit()
+ * is true, and with std::false_type otherwise.
+ */
+template <typename F>
+void invoke_bit_deposit(F&& f)
+{
+#if VELM_DISPATCH
+	if(fast_bit_deposit()) {
+		detail::call_bmi2(f);
+		return;
+	}
+#endif
+	f(std::false_type());
+}
+
+/**
+ * \fn invoke_half_conversion
+ * \brief call a kernel, with or without the F16C instructions
+ *
+ * f is called with std::true_type, compiled for AVX2 and F16C, if
+ * fast_half_conversion() is true, and with std::false_type otherwise.
+ */
+template <typename F>
+void invoke_half_conversion(F&& f)
+{
+#if VELM_DISPATCH
+	if(fast_half_conversion()) {
+		detail::call_f16c(f);
+		return;
+	}
+#endif
+	f(std::false_type());
+}
+
+} } // namespace velm::dispatch
@@ -0,0 +1,849 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <unistd.h>
+#endif
+
+#include "defs.hpp"
+#include "utility.hpp"
+#include "vector_array.hpp"
+#include "batch.hpp"
+#include "dispatch.hpp"
+
+/**
+ * \file exec.hpp
+ * \brief execution policies, and the thread pool which runs them
+ *
+ * Whole-range operations take a velm::exec::policy as their first argument
+ * to spread across cores:
+ *
+ *      velm::batch::normalize(velm::exec::par, dirs, out);
+ *      velm::array_transform(velm::exec::par, out, [] (auto&& p, auto&& v) { return p + v * dt; }, pos, vel);
+ *
+ * seq runs on the calling thread, and par splits the range into chunks
+ * which the threads of a pool take in turn. par_unseq is accepted for
+ * symmetry with the standard library, and behaves as par: velm kernels are
+ * vectorised either way. This header provides the policy overloads of the
+ * functions in batch.hpp, array_transform and array_apply; sort.hpp,
+ * kdtree.hpp, bvh.hpp and spatial_grid.hpp have their own.
+ *
+ * Chunks are sized so the data of each fits in half of the L2 cache, and
+ * not below 16 KiB so the cost of scheduling stays small. For par, large
+ * chunks are split further so each thread gets several, and faster threads
+ * take (steal) the chunks of slower ones.
+ *
+ * for_each_chunk runs a function over the chunks of a range, and reduce
+ * combines a result per chunk:
+ *
+ *      auto bounds = velm::exec::reduce(velm::exec::par, points.size(), box(),
+ *          [&] (std::size_t begin, std::size_t end) { ... return chunk_box; },
+ *          [] (const box& a, const box& b) { return merge(a, b); });
+ *
+ * The chunk results are combined in a fixed tree, so reduce returns the
+ * same result for the same chunks. Since floating point addition is not
+ * associative, sums can still change with the number of threads, which
+ * splits chunks differently. policy::with_deterministic() fixes the chunks
+ * too, at 16 KiB whatever the cache size, so results are the same with seq
+ * and par on any number of threads and on any machine.
+ *
+ * The default pool has a thread per core (including the calling thread),
+ * or VELM_THREADS threads if that environment variable is set, and is
+ * started on first use. Code using this header must be linked with the
+ * thread library (e.g. -pthread, or Threads::Threads with CMake).
+ */
+
+namespace velm { namespace exec {
+
+struct thread_pool;
+
+/**
+ * \struct policy
+ * \brief how to run an operation over a range
+ */
+struct policy
+{
+	bool parallel;
+	bool unsequenced;
+	bool deterministic;
+	// elements per chunk, or 0 for the default of exec::chunk_size
+	std::size_t chunk_size;
+	// the pool to run on, or null for default_pool()
+	thread_pool* pool;
+
+	constexpr policy with_chunk_size(std::size_t n) const
+	{
+		return {parallel, unsequenced, deterministic, n, pool};
+	}
+
+	constexpr policy with_deterministic(bool d = true) const
+	{
+		return {parallel, unsequenced, d, chunk_size, pool};
+	}
+
+	constexpr policy with_pool(thread_pool& p) const
+	{
+		return {parallel, unsequenced, deterministic, chunk_size, &p};
+	}
+};
+
+constexpr policy seq = {false, false, false, 0, nullptr};
+constexpr policy par = {true, false, false, 0, nullptr};
+constexpr policy par_unseq = {true, true, false, 0, nullptr};
+
+// thread pool {{{
+
+/**
+ * \struct thread_pool
+ * \brief threads running the chunks of parallel loops
+ *
+ * Each worker thread has a queue of tasks, a range of a loop each. A thread
+ * running a task splits it in half until it is a single chunk, and pushes
+ * the second halves onto its own queue, so the largest remaining halves are
+ * at the front. Idle threads steal from the front of the other queues, and
+ * so take large pieces of work, which they split in turn.
+ *
+ * The thread starting a loop runs chunks of it too, and waits by running
+ * any queued task, so loops can be nested (e.g. a parallel batch function
+ * called from the chunks of another loop) without running out of threads.
+ */
+struct thread_pool
+{
+private:
+
+	struct job
+	{
+		void (*call)(void* f, std::size_t begin, std::size_t end);
+		void* f;
+		std::size_t chunk;
+		// elements which have not run yet
+		std::atomic<std::size_t> remaining;
+		std::atomic<bool> failed;
+		std::mutex error_lock;
+		std::exception_ptr error;
+	};
+
+	struct task
+	{
+		job* owner;
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	struct queue
+	{
+		std::size_t index;
+		std::mutex lock;
+		std::deque<task> tasks;
+		// every thread locks its own queue often, so keep queues off each other's cache lines
+		char padding[64];
+	};
+
+	struct worker_id
+	{
+		const thread_pool* pool;
+		std::size_t index;
+	};
+
+	// a queue per worker, then one for all other threads
+	std::vector<std::unique_ptr<queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::atomic<std::size_t> queued{0};
+	std::atomic<unsigned int> sleeping{0};
+	std::mutex sleep_lock;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	static worker_id& current()
+	{
+		static thread_local worker_id id{nullptr, 0};
+		return id;
+	}
+
+	template <typename F>
+	static void call(void* f, std::size_t begin, std::size_t end)
+	{
+		(*static_cast<F*>(f))(begin, end);
+	}
+
+	queue& own_queue()
+	{
+		const worker_id& id = current();
+		return id.pool == this ? *queues[id.index] : *queues.back();
+	}
+
+	void push(queue& q, const task& t)
+	{
+		{
+			std::lock_guard<std::mutex> guard(q.lock);
+			q.tasks.push_back(t);
+		}
+		queued.fetch_add(1);
+		if(sleeping.load() > 0) {
+			// a sleeper checks queued under this lock, so it cannot miss the wake
+			{
+				std::lock_guard<std::mutex> guard(sleep_lock);
+			}
+			wake.notify_one();
+		}
+	}
+
+	// the newest task of the own queue, or the oldest of another
+	bool take(queue& own, task& out)
+	{
+		if(queued.load() == 0) {
+			return false;
+		}
+		{
+			std::lock_guard<std::mutex> guard(own.lock);
+			if(!own.tasks.empty()) {
+				out = own.tasks.back();
+				own.tasks.pop_back();
+				queued.fetch_sub(1);
+				return true;
+			}
+		}
+		const std::size_t n = queues.size();
+		// victims in turn from the next queue, so thieves spread out
+		for(std::size_t i = 1; i < n; ++i) {
+			queue& victim = *queues[(own.index + i) % n];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if(!victim.tasks.empty()) {
+				out = victim.tasks.front();
+				victim.tasks.pop_front();
+				queued.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void run(task t, queue& own)
+	{
+		job& j = *t.owner;
+		while(t.end - t.begin > j.chunk) {
+			// split on a chunk boundary, so chunks are the same however the work is shared
+			const std::size_t chunks = (t.end - t.begin + j.chunk - 1) / j.chunk;
+			const std::size_t mid = t.begin + chunks / 2 * j.chunk;
+			this->push(own, task{&j, mid, t.end});
+			t.end = mid;
+		}
+
+		if(!j.failed.load(std::memory_order_relaxed)) {
+			try {
+				j.call(j.f, t.begin, t.end);
+			} catch(...) {
+				std::lock_guard<std::mutex> guard(j.error_lock);
+				if(!j.failed.exchange(true)) {
+					j.error = std::current_exception();
+				}
+			}
+		}
+		// the job may be gone as soon as the last elements are counted
+		j.remaining.fetch_sub(t.end - t.begin, std::memory_order_acq_rel);
+	}
+
+	void work(std::size_t index)
+	{
+		current() = worker_id{this, index};
+		queue& own = *queues[index];
+		task t;
+		for(;;) {
+			if(this->take(own, t)) {
+				this->run(t, own);
+				continue;
+			}
+			// loops often come in quick succession, so spin briefly before sleeping
+			for(unsigned int spin = 0; spin < 64 && queued.load() == 0; ++spin) {
+				std::this_thread::yield();
+			}
+			if(queued.load() > 0) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> guard(sleep_lock);
+			sleeping.fetch_add(1);
+			wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+			sleeping.fetch_sub(1);
+			if(stopping) {
+				return;
+			}
+		}
+	}
+
+public: // methods
+
+	/*
+	 * A pool running loops on threads threads, counting the thread which
+	 * starts a loop, so threads - 1 worker threads are started.
+	 */
+	explicit thread_pool(unsigned int threads)
+	{
+		threads = std::max(threads, 1u);
+		for(unsigned int i = 0; i < threads; ++i) {
+			queues.emplace_back(new queue());
+			queues.back()->index = i;
+		}
+		for(unsigned int i = 0; i + 1 < threads; ++i) {
+			workers.emplace_back([this, i] { this->work(i); });
+		}
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(sleep_lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(std::thread& t : workers) {
+			t.join();
+		}
+	}
+
+	// threads running loops, including the caller
+	unsigned int size() const
+	{
+		return static_cast<unsigned int>(workers.size() + 1);
+	}
+
+	/**
+	 * \fn parallel_for
+	 * \brief call f(begin, end) over the chunks of [0, n)
+	 *
+	 * Each call covers a single chunk [c * chunk, min((c + 1) * chunk, n)),
+	 * and calls may run concurrently. Returns when all calls are done. If
+	 * f throws, the remaining chunks are skipped and the first exception is
+	 * rethrown.
+	 */
+	template <typename F>
+	void parallel_for(std::size_t n, std::size_t chunk, F&& f)
+	{
+		chunk = std::max(chunk, std::size_t(1));
+		if(workers.empty() || n <= chunk) {
+			for(std::size_t begin = 0; begin < n; begin += chunk) {
+				f(begin, std::min(begin + chunk, n));
+			}
+			return;
+		}
+
+		using func = std::remove_reference_t<F>;
+		job j;
+		j.call = &call<func>;
+		j.f = const_cast<void*>(static_cast<const void*>(&f));
+		j.chunk = chunk;
+		j.remaining.store(n);
+		j.failed.store(false);
+
+		queue& own = this->own_queue();
+		this->run(task{&j, 0, n}, own);
+		task t;
+		while(j.remaining.load(std::memory_order_acquire) != 0) {
+			if(this->take(own, t)) {
+				this->run(t, own);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		if(j.error) {
+			std::rethrow_exception(j.error);
+		}
+	}
+};
+
+/**
+ * \fn default_threads
+ * \brief threads of the default pool
+ *
+ * VELM_THREADS if it is set to a positive number, and otherwise the number
+ * of cores.
+ */
+inline unsigned int default_threads()
+{
+	if(const char* env = std::getenv("VELM_THREADS")) {
+		const long threads = std::strtol(env, nullptr, 10);
+		if(threads > 0) {
+			return static_cast<unsigned int>(threads);
+		}
+	}
+	const unsigned int cores = std::thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
+/**
+ * \fn default_pool
+ * \brief the pool of policies without one, started on first use
+ */
+inline thread_pool& default_pool()
+{
+	static thread_pool pool(default_threads());
+	return pool;
+}
+
+// }}}
+// chunks {{{
+
+/**
+ * \fn cache_size
+ * \brief bytes of L2 cache per core, or 256 KiB if that is unknown
+ */
+inline std::size_t cache_size()
+{
+	static const std::size_t bytes = [] {
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+		const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+		if(l2 > 0) {
+			return static_cast<std::size_t>(l2);
+		}
+#endif
+		return std::size_t(256) * 1024;
+	}();
+	return bytes;
+}
+
+/**
+ * \fn threads
+ * \brief threads a policy runs on
+ */
+inline unsigned int threads(const policy& p)
+{
+	if(!p.parallel) {
+		return 1;
+	}
+	return p.pool != nullptr ? p.pool->size() : default_pool().size();
+}
+
+/**
+ * \fn chunk_size
+ * \brief elements per chunk, for n elements of element_bytes each
+ *
+ * This is the chunk_size of the policy if it has one, or 16 KiB of elements
+ * if the policy is deterministic, so the chunks do not depend on the host.
+ * Otherwise, chunks hold half of the L2 cache, but at least 16 KiB, and are
+ * split so each thread of a parallel policy gets at least four.
+ */
+inline std::size_t chunk_size(const policy& p, std::size_t n, std::size_t element_bytes)
+{
+	if(p.chunk_size > 0) {
+		return p.chunk_size;
+	}
+	element_bytes = std::max(element_bytes, std::size_t(1));
+	const std::size_t least = std::max(std::size_t(16 * 1024) / element_bytes, std::size_t(1));
+	if(p.deterministic) {
+		return least;
+	}
+	const std::size_t cached = std::max(cache_size() / 2 / element_bytes, std::size_t(1));
+	if(!p.parallel) {
+		return cached;
+	}
+	const std::size_t shared = (n + 4 * threads(p) - 1) / (4 * threads(p));
+	return std::max(std::min(cached, shared), least);
+}
+
+/**
+ * \fn for_each_chunk
+ * \brief call f(begin, end) over the chunks of [0, n), or of a range
+ *
+ * With a count, chunks are sized as for 16 byte elements (e.g. a
+ * vector<float, 4>), and with a range (such as a vector_array or
+ * std::vector) for its elements. With a parallel policy, calls run
+ * concurrently, so f must only write to its own chunk (or synchronise).
+ */
+template <typename F>
+void for_each_chunk(const policy& p, std::size_t n, F&& f)
+{
+	const std::size_t chunk = chunk_size(p, n, 16);
+	if(!p.parallel) {
+		for(std::size_t begin = 0; begin < n; begin += chunk) {
+			f(begin, std::min(begin + chunk, n));
+		}
+		return;
+	}
+	thread_pool& pool = p.pool != nullptr ? *p.pool : default_pool();
+	pool.parallel_for(n, chunk, f);
+}
+
+namespace detail {
+
+	template <typename R>
+	using range_size_detect = decltype(std::declval<const R&>().size());
+
+	template <typename R>
+	using if_range = std::enable_if_t<utility::detect<range_size_detect, R>::value_t::value, int>;
+
+} // namespace detail
+
+template <typename Range, typename F, detail::if_range<Range> = 0>
+void for_each_chunk(const policy& p, const Range& range, F&& f)
+{
+	const std::size_t n = range.size();
+	exec::for_each_chunk(p.with_chunk_size(chunk_size(p, n, sizeof(typename Range::value_type))), n, f);
+}
+
+/**
+ * \fn reduce
+ * \brief combine the results of map(begin, end) over the chunks of [0, n)
+ *
+ * The chunk results are combined pairwise, in a fixed order, with
+ * combine(a, b) where a is for the chunks before b. Returns identity if n is
+ * 0. Chunks are sized as for for_each_chunk.
+ */
+template <typename T, typename Map, typename Combine>
+T reduce(const policy& p, std::size_t n, T identity, Map&& map, Combine&& combine)
+{
+	if(n == 0) {
+		return identity;
+	}
+	const std::size_t chunk = chunk_size(p, n, 16);
+	if(!p.parallel && !p.deterministic) {
+		return combine(identity, map(std::size_t(0), n));
+	}
+
+	std::vector<T> partial((n + chunk - 1) / chunk, identity);
+	exec::for_each_chunk(p.with_chunk_size(chunk), n, [&] (std::size_t begin, std::size_t end) {
+		partial[begin / chunk] = map(begin, end);
+	});
+	for(std::size_t step = 1; step < partial.size(); step *= 2) {
+		for(std::size_t i = 0; i + step < partial.size(); i += 2 * step) {
+			partial[i] = combine(partial[i], partial[i + step]);
+		}
+	}
+	return combine(identity, partial[0]);
+}
+
+template <typename Range, typename T, typename Map, typename Combine, detail::if_range<Range> = 0>
+T reduce(const policy& p, const Range& range, T identity, Map&& map, Combine&& combine)
+{
+	const std::size_t n = range.size();
+	return exec::reduce(p.with_chunk_size(chunk_size(p, n, sizeof(typename Range::value_type))), n,
+		std::move(identity), map, combine);
+}
+
+// }}}
+
+} } // namespace velm::exec
+
+namespace velm {
+
+// arrays {{{
+
+/**
+ * \fn array_transform
+ * \brief array_transform, over chunks run as the policy says
+ */
+template <typename Out, typename F, typename... Args>
+Out& array_transform(const exec::policy& policy, Out& out, F&& f, Args&&... args)
+{
+	const std::size_t size = out.size();
+	assert(utility::common_array_size(args...) == std::size_t(-1)
+		|| utility::common_array_size(args...) == size);
+
+	utility::array_cursor<Out> dst(out);
+	exec::for_each_chunk(policy, out, [&] (std::size_t begin, std::size_t end) {
+		auto run = [&] (auto... srcs) {
+			// elements are independent, and out may only alias an input at the same index
+			VELM_IVDEP
+			for(std::size_t i = begin; i < end; ++i) {
+				dst[i] = f(srcs[i]...);
+			}
+		};
+		dispatch::invoke([&] {
+			run(utility::array_cursor_for<Args>(args)...);
+		});
+	});
+	return out;
+}
+
+/**
+ * \fn array_apply
+ * \brief array_apply, over chunks run as the policy says
+ */
+template <typename F, typename... Args>
+auto array_apply(const exec::policy& policy, F&& f, Args&&... args)
+{
+	using result_type = decltype(f(std::declval<utility::array_cursor_for<Args>&>()[0]...));
+	using out_type = typename utility::array_result<result_type>::type;
+
+	const std::size_t size = utility::common_array_size(args...);
+	static_assert(sizeof...(Args) > 0, "At least one argument is required");
+	assert(size != std::size_t(-1) && "At least one argument must be an array");
+
+	out_type out(size);
+	return array_transform(policy, out, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+// }}}
+
+} // namespace velm
+
+namespace velm { namespace batch {
+
+namespace detail {
+
+	// the part of an argument for the chunk [begin, end): ranges are sliced, the rest is passed on
+	template <typename C, std::enable_if_t<is_range<C>::value, int> = 0>
+	span<range_element<C>> slice(C& c, std::size_t begin, std::size_t end)
+	{
+		return {c.data() + begin, end - begin};
+	}
+
+	template <typename C, std::enable_if_t<!is_range<C>::value, int> = 0>
+	C& slice(C& c, std::size_t /* begin */, std::size_t /* end */)
+	{
+		return c;
+	}
+
+	template <typename C, std::enable_if_t<is_range<C>::value, int> = 0>
+	std::size_t element_bytes(const C& /* c */)
+	{
+		return sizeof(range_element<const C>);
+	}
+
+	template <typename C, std::enable_if_t<!is_range<C>::value, int> = 0>
+	std::size_t element_bytes(const C& /* c */)
+	{
+		return 0;
+	}
+
+	/*
+	 * Call f on the slices of args for each chunk. Chunks are sized for the
+	 * bytes of an element of all the ranges together.
+	 */
+	template <typename F, typename... Args>
+	void run_chunks(const exec::policy& policy, F&& f, Args&... args)
+	{
+		std::size_t n = std::size_t(-1);
+		std::size_t bytes = 0;
+		(void)std::initializer_list<int>{ (n = std::min(n, size_of(args)), bytes += element_bytes(args), 0)... };
+		assert(n != std::size_t(-1) && "At least one argument must be a range");
+		assert(sizes_match(n, args...));
+
+		exec::for_each_chunk(policy.with_chunk_size(exec::chunk_size(policy, n, bytes)), n,
+			[&] (std::size_t begin, std::size_t end) {
+				f(slice(args, begin, end)...);
+			});
+	}
+
+} // namespace detail
+
+/*
+ * Each function of batch.hpp taking an output range also takes a policy as
+ * its first argument. There are no policy overloads of the in-place forms:
+ * pass the same range as the input and the output instead.
+ */
+
+// geometric {{{
+
+template <typename In, typename Out>
+void length(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::length(a...); }, in, out);
+}
+
+template <typename P0, typename P1, typename Out>
+void distance(const exec::policy& policy, const P0& p0, const P1& p1, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::distance(a...); }, p0, p1, out);
+}
+
+template <typename L, typename R, typename Out>
+void dot(const exec::policy& policy, const L& lhs, const R& rhs, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::dot(a...); }, lhs, rhs, out);
+}
+
+template <typename In, typename Out>
+void normalize(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::normalize(a...); }, in, out);
+}
+
+template <typename I, typename N, typename Out>
+void reflect(const exec::policy& policy, const I& i, const N& n, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::reflect(a...); }, i, n, out);
+}
+
+// }}}
+// common {{{
+
+template <typename In, typename L, typename H, typename Out>
+void clamp(const exec::policy& policy, const In& in, const L& lo, const H& hi, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::clamp(a...); }, in, lo, hi, out);
+}
+
+template <typename A, typename B, typename WB, typename Out>
+void mix(const exec::policy& policy, const A& a, const B& b, const WB& wb, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... x) { batch::mix(x...); }, a, b, wb, out);
+}
+
+// }}}
+// math {{{
+
+template <typename In, typename Out>
+void exp(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::exp(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void exp2(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::exp2(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void log(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::log(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void log2(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::log2(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void sqrt(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::sqrt(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void inversesqrt(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::inversesqrt(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void sin(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::sin(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void cos(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::cos(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void tan(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::tan(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void floor(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::floor(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void ceil(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::ceil(a...); }, in, out);
+}
+
+template <typename In, typename Out>
+void fract(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::fract(a...); }, in, out);
+}
+
+template <typename X, typename Y, typename Out>
+void pow(const exec::policy& policy, const X& x, const Y& y, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::pow(a...); }, x, y, out);
+}
+
+template <typename Y, typename X, typename Out>
+void atan2(const exec::policy& policy, const Y& y, const X& x, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::atan2(a...); }, y, x, out);
+}
+
+template <typename X, typename Y, typename Out>
+void mod(const exec::policy& policy, const X& x, const Y& y, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::mod(a...); }, x, y, out);
+}
+
+template <typename In, typename S, typename C>
+void sincos(const exec::policy& policy, const In& in, S&& s, C&& c)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::sincos(a...); }, in, s, c);
+}
+
+template <typename E, typename X, typename Out>
+void step(const exec::policy& policy, const E& edge, const X& x, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::step(a...); }, edge, x, out);
+}
+
+template <typename E0, typename E1, typename X, typename Out>
+void smoothstep(const exec::policy& policy, const E0& edge0, const E1& edge1, const X& x, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::smoothstep(a...); }, edge0, edge1, x, out);
+}
+
+// }}}
+// transform {{{
+
+template <typename T, unsigned int R, unsigned int C, typename In, typename Out>
+void transform(const exec::policy& policy, const matrix<T, R, C>& m, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::transform(a...); }, m, in, out);
+}
+
+template <typename T, typename In, typename Out>
+void transform_points(const exec::policy& policy, const matrix<T, 4, 4>& m, const In& in, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::transform_points(a...); }, m, in, out);
+}
+
+// }}}
+// quaternion {{{
+
+template <typename Q, typename X, typename Out>
+void rotate(const exec::policy& policy, const Q& q, const X& x, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... a) { batch::rotate(a...); }, q, x, out);
+}
+
+template <typename A, typename B, typename S, typename Out>
+void nlerp(const exec::policy& policy, const A& a, const B& b, const S& s, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... x) { batch::nlerp(x...); }, a, b, s, out);
+}
+
+template <typename A, typename B, typename S, typename Out>
+void slerp(const exec::policy& policy, const A& a, const B& b, const S& s, Out&& out)
+{
+	detail::run_chunks(policy, [] (auto&&... x) { batch::slerp(x...); }, a, b, s, out);
+}
+
+// }}}
+
+} } // namespace velm::batch
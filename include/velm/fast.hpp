@@ -0,0 +1,335 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+#include "math.hpp"
+#include "pack.hpp"
+
+/**
+ * \file fast.hpp
+ * \brief approximate square roots, reciprocals and normalization
+ *
+ * velm::fast has versions of inversesqrt, sqrt, length, distance and
+ * normalize, plus rcp (1 / x) and divide, which trade a few bits of accuracy
+ * for speed. For float they start from the SSE reciprocal and reciprocal
+ * square root estimates (12 bits) and refine them with one Newton step,
+ * replacing a square root and division (together about 20-40 cycles of
+ * latency, and not pipelined on older CPUs) with a few multiplications:
+ *
+ *      velm::vector<float, 3> n = velm::fast::normalize(a);
+ *      float d = velm::fast::distance(a, b);
+ *
+ * Like the functions of math.hpp they work on scalars, vectors and packs, a
+ * register at a time. Other component types, double included (SSE has no
+ * double estimates), and builds without VELM_SIMD use the exact functions.
+ *
+ * Whether this is faster depends on the CPU, so measure with the benchmarks
+ * (the velm_fast implementations in bench/) before switching. Recent cores
+ * pipeline square roots and divisions, and there the estimates only pay off
+ * with enough independent work: on an Intel Xeon (Emerald Rapids),
+ * normalize of packs of 8 vectors is 1.4-1.6 times as fast and dividing a
+ * vector of 4 or 8 floats by a scalar 1.4-2 times, but length, distance and
+ * divide of single vectors take 2-4 times as long as the exact versions, and
+ * normalize 1.1-1.3 times. Older and low-power cores, with slower square
+ * roots and divisions, gain more.
+ *
+ * Maximum relative errors (about 2-3 ulp, against 0.5-1.5 ulp for the exact
+ * functions), measured over 16 million random arguments spread over the
+ * normal float range, with the estimate tables of an Intel CPU. For
+ * normalize, this is the error of each component of a unit vector of 3 or 4
+ * components.
+ *
+ *      function             fast       exact
+ *      inversesqrt          2.7e-7     0.9e-7
+ *      sqrt                 2.8e-7     0.6e-7
+ *      rcp                  2.0e-7     0.6e-7
+ *      divide               2.4e-7     0.6e-7
+ *      length, distance     3.1e-7     1.4e-7
+ *      normalize            2.9e-7     1.5e-7
+ *
+ * The estimates are tables built into the CPU, which differ between vendors
+ * (and sometimes generations), so results can differ in the last bits
+ * between machines, unlike those of math.hpp. Special values are those of
+ * the exact functions, except that the estimates treat subnormal arguments
+ * as 0, so inversesqrt and rcp return infinity for them and sqrt returns the
+ * argument, and rcp flushes results below FLT_MIN (arguments beyond about
+ * 8.5e37) to 0.
+ */
+
+namespace velm {
+
+namespace detail {
+
+	struct fast_inversesqrt_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::fast_inversesqrt(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			return inversesqrt_fn().fallback(x);
+		}
+	};
+
+	struct fast_inversesqrt_normal_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::fast_inversesqrt_normal(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			return inversesqrt_fn().fallback(x);
+		}
+	};
+
+	struct fast_sqrt_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::fast_sqrt(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			return sqrt_fn().fallback(x);
+		}
+	};
+
+	struct fast_rcp_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::fast_rcp(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			return T(1) / x;
+		}
+	};
+
+	/*
+	 * The component type of a scalar, vector or pack, or of a vector of
+	 * packs. Only float has estimates, so normalize and divide are exact for
+	 * everything else, as if velm::fast were not used.
+	 */
+	template <typename T, typename = void>
+	struct fast_component
+	{
+		using type = T;
+	};
+
+	template <typename T>
+	struct fast_component<T, utility::void_t<typename T::value_type>>
+		: fast_component<typename T::value_type>
+	{
+	};
+
+	template <typename T>
+	using has_fast_estimate = std::is_same<typename fast_component<std::decay_t<T>>::type, float>;
+
+} // namespace detail
+
+namespace fast {
+
+	// roots {{{
+
+	/**
+	 * \fn inversesqrt
+	 * \brief approximate reciprocal of the square root
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto inversesqrt(T x)
+	{
+		return detail::math_call(detail::fast_inversesqrt_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto inversesqrt(const V& vec)
+	{
+		return detail::vector_call(detail::fast_inversesqrt_fn(), vec);
+	}
+
+	template <typename T, unsigned int W>
+	pack<T, W> inversesqrt(const pack<T, W>& p)
+	{
+		return detail::pack_call(detail::fast_inversesqrt_fn(), p, detail::is_kernel_type<T>());
+	}
+
+	/**
+	 * \fn sqrt
+	 * \brief approximate square root
+	 *
+	 * This is x * inversesqrt(x), refined. Square root instructions are
+	 * pipelined on recent CPUs, where this is slower than velm::sqrt.
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto sqrt(T x)
+	{
+		return detail::math_call(detail::fast_sqrt_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto sqrt(const V& vec)
+	{
+		return detail::vector_call(detail::fast_sqrt_fn(), vec);
+	}
+
+	template <typename T, unsigned int W>
+	pack<T, W> sqrt(const pack<T, W>& p)
+	{
+		return detail::pack_call(detail::fast_sqrt_fn(), p, detail::is_kernel_type<T>());
+	}
+
+	// }}}
+	// reciprocal {{{
+
+	/**
+	 * \fn rcp
+	 * \brief approximate reciprocal, 1 / x
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto rcp(T x)
+	{
+		return detail::math_call(detail::fast_rcp_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto rcp(const V& vec)
+	{
+		return detail::vector_call(detail::fast_rcp_fn(), vec);
+	}
+
+	template <typename T, unsigned int W>
+	pack<T, W> rcp(const pack<T, W>& p)
+	{
+		return detail::pack_call(detail::fast_rcp_fn(), p, detail::is_kernel_type<T>());
+	}
+
+	// }}}
+
+} // namespace fast
+
+namespace detail {
+
+	template <typename A, typename B>
+	auto fast_divide(const A& a, const B& b, std::true_type /* estimate */)
+	{
+		return a * fast::rcp(b);
+	}
+
+	template <typename A, typename B>
+	auto fast_divide(const A& a, const B& b, std::false_type /* estimate */)
+	{
+		return a / b;
+	}
+
+	template <typename T, if_math_scalar<T> = 0>
+	auto fast_scale(T len2)
+	{
+		return math_call(fast_inversesqrt_normal_fn(), len2, is_kernel_type<T>());
+	}
+
+	template <typename T, unsigned int W>
+	pack<T, W> fast_scale(const pack<T, W>& len2)
+	{
+		return pack_call(fast_inversesqrt_normal_fn(), len2, is_kernel_type<T>());
+	}
+
+	/*
+	 * The scale skips the special cases of fast::inversesqrt, since the
+	 * result is NaN for zero and infinite vectors anyway, as with
+	 * velm::normalize.
+	 */
+	template <typename T>
+	auto fast_normalize(const T& val, std::true_type /* estimate */)
+	{
+		return val * fast_scale(dot(val, val));
+	}
+
+	template <typename T>
+	auto fast_normalize(const T& val, std::false_type /* estimate */)
+	{
+		return velm::normalize(val);
+	}
+
+} // namespace detail
+
+namespace fast {
+
+	// division {{{
+
+	/**
+	 * \fn divide
+	 * \brief approximate division, a * rcp(b)
+	 *
+	 * Either operand may be a scalar, vector or pack, as with operator/.
+	 * Dividing several values by the same b is better written as a
+	 * multiplication by rcp(b).
+	 */
+	template <typename A, typename B>
+	auto divide(const A& a, const B& b)
+	{
+		return detail::fast_divide(a, b, detail::has_fast_estimate<B>());
+	}
+
+	// }}}
+	// geometric {{{
+
+	/**
+	 * \fn length
+	 * \brief approximate length of a vector
+	 */
+	template <typename T>
+	auto length(const T& val)
+	{
+		return fast::sqrt(dot(val, val));
+	}
+
+	/**
+	 * \fn distance
+	 * \brief approximate distance between two points, length(p0 - p1)
+	 */
+	template <typename L, typename R>
+	auto distance(const L& p0, const R& p1)
+	{
+		return fast::length(p0 - p1);
+	}
+
+	/**
+	 * \fn normalize
+	 * \brief approximate unit vector in the same direction
+	 *
+	 * This is val * inversesqrt(dot(val, val)), one estimate and a
+	 * multiplication per component instead of a square root and a division
+	 * per component.
+	 */
+	template <typename T>
+	auto normalize(const T& val)
+	{
+		return detail::fast_normalize(val, detail::has_fast_estimate<T>());
+	}
+
+	// }}}
+
+} // namespace fast
+
+} // namespace velm
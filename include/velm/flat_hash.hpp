@@ -0,0 +1,794 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "bits.hpp"
+#include "simd.hpp"
+#include "hash.hpp"
+
+/**
+ * \file flat_hash.hpp
+ * \brief open addressing hash map and set
+ *
+ * velm::flat_hash_map and velm::flat_hash_set store their elements in one
+ * array of slots, rather than a node per element like std::unordered_map,
+ * which suits small keys such as the integer vectors of voxel and cell grids:
+ *
+ *      velm::flat_hash_map<velm::vector<int32_t, 3>, float> density;
+ *      density[cell] += 1;
+ *      auto it = density.find(cell + offset);
+ *
+ * As in Abseil's SwissTable, each slot has a control byte holding 7 bits of
+ * the hash of its key (or marking it empty or deleted). Lookups compare 16
+ * control bytes at a time with SSE2 (8 at a time with bit tricks without
+ * VELM_SIMD), and only compare keys whose bits match, so a lookup usually
+ * touches one group of control bytes and one slot. The table grows once
+ * 7/8 of the slots are used.
+ *
+ * The interface is a subset of that of the std containers, but inserting and
+ * rehashing move elements, so references and iterators are invalidated by
+ * every insertion which grows the table (and erase leaves them valid).
+ * Elements should have non-throwing move constructors. The std::hash of
+ * hash.hpp is used for vectors by default; other hash functions are mixed
+ * again, so the identity std::hash of integers works too.
+ */
+
+namespace velm {
+
+namespace detail {
+
+	// control bytes {{{
+
+	/*
+	 * The control byte of a full slot is h2 of its hash (0 to 127); the
+	 * others are negative. The sentinel marks the end of the slots for
+	 * iteration, and is neither full nor free.
+	 */
+	using ctrl_t = std::int8_t;
+	constexpr ctrl_t ctrl_empty = -128;
+	constexpr ctrl_t ctrl_deleted = -2;
+	constexpr ctrl_t ctrl_sentinel = -1;
+
+#if VELM_SIMD
+
+	/*
+	 * 16 control bytes, compared in one instruction. Matches are returned as
+	 * a bitmask with bit i set for byte i.
+	 */
+	struct ctrl_group
+	{
+		using bitmask = std::uint32_t;
+		static constexpr std::size_t width = 16;
+
+		__m128i ctrl;
+
+		explicit ctrl_group(const ctrl_t* pos)
+			: ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)))
+		{
+		}
+
+		bitmask match(ctrl_t h2) const
+		{
+			return static_cast<bitmask>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+		}
+
+		bitmask match_empty() const
+		{
+			return this->match(ctrl_empty);
+		}
+
+		// empty and deleted are the bytes below the sentinel
+		bitmask match_free() const
+		{
+			return static_cast<bitmask>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl_sentinel), ctrl)));
+		}
+
+		static std::size_t lowest(bitmask bits)
+		{
+			return utility::count_trailing_zeros(bits);
+		}
+
+		// bytes after the last match
+		static std::size_t trailing(bitmask bits)
+		{
+			return bits == 0 ? width : utility::count_leading_zeros(bits) - 16;
+		}
+	};
+
+#else
+
+	/*
+	 * 8 control bytes in a word. Matches are returned as a bitmask with the
+	 * top bit of byte i set for byte i. match can also report a full slot
+	 * just after a true match, which is harmless since keys are compared
+	 * anyway.
+	 */
+	struct ctrl_group
+	{
+		using bitmask = std::uint64_t;
+		static constexpr std::size_t width = 8;
+		static constexpr bitmask lsbs = 0x0101010101010101;
+		static constexpr bitmask msbs = 0x8080808080808080;
+
+		bitmask ctrl;
+
+		explicit ctrl_group(const ctrl_t* pos)
+		{
+			std::memcpy(&ctrl, pos, sizeof(ctrl));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			ctrl = __builtin_bswap64(ctrl);
+#endif
+		}
+
+		bitmask match(ctrl_t h2) const
+		{
+			const bitmask x = ctrl ^ (lsbs * static_cast<std::uint8_t>(h2));
+			return (x - lsbs) & ~x & msbs;
+		}
+
+		// the top bit set and bit 1 clear
+		bitmask match_empty() const
+		{
+			return ctrl & ~(ctrl << 6) & msbs;
+		}
+
+		// the top bit set and bit 0 clear
+		bitmask match_free() const
+		{
+			return ctrl & ~(ctrl << 7) & msbs;
+		}
+
+		static std::size_t lowest(bitmask bits)
+		{
+			return utility::count_trailing_zeros(bits) >> 3;
+		}
+
+		static std::size_t trailing(bitmask bits)
+		{
+			return bits == 0 ? width : utility::count_leading_zeros(bits) >> 3;
+		}
+	};
+
+#endif
+
+	// the control bytes of tables with no slots, so they need no checks for it
+	inline ctrl_t* empty_ctrl()
+	{
+		alignas(16) static const ctrl_t group[16] = {
+			ctrl_sentinel, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+			ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+		};
+		return const_cast<ctrl_t*>(group);
+	}
+
+	// }}}
+	// policies {{{
+
+	template <typename K, typename V>
+	struct map_policy
+	{
+		using key_type = K;
+		using slot_type = std::pair<const K, V>;
+		static constexpr bool constant = false;
+
+		static const K& key(const slot_type& slot)
+		{
+			return slot.first;
+		}
+	};
+
+	template <typename K>
+	struct set_policy
+	{
+		using key_type = K;
+		using slot_type = K;
+		static constexpr bool constant = true;
+
+		static const K& key(const slot_type& slot)
+		{
+			return slot;
+		}
+	};
+
+	// }}}
+
+	/*
+	 * The table of flat_hash_map and flat_hash_set. There are cap slots,
+	 * where cap is 0 or one less than a power of two, and cap + width
+	 * control bytes: one per slot, the sentinel, and copies of the first
+	 * width - 1, so a group can be loaded at any slot without wrapping.
+	 * Probing visits groups at triangular offsets from h1 of the hash, which
+	 * reaches every group.
+	 */
+	template <typename Policy, typename Hash, typename Eq>
+	struct flat_table
+	{
+	public: // statics
+
+		using key_type = typename Policy::key_type;
+		using value_type = typename Policy::slot_type;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using hasher = Hash;
+		using key_equal = Eq;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+
+		template <bool Const>
+		struct basic_iterator
+		{
+			using S = std::conditional_t<Const || Policy::constant, const typename Policy::slot_type, typename Policy::slot_type>;
+
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = typename Policy::slot_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = S&;
+			using pointer = S*;
+
+			const ctrl_t* ctrl = nullptr;
+			S* slot = nullptr;
+
+			basic_iterator() = default;
+
+			basic_iterator(const ctrl_t* c, S* s)
+				: ctrl(c), slot(s)
+			{
+			}
+
+			template <bool C = Const, std::enable_if_t<C, int> = 0>
+			basic_iterator(const basic_iterator<false>& other)
+				: ctrl(other.ctrl), slot(other.slot)
+			{
+			}
+
+			reference operator*() const
+			{
+				return *slot;
+			}
+
+			pointer operator->() const
+			{
+				return slot;
+			}
+
+			// move to the first full slot from here, or the sentinel
+			void skip_free()
+			{
+				while(*ctrl < ctrl_sentinel) {
+					++ctrl;
+					++slot;
+				}
+			}
+
+			basic_iterator& operator++()
+			{
+				++ctrl;
+				++slot;
+				this->skip_free();
+				return *this;
+			}
+
+			basic_iterator operator++(int)
+			{
+				auto copy = *this;
+				++*this;
+				return copy;
+			}
+
+			bool operator==(const basic_iterator& other) const
+			{
+				return ctrl == other.ctrl;
+			}
+
+			bool operator!=(const basic_iterator& other) const
+			{
+				return ctrl != other.ctrl;
+			}
+		};
+
+		using iterator = basic_iterator<false>;
+		using const_iterator = basic_iterator<true>;
+
+	private:
+
+		static constexpr size_type width = ctrl_group::width;
+
+		ctrl_t* ctrl = empty_ctrl();
+		value_type* slots = nullptr;
+		size_type cap = 0;
+		size_type elements = 0;
+		// insertions into empty slots left before the table must grow
+		size_type growth = 0;
+		Hash hash_fn;
+		Eq equal_fn;
+
+		// 7/8 of the slots, always leaving one empty so probes end
+		static constexpr size_type max_load(size_type c)
+		{
+			return c - (c + 1) / 8;
+		}
+
+		static size_type capacity_for(size_type n)
+		{
+			size_type c = width - 1;
+			while(max_load(c) < n) {
+				c = c * 2 + 1;
+			}
+			return c;
+		}
+
+		std::uint64_t hash_of(const key_type& key) const
+		{
+			return hash_mix(static_cast<std::uint64_t>(hash_fn(key)));
+		}
+
+		static size_type h1(std::uint64_t hash)
+		{
+			return static_cast<size_type>(hash >> 7);
+		}
+
+		static ctrl_t h2(std::uint64_t hash)
+		{
+			return static_cast<ctrl_t>(hash & 0x7f);
+		}
+
+		void set_ctrl(size_type idx, ctrl_t h)
+		{
+			ctrl[idx] = h;
+			ctrl[((idx - (width - 1)) & cap) + (width - 1)] = h;
+		}
+
+		// the slot holding key, or cap
+		size_type find_index(const key_type& key, std::uint64_t hash) const
+		{
+			size_type pos = h1(hash) & cap;
+			size_type step = 0;
+			while(true) {
+				const ctrl_group group(ctrl + pos);
+				for(auto bits = group.match(h2(hash)); bits != 0; bits &= bits - 1) {
+					const size_type idx = (pos + ctrl_group::lowest(bits)) & cap;
+					if(equal_fn(Policy::key(slots[idx]), key)) {
+						return idx;
+					}
+				}
+				if(group.match_empty() != 0) {
+					return cap;
+				}
+				step += width;
+				pos = (pos + step) & cap;
+			}
+		}
+
+		// the first empty or deleted slot of the probe sequence
+		size_type find_free(std::uint64_t hash) const
+		{
+			size_type pos = h1(hash) & cap;
+			size_type step = 0;
+			while(true) {
+				const auto bits = ctrl_group(ctrl + pos).match_free();
+				if(bits != 0) {
+					return (pos + ctrl_group::lowest(bits)) & cap;
+				}
+				step += width;
+				pos = (pos + step) & cap;
+			}
+		}
+
+		void allocate(size_type c)
+		{
+			ctrl = new ctrl_t[c + width];
+			std::memset(ctrl, static_cast<unsigned char>(ctrl_empty), c + width);
+			ctrl[c] = ctrl_sentinel;
+			slots = std::allocator<value_type>().allocate(c);
+			cap = c;
+			growth = max_load(c) - elements;
+		}
+
+		void deallocate()
+		{
+			if(cap != 0) {
+				delete[] ctrl;
+				std::allocator<value_type>().deallocate(slots, cap);
+			}
+			ctrl = empty_ctrl();
+			slots = nullptr;
+			cap = 0;
+			growth = 0;
+		}
+
+		void destroy_all()
+		{
+			for(size_type i = 0; i < cap; ++i) {
+				if(ctrl[i] >= 0) {
+					slots[i].~value_type();
+				}
+			}
+		}
+
+		void resize(size_type c)
+		{
+			ctrl_t* const old_ctrl = ctrl;
+			value_type* const old_slots = slots;
+			const size_type old_cap = cap;
+
+			this->allocate(c);
+			for(size_type i = 0; i < old_cap; ++i) {
+				if(old_ctrl[i] >= 0) {
+					const std::uint64_t hash = this->hash_of(Policy::key(old_slots[i]));
+					const size_type idx = this->find_free(hash);
+					::new(static_cast<void*>(slots + idx)) value_type(std::move(old_slots[i]));
+					this->set_ctrl(idx, h2(hash));
+					old_slots[i].~value_type();
+				}
+			}
+
+			if(old_cap != 0) {
+				delete[] old_ctrl;
+				std::allocator<value_type>().deallocate(old_slots, old_cap);
+			}
+		}
+
+		/*
+		 * Grow once all the slots which may be filled have been, unless over
+		 * half of them are deleted, in which case rehashing into the same
+		 * capacity is enough.
+		 */
+		void grow()
+		{
+			if(cap != 0 && elements < max_load(cap) / 2) {
+				this->resize(cap);
+			} else {
+				this->resize(cap == 0 ? capacity_for(1) : cap * 2 + 1);
+			}
+		}
+
+		/*
+		 * A probe only moves past a group which had no empty slots, so if
+		 * every group containing this slot has had an empty one since it was
+		 * last full, no probe has passed it, and it can become empty rather
+		 * than deleted.
+		 */
+		void erase_at(size_type idx)
+		{
+			slots[idx].~value_type();
+			--elements;
+
+			const auto empty_after = ctrl_group(ctrl + idx).match_empty();
+			const auto empty_before = ctrl_group(ctrl + ((idx - width) & cap)).match_empty();
+			const bool was_never_full = empty_before != 0 && empty_after != 0
+				&& ctrl_group::lowest(empty_after) + ctrl_group::trailing(empty_before) < width;
+			this->set_ctrl(idx, was_never_full ? ctrl_empty : ctrl_deleted);
+			growth += was_never_full;
+		}
+
+		iterator iterator_at(size_type idx)
+		{
+			return {ctrl + idx, slots + idx};
+		}
+
+		const_iterator iterator_at(size_type idx) const
+		{
+			return {ctrl + idx, slots + idx};
+		}
+
+	public: // methods
+
+		flat_table() = default;
+
+		explicit flat_table(size_type n, const Hash& hash = Hash(), const Eq& equal = Eq())
+			: hash_fn(hash), equal_fn(equal)
+		{
+			this->reserve(n);
+		}
+
+		flat_table(std::initializer_list<value_type> vals)
+		{
+			this->reserve(vals.size());
+			for(auto&& v : vals) {
+				this->insert(v);
+			}
+		}
+
+		flat_table(const flat_table& other)
+			: hash_fn(other.hash_fn), equal_fn(other.equal_fn)
+		{
+			this->reserve(other.elements);
+			for(auto&& v : other) {
+				const std::uint64_t hash = this->hash_of(Policy::key(v));
+				const size_type idx = this->find_free(hash);
+				::new(static_cast<void*>(slots + idx)) value_type(v);
+				--growth;
+				++elements;
+				this->set_ctrl(idx, h2(hash));
+			}
+		}
+
+		flat_table(flat_table&& other) noexcept
+			: ctrl(other.ctrl), slots(other.slots), cap(other.cap), elements(other.elements), growth(other.growth),
+			hash_fn(std::move(other.hash_fn)), equal_fn(std::move(other.equal_fn))
+		{
+			other.ctrl = empty_ctrl();
+			other.slots = nullptr;
+			other.cap = 0;
+			other.elements = 0;
+			other.growth = 0;
+		}
+
+		flat_table& operator=(const flat_table& other)
+		{
+			if(this != &other) {
+				flat_table copy(other);
+				this->swap(copy);
+			}
+			return *this;
+		}
+
+		flat_table& operator=(flat_table&& other) noexcept
+		{
+			flat_table moved(std::move(other));
+			this->swap(moved);
+			return *this;
+		}
+
+		~flat_table()
+		{
+			this->destroy_all();
+			this->deallocate();
+		}
+
+		void swap(flat_table& other) noexcept
+		{
+			using std::swap;
+			swap(ctrl, other.ctrl);
+			swap(slots, other.slots);
+			swap(cap, other.cap);
+			swap(elements, other.elements);
+			swap(growth, other.growth);
+			swap(hash_fn, other.hash_fn);
+			swap(equal_fn, other.equal_fn);
+		}
+
+		size_type size() const
+		{
+			return elements;
+		}
+
+		bool empty() const
+		{
+			return elements == 0;
+		}
+
+		size_type capacity() const
+		{
+			return cap;
+		}
+
+		// make room for n elements without growing
+		void reserve(size_type n)
+		{
+			if(n > elements + growth) {
+				this->resize(std::max(capacity_for(n), cap));
+			}
+		}
+
+		void clear()
+		{
+			this->destroy_all();
+			elements = 0;
+			if(cap != 0) {
+				std::memset(ctrl, static_cast<unsigned char>(ctrl_empty), cap + width);
+				ctrl[cap] = ctrl_sentinel;
+				growth = max_load(cap);
+			}
+		}
+
+		iterator begin()
+		{
+			iterator it(ctrl, slots);
+			it.skip_free();
+			return it;
+		}
+
+		iterator end()
+		{
+			return this->iterator_at(cap);
+		}
+
+		const_iterator begin() const
+		{
+			const_iterator it(ctrl, slots);
+			it.skip_free();
+			return it;
+		}
+
+		const_iterator end() const
+		{
+			return this->iterator_at(cap);
+		}
+
+		iterator find(const key_type& key)
+		{
+			return this->iterator_at(this->find_index(key, this->hash_of(key)));
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			return this->iterator_at(this->find_index(key, this->hash_of(key)));
+		}
+
+		bool contains(const key_type& key) const
+		{
+			return this->find_index(key, this->hash_of(key)) != cap;
+		}
+
+		size_type count(const key_type& key) const
+		{
+			return this->contains(key) ? 1 : 0;
+		}
+
+		std::pair<iterator, bool> insert(const value_type& val)
+		{
+			return this->emplace_key(Policy::key(val), val);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& val)
+		{
+			return this->emplace_key(Policy::key(val), std::move(val));
+		}
+
+		size_type erase(const key_type& key)
+		{
+			const size_type idx = this->find_index(key, this->hash_of(key));
+			if(idx == cap) {
+				return 0;
+			}
+			this->erase_at(idx);
+			return 1;
+		}
+
+		// returns the iterator after pos
+		iterator erase(const_iterator pos)
+		{
+			const size_type idx = static_cast<size_type>(pos.ctrl - ctrl);
+			this->erase_at(idx);
+			iterator next = this->iterator_at(idx);
+			next.skip_free();
+			return next;
+		}
+
+		iterator erase(iterator pos)
+		{
+			return this->erase(const_iterator(pos));
+		}
+
+		hasher hash_function() const
+		{
+			return hash_fn;
+		}
+
+		key_equal key_eq() const
+		{
+			return equal_fn;
+		}
+
+	protected:
+
+		template <typename... Args>
+		std::pair<iterator, bool> emplace_key(const key_type& key, Args&&... args)
+		{
+			const std::uint64_t hash = this->hash_of(key);
+			size_type idx = this->find_index(key, hash);
+			if(idx != cap) {
+				return {this->iterator_at(idx), false};
+			}
+
+			idx = this->find_free(hash);
+			if(growth == 0 && ctrl[idx] != ctrl_deleted) {
+				this->grow();
+				idx = this->find_free(hash);
+			}
+			::new(static_cast<void*>(slots + idx)) value_type(std::forward<Args>(args)...);
+			growth -= ctrl[idx] == ctrl_empty;
+			++elements;
+			this->set_ctrl(idx, h2(hash));
+			return {this->iterator_at(idx), true};
+		}
+	};
+
+} // namespace detail
+
+/**
+ * \struct flat_hash_map
+ * \brief open addressing hash map
+ *
+ * Elements are std::pair<const K, V>, as in std::unordered_map.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+struct flat_hash_map
+	: public detail::flat_table<detail::map_policy<K, V>, Hash, Eq>
+{
+public: // statics
+
+	using base_type = detail::flat_table<detail::map_policy<K, V>, Hash, Eq>;
+	using mapped_type = V;
+	using typename base_type::iterator;
+
+public: // methods
+
+	using base_type::base_type;
+
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(const K& key, Args&&... args)
+	{
+		return this->emplace_key(key, std::piecewise_construct,
+			std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+	}
+
+	template <typename M>
+	std::pair<iterator, bool> insert_or_assign(const K& key, M&& val)
+	{
+		auto res = this->try_emplace(key, std::forward<M>(val));
+		if(!res.second) {
+			res.first->second = std::forward<M>(val);
+		}
+		return res;
+	}
+
+	V& operator[](const K& key)
+	{
+		return this->try_emplace(key).first->second;
+	}
+
+	V& at(const K& key)
+	{
+		auto it = this->find(key);
+		if(it == this->end()) {
+			throw std::out_of_range("velm::flat_hash_map::at: key not found");
+		}
+		return it->second;
+	}
+
+	const V& at(const K& key) const
+	{
+		auto it = this->find(key);
+		if(it == this->end()) {
+			throw std::out_of_range("velm::flat_hash_map::at: key not found");
+		}
+		return it->second;
+	}
+};
+
+/**
+ * \struct flat_hash_set
+ * \brief open addressing hash set
+ *
+ * Iterators are always const, since changing an element would change its
+ * hash.
+ */
+template <typename K, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+struct flat_hash_set
+	: public detail::flat_table<detail::set_policy<K>, Hash, Eq>
+{
+public: // statics
+
+	using base_type = detail::flat_table<detail::set_policy<K>, Hash, Eq>;
+
+public: // methods
+
+	using base_type::base_type;
+};
+
+} // namespace velm
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <cmath>
+#include <tuple>
 
 #include "utility.hpp"
+#include "simd.hpp"
+#include "mask.hpp"
 
 /**
  * \file funcs.hpp
@@ -16,6 +19,10 @@
  *
  * One difference is the negate function, which is equivalent to the GLSL not
  * function. This was named differently as 'not' is a reserved keyword in C++.
+ *
+ * Functions which choose between values (min, max, abs, faceforward) do so
+ * through select rather than ?:, so that component types whose comparisons
+ * do not produce a bool (e.g. velm::pack) can provide a lane-wise version.
  */
 
 namespace velm { inline namespace funcs {
@@ -29,12 +36,10 @@ namespace velm { inline namespace funcs {
 	 * This checks that all components of the vector are true.
 	 */
 	template <typename T, std::enable_if_t<utility::is_tied_vector<T>::value, int> = 0>
-	constexpr bool all(T&& vec)
+	constexpr auto all(T&& vec)
 	{
-		bool result = true;
-		utility::vec_apply(get_tie(vec),
-			[&] (auto&& x) { return result &= bool(x); });
-		return result;
+		return utility::tuple_fold(get_tie(vec), true,
+			[] (auto&& acc, auto&& x) { return acc && x; });
 	}
 
 	/**
@@ -44,12 +49,10 @@ namespace velm { inline namespace funcs {
 	 * This checks if any component of the vector is true.
 	 */
 	template <typename T, std::enable_if_t<utility::is_tied_vector<T>::value, int> = 0>
-	constexpr bool any(T&& vec)
+	constexpr auto any(T&& vec)
 	{
-		bool result = false;
-		utility::vec_apply(get_tie(vec),
-			[&] (auto&& x) { return result |= bool(x); });
-		return result;
+		return utility::tuple_fold(get_tie(vec), false,
+			[] (auto&& acc, auto&& x) { return acc || x; });
 	}
 
 	/**
@@ -59,7 +62,7 @@ namespace velm { inline namespace funcs {
 	 * This checks that all components of the vector are false.
 	 */
 	template <typename T, std::enable_if_t<utility::is_tied_vector<T>::value, int> = 0>
-	constexpr bool none(T&& vec)
+	constexpr auto none(T&& vec)
 	{
 		return !any(std::forward<T>(vec));
 	}
@@ -73,12 +76,26 @@ namespace velm { inline namespace funcs {
 	 * 'not' is a reserved keyword in c++.
 	 */
 	template <typename T, std::enable_if_t<utility::is_tied_vector<T>::value, int> = 0>
-	constexpr bool negate(T&& vec)
+	constexpr auto negate(T&& vec)
 	{
-		return utility::vec_apply(get_tie(vec),
+		return utility::unary_apply(vec,
 			[] (auto&& x) { return !x; });
 	}
 
+	/**
+	 * \fn select
+	 * \brief choose between two values
+	 *
+	 * Returns a if cond is true, and b otherwise. Component types with
+	 * lane-wise conditions (e.g. velm::pack) provide their own overloads,
+	 * found through argument-dependent lookup.
+	 */
+	template <typename A, typename B>
+	constexpr auto select(bool cond, A&& a, B&& b)
+	{
+		return cond ? a : b;
+	}
+
 	// }}}
 	// relational {{{
 
@@ -86,12 +103,13 @@ namespace velm { inline namespace funcs {
 	 * \fn lessThan
 	 * \brief component-wise less than comparison
 	 *
-	 * Compares the elements of 2 vectors, and creates a boolean vector
-	 * where each dimension represents the result of the comparison.
-	 * Comparisons between values return a single boolean.
+	 * Compares the elements of 2 vectors, and creates a velm::mask where
+	 * each bit represents the result of the comparison (or a vector of the
+	 * results, for components which do not compare to bool). Comparisons
+	 * between values return a single boolean.
 	 */
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
-	constexpr bool lessThan(L&& lhs, R&& rhs)
+	constexpr auto lessThan(L&& lhs, R&& rhs)
 	{
 		return lhs < rhs;
 	}
@@ -99,7 +117,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
 	constexpr auto lessThan(L&& lhs, R&& rhs)
 	{
-		return utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+		return simd::compare_apply(simd::op_lt{}, std::forward<L>(lhs), std::forward<R>(rhs),
 			[] (auto&& a, auto&& b) { return lessThan(a, b); });
 	}
 
@@ -107,12 +125,13 @@ namespace velm { inline namespace funcs {
 	 * \fn lessThanEqual
 	 * \brief component-wise less than or equal comparison
 	 *
-	 * Compares the elements of 2 vectors, and creates a boolean vector
-	 * where each dimension represents the result of the comparison.
-	 * Comparisons between values return a single boolean.
+	 * Compares the elements of 2 vectors, and creates a velm::mask where
+	 * each bit represents the result of the comparison (or a vector of the
+	 * results, for components which do not compare to bool). Comparisons
+	 * between values return a single boolean.
 	 */
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
-	constexpr bool lessThanEqual(L&& lhs, R&& rhs)
+	constexpr auto lessThanEqual(L&& lhs, R&& rhs)
 	{
 		return lhs <= rhs;
 	}
@@ -120,7 +139,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
 	constexpr auto lessThanEqual(L&& lhs, R&& rhs)
 	{
-		return utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+		return simd::compare_apply(simd::op_le{}, std::forward<L>(lhs), std::forward<R>(rhs),
 			[] (auto&& a, auto&& b) { return lessThanEqual(a, b); });
 	}
 
@@ -128,12 +147,13 @@ namespace velm { inline namespace funcs {
 	 * \fn greaterThan
 	 * \brief component-wise greater than comparison
 	 *
-	 * Compares the elements of 2 vectors, and creates a boolean vector
-	 * where each dimension represents the result of the comparison.
-	 * Comparisons between values return a single boolean.
+	 * Compares the elements of 2 vectors, and creates a velm::mask where
+	 * each bit represents the result of the comparison (or a vector of the
+	 * results, for components which do not compare to bool). Comparisons
+	 * between values return a single boolean.
 	 */
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
-	constexpr bool greaterThan(L&& lhs, R&& rhs)
+	constexpr auto greaterThan(L&& lhs, R&& rhs)
 	{
 		return lhs > rhs;
 	}
@@ -141,7 +161,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
 	constexpr auto greaterThan(L&& lhs, R&& rhs)
 	{
-		return binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+		return simd::compare_apply(simd::op_gt{}, std::forward<L>(lhs), std::forward<R>(rhs),
 			[] (auto&& a, auto&& b) { return greaterThan(a, b); });
 	}
 
@@ -149,12 +169,13 @@ namespace velm { inline namespace funcs {
 	 * \fn greaterThanEqual
 	 * \brief component-wise greater than or equal comparison
 	 *
-	 * Compares the elements of 2 vectors, and creates a boolean vector
-	 * where each dimension represents the result of the comparison.
-	 * Comparisons between values return a single boolean.
+	 * Compares the elements of 2 vectors, and creates a velm::mask where
+	 * each bit represents the result of the comparison (or a vector of the
+	 * results, for components which do not compare to bool). Comparisons
+	 * between values return a single boolean.
 	 */
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
-	constexpr bool greaterThanEqual(L&& lhs, R&& rhs)
+	constexpr auto greaterThanEqual(L&& lhs, R&& rhs)
 	{
 		return lhs >= rhs;
 	}
@@ -162,7 +183,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
 	constexpr auto greaterThanEqual(L&& lhs, R&& rhs)
 	{
-		return utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+		return simd::compare_apply(simd::op_ge{}, std::forward<L>(lhs), std::forward<R>(rhs),
 			[] (auto&& a, auto&& b) { return greaterThanEqual(a, b); });
 	}
 
@@ -170,12 +191,13 @@ namespace velm { inline namespace funcs {
 	 * \fn equal
 	 * \brief component-wise equality comparison
 	 *
-	 * Compares the elements of 2 vectors, and creates a boolean vector
-	 * where each dimension represents the result of the comparison.
-	 * Comparisons between values return a single boolean.
+	 * Compares the elements of 2 vectors, and creates a velm::mask where
+	 * each bit represents the result of the comparison (or a vector of the
+	 * results, for components which do not compare to bool). Comparisons
+	 * between values return a single boolean.
 	 */
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
-	constexpr bool equal(L&& lhs, R&& rhs)
+	constexpr auto equal(L&& lhs, R&& rhs)
 	{
 		return lhs == rhs;
 	}
@@ -183,20 +205,21 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
 	constexpr auto equal(L&& lhs, R&& rhs)
 	{
-		return utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+		return simd::compare_apply(simd::op_eq{}, std::forward<L>(lhs), std::forward<R>(rhs),
 			[] (auto&& a, auto&& b) { return equal(a, b); });
 	}
 
 	/**
-	 * \fn equal
+	 * \fn notEqual
 	 * \brief component-wise inequality comparison
 	 *
-	 * Compares the elements of 2 vectors, and creates a boolean vector
-	 * where each dimension represents the result of the comparison.
-	 * Comparisons between values return a single boolean.
+	 * Compares the elements of 2 vectors, and creates a velm::mask where
+	 * each bit represents the result of the comparison (or a vector of the
+	 * results, for components which do not compare to bool). Comparisons
+	 * between values return a single boolean.
 	 */
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
-	constexpr bool notEqual(L&& lhs, R&& rhs)
+	constexpr auto notEqual(L&& lhs, R&& rhs)
 	{
 		return lhs != rhs;
 	}
@@ -204,7 +227,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
 	constexpr auto notEqual(L&& lhs, R&& rhs)
 	{
-		return utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+		return simd::compare_apply(simd::op_ne{}, std::forward<L>(lhs), std::forward<R>(rhs),
 			[] (auto&& a, auto&& b) { return notEqual(a, b); });
 	}
 
@@ -235,6 +258,31 @@ namespace velm { inline namespace funcs {
 		return lhs * rhs;
 	}
 
+	/**
+	 * \fn cross
+	 * \brief cross product of 2 vectors
+	 *
+	 * This calculates the vector perpendicular to both parameters, following
+	 * the right-hand rule. Both vectors must have 3 dimensions.
+	 */
+	template <typename L, typename R, std::enable_if_t<
+		utility::is_tied_vector<L>::value && utility::is_tied_vector<R>::value, int> = 0>
+	constexpr auto cross(L&& lhs, R&& rhs)
+	{
+		auto&& a = get_tie(lhs);
+		auto&& b = get_tie(rhs);
+		static_assert(std::tuple_size<std::decay_t<decltype(a)>>::value == 3
+			&& std::tuple_size<std::decay_t<decltype(b)>>::value == 3,
+			"Cross product is only defined for 3 dimensions");
+
+		using std::get;
+		return utility::vec_apply(std::make_tuple(
+				get<1>(a) * get<2>(b) - get<2>(a) * get<1>(b),
+				get<2>(a) * get<0>(b) - get<0>(a) * get<2>(b),
+				get<0>(a) * get<1>(b) - get<1>(a) * get<0>(b)),
+			[] (auto&& x) { return x; });
+	}
+
 	/**
 	 * \fn length
 	 * \brief length of a vector
@@ -246,7 +294,8 @@ namespace velm { inline namespace funcs {
 	template <typename T>
 	auto length(T&& val)
 	{
-		return std::sqrt(dot(val, val));
+		using std::sqrt;
+		return sqrt(dot(val, val));
 	}
 
 	/**
@@ -284,7 +333,7 @@ namespace velm { inline namespace funcs {
 	template <typename N, typename I, typename R>
 	constexpr auto faceforward(N&& n, I&& i, R&& nref)
 	{
-		return dot(nref, i) < 0 ? n : -n;
+		return select(dot(nref, i) < 0, n, -n);
 	}
 
 	/**
@@ -324,13 +373,13 @@ namespace velm { inline namespace funcs {
 	template <typename T, std::enable_if_t<!utility::is_tied_vector<T>::value, int> = 0>
 	constexpr auto abs(T&& val)
 	{
-		return val < 0 ? val : -val;
+		return select(val < 0, -val, val);
 	}
 
 	template <typename T, std::enable_if_t<utility::is_tied_vector<T>::value, int> = 0>
 	constexpr auto abs(T&& vec)
 	{
-		return utility::vec_apply(get_tie(vec),
+		return utility::unary_apply(vec,
 			[] (auto&& x) { return abs(x); });
 	}
 
@@ -344,7 +393,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
 	constexpr auto min(L&& lhs, R&& rhs)
 	{
-		return lhs < rhs ? lhs : rhs;
+		return select(lhs < rhs, lhs, rhs);
 	}
 
 	template <typename L, typename R, utility::if_appliable<L, R> = 0>
@@ -357,7 +406,7 @@ namespace velm { inline namespace funcs {
 	template <typename L, typename R, std::enable_if_t<!utility::is_appliable<L, R>::value, int> = 0>
 	constexpr auto max(L&& lhs, R&& rhs)
 	{
-		return lhs > rhs ? lhs : rhs;
+		return select(lhs > rhs, lhs, rhs);
 	}
 
 	template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
@@ -376,7 +425,7 @@ namespace velm { inline namespace funcs {
 	template <typename A, typename B, typename WB>
 	constexpr auto mix(A&& a, B&& b, WB&& wb)
 	{
-		return a * (A(1) - wb) + b * wb;
+		return a * (std::decay_t<WB>(1) - wb) + b * wb;
 	}
 
 } } // namespace velm::funcs
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+
+/**
+ * \file hash.hpp
+ * \brief std::hash for vectors and swizzles
+ *
+ * With this, velm::vector (and swizzles, which hash like the vector they
+ * convert to) can be used as keys of std::unordered_map and velm's
+ * flat_hash_map, e.g. for sparse voxel grids:
+ *
+ *      std::unordered_map<velm::vector<int32_t, 3>, chunk> chunks;
+ *      chunks[velm::vector<int32_t, 3>(floor(p / 16.f))].add(p);
+ *
+ * Vectors of integers are hashed as their bytes, 8 at a time, each mixed in
+ * with a multiply and an xor-shift, rather than by combining the hashes of
+ * their components one at a time. Vectors of float and double are hashed the
+ * same way, after turning -0 into +0 (since -0 == +0). Other component types
+ * combine their std::hash.
+ *
+ * Hashes are the same within a program, but may change between versions of
+ * velm, so don't store them.
+ */
+
+namespace velm {
+
+namespace detail {
+
+	constexpr std::uint64_t hash_seed = 0x243f6a8885a308d3;
+
+	// multiply-xorshift, moving the well mixed high bits of the product down
+	constexpr std::uint64_t hash_mix(std::uint64_t x)
+	{
+		x *= 0x9e3779b97f4a7c15;
+		return x ^ (x >> 32);
+	}
+
+	template <std::size_t Size>
+	std::uint64_t hash_bytes(const void* data)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+
+		std::uint64_t h = hash_seed ^ Size;
+		std::size_t i = 0;
+		for(; i + 8 <= Size; i += 8) {
+			std::uint64_t word;
+			std::memcpy(&word, p + i, 8);
+			h = hash_mix(h ^ word);
+		}
+		if(i < Size) {
+			std::uint64_t word = 0;
+			std::memcpy(&word, p + i, Size - i);
+			h = hash_mix(h ^ word);
+		}
+		return h;
+	}
+
+	// types whose values are their bytes, without padding or other representations
+	template <typename T>
+	using is_hashed_as_bytes = std::integral_constant<bool,
+		std::is_integral<T>::value || std::is_enum<T>::value>;
+
+	template <typename T>
+	using is_hashed_as_float = std::integral_constant<bool,
+		std::is_same<T, float>::value || std::is_same<T, double>::value>;
+
+	template <typename T, unsigned int N>
+	std::uint64_t hash_vector(const vector<T, N>& vec, std::true_type /* bytes */, std::false_type /* float */)
+	{
+		return hash_bytes<sizeof(vec.data)>(vec.data.data());
+	}
+
+	template <typename T, unsigned int N>
+	std::uint64_t hash_vector(const vector<T, N>& vec, std::false_type /* bytes */, std::true_type /* float */)
+	{
+		T vals[N];
+		for(unsigned int i = 0; i < N; ++i) {
+			vals[i] = vec.data[i] + T(0);
+		}
+		return hash_bytes<sizeof(vals)>(vals);
+	}
+
+	template <typename T, unsigned int N>
+	std::uint64_t hash_vector(const vector<T, N>& vec, std::false_type /* bytes */, std::false_type /* float */)
+	{
+		std::uint64_t h = hash_seed ^ N;
+		for(unsigned int i = 0; i < N; ++i) {
+			h = hash_mix(h ^ static_cast<std::uint64_t>(std::hash<T>()(vec.data[i])));
+		}
+		return h;
+	}
+
+} // namespace detail
+
+/**
+ * \fn hash_value
+ * \brief hash of a vector, as returned by std::hash
+ */
+template <typename T, unsigned int N>
+std::size_t hash_value(const vector<T, N>& vec)
+{
+	return static_cast<std::size_t>(detail::hash_vector(vec,
+		detail::is_hashed_as_bytes<T>(), detail::is_hashed_as_float<T>()));
+}
+
+template <typename T, unsigned int... N>
+std::size_t hash_value(const swizzle_proxy<T, N...>& p)
+{
+	return velm::hash_value(p());
+}
+
+} // namespace velm
+
+namespace std {
+
+template <typename T, unsigned int N>
+struct hash<velm::vector<T, N>>
+{
+	std::size_t operator()(const velm::vector<T, N>& vec) const
+	{
+		return velm::hash_value(vec);
+	}
+};
+
+template <typename T, unsigned int... N>
+struct hash<velm::swizzle_proxy<T, N...>>
+{
+	std::size_t operator()(const velm::swizzle_proxy<T, N...>& p) const
+	{
+		return velm::hash_value(p);
+	}
+};
+
+} // namespace std
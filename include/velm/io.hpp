@@ -0,0 +1,885 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "view.hpp"
+#include "vector_array.hpp"
+#include "allocator.hpp"
+
+/**
+ * \file io.hpp
+ * \brief binary files of vectors, read by mapping them into memory
+ *
+ * velm::io stores a sequence of velm::vector<T, N> in a simple binary format
+ * which can be used in place once the file is mapped, with no parsing:
+ *
+ *      velm::io::save("points.velm", points.data(), points.size());
+ *
+ *      velm::io::mapped_array<float, 3> in("points.velm");
+ *      velm::strided_view<const float, 3> pts = in.vectors();
+ *      auto len = velm::array_apply([] (auto&& p) { return velm::length(p); }, pts);
+ *
+ * The file starts with a 128 byte header (see io::header) giving the
+ * component type, the number of dimensions, the number of vectors, the layout
+ * and the byte order. The payload follows at a 64 byte boundary, either as
+ * packed vectors (layout::aos) or as one lane per component (layout::soa, as
+ * in vector_array), with every lane starting on a 64 byte boundary. Since
+ * mappings are page aligned, the vectors are then as aligned as in memory.
+ *
+ * The payload can be covered by checksums (XXH64), one per chunk of vectors,
+ * stored in a table after the payload. Nothing is checked when a file is
+ * opened, so opening is constant time whatever the size. Call verify(first,
+ * n) before using a range of vectors to check the chunks it covers; each
+ * chunk is checked once, even from several threads.
+ *
+ * Files use the byte order of the machine which wrote them, and can't be
+ * mapped by a machine with the other byte order (opening them throws). Files
+ * are mapped with mmap where available (VELM_MMAP is 1 on POSIX systems), and
+ * otherwise read into memory when opened.
+ *
+ * Errors opening, reading or writing a file throw std::system_error, and
+ * files which are not valid (or do not match T and N) throw io::error.
+ */
+
+#if !defined(VELM_MMAP)
+	#if defined(__unix__) || defined(__APPLE__)
+		#define VELM_MMAP 1
+	#else
+		#define VELM_MMAP 0
+	#endif
+#endif
+
+#if VELM_MMAP
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace velm { namespace io {
+
+// format {{{
+
+/**
+ * \enum layout
+ * \brief order of the components in the payload
+ */
+enum class layout : std::uint32_t
+{
+	aos = 0, // vectors one after the other, as in an array of velm::vector
+	soa = 1, // one lane per component, as in vector_array
+};
+
+/**
+ * \enum scalar
+ * \brief component type codes
+ */
+enum class scalar : std::uint32_t
+{
+	f32 = 1,
+	f64 = 2,
+	i8 = 3,
+	u8 = 4,
+	i16 = 5,
+	u16 = 6,
+	i32 = 7,
+	u32 = 8,
+	i64 = 9,
+	u64 = 10,
+};
+
+namespace detail {
+
+	template <typename T, typename = void>
+	struct scalar_code;
+
+	template <> struct scalar_code<float> : std::integral_constant<scalar, scalar::f32> {};
+	template <> struct scalar_code<double> : std::integral_constant<scalar, scalar::f64> {};
+
+	template <typename T>
+	struct scalar_code<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+		: std::integral_constant<scalar, static_cast<scalar>(
+			(sizeof(T) == 1 ? 3 : sizeof(T) == 2 ? 5 : sizeof(T) == 4 ? 7 : 9) + (std::is_signed<T>::value ? 0 : 1))>
+	{
+		static_assert(sizeof(T) <= 8, "Integer components must be at most 64 bits");
+	};
+
+	// the first 8 bytes of every file
+	inline const char* signature()
+	{
+		return "velmarr";
+	}
+
+	constexpr std::uint32_t byte_order_mark = 0x01020304;
+	constexpr std::uint64_t alignment = 64;
+
+	constexpr std::uint64_t align_up(std::uint64_t n)
+	{
+		return (n + alignment - 1) / alignment * alignment;
+	}
+
+} // namespace detail
+
+/**
+ * \struct header
+ * \brief start of every file
+ *
+ * All offsets are in bytes from the start of the file. Unused bytes up to
+ * header_size are zero.
+ */
+struct header
+{
+	static constexpr std::uint32_t current_version = 1;
+	static constexpr std::size_t header_size = 128;
+
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;   // 0x01020304, as written by the machine
+	scalar type;
+	std::uint32_t type_size;    // sizeof(T)
+	std::uint32_t dimensions;
+	io::layout layout;
+	std::uint64_t count;        // number of vectors
+	std::uint64_t payload;      // first vector (aos) or lane 0 (soa)
+	std::uint64_t lane_stride;  // distance between lanes (soa), 0 for aos
+	std::uint64_t chunk;        // vectors per checksum, 0 without checksums
+	std::uint64_t checksums;    // table of one uint64 per chunk, or 0
+};
+
+static_assert(sizeof(header) <= header::header_size, "The header must fit in header_size bytes");
+static_assert(std::is_trivially_copyable<header>::value, "The header is copied from and to files as bytes");
+
+/**
+ * \struct error
+ * \brief thrown for files which are not valid, or not of the expected type
+ */
+struct error
+	: std::runtime_error
+{
+	using std::runtime_error::runtime_error;
+};
+
+// }}}
+// checksum {{{
+
+namespace detail {
+
+	constexpr std::uint64_t xxh_prime1 = 0x9E3779B185EBCA87ull;
+	constexpr std::uint64_t xxh_prime2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr std::uint64_t xxh_prime3 = 0x165667B19E3779F9ull;
+	constexpr std::uint64_t xxh_prime4 = 0x85EBCA77C2B2AE63ull;
+	constexpr std::uint64_t xxh_prime5 = 0x27D4EB2F165667C5ull;
+
+	inline std::uint64_t rotl(std::uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	inline std::uint64_t read64(const unsigned char* p)
+	{
+		std::uint64_t val;
+		std::memcpy(&val, p, sizeof(val));
+		return val;
+	}
+
+	inline std::uint32_t read32(const unsigned char* p)
+	{
+		std::uint32_t val;
+		std::memcpy(&val, p, sizeof(val));
+		return val;
+	}
+
+	inline std::uint64_t xxh_round(std::uint64_t acc, std::uint64_t input)
+	{
+		acc += input * xxh_prime2;
+		acc = rotl(acc, 31);
+		return acc * xxh_prime1;
+	}
+
+	inline std::uint64_t xxh_merge(std::uint64_t acc, std::uint64_t val)
+	{
+		acc ^= xxh_round(0, val);
+		return acc * xxh_prime1 + xxh_prime4;
+	}
+
+} // namespace detail
+
+/**
+ * \fn checksum
+ * \brief XXH64 of a block of bytes
+ *
+ * Words are read in the byte order of the machine, which matches the
+ * reference implementation on little endian machines.
+ */
+inline std::uint64_t checksum(const void* data, std::size_t size, std::uint64_t seed = 0)
+{
+	using namespace detail;
+
+	const auto* p = static_cast<const unsigned char*>(data);
+	const unsigned char* const end = p + size;
+	std::uint64_t h;
+
+	if(size >= 32) {
+		std::uint64_t v1 = seed + xxh_prime1 + xxh_prime2;
+		std::uint64_t v2 = seed + xxh_prime2;
+		std::uint64_t v3 = seed;
+		std::uint64_t v4 = seed - xxh_prime1;
+		const unsigned char* const limit = end - 32;
+		do {
+			v1 = xxh_round(v1, read64(p));
+			v2 = xxh_round(v2, read64(p + 8));
+			v3 = xxh_round(v3, read64(p + 16));
+			v4 = xxh_round(v4, read64(p + 24));
+			p += 32;
+		} while(p <= limit);
+
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		h = xxh_merge(h, v1);
+		h = xxh_merge(h, v2);
+		h = xxh_merge(h, v3);
+		h = xxh_merge(h, v4);
+	} else {
+		h = seed + xxh_prime5;
+	}
+
+	h += static_cast<std::uint64_t>(size);
+
+	for(; p + 8 <= end; p += 8) {
+		h ^= xxh_round(0, read64(p));
+		h = rotl(h, 27) * xxh_prime1 + xxh_prime4;
+	}
+	if(p + 4 <= end) {
+		h ^= static_cast<std::uint64_t>(read32(p)) * xxh_prime1;
+		h = rotl(h, 23) * xxh_prime2 + xxh_prime3;
+		p += 4;
+	}
+	for(; p < end; ++p) {
+		h ^= (*p) * xxh_prime5;
+		h = rotl(h, 11) * xxh_prime1;
+	}
+
+	h ^= h >> 33;
+	h *= xxh_prime2;
+	h ^= h >> 29;
+	h *= xxh_prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+// }}}
+// writing {{{
+
+/**
+ * \struct options
+ * \brief how a file is written
+ *
+ * chunk is the number of vectors covered by each checksum, or 0 to write no
+ * checksums. Files in layout::soa must be given their count up front, since
+ * every lane is placed after the previous one.
+ */
+struct options
+{
+	io::layout layout = io::layout::aos;
+	std::uint64_t chunk = 0;
+	std::uint64_t count = 0;
+};
+
+/**
+ * \struct writer
+ * \brief streaming writer of vectors to a file
+ *
+ * Vectors are buffered a chunk (or, without checksums, 64k vectors) at a time,
+ * so memory use doesn't grow with the file. The header is written last, by
+ * close, so a file which was not closed is not valid. The destructor closes
+ * the file if needed, but ignores errors; call close to see them.
+ */
+template <typename T, unsigned int N>
+struct writer
+{
+public: // statics
+
+	static constexpr auto dimensions = N;
+	using value_type = vector<T, N>;
+	using size_type = std::uint64_t;
+
+	static_assert(std::is_trivially_copyable<T>::value, "Components must be trivially copyable");
+
+private:
+
+	std::string path;
+	std::ofstream file;
+	options opts;
+	header head;
+	size_type block = 0;             // vectors per buffer flush
+	size_type written = 0;           // vectors already flushed
+	std::vector<T> buffer;           // aos: block * N components, soa: N lanes of block
+	size_type buffered = 0;
+	std::vector<std::uint64_t> sums;
+
+	[[noreturn]] void fail(const char* what) const
+	{
+		throw std::system_error(errno ? errno : EIO, std::generic_category(), std::string(what) + " " + path);
+	}
+
+	void put(std::uint64_t offset, const void* data, std::size_t size)
+	{
+		file.seekp(static_cast<std::streamoff>(offset));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		if(!file) {
+			this->fail("failed to write");
+		}
+	}
+
+	void flush()
+	{
+		if(buffered == 0) {
+			return;
+		}
+
+		std::uint64_t sum = 0;
+		if(opts.layout == io::layout::aos) {
+			const std::size_t bytes = buffered * N * sizeof(T);
+			this->put(head.payload + written * N * sizeof(T), buffer.data(), bytes);
+			sum = checksum(buffer.data(), bytes);
+		} else {
+			const std::size_t bytes = buffered * sizeof(T);
+			for(unsigned int k = 0; k < N; ++k) {
+				const T* lane = buffer.data() + k * block;
+				this->put(head.payload + k * head.lane_stride + written * sizeof(T), lane, bytes);
+				sum = checksum(lane, bytes, sum);
+			}
+		}
+
+		if(opts.chunk != 0) {
+			sums.push_back(sum);
+		}
+		written += buffered;
+		buffered = 0;
+	}
+
+public: // methods
+
+	explicit writer(const std::string& filename, const options& o = options())
+		: path(filename), file(filename, std::ios::binary | std::ios::trunc), opts(o), head()
+	{
+		if(!file) {
+			this->fail("failed to create");
+		}
+		block = opts.chunk != 0 ? opts.chunk : 65536;
+		if(opts.layout == io::layout::soa && opts.count != 0 && block > opts.count) {
+			block = opts.count;
+		}
+		buffer.resize(block * N);
+
+		std::memcpy(head.magic, detail::signature(), sizeof(head.magic));
+		head.version = header::current_version;
+		head.byte_order = detail::byte_order_mark;
+		head.type = detail::scalar_code<T>::value;
+		head.type_size = sizeof(T);
+		head.dimensions = N;
+		head.layout = opts.layout;
+		head.payload = detail::align_up(header::header_size);
+		head.lane_stride = opts.layout == io::layout::soa ? detail::align_up(opts.count * sizeof(T)) : 0;
+		head.chunk = opts.chunk;
+	}
+
+	writer(const writer&) = delete;
+	writer& operator=(const writer&) = delete;
+
+	~writer()
+	{
+		if(file.is_open()) {
+			try {
+				this->close();
+			} catch(...) {
+			}
+		}
+	}
+
+	// number of vectors written so far
+	size_type size() const
+	{
+		return written + buffered;
+	}
+
+	template <typename V>
+	void push(const V& vec)
+	{
+		if(opts.layout == io::layout::soa && this->size() == opts.count) {
+			throw error("more vectors than the count given for a soa file");
+		}
+
+		const vector<T, N> val(vec);
+		if(opts.layout == io::layout::aos) {
+			for(unsigned int k = 0; k < N; ++k) {
+				buffer[buffered * N + k] = val[k];
+			}
+		} else {
+			for(unsigned int k = 0; k < N; ++k) {
+				buffer[k * block + buffered] = val[k];
+			}
+		}
+
+		if(++buffered == block) {
+			this->flush();
+		}
+	}
+
+	void write(const vector<T, N>* vecs, std::size_t n)
+	{
+		for(std::size_t i = 0; i < n; ++i) {
+			this->push(vecs[i]);
+		}
+	}
+
+	/*
+	 * Write the remaining vectors, the checksums and the header. The writer
+	 * can't be used afterwards.
+	 */
+	void close()
+	{
+		if(!file.is_open()) {
+			return;
+		}
+		if(opts.layout == io::layout::soa && this->size() != opts.count) {
+			file.close();
+			throw error("fewer vectors than the count given for a soa file");
+		}
+
+		this->flush();
+		head.count = written;
+
+		std::uint64_t end = opts.layout == io::layout::aos
+			? head.payload + written * N * sizeof(T)
+			: head.payload + N * head.lane_stride;
+		if(opts.chunk != 0) {
+			head.checksums = detail::align_up(end);
+			this->put(head.checksums, sums.data(), sums.size() * sizeof(std::uint64_t));
+			end = head.checksums + sums.size() * sizeof(std::uint64_t);
+		} else if(opts.layout == io::layout::soa && end > head.payload + (N - 1) * head.lane_stride + written * sizeof(T)) {
+			// the last lane is padded to lane_stride like the others
+			const char zero = 0;
+			this->put(end - 1, &zero, 1);
+		}
+
+		unsigned char bytes[header::header_size] = {};
+		std::memcpy(bytes, &head, sizeof(head));
+		this->put(0, bytes, sizeof(bytes));
+
+		file.close();
+		if(file.fail()) {
+			this->fail("failed to close");
+		}
+	}
+};
+
+/**
+ * \fn save
+ * \brief write a whole array of vectors to a file
+ *
+ * vector_arrays are written in layout::soa unless given other options.
+ */
+template <typename T, unsigned int N>
+void save(const std::string& path, const vector<T, N>* vecs, std::size_t n, options opts = options())
+{
+	if(opts.layout == layout::soa) {
+		opts.count = n;
+	}
+	writer<T, N> out(path, opts);
+	out.write(vecs, n);
+	out.close();
+}
+
+template <typename T, unsigned int N>
+void save(const std::string& path, const vector_array<T, N>& arr, options opts = options{layout::soa, 0, 0})
+{
+	if(opts.layout == layout::soa) {
+		opts.count = arr.size();
+	}
+	writer<T, N> out(path, opts);
+	for(auto&& vec : arr) {
+		out.push(vec);
+	}
+	out.close();
+}
+
+// }}}
+// reading {{{
+
+namespace detail {
+
+	/*
+	 * Read-only contents of a whole file, mapped where possible. Mappings
+	 * start on a page boundary, and the fallback buffer is aligned to match
+	 * the payload alignment.
+	 */
+	class mapping
+	{
+		const unsigned char* bytes = nullptr;
+		std::size_t length = 0;
+#if !VELM_MMAP
+		std::vector<unsigned char, utility::aligned_allocator<unsigned char, alignment>> storage;
+#endif
+
+		[[noreturn]] static void fail(const char* what, const std::string& path)
+		{
+			throw std::system_error(errno ? errno : EIO, std::generic_category(), std::string(what) + " " + path);
+		}
+
+	public:
+
+		mapping() = default;
+
+		explicit mapping(const std::string& path)
+		{
+#if VELM_MMAP
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if(fd < 0) {
+				fail("failed to open", path);
+			}
+			struct stat st;
+			if(::fstat(fd, &st) != 0) {
+				const int err = errno;
+				::close(fd);
+				errno = err;
+				fail("failed to stat", path);
+			}
+			length = static_cast<std::size_t>(st.st_size);
+			if(length != 0) {
+				void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(addr == MAP_FAILED) {
+					const int err = errno;
+					::close(fd);
+					errno = err;
+					fail("failed to map", path);
+				}
+				bytes = static_cast<const unsigned char*>(addr);
+			}
+			::close(fd);
+#else
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if(!file) {
+				fail("failed to open", path);
+			}
+			storage.resize(static_cast<std::size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(storage.data()), static_cast<std::streamsize>(storage.size()));
+			if(!file) {
+				fail("failed to read", path);
+			}
+			bytes = storage.data();
+			length = storage.size();
+#endif
+		}
+
+		mapping(mapping&& other) noexcept
+		{
+			*this = std::move(other);
+		}
+
+		mapping& operator=(mapping&& other) noexcept
+		{
+			if(this != &other) {
+				this->reset();
+				bytes = other.bytes;
+				length = other.length;
+#if !VELM_MMAP
+				storage = std::move(other.storage);
+#endif
+				other.bytes = nullptr;
+				other.length = 0;
+			}
+			return *this;
+		}
+
+		~mapping()
+		{
+			this->reset();
+		}
+
+		void reset()
+		{
+#if VELM_MMAP
+			if(bytes != nullptr) {
+				::munmap(const_cast<unsigned char*>(bytes), length);
+			}
+#else
+			storage.clear();
+#endif
+			bytes = nullptr;
+			length = 0;
+		}
+
+		const unsigned char* data() const
+		{
+			return bytes;
+		}
+
+		std::size_t size() const
+		{
+			return length;
+		}
+	};
+
+	// number of checksums, without overflowing for a huge chunk
+	inline std::uint64_t chunk_count(const header& h)
+	{
+		return h.count / h.chunk + (h.count % h.chunk != 0);
+	}
+
+	/*
+	 * Check that a header describes a file which fits in size bytes, so
+	 * that the payload and checksums can be used without further checks.
+	 */
+	inline void validate(const header& h, std::uint64_t size)
+	{
+		if(std::memcmp(h.magic, signature(), sizeof(h.magic)) != 0) {
+			throw error("not a velm vector file");
+		}
+		if(h.byte_order != byte_order_mark) {
+			throw error("vector file has the wrong byte order for this machine");
+		}
+		if(h.version == 0 || h.version > header::current_version) {
+			throw error("unsupported vector file version " + std::to_string(h.version));
+		}
+		if(h.dimensions == 0 || h.type_size == 0 || h.payload % alignment != 0 || h.payload < header::header_size) {
+			throw error("corrupt vector file header");
+		}
+
+		const std::uint64_t vec_size = std::uint64_t(h.dimensions) * h.type_size;
+		const std::uint64_t room = size > h.payload ? size - h.payload : 0;
+		bool fits;
+		if(h.layout == layout::aos) {
+			fits = h.count <= room / vec_size;
+		} else if(h.layout == layout::soa) {
+			fits = h.lane_stride % alignment == 0
+				&& h.count <= h.lane_stride / h.type_size
+				&& (h.count == 0 || h.lane_stride <= room / h.dimensions);
+		} else {
+			throw error("unknown vector file layout");
+		}
+		if(!fits) {
+			throw error("vector file is truncated");
+		}
+
+		if(h.chunk != 0) {
+			const std::uint64_t chunks = chunk_count(h);
+			if(h.checksums % sizeof(std::uint64_t) != 0 || h.checksums > size
+				|| chunks > (size - h.checksums) / sizeof(std::uint64_t)) {
+				throw error("vector file is truncated");
+			}
+		}
+		if(h.count > std::uint64_t(std::size_t(-1)) / vec_size) {
+			throw error("vector file is too large for this machine");
+		}
+	}
+
+} // namespace detail
+
+/**
+ * \fn inspect
+ * \brief header of a file, checked, without knowing its type
+ */
+inline header inspect(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if(!file) {
+		throw std::system_error(errno ? errno : EIO, std::generic_category(), "failed to open " + path);
+	}
+	const auto size = static_cast<std::uint64_t>(file.tellg());
+
+	header h;
+	file.seekg(0);
+	if(!file.read(reinterpret_cast<char*>(&h), sizeof(h))) {
+		throw error("not a velm vector file");
+	}
+	detail::validate(h, size);
+	return h;
+}
+
+/**
+ * \struct mapped_array
+ * \brief read-only vectors of a file, used in place
+ *
+ * Opening a file only maps and checks the header, and the vectors are read
+ * from the mapping when used. Files in layout::aos are used through vectors(),
+ * and files in layout::soa through lane(k); element(i) works for both. The
+ * views and pointers are valid while the mapped_array exists.
+ */
+template <typename T, unsigned int N>
+struct mapped_array
+{
+public: // statics
+
+	static constexpr auto dimensions = N;
+	using value_type = vector<T, N>;
+	using size_type = std::size_t;
+
+private:
+
+	detail::mapping map;
+	header head;
+	std::unique_ptr<std::atomic<bool>[]> verified;
+
+	const T* component(size_type offset) const
+	{
+		return reinterpret_cast<const T*>(map.data() + offset);
+	}
+
+	void check_chunk(size_type c) const
+	{
+		if(verified[c].load(std::memory_order_acquire)) {
+			return;
+		}
+
+		const size_type first = c * head.chunk;
+		const size_type n = std::min<size_type>(head.chunk, head.count - first);
+		std::uint64_t sum = 0;
+		if(head.layout == io::layout::aos) {
+			sum = checksum(map.data() + head.payload + first * N * sizeof(T), n * N * sizeof(T));
+		} else {
+			for(unsigned int k = 0; k < N; ++k) {
+				sum = checksum(this->lane(k) + first, n * sizeof(T), sum);
+			}
+		}
+
+		std::uint64_t expected;
+		std::memcpy(&expected, map.data() + head.checksums + c * sizeof(std::uint64_t), sizeof(expected));
+		if(sum != expected) {
+			throw error("checksum mismatch in vectors " + std::to_string(first) + " to " + std::to_string(first + n - 1));
+		}
+		verified[c].store(true, std::memory_order_release);
+	}
+
+public: // methods
+
+	explicit mapped_array(const std::string& path)
+		: map(path), head()
+	{
+		if(map.size() < header::header_size) {
+			throw error("not a velm vector file");
+		}
+		std::memcpy(&head, map.data(), sizeof(head));
+		detail::validate(head, map.size());
+
+		if(head.type != detail::scalar_code<T>::value || head.type_size != sizeof(T) || head.dimensions != N) {
+			throw error("vector file does not have the requested component type and dimensions");
+		}
+
+		if(head.chunk != 0) {
+			const size_type chunks = detail::chunk_count(head);
+			verified.reset(new std::atomic<bool>[chunks]);
+			for(size_type c = 0; c < chunks; ++c) {
+				verified[c].store(false, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	size_type size() const
+	{
+		return head.count;
+	}
+
+	bool empty() const
+	{
+		return head.count == 0;
+	}
+
+	io::layout layout() const
+	{
+		return head.layout;
+	}
+
+	const header& info() const
+	{
+		return head;
+	}
+
+	bool has_checksums() const
+	{
+		return head.chunk != 0;
+	}
+
+	// all vectors of a layout::aos file
+	strided_view<const T, N> vectors() const
+	{
+		if(head.layout != io::layout::aos) {
+			throw error("vectors() needs a file in layout::aos");
+		}
+		return strided_view<const T, N>(map.data() + head.payload, this->size());
+	}
+
+	// lane k of a layout::soa file, this->size() components long
+	const T* lane(unsigned int k) const
+	{
+		if(head.layout != io::layout::soa) {
+			throw error("lane() needs a file in layout::soa");
+		}
+		return this->component(head.payload + k * head.lane_stride);
+	}
+
+	std::array<const T*, N> lanes() const
+	{
+		std::array<const T*, N> out;
+		for(unsigned int k = 0; k < N; ++k) {
+			out[k] = this->lane(k);
+		}
+		return out;
+	}
+
+	// copy of vector i, in either layout
+	value_type element(size_type idx) const
+	{
+		assert(idx < this->size());
+		value_type out;
+		for(unsigned int k = 0; k < N; ++k) {
+			out[k] = head.layout == io::layout::aos
+				? this->component(head.payload + (idx * N + k) * sizeof(T))[0]
+				: this->component(head.payload + k * head.lane_stride)[idx];
+		}
+		return out;
+	}
+
+	/*
+	 * Check the checksums of the chunks covering vectors [first, first + n),
+	 * throwing io::error on a mismatch. Chunks which were already checked are
+	 * skipped. Files without checksums are not checked.
+	 */
+	void verify(size_type first, size_type n) const
+	{
+		assert(first <= this->size() && n <= this->size() - first);
+		if(head.chunk == 0 || n == 0) {
+			return;
+		}
+		for(size_type c = first / head.chunk; c <= (first + n - 1) / head.chunk; ++c) {
+			this->check_chunk(c);
+		}
+	}
+
+	void verify() const
+	{
+		this->verify(0, this->size());
+	}
+};
+
+// }}}
+
+} } // namespace velm::io
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "exec.hpp"
+#include "vector.hpp"
+#include "vector_array.hpp"
+
+/**
+ * \file kdtree.hpp
+ * \brief k-d tree for nearest neighbour queries
+ *
+ * velm::kdtree<T, N> is built once from a range of points (a vector_array,
+ * a std::vector of vectors or a strided_view), and answers k nearest
+ * neighbour and radius queries under the squared Euclidean distance, i.e.
+ * velm::dot(p - q, p - q):
+ *
+ *      velm::kdtree<float, 3> tree(positions);
+ *      velm::kdtree<float, 3>::neighbour near[8];
+ *      std::size_t found = tree.knn(query, 8, near);
+ *      // positions[near[0].index] is the closest point
+ *
+ * The tree splits each range of points at the median along the widest axis
+ * of their bounds, down to leaves of at most leaf_size points, so it is
+ * balanced and its shape follows from the number of points alone. Nodes are
+ * a flat array in breadth first order holding only the split, and children
+ * and point ranges are worked out while descending. The points are copied
+ * into the tree in leaf order, a lane per component as in vector_array, so
+ * leaves are scanned with contiguous, vectorisable loads.
+ *
+ * Results refer to points by their index in the range the tree was built
+ * from. Points must not be NaN, and there may be at most 2^32 - 1 of them.
+ *
+ * The constructor and batch_knn also take an execution policy (see
+ * exec.hpp). A parallel build splits the top of the tree as usual and then
+ * builds the two subtrees of every large enough node at the same time, and
+ * gives the same tree as a sequential one.
+ */
+
+namespace velm {
+
+/**
+ * \struct kdtree
+ * \brief static k-d tree over N-dimensional points
+ */
+template <typename T, unsigned int N>
+struct kdtree
+{
+	static_assert(std::is_floating_point<T>::value, "kdtree needs floating point components");
+
+public: // statics
+
+	static constexpr auto dimensions = N;
+	static constexpr std::size_t default_leaf_size = 8;
+	static constexpr std::size_t max_leaf_size = 64;
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+	// smaller subtrees are built by the thread which split them
+	static constexpr std::size_t parallel_build_size = 65536;
+
+	using value_type = vector<T, N>;
+	using component_type = T;
+	using size_type = std::size_t;
+
+	/**
+	 * \struct neighbour
+	 * \brief point found by a query, and its squared distance to the query
+	 */
+	struct neighbour
+	{
+		std::uint32_t index;
+		T distance2;
+	};
+
+private:
+
+	struct node
+	{
+		T split;
+		unsigned int dim;
+	};
+
+	struct build_item
+	{
+		value_type point;
+		std::uint32_t index;
+	};
+
+	// nearest k so far, as a max-heap on distance
+	struct knn_visitor
+	{
+		neighbour* out;
+		size_type k;
+		size_type count;
+
+		T bound() const
+		{
+			return count < k ? std::numeric_limits<T>::infinity() : out[0].distance2;
+		}
+
+		void add(std::uint32_t index, T d2)
+		{
+			const auto further = [] (const neighbour& a, const neighbour& b) {
+				return a.distance2 < b.distance2;
+			};
+			if(count < k) {
+				out[count++] = {index, d2};
+				std::push_heap(out, out + count, further);
+			} else if(d2 < out[0].distance2) {
+				std::pop_heap(out, out + count, further);
+				out[count - 1] = {index, d2};
+				std::push_heap(out, out + count, further);
+			}
+		}
+	};
+
+	struct radius_visitor
+	{
+		std::vector<neighbour>* out;
+		T r2;
+
+		T bound() const
+		{
+			return r2;
+		}
+
+		void add(std::uint32_t index, T d2)
+		{
+			out->push_back({index, d2});
+		}
+	};
+
+	std::vector<node> nodes;
+	vector_array<T, N> points;
+	std::vector<std::uint32_t> indices;
+
+	/*
+	 * Split items [begin, end) for the subtree at node. The two halves are
+	 * independent, and only touch their own items and nodes.
+	 */
+	void build(const exec::policy& policy, build_item* items, size_type node_idx, size_type begin, size_type end)
+	{
+		if(node_idx >= nodes.size()) {
+			return;
+		}
+
+		value_type lo = items[begin].point;
+		value_type hi = items[begin].point;
+		for(size_type i = begin + 1; i < end; ++i) {
+			for(unsigned int k = 0; k < N; ++k) {
+				const T c = items[i].point[k];
+				lo[k] = c < lo[k] ? c : lo[k];
+				hi[k] = hi[k] < c ? c : hi[k];
+			}
+		}
+		unsigned int dim = 0;
+		for(unsigned int k = 1; k < N; ++k) {
+			if(hi[k] - lo[k] > hi[dim] - lo[dim]) {
+				dim = k;
+			}
+		}
+
+		const size_type mid = begin + (end - begin) / 2;
+		std::nth_element(items + begin, items + mid, items + end, [dim] (const build_item& a, const build_item& b) {
+			return a.point[dim] < b.point[dim];
+		});
+		nodes[node_idx] = {items[mid].point[dim], dim};
+
+		if(!policy.parallel || end - begin < parallel_build_size) {
+			this->build(exec::seq, items, 2 * node_idx + 1, begin, mid);
+			this->build(exec::seq, items, 2 * node_idx + 2, mid, end);
+			return;
+		}
+		exec::for_each_chunk(policy.with_chunk_size(1), 2, [&] (std::size_t child, std::size_t) {
+			this->build(policy, items, 2 * node_idx + 1 + child, child == 0 ? begin : mid, child == 0 ? mid : end);
+		});
+	}
+
+	/*
+	 * Visit the leaves which may hold points within visitor.bound() of q,
+	 * nearer leaves first. rd is the squared distance from q to the cell of
+	 * the node, and off its offset from the cell along each axis (Arya and
+	 * Mount's incremental distance), so a far child is skipped using the
+	 * distance to the whole cell rather than to the splitting plane alone.
+	 */
+	template <typename Visitor>
+	void search(const value_type& q, Visitor& visitor, size_type node_idx,
+		size_type begin, size_type end, T rd, value_type& off) const
+	{
+		if(node_idx >= nodes.size()) {
+			this->scan_leaf(q, visitor, begin, end);
+			return;
+		}
+
+		const node nd = nodes[node_idx];
+		const size_type mid = begin + (end - begin) / 2;
+		const T diff = q[nd.dim] - nd.split;
+
+		if(diff < 0) {
+			this->search(q, visitor, 2 * node_idx + 1, begin, mid, rd, off);
+		} else {
+			this->search(q, visitor, 2 * node_idx + 2, mid, end, rd, off);
+		}
+
+		const T old = off[nd.dim];
+		const T far_rd = rd - old * old + diff * diff;
+		if(far_rd <= visitor.bound()) {
+			off[nd.dim] = diff;
+			if(diff < 0) {
+				this->search(q, visitor, 2 * node_idx + 2, mid, end, far_rd, off);
+			} else {
+				this->search(q, visitor, 2 * node_idx + 1, begin, mid, far_rd, off);
+			}
+			off[nd.dim] = old;
+		}
+	}
+
+	template <typename Visitor>
+	void scan_leaf(const value_type& q, Visitor& visitor, size_type begin, size_type end) const
+	{
+		const size_type count = end - begin;
+		T d2[max_leaf_size];
+		for(size_type i = 0; i < count; ++i) {
+			d2[i] = 0;
+		}
+		for(unsigned int k = 0; k < N; ++k) {
+			const T* lane = points.lane(k) + begin;
+			const T qk = q[k];
+			for(size_type i = 0; i < count; ++i) {
+				const T d = lane[i] - qk;
+				d2[i] += d * d;
+			}
+		}
+
+		for(size_type i = 0; i < count; ++i) {
+			if(d2[i] <= visitor.bound()) {
+				visitor.add(indices[begin + i], d2[i]);
+			}
+		}
+	}
+
+	template <typename Visitor>
+	void search(const value_type& q, Visitor& visitor) const
+	{
+		if(this->empty()) {
+			return;
+		}
+		value_type off(T(0));
+		this->search(q, visitor, 0, 0, this->size(), T(0), off);
+	}
+
+public: // methods
+
+	kdtree() = default;
+
+	/*
+	 * Build the tree from a range of points, such as a vector_array, a
+	 * std::vector of vectors or a strided_view. leaf_size is clamped to
+	 * [1, max_leaf_size].
+	 */
+	template <typename Range>
+	explicit kdtree(const Range& range, size_type leaf_size = default_leaf_size)
+		: kdtree(exec::seq, range, leaf_size)
+	{
+	}
+
+	template <typename Range>
+	kdtree(const exec::policy& policy, const Range& range, size_type leaf_size = default_leaf_size)
+	{
+		const size_type n = range.size();
+		assert(n < npos);
+		leaf_size = std::min(std::max(leaf_size, size_type(1)), size_type(max_leaf_size));
+
+		std::vector<build_item> items(n);
+		exec::for_each_chunk(policy, range, [&] (std::size_t begin, std::size_t end) {
+			for(size_type i = begin; i < end; ++i) {
+				items[i].point = range[i];
+				items[i].index = static_cast<std::uint32_t>(i);
+			}
+		});
+
+		// halving from n, leaves of the deepest level have at most leaf_size points
+		unsigned int depth = 0;
+		while(n > (leaf_size << depth)) {
+			++depth;
+		}
+		nodes.resize((size_type(1) << depth) - 1);
+		if(n > 0) {
+			this->build(policy, items.data(), 0, 0, n);
+		}
+
+		points.resize(n);
+		indices.resize(n);
+		exec::for_each_chunk(policy, n, [&] (std::size_t begin, std::size_t end) {
+			for(size_type i = begin; i < end; ++i) {
+				points[i] = items[i].point;
+				indices[i] = items[i].index;
+			}
+		});
+	}
+
+	size_type size() const
+	{
+		return indices.size();
+	}
+
+	bool empty() const
+	{
+		return indices.empty();
+	}
+
+	/**
+	 * \fn knn
+	 * \brief the k points nearest to q, nearest first
+	 *
+	 * out must have room for k neighbours. Returns the number found, which is
+	 * k unless the tree has fewer points. Ties are broken arbitrarily.
+	 */
+	size_type knn(const value_type& q, size_type k, neighbour* out) const
+	{
+		if(k == 0) {
+			return 0;
+		}
+		knn_visitor visitor{out, k, 0};
+		this->search(q, visitor);
+		std::sort_heap(out, out + visitor.count, [] (const neighbour& a, const neighbour& b) {
+			return a.distance2 < b.distance2;
+		});
+		return visitor.count;
+	}
+
+	std::vector<neighbour> knn(const value_type& q, size_type k) const
+	{
+		std::vector<neighbour> out(std::min(k, this->size()));
+		this->knn(q, k, out.data());
+		return out;
+	}
+
+	/**
+	 * \fn nearest
+	 * \brief the point nearest to q
+	 *
+	 * The tree must not be empty.
+	 */
+	neighbour nearest(const value_type& q) const
+	{
+		assert(!this->empty());
+		neighbour out;
+		this->knn(q, 1, &out);
+		return out;
+	}
+
+	/**
+	 * \fn radius
+	 * \brief all points within distance r of q, in no particular order
+	 *
+	 * out is cleared first, so one vector can be reused between queries.
+	 * Points at exactly distance r are included.
+	 */
+	void radius(const value_type& q, T r, std::vector<neighbour>& out) const
+	{
+		out.clear();
+		radius_visitor visitor{&out, r * r};
+		this->search(q, visitor);
+	}
+
+	/**
+	 * \fn batch_knn
+	 * \brief knn for every point of a range of queries
+	 *
+	 * The neighbours of queries[i] are written to out[i * k, (i + 1) * k),
+	 * nearest first. If the tree has fewer than k points, the remaining
+	 * entries have index npos and an infinite distance.
+	 */
+	template <typename Range>
+	void batch_knn(const Range& queries, size_type k, neighbour* out) const
+	{
+		this->batch_knn(exec::seq, queries, k, out);
+	}
+
+	template <typename Range>
+	void batch_knn(const exec::policy& policy, const Range& queries, size_type k, neighbour* out) const
+	{
+		exec::for_each_chunk(policy, queries, [&] (std::size_t begin, std::size_t end) {
+			for(size_type i = begin; i < end; ++i) {
+				neighbour* dst = out + i * k;
+				const size_type found = this->knn(queries[i], k, dst);
+				std::fill(dst + found, dst + k, neighbour{npos, std::numeric_limits<T>::infinity()});
+			}
+		});
+	}
+};
+
+} // namespace velm
@@ -0,0 +1,1621 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "simd.hpp"
+
+/**
+ * \file kernels.hpp
+ * \brief polynomial kernels for the exponential and trigonometric functions
+ *
+ * Each kernel is written once, as a template over a lane type: float or
+ * double for a single value, or (with VELM_SIMD) f32x4 and f64x2, which hold
+ * an SSE register of 4 floats or 2 doubles. Lane types have the arithmetic
+ * operators, comparisons producing a mask of the same type, and the helpers
+ * below (select, any, round, pow2, ...). Since both kinds of lane execute the
+ * same operations, a value gives the same result whether it is computed alone
+ * or as part of a register.
+ *
+ * Kernels reduce the argument to a small interval, evaluate a polynomial and
+ * reconstruct the result, without branches. The exceptions are sin, cos and
+ * tan, which fall back to the standard functions for registers holding an
+ * argument too large for the reduction (|x| > 2^20 pi/2, about 1.6e6).
+ *
+ * The accuracy of each function is documented in math.hpp, which is the
+ * public interface. The error bounds assume IEEE arithmetic: options which
+ * let the compiler reassociate floating point expressions (-ffast-math,
+ * -fassociative-math) break the range reductions.
+ */
+
+namespace velm { namespace kernels {
+
+// lanes {{{
+
+template <typename V>
+struct lane_traits
+{
+	static constexpr bool supported = false;
+};
+
+template <>
+struct lane_traits<float>
+{
+	static constexpr bool supported = true;
+	static constexpr unsigned int width = 1;
+	using scalar = float;
+
+	static float load(const float* src) { return *src; }
+	static void store(float* dst, float val) { *dst = val; }
+	static float load_partial(const float* src, std::size_t /* n */) { return *src; }
+	static void store_partial(float* dst, float val, std::size_t /* n */) { *dst = val; }
+};
+
+template <>
+struct lane_traits<double>
+{
+	static constexpr bool supported = true;
+	static constexpr unsigned int width = 1;
+	using scalar = double;
+
+	static double load(const double* src) { return *src; }
+	static void store(double* dst, double val) { *dst = val; }
+	static double load_partial(const double* src, std::size_t /* n */) { return *src; }
+	static void store_partial(double* dst, double val, std::size_t /* n */) { *dst = val; }
+};
+
+template <typename V>
+using scalar_t = typename lane_traits<V>::scalar;
+
+template <typename V>
+using if_lane = std::enable_if_t<lane_traits<V>::supported, int>;
+
+template <typename T>
+struct float_bits;
+
+template <>
+struct float_bits<float>
+{
+	using type = std::uint32_t;
+	using signed_type = std::int32_t;
+	static constexpr int mantissa = 23;
+	static constexpr int bias = 127;
+};
+
+template <>
+struct float_bits<double>
+{
+	using type = std::uint64_t;
+	using signed_type = std::int64_t;
+	static constexpr int mantissa = 52;
+	static constexpr int bias = 1023;
+};
+
+template <typename T>
+typename float_bits<T>::type to_bits(T val)
+{
+	typename float_bits<T>::type out;
+	std::memcpy(&out, &val, sizeof(out));
+	return out;
+}
+
+template <typename T>
+T from_bits(typename float_bits<T>::type val)
+{
+	T out;
+	std::memcpy(&out, &val, sizeof(out));
+	return out;
+}
+
+template <typename T>
+using if_scalar_lane = std::enable_if_t<std::is_same<T, float>::value || std::is_same<T, double>::value, int>;
+
+/*
+ * Scalar lanes use bool as the mask type. Masks are combined with & and |,
+ * which also work on bool.
+ */
+template <typename T, if_scalar_lane<T> = 0>
+T select(bool mask, T a, T b)
+{
+	return mask ? a : b;
+}
+
+inline bool any(bool mask)
+{
+	return mask;
+}
+
+template <typename T, if_scalar_lane<T> = 0>
+T abs(T x)
+{
+	using U = typename float_bits<T>::type;
+	return from_bits<T>(to_bits(x) & ~(U(1) << (sizeof(T) * 8 - 1)));
+}
+
+template <typename T, if_scalar_lane<T> = 0>
+bool signbit(T x)
+{
+	return (to_bits(x) >> (sizeof(T) * 8 - 1)) != 0;
+}
+
+// magnitude of mag with the sign of sgn
+template <typename T, if_scalar_lane<T> = 0>
+T copysign(T mag, T sgn)
+{
+	using U = typename float_bits<T>::type;
+	const U sign = U(1) << (sizeof(T) * 8 - 1);
+	return from_bits<T>((to_bits(mag) & ~sign) | (to_bits(sgn) & sign));
+}
+
+// nearest integer, ties to even, for any x
+template <typename T, if_scalar_lane<T> = 0>
+T round(T x)
+{
+	// adding 2^mantissa to the magnitude leaves no fraction bits
+	const T big = T(typename float_bits<T>::type(1) << float_bits<T>::mantissa);
+	const T a = abs(x);
+	return a < big ? copysign((a + big) - big, x) : x;
+}
+
+// 2^n, for integer n in the normal exponent range
+template <typename T, if_scalar_lane<T> = 0>
+T pow2(T n)
+{
+	using bits = float_bits<T>;
+	const auto e = static_cast<typename bits::signed_type>(n) + bits::bias;
+	return from_bits<T>(static_cast<typename bits::type>(e) << bits::mantissa);
+}
+
+/*
+ * p * 2^n, given k = n + 1.5 * 2^52 (which holds the integer n in its low
+ * mantissa bits), for double p where the result is normal
+ */
+inline double scale_rounded(double p, double k)
+{
+	return from_bits<double>(to_bits(p) + (to_bits(k) << float_bits<double>::mantissa));
+}
+
+// floor(log2(x)) for normal positive x
+template <typename T, if_scalar_lane<T> = 0>
+T exponent(T x)
+{
+	using bits = float_bits<T>;
+	return T(static_cast<typename bits::signed_type>(to_bits(x) >> bits::mantissa) - bits::bias);
+}
+
+// x / 2^exponent(x), in [1, 2)
+template <typename T, if_scalar_lane<T> = 0>
+T mantissa(T x)
+{
+	using bits = float_bits<T>;
+	const typename bits::type mask = (typename bits::type(1) << bits::mantissa) - 1;
+	return from_bits<T>((to_bits(x) & mask) | to_bits(T(1)));
+}
+
+// tests on the low bits of an integer-valued lane
+template <typename T, if_scalar_lane<T> = 0>
+bool bit0(T n)
+{
+	return (static_cast<typename float_bits<T>::signed_type>(n) & 1) != 0;
+}
+
+template <typename T, if_scalar_lane<T> = 0>
+bool bit1(T n)
+{
+	return (static_cast<typename float_bits<T>::signed_type>(n) & 2) != 0;
+}
+
+// x with the low 32 bits of the mantissa cleared
+inline double high_bits(double x)
+{
+	return from_bits<double>(to_bits(x) & 0xffffffff00000000ULL);
+}
+
+inline double widen(float x)
+{
+	return x;
+}
+
+inline float narrow(double x)
+{
+	return static_cast<float>(x);
+}
+
+template <typename F>
+float fallback(float x, F&& f)
+{
+	return f(x);
+}
+
+template <typename F>
+double fallback(double x, F&& f)
+{
+	return f(x);
+}
+
+#if VELM_SIMD
+
+struct f32x4
+{
+	__m128 v;
+
+	f32x4() = default;
+	f32x4(__m128 r) : v(r) {}
+	f32x4(float s) : v(_mm_set1_ps(s)) {}
+};
+
+struct f64x2
+{
+	__m128d v;
+
+	f64x2() = default;
+	f64x2(__m128d r) : v(r) {}
+	f64x2(double s) : v(_mm_set1_pd(s)) {}
+};
+
+template <>
+struct lane_traits<f32x4>
+{
+	static constexpr bool supported = true;
+	static constexpr unsigned int width = 4;
+	using scalar = float;
+
+	static f32x4 load(const float* src) { return _mm_loadu_ps(src); }
+	static void store(float* dst, f32x4 val) { _mm_storeu_ps(dst, val.v); }
+
+	/*
+	 * The first n < 4 elements. The other lanes are 2, which is in the
+	 * domain of every kernel and not one of their special cases (such as
+	 * pow(1, y)), so it does not send the whole register down a slow path.
+	 */
+	static f32x4 load_partial(const float* src, std::size_t n)
+	{
+		switch(n) {
+		case 1: return _mm_setr_ps(src[0], 2.f, 2.f, 2.f);
+		case 2: return _mm_setr_ps(src[0], src[1], 2.f, 2.f);
+		default: return _mm_setr_ps(src[0], src[1], src[2], 2.f);
+		}
+	}
+
+	static void store_partial(float* dst, f32x4 val, std::size_t n)
+	{
+		if(n == 1) {
+			_mm_store_ss(dst, val.v);
+			return;
+		}
+		_mm_storel_pi(reinterpret_cast<__m64*>(dst), val.v);
+		if(n == 3) {
+			_mm_store_ss(dst + 2, _mm_movehl_ps(val.v, val.v));
+		}
+	}
+};
+
+template <>
+struct lane_traits<f64x2>
+{
+	static constexpr bool supported = true;
+	static constexpr unsigned int width = 2;
+	using scalar = double;
+
+	static f64x2 load(const double* src) { return _mm_loadu_pd(src); }
+	static void store(double* dst, f64x2 val) { _mm_storeu_pd(dst, val.v); }
+	static f64x2 load_partial(const double* src, std::size_t /* n */) { return _mm_setr_pd(src[0], 2.0); }
+	static void store_partial(double* dst, f64x2 val, std::size_t /* n */) { _mm_store_sd(dst, val.v); }
+};
+
+// arithmetic and masks {{{
+
+inline f32x4 operator+(f32x4 a, f32x4 b) { return _mm_add_ps(a.v, b.v); }
+inline f32x4 operator-(f32x4 a, f32x4 b) { return _mm_sub_ps(a.v, b.v); }
+inline f32x4 operator*(f32x4 a, f32x4 b) { return _mm_mul_ps(a.v, b.v); }
+inline f32x4 operator/(f32x4 a, f32x4 b) { return _mm_div_ps(a.v, b.v); }
+inline f32x4 operator-(f32x4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.f)); }
+inline f32x4 operator<(f32x4 a, f32x4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline f32x4 operator<=(f32x4 a, f32x4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline f32x4 operator>(f32x4 a, f32x4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline f32x4 operator>=(f32x4 a, f32x4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline f32x4 operator==(f32x4 a, f32x4 b) { return _mm_cmpeq_ps(a.v, b.v); }
+inline f32x4 operator!=(f32x4 a, f32x4 b) { return _mm_cmpneq_ps(a.v, b.v); }
+inline f32x4 operator&(f32x4 a, f32x4 b) { return _mm_and_ps(a.v, b.v); }
+inline f32x4 operator|(f32x4 a, f32x4 b) { return _mm_or_ps(a.v, b.v); }
+
+inline f64x2 operator+(f64x2 a, f64x2 b) { return _mm_add_pd(a.v, b.v); }
+inline f64x2 operator-(f64x2 a, f64x2 b) { return _mm_sub_pd(a.v, b.v); }
+inline f64x2 operator*(f64x2 a, f64x2 b) { return _mm_mul_pd(a.v, b.v); }
+inline f64x2 operator/(f64x2 a, f64x2 b) { return _mm_div_pd(a.v, b.v); }
+inline f64x2 operator-(f64x2 a) { return _mm_xor_pd(a.v, _mm_set1_pd(-0.0)); }
+inline f64x2 operator<(f64x2 a, f64x2 b) { return _mm_cmplt_pd(a.v, b.v); }
+inline f64x2 operator<=(f64x2 a, f64x2 b) { return _mm_cmple_pd(a.v, b.v); }
+inline f64x2 operator>(f64x2 a, f64x2 b) { return _mm_cmpgt_pd(a.v, b.v); }
+inline f64x2 operator>=(f64x2 a, f64x2 b) { return _mm_cmpge_pd(a.v, b.v); }
+inline f64x2 operator==(f64x2 a, f64x2 b) { return _mm_cmpeq_pd(a.v, b.v); }
+inline f64x2 operator!=(f64x2 a, f64x2 b) { return _mm_cmpneq_pd(a.v, b.v); }
+inline f64x2 operator&(f64x2 a, f64x2 b) { return _mm_and_pd(a.v, b.v); }
+inline f64x2 operator|(f64x2 a, f64x2 b) { return _mm_or_pd(a.v, b.v); }
+
+inline f32x4 select(f32x4 mask, f32x4 a, f32x4 b)
+{
+#if defined(__SSE4_1__)
+	return _mm_blendv_ps(b.v, a.v, mask.v);
+#else
+	return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+#endif
+}
+
+inline f64x2 select(f64x2 mask, f64x2 a, f64x2 b)
+{
+#if defined(__SSE4_1__)
+	return _mm_blendv_pd(b.v, a.v, mask.v);
+#else
+	return _mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v));
+#endif
+}
+
+inline bool any(f32x4 mask)
+{
+	return _mm_movemask_ps(mask.v) != 0;
+}
+
+inline bool any(f64x2 mask)
+{
+	return _mm_movemask_pd(mask.v) != 0;
+}
+
+// }}}
+// bit helpers {{{
+
+inline f32x4 abs(f32x4 x)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.f), x.v);
+}
+
+inline f64x2 abs(f64x2 x)
+{
+	return _mm_andnot_pd(_mm_set1_pd(-0.0), x.v);
+}
+
+inline f32x4 signbit(f32x4 x)
+{
+	return _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x.v), 31));
+}
+
+inline f64x2 signbit(f64x2 x)
+{
+	// the arithmetic shift fills the high halves, which are copied to the low halves
+	const __m128i high = _mm_srai_epi32(_mm_castpd_si128(x.v), 31);
+	return _mm_castsi128_pd(_mm_shuffle_epi32(high, _MM_SHUFFLE(3, 3, 1, 1)));
+}
+
+inline f32x4 copysign(f32x4 mag, f32x4 sgn)
+{
+	const __m128 sign = _mm_set1_ps(-0.f);
+	return _mm_or_ps(_mm_andnot_ps(sign, mag.v), _mm_and_ps(sign, sgn.v));
+}
+
+inline f64x2 copysign(f64x2 mag, f64x2 sgn)
+{
+	const __m128d sign = _mm_set1_pd(-0.0);
+	return _mm_or_pd(_mm_andnot_pd(sign, mag.v), _mm_and_pd(sign, sgn.v));
+}
+
+inline f32x4 round(f32x4 x)
+{
+#if defined(__SSE4_1__)
+	return _mm_round_ps(x.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+#else
+	const f32x4 big = 8388608.f; // 2^23
+	const f32x4 a = abs(x);
+	return select(a < big, copysign((a + big) - big, x), x);
+#endif
+}
+
+inline f64x2 round(f64x2 x)
+{
+#if defined(__SSE4_1__)
+	return _mm_round_pd(x.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+#else
+	const f64x2 big = 4503599627370496.0; // 2^52
+	const f64x2 a = abs(x);
+	return select(a < big, copysign((a + big) - big, x), x);
+#endif
+}
+
+inline f32x4 pow2(f32x4 n)
+{
+	const __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+	return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+}
+
+inline f64x2 pow2(f64x2 n)
+{
+	// the biased exponents are positive, so zero-extending them to 64 bits is enough
+	const __m128i e = _mm_add_epi32(_mm_cvtpd_epi32(n.v), _mm_set1_epi32(1023));
+	return _mm_castsi128_pd(_mm_slli_epi64(_mm_unpacklo_epi32(e, _mm_setzero_si128()), 52));
+}
+
+inline f64x2 scale_rounded(f64x2 p, f64x2 k)
+{
+	return _mm_castsi128_pd(_mm_add_epi64(_mm_castpd_si128(p.v), _mm_slli_epi64(_mm_castpd_si128(k.v), 52)));
+}
+
+// as the generic clamp below: min and max return their second operand, x, when it is NaN
+inline f32x4 clamp(f32x4 x, f32x4 lo, f32x4 hi)
+{
+	return _mm_min_ps(hi.v, _mm_max_ps(lo.v, x.v));
+}
+
+inline f64x2 clamp(f64x2 x, f64x2 lo, f64x2 hi)
+{
+	return _mm_min_pd(hi.v, _mm_max_pd(lo.v, x.v));
+}
+
+inline f32x4 exponent(f32x4 x)
+{
+	const __m128i e = _mm_srli_epi32(_mm_castps_si128(x.v), 23);
+	return _mm_cvtepi32_ps(_mm_sub_epi32(e, _mm_set1_epi32(127)));
+}
+
+inline f64x2 exponent(f64x2 x)
+{
+	// there is no 64 bit integer conversion, so the exponent goes into the mantissa of 2^52
+	const __m128i e = _mm_srli_epi64(_mm_castpd_si128(x.v), 52);
+	const __m128d big = _mm_set1_pd(4503599627370496.0);
+	const __m128d biased = _mm_sub_pd(_mm_or_pd(_mm_castsi128_pd(e), big), big);
+	return _mm_sub_pd(biased, _mm_set1_pd(1023.0));
+}
+
+inline f32x4 mantissa(f32x4 x)
+{
+	const __m128i bits = _mm_and_si128(_mm_castps_si128(x.v), _mm_set1_epi32(0x007fffff));
+	return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f800000)));
+}
+
+inline f64x2 mantissa(f64x2 x)
+{
+	const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x000fffffffffffffLL));
+	return _mm_or_pd(_mm_and_pd(x.v, mask), _mm_set1_pd(1.0));
+}
+
+inline f32x4 bit0(f32x4 n)
+{
+	const __m128i one = _mm_set1_epi32(1);
+	return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_cvtps_epi32(n.v), one), one));
+}
+
+inline f32x4 bit1(f32x4 n)
+{
+	const __m128i two = _mm_set1_epi32(2);
+	return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_cvtps_epi32(n.v), two), two));
+}
+
+inline f64x2 bit0(f64x2 n)
+{
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i m = _mm_cmpeq_epi32(_mm_and_si128(_mm_cvtpd_epi32(n.v), one), one);
+	return _mm_castsi128_pd(_mm_shuffle_epi32(m, _MM_SHUFFLE(1, 1, 0, 0)));
+}
+
+inline f64x2 bit1(f64x2 n)
+{
+	const __m128i two = _mm_set1_epi32(2);
+	const __m128i m = _mm_cmpeq_epi32(_mm_and_si128(_mm_cvtpd_epi32(n.v), two), two);
+	return _mm_castsi128_pd(_mm_shuffle_epi32(m, _MM_SHUFFLE(1, 1, 0, 0)));
+}
+
+inline f64x2 high_bits(f64x2 x)
+{
+	return _mm_and_pd(x.v, _mm_castsi128_pd(_mm_set1_epi64x(static_cast<long long>(0xffffffff00000000ULL))));
+}
+
+/*
+ * float lanes for the float kernels which work in double precision. The
+ * halves go through each function together, so their dependency chains
+ * interleave.
+ */
+struct f64x2x2
+{
+	f64x2 lo;
+	f64x2 hi;
+
+	f64x2x2() = default;
+	f64x2x2(f64x2 l, f64x2 h) : lo(l), hi(h) {}
+	f64x2x2(double s) : lo(s), hi(s) {}
+};
+
+inline f64x2x2 operator+(f64x2x2 a, f64x2x2 b) { return {a.lo + b.lo, a.hi + b.hi}; }
+inline f64x2x2 operator-(f64x2x2 a, f64x2x2 b) { return {a.lo - b.lo, a.hi - b.hi}; }
+inline f64x2x2 operator*(f64x2x2 a, f64x2x2 b) { return {a.lo * b.lo, a.hi * b.hi}; }
+inline f64x2x2 operator/(f64x2x2 a, f64x2x2 b) { return {a.lo / b.lo, a.hi / b.hi}; }
+
+inline f64x2x2 scale_rounded(f64x2x2 p, f64x2x2 k)
+{
+	return {scale_rounded(p.lo, k.lo), scale_rounded(p.hi, k.hi)};
+}
+
+inline f64x2x2 clamp(f64x2x2 x, f64x2x2 lo, f64x2x2 hi)
+{
+	return {clamp(x.lo, lo.lo, hi.lo), clamp(x.hi, lo.hi, hi.hi)};
+}
+
+inline f64x2x2 widen(f32x4 x)
+{
+	return {_mm_cvtps_pd(x.v), _mm_cvtps_pd(_mm_movehl_ps(x.v, x.v))};
+}
+
+inline f32x4 narrow(f64x2x2 x)
+{
+	return _mm_movelh_ps(_mm_cvtpd_ps(x.lo.v), _mm_cvtpd_ps(x.hi.v));
+}
+
+template <typename F>
+f32x4 fallback(f32x4 x, F&& f)
+{
+	alignas(16) float vals[4];
+	_mm_store_ps(vals, x.v);
+	for(float& val : vals) {
+		val = f(val);
+	}
+	return _mm_load_ps(vals);
+}
+
+template <typename F>
+f64x2 fallback(f64x2 x, F&& f)
+{
+	alignas(16) double vals[2];
+	_mm_store_pd(vals, x.v);
+	for(double& val : vals) {
+		val = f(val);
+	}
+	return _mm_load_pd(vals);
+}
+
+// }}}
+
+#endif // VELM_SIMD
+
+/*
+ * Helpers written in terms of the above, for all lane types. Comparisons with
+ * a bound are arranged so that NaN passes through.
+ */
+
+template <typename V>
+V clamp(V x, V lo, V hi)
+{
+	return select(x < lo, lo, select(x > hi, hi, x));
+}
+
+/*
+ * Nearest integer, ties to even, for |x| < 2^(mantissa - 1) (2^22 for
+ * float): adding 1.5 * 2^mantissa leaves no fraction bits. This is much
+ * cheaper than round without SSE4.1, for arguments the kernels have
+ * already bounded; larger x give some other finite value.
+ */
+template <typename V>
+V round_bounded(V x)
+{
+	using S = scalar_t<V>;
+	const V magic = V(S(1.5) * S(typename float_bits<S>::type(1) << float_bits<S>::mantissa));
+	return (x + magic) - magic;
+}
+
+template <typename V>
+auto is_nan(V x)
+{
+	return x != x;
+}
+
+template <typename V>
+auto is_finite(V x)
+{
+	return x - x == V(scalar_t<V>(0));
+}
+
+template <typename V>
+V floor(V x)
+{
+	const V r = round(x);
+	return select(r > x, r - V(1), r);
+}
+
+template <typename V>
+V ceil(V x)
+{
+	const V r = round(x);
+	return select(r < x, r + V(1), r);
+}
+
+// }}}
+// exponential {{{
+
+namespace detail {
+
+	/*
+	 * e^r for |r| <= ln2 / 2. The float polynomial is the minimax fit from
+	 * Cephes expf; the double one is the Taylor series, whose truncation
+	 * error (r^14 / 14!) is below 2^-56.
+	 */
+	template <typename V>
+	V exp_poly(V r, std::false_type /* double */)
+	{
+		V p = V(1.9875691500e-4f);
+		p = p * r + V(1.3981999507e-3f);
+		p = p * r + V(8.3334519073e-3f);
+		p = p * r + V(4.1665795894e-2f);
+		p = p * r + V(1.6666665459e-1f);
+		p = p * r + V(5.0000001201e-1f);
+		return p * (r * r) + r + V(1.f);
+	}
+
+	template <typename V>
+	V exp_poly(V r, std::true_type /* double */)
+	{
+		V p = V(1.0 / 6227020800);
+		p = p * r + V(1.0 / 479001600);
+		p = p * r + V(1.0 / 39916800);
+		p = p * r + V(1.0 / 3628800);
+		p = p * r + V(1.0 / 362880);
+		p = p * r + V(1.0 / 40320);
+		p = p * r + V(1.0 / 5040);
+		p = p * r + V(1.0 / 720);
+		p = p * r + V(1.0 / 120);
+		p = p * r + V(1.0 / 24);
+		p = p * r + V(1.0 / 6);
+		p = p * r + V(0.5);
+		return p * (r * r) + r + V(1.0);
+	}
+
+	/*
+	 * p * 2^n for integer n, with n split in two so that each factor is a
+	 * normal number. The first multiplication is exact, so results in the
+	 * subnormal range are only rounded once.
+	 */
+	template <typename V>
+	V scale(V p, V n)
+	{
+		const V n1 = round_bounded(n * V(0.5f));
+		return p * pow2(n1) * pow2(n - n1);
+	}
+
+	// ln2 split so that n * hi is exact
+	template <typename V>
+	V reduce_ln2(V x, V n, std::false_type /* double */)
+	{
+		return (x - n * V(0.693359375f)) - n * V(-2.12194440e-4f);
+	}
+
+	template <typename V>
+	V reduce_ln2(V x, V n, std::true_type /* double */)
+	{
+		return (x - n * V(6.93147180369123816490e-01)) - n * V(1.90821492927058770002e-10);
+	}
+} // namespace detail
+
+template <typename V, if_lane<V> = 0>
+V exp(V x)
+{
+	using S = scalar_t<V>;
+	using is_double = std::is_same<S, double>;
+	// beyond these the result is 0 or infinity anyway, and n stays small enough for scale
+	const V lo = is_double::value ? S(-746) : S(-104);
+	const V hi = is_double::value ? S(710) : S(89);
+	x = clamp(x, lo, hi);
+
+	const V n = round_bounded(x * V(S(1.44269504088896340736)));
+	const V r = detail::reduce_ln2(x, n, is_double());
+	return detail::scale(detail::exp_poly(r, is_double()), n);
+}
+
+template <typename V, if_lane<V> = 0>
+V exp2(V x)
+{
+	using S = scalar_t<V>;
+	using is_double = std::is_same<S, double>;
+	const V lo = is_double::value ? S(-1076) : S(-151);
+	const V hi = is_double::value ? S(1025) : S(129);
+	x = clamp(x, lo, hi);
+
+	const V n = round_bounded(x);
+	// x - n is exact
+	const V r = (x - n) * V(S(0.693147180559945309417));
+	return detail::scale(detail::exp_poly(r, is_double()), n);
+}
+
+// }}}
+// logarithm {{{
+
+namespace detail {
+
+	/*
+	 * Splits x into 2^e * m with m in [sqrt(1/2), sqrt(2)). Subnormals are
+	 * scaled into the normal range first.
+	 */
+	template <typename V>
+	void split(V x, V& e, V& m)
+	{
+		using S = scalar_t<V>;
+		using bits = float_bits<S>;
+		const S tiny = std::is_same<S, double>::value ? S(2.2250738585072014e-308) : S(1.17549435e-38f);
+		const S up = S(typename bits::type(1) << bits::mantissa);
+
+		const V sub = x < V(tiny);
+		x = select(sub, x * V(up), x);
+		e = exponent(x) - select(sub, V(S(bits::mantissa)), V(S(0)));
+		m = mantissa(x);
+
+		const V high = m > V(S(1.41421356237309504880));
+		m = select(high, m * V(S(0.5)), m);
+		e = select(high, e + V(S(1)), e);
+	}
+
+	// patches log(x) for x <= 0, infinity and NaN
+	template <typename V>
+	V log_special(V x, V result)
+	{
+		using S = scalar_t<V>;
+		const S inf = std::numeric_limits<S>::infinity();
+		result = select(x == V(inf), x, result);
+		result = select(x == V(S(0)), V(-inf), result);
+		result = select(x < V(S(0)), V(std::numeric_limits<S>::quiet_NaN()), result);
+		return select(is_nan(x), x, result);
+	}
+
+	/*
+	 * log(1 + f) - f for f in [sqrt(1/2) - 1, sqrt(2) - 1]. The float
+	 * polynomial is from Cephes logf; the double one is the fdlibm series in
+	 * s = f / (2 + f), returning the terms past f separately so callers can
+	 * keep extra precision.
+	 */
+	template <typename V>
+	V log1p_tail(V f, std::false_type /* double */)
+	{
+		const V z = f * f;
+		V p = V(7.0376836292e-2f);
+		p = p * f + V(-1.1514610310e-1f);
+		p = p * f + V(1.1676998740e-1f);
+		p = p * f + V(-1.2420140846e-1f);
+		p = p * f + V(1.4249322787e-1f);
+		p = p * f + V(-1.6668057665e-1f);
+		p = p * f + V(2.0000714765e-1f);
+		p = p * f + V(-2.4999993993e-1f);
+		p = p * f + V(3.3333331174e-1f);
+		return p * f * z - V(0.5f) * z;
+	}
+
+	// s (hfsq + R) in the fdlibm notation
+	template <typename V>
+	V log1p_series(V f, V hfsq)
+	{
+		const V s = f / (V(2.0) + f);
+		const V z = s * s;
+		const V w = z * z;
+		const V t1 = w * (V(3.999999999940941908e-01) + w * (V(2.222219843214978396e-01) + w * V(1.531383769920937332e-01)));
+		const V t2 = z * (V(6.666666666666735130e-01) + w * (V(2.857142874366239149e-01)
+			+ w * (V(1.818357216161805012e-01) + w * V(1.479819860511658591e-01))));
+		return s * (hfsq + t1 + t2);
+	}
+
+	template <typename V>
+	V log(V x, std::false_type /* double */)
+	{
+		V e, m;
+		split(x, e, m);
+		const V f = m - V(1.f);
+		const V y = log1p_tail(f, std::false_type()) + e * V(-2.12194440e-4f);
+		return log_special(x, (f + y) + e * V(0.693359375f));
+	}
+
+	template <typename V>
+	V log(V x, std::true_type /* double */)
+	{
+		V e, m;
+		split(x, e, m);
+		const V f = m - V(1.0);
+		const V hfsq = V(0.5) * f * f;
+		const V r = log1p_series(f, hfsq) + e * V(1.90821492927058770002e-10);
+		return log_special(x, e * V(6.93147180369123816490e-01) - ((hfsq - r) - f));
+	}
+
+	/*
+	 * log2(2^e m) in double precision, for the float kernels, given the
+	 * split of x (which is exact in float, so it is done before widening).
+	 * The series in s = (m - 1) / (m + 1) is truncated after s^11, whose
+	 * relative error (s^12 / 13 < 2^-34) is well below float precision.
+	 */
+	template <typename W>
+	inline W log2_widened(W e, W m)
+	{
+		const W s = (m - W(1.0)) / (m + W(1.0));
+		const W z = s * s;
+		const W z2 = z * z;
+		// Estrin's scheme, as these kernels are limited by latency rather than throughput
+		const W p01 = W(2.0) + z * W(2.0 / 3);
+		const W p23 = W(2.0 / 5) + z * W(2.0 / 7);
+		const W p45 = W(2.0 / 9) + z * W(2.0 / 11);
+		const W p = p01 + z2 * (p23 + z2 * p45);
+		return e + s * p * W(1.44269504088896340736);
+	}
+
+	template <typename V>
+	V log2(V x, std::false_type /* double */)
+	{
+		V e, m;
+		split(x, e, m);
+		return log_special(x, narrow(log2_widened(widen(e), widen(m))));
+	}
+
+	/*
+	 * As in fdlibm, f - hfsq is split so that multiplying its leading part
+	 * by the leading part of log2(e) is exact.
+	 */
+	template <typename V>
+	V log2(V x, std::true_type /* double */)
+	{
+		V e, m;
+		split(x, e, m);
+		const V f = m - V(1.0);
+		const V hfsq = V(0.5) * f * f;
+		const V r = log1p_series(f, hfsq);
+		const V hi = high_bits(f - hfsq);
+		const V lo = ((f - hi) - hfsq) + r;
+
+		const V log2e_hi = V(1.44269504072144627571e+00);
+		const V log2e_lo = V(1.67517131648865118353e-10);
+		const V val_hi = hi * log2e_hi;
+		const V val_lo = (lo + hi) * log2e_lo + lo * log2e_hi;
+		const V w = e + val_hi;
+		return log_special(x, (val_lo + ((e - w) + val_hi)) + w);
+	}
+
+} // namespace detail
+
+template <typename V, if_lane<V> = 0>
+V log(V x)
+{
+	return detail::log(x, std::is_same<scalar_t<V>, double>());
+}
+
+template <typename V, if_lane<V> = 0>
+V log2(V x)
+{
+	return detail::log2(x, std::is_same<scalar_t<V>, double>());
+}
+
+// }}}
+// power {{{
+
+namespace detail {
+
+	// the exact product a * b = hi + lo (Dekker)
+	template <typename V>
+	void two_product(V a, V b, V& hi, V& lo)
+	{
+		const V split = V(134217729.0); // 2^27 + 1
+		const V ta = a * split;
+		const V a_hi = ta - (ta - a);
+		const V a_lo = a - a_hi;
+		const V tb = b * split;
+		const V b_hi = tb - (tb - b);
+		const V b_lo = b - b_hi;
+		hi = a * b;
+		lo = ((a_hi * b_hi - hi) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+	}
+
+	/*
+	 * Whether x^y needs pow_special: x is not positive, or either argument
+	 * is infinite or NaN (which makes x * 0 + y * 0 NaN), or x is 1 (where
+	 * the double version's split of a huge y overflows). Other lanes are
+	 * left unchanged by pow_special, so it is skipped when there are none
+	 * of these.
+	 */
+	template <typename V>
+	bool pow_is_special(V x, V y)
+	{
+		using S = scalar_t<V>;
+		const V zero = V(S(0));
+		return any((x <= zero) | (x == V(S(1))) | (x * zero + y * zero != zero));
+	}
+
+	// patches x^y for the IEEE special cases, given the result for finite positive x
+	template <typename V>
+	V pow_special(V x, V y, V result)
+	{
+		using S = scalar_t<V>;
+		const S inf = std::numeric_limits<S>::infinity();
+		const V zero = V(S(0));
+		const V one = V(S(1));
+		const V ax = abs(x);
+
+		// 0^y and inf^y, for positive zero and infinity
+		result = select(ax == zero, select(y < zero, V(inf), select(y > zero, zero, one)), result);
+		result = select(ax == V(inf), select(y < zero, zero, select(y > zero, V(inf), one)), result);
+		result = select(is_nan(x) | is_nan(y), x + y, result);
+		// negative bases are not supported (see math.hpp)
+		result = select(x < zero, V(std::numeric_limits<S>::quiet_NaN()), result);
+		return select((y == zero) | (x == one), one, result);
+	}
+
+	/*
+	 * 2^t in double precision, for the float kernels. Only about 32 bits
+	 * are needed before rounding to float, so the Taylor series stops at
+	 * r^7 (error below 2^-27), and t is clamped to where the float result
+	 * is 0 or infinity, so 2^n is a normal double and t can be rounded by
+	 * adding 1.5 * 2^52.
+	 */
+	template <typename W>
+	inline W exp2_widened(W t)
+	{
+		const W round_const = W(6755399441055744.0);
+		t = clamp(t, W(-160.0), W(130.0));
+		const W k = t + round_const;
+		const W n = k - round_const;
+		const W r = (t - n) * W(0.693147180559945309417);
+		const W r2 = r * r;
+		const W p01 = W(1.0) + r;
+		const W p23 = W(0.5) + r * W(1.0 / 6);
+		const W p45 = W(1.0 / 24) + r * W(1.0 / 120);
+		const W p67 = W(1.0 / 720) + r * W(1.0 / 5040);
+		const W r4 = r2 * r2;
+		return scale_rounded(p01 + r2 * (p23 + r4 * p67) + r4 * p45, k);
+	}
+
+	/*
+	 * The float version works in double precision, which leaves an error
+	 * well below that of the final rounding to float.
+	 */
+	template <typename V>
+	V pow(V x, V y, std::false_type /* double */)
+	{
+		V e, m;
+		split(x, e, m);
+		const V result = narrow(exp2_widened(widen(y) * log2_widened(widen(e), widen(m))));
+		return pow_is_special(x, y) ? pow_special(x, y, result) : result;
+	}
+
+	/*
+	 * The double version computes log(x) as hi + lo, multiplies it by y
+	 * exactly, and adds the low part of the product to the reduced argument
+	 * of exp. The series part of lo is only rounded to double, so log(x) has
+	 * about 55 correct bits, and the error grows with |y| (see math.hpp).
+	 */
+	template <typename V>
+	V pow(V x, V y, std::true_type /* double */)
+	{
+		V e, m;
+		split(x, e, m);
+		const V f = m - V(1.0);
+
+		// log(x) = e ln2_hi + f - hfsq + (e ln2_lo + s (hfsq + R)), with hfsq exact
+		V sq_hi, sq_lo;
+		two_product(f, f, sq_hi, sq_lo);
+		const V hfsq = sq_hi * V(0.5);
+		const V hfsq_lo = sq_lo * V(0.5);
+		const V tail = log1p_series(f, hfsq) + e * V(1.90821492927058770002e-10);
+
+		// (a, b) accumulates the leading terms with an exact error term
+		const V a = e * V(6.93147180369123816490e-01);
+		V hi = a + f;
+		V lo = (a - hi) + f;
+		const V t = hi - hfsq;
+		lo = lo + ((hi - t) - hfsq) - hfsq_lo + tail;
+		hi = t;
+		const V l_hi = hi + lo;
+		const V l_lo = lo - (l_hi - hi);
+
+		// y log(x) = p_hi + p_lo
+		V p_hi, p_lo;
+		two_product(y, l_hi, p_hi, p_lo);
+		p_lo = p_lo + y * l_lo;
+
+		const V c = clamp(p_hi, V(-746.0), V(710.0));
+		const V n = round_bounded(c * V(1.44269504088896340736));
+		const V r = reduce_ln2(c, n, std::true_type()) + select(c == p_hi, p_lo, V(0.0));
+		const V result = scale(exp_poly(r, std::true_type()), n);
+		return pow_is_special(x, y) ? pow_special(x, y, result) : result;
+	}
+
+} // namespace detail
+
+template <typename V, if_lane<V> = 0>
+V pow(V x, V y)
+{
+	return detail::pow(x, y, std::is_same<scalar_t<V>, double>());
+}
+
+// }}}
+// trigonometric {{{
+
+namespace detail {
+
+	/*
+	 * sin and cos of r, for |r| <= pi/4. The float polynomials are from
+	 * Cephes sinf and cosf; the double ones are the fdlibm kernels, which
+	 * take the reduced argument as r + rr.
+	 */
+	template <typename V>
+	V sin_poly(V r, V /* rr */, std::false_type /* double */)
+	{
+		const V z = r * r;
+		V p = V(-1.9515295891e-4f);
+		p = p * z + V(8.3321608736e-3f);
+		p = p * z + V(-1.6666654611e-1f);
+		return p * z * r + r;
+	}
+
+	template <typename V>
+	V cos_poly(V r, V /* rr */, std::false_type /* double */)
+	{
+		const V z = r * r;
+		V p = V(2.443315711809948e-5f);
+		p = p * z + V(-1.388731625493765e-3f);
+		p = p * z + V(4.166664568298827e-2f);
+		return p * z * z - V(0.5f) * z + V(1.f);
+	}
+
+	template <typename V>
+	V sin_poly(V r, V rr, std::true_type /* double */)
+	{
+		const V z = r * r;
+		const V v = z * r;
+		const V p = V(8.33333333332248946124e-03) + z * (V(-1.98412698298579493134e-04)
+			+ z * (V(2.75573137070700676789e-06) + z * (V(-2.50507602534068634195e-08)
+			+ z * V(1.58969099521155010221e-10))));
+		return r - ((z * (V(0.5) * rr - v * p) - rr) - v * V(-1.66666666666666324348e-01));
+	}
+
+	template <typename V>
+	V cos_poly(V r, V rr, std::true_type /* double */)
+	{
+		const V z = r * r;
+		const V p = z * (V(4.16666666666666019037e-02) + z * (V(-1.38888888888741095749e-03)
+			+ z * (V(2.48015872894767294178e-05) + z * (V(-2.75573143513906633035e-07)
+			+ z * (V(2.08757232129817482790e-09) + z * V(-1.13596475577881948265e-11))))));
+		const V hz = V(0.5) * z;
+		const V w = V(1.0) - hz;
+		return w + (((V(1.0) - w) - hz) + (z * p - r * rr));
+	}
+
+	/*
+	 * x - n pi/2 = r + rr, with pi/2 in parts (Cody-Waite). n times the
+	 * leading part is exact for the supported range. float arguments are
+	 * reduced in double precision, since float parts would need four
+	 * terms to keep the result accurate next to multiples of pi/2.
+	 */
+	template <typename W>
+	W reduce_pio2_wide(W x, W& n)
+	{
+		n = round_bounded(x * W(0.636619772367581343076));
+		return (x - n * W(1.57079632673412561417e+00)) - n * W(6.07710050650619224932e-11);
+	}
+
+#if VELM_SIMD
+
+	inline f64x2x2 reduce_pio2_wide(f64x2x2 x, f64x2x2& n)
+	{
+		return {reduce_pio2_wide(x.lo, n.lo), reduce_pio2_wide(x.hi, n.hi)};
+	}
+
+#endif // VELM_SIMD
+
+	template <typename V>
+	V reduce_pio2(V x, V& n, V& rr, std::false_type /* double */)
+	{
+		decltype(widen(x)) wn;
+		const V r = narrow(reduce_pio2_wide(widen(x), wn));
+		n = narrow(wn);
+		rr = V(0.f);
+		return r;
+	}
+
+	template <typename V>
+	V reduce_pio2(V x, V& n, V& rr, std::true_type /* double */)
+	{
+		n = round_bounded(x * V(0.636619772367581343076));
+		const V t = x - n * V(1.57079632673412561417e+00);
+		const V w = n * V(6.07710050630396597660e-11);
+		const V r = t - w;
+		// the error of t - w, and the third part of pi/2
+		const V lo = ((t - r) - w) - n * V(2.02226624879595063154e-21);
+		const V out = r + lo;
+		rr = lo - (out - r);
+		return out;
+	}
+
+	// about 2^20 pi/2, so that n fits the leading part of pi/2
+	template <typename V>
+	V trig_limit()
+	{
+		return V(scalar_t<V>(1647099));
+	}
+
+	/*
+	 * Computes sin and cos of the reduced argument, and the quadrant. Lanes
+	 * beyond the limit have to be recomputed by the caller.
+	 */
+	template <typename V>
+	bool sincos_reduced(V x, V& s, V& c, V& quadrant)
+	{
+		using S = scalar_t<V>;
+		using is_double = std::is_same<S, double>;
+		V rr;
+		const V r = reduce_pio2(x, quadrant, rr, is_double());
+		s = sin_poly(r, rr, is_double());
+		c = cos_poly(r, rr, is_double());
+		// lanes beyond the limit (or NaN) get quadrant 0, so that it converts to an integer
+		quadrant = select(abs(x) <= trig_limit<V>(), quadrant, V(S(0)));
+		return any(abs(x) > trig_limit<V>());
+	}
+
+} // namespace detail
+
+template <typename V, if_lane<V> = 0>
+V sin(V x)
+{
+	V s, c, q;
+	const bool large = detail::sincos_reduced(x, s, c, q);
+	V out = select(bit0(q), c, s);
+	out = select(bit1(q), -out, out);
+	// the reduction loses the sign of zero
+	out = select(x == V(scalar_t<V>(0)), x, out);
+	if(large) {
+		using S = scalar_t<V>;
+		out = select(abs(x) > detail::trig_limit<V>(), fallback(x, [] (S a) { return std::sin(a); }), out);
+	}
+	return out;
+}
+
+template <typename V, if_lane<V> = 0>
+V cos(V x)
+{
+	V s, c, q;
+	const bool large = detail::sincos_reduced(x, s, c, q);
+	V out = select(bit0(q), -s, c);
+	out = select(bit1(q), -out, out);
+	if(large) {
+		using S = scalar_t<V>;
+		out = select(abs(x) > detail::trig_limit<V>(), fallback(x, [] (S a) { return std::cos(a); }), out);
+	}
+	return out;
+}
+
+template <typename V, if_lane<V> = 0>
+void sincos(V x, V& sin_out, V& cos_out)
+{
+	V s, c, q;
+	const bool large = detail::sincos_reduced(x, s, c, q);
+	const V odd = bit0(q);
+	V so = select(odd, c, s);
+	V co = select(odd, -s, c);
+	so = select(bit1(q), -so, so);
+	co = select(bit1(q), -co, co);
+	sin_out = select(x == V(scalar_t<V>(0)), x, so);
+	cos_out = co;
+	if(large) {
+		using S = scalar_t<V>;
+		const V big = abs(x) > detail::trig_limit<V>();
+		sin_out = select(big, fallback(x, [] (S a) { return std::sin(a); }), sin_out);
+		cos_out = select(big, fallback(x, [] (S a) { return std::cos(a); }), cos_out);
+	}
+}
+
+template <typename V, if_lane<V> = 0>
+V tan(V x)
+{
+	V s, c, q;
+	const bool large = detail::sincos_reduced(x, s, c, q);
+	V out = select(bit0(q), -c / s, s / c);
+	out = select(x == V(scalar_t<V>(0)), x, out);
+	if(large) {
+		using S = scalar_t<V>;
+		out = select(abs(x) > detail::trig_limit<V>(), fallback(x, [] (S a) { return std::tan(a); }), out);
+	}
+	return out;
+}
+
+// }}}
+// inverse trigonometric {{{
+
+namespace detail {
+
+	/*
+	 * atan(a) for a in [0, inf]. The float version reduces to |t| <=
+	 * tan(pi/8) and uses the Cephes atanf polynomial; the double one is fdlibm
+	 * atan, with five intervals and an 11 term series. Each interval is
+	 * (num / den), chosen with selects so that there is one division.
+	 */
+	template <typename V>
+	V atan_positive(V a, std::false_type /* double */)
+	{
+		const V big = a > V(2.414213562373095f);
+		const V mid = a > V(0.414213562373095f);
+		const V num = select(big, V(-1.f), select(mid, a - V(1.f), a));
+		const V den = select(big, a, select(mid, a + V(1.f), V(1.f)));
+		// pi/2 and pi/4 as float, and the remainders
+		const V base = select(big, V(1.57079637f), select(mid, V(0.785398185f), V(0.f)));
+		const V base_lo = select(big, V(-4.37113883e-8f), select(mid, V(-2.18556941e-8f), V(0.f)));
+		const V t = num / den;
+		const V z = t * t;
+		V p = V(8.05374449538e-2f);
+		p = p * z + V(-1.38776856032e-1f);
+		p = p * z + V(1.99777106478e-1f);
+		p = p * z + V(-3.33329491539e-1f);
+		return base + ((p * z * t + base_lo) + t);
+	}
+
+	template <typename V>
+	V atan_positive(V a, std::true_type /* double */)
+	{
+		const V i0 = a >= V(0.4375);
+		const V i1 = a >= V(0.6875);
+		const V i2 = a >= V(1.1875);
+		const V i3 = a >= V(2.4375);
+
+		V num = a, den = V(1.0), hi = V(0.0), lo = V(0.0);
+		num = select(i0, V(2.0) * a - V(1.0), num);
+		den = select(i0, V(2.0) + a, den);
+		hi = select(i0, V(4.63647609000806093515e-01), hi);
+		lo = select(i0, V(2.26987774529616870924e-17), lo);
+		num = select(i1, a - V(1.0), num);
+		den = select(i1, a + V(1.0), den);
+		hi = select(i1, V(7.85398163397448278999e-01), hi);
+		lo = select(i1, V(3.06161699786838301793e-17), lo);
+		num = select(i2, a - V(1.5), num);
+		den = select(i2, V(1.0) + V(1.5) * a, den);
+		hi = select(i2, V(9.82793723247329054082e-01), hi);
+		lo = select(i2, V(1.39033110312309984516e-17), lo);
+		num = select(i3, V(-1.0), num);
+		den = select(i3, a, den);
+		hi = select(i3, V(1.57079632679489655800e+00), hi);
+		lo = select(i3, V(6.12323399573676603587e-17), lo);
+
+		const V t = num / den;
+		const V z = t * t;
+		const V w = z * z;
+		const V s1 = z * (V(3.33333333333329318027e-01) + w * (V(1.42857142725034663711e-01)
+			+ w * (V(9.09088713343650656196e-02) + w * (V(6.66107313738753120669e-02)
+			+ w * (V(4.97687799461593236017e-02) + w * V(1.62858201153657823623e-02))))));
+		const V s2 = w * (V(-1.99999999998764832476e-01) + w * (V(-1.11111104054623557880e-01)
+			+ w * (V(-7.69187620504482999495e-02) + w * (V(-5.83357013379057348645e-02)
+			+ w * V(-3.65315727442169155270e-02)))));
+		// for the first interval hi and lo are 0, which leaves t - t (s1 + s2)
+		return hi - ((t * (s1 + s2) - lo) - t);
+	}
+} // namespace detail
+
+template <typename V, if_lane<V> = 0>
+V atan2(V y, V x)
+{
+	using S = scalar_t<V>;
+	using is_double = std::is_same<S, double>;
+	const S inf = std::numeric_limits<S>::infinity();
+	const V zero = V(S(0));
+	const V ax = abs(x);
+	const V ay = abs(y);
+
+	// atan(|y| / |x|), with 0 / 0 taken as 0 and inf / inf as 1
+	V a = ay / ax;
+	a = select(ay == zero, zero, a);
+	a = select((ax == V(inf)) & (ay == V(inf)), V(S(1)), a);
+	V r = detail::atan_positive(a, is_double());
+
+	// reflect into the left half-plane, using the sign of x so that -0 counts as negative
+	const V pi_hi = V(S(3.1415926535897931160));
+	const V pi_lo = V(S(1.2246467991473531772e-16));
+	r = select(signbit(x), pi_hi - (r - pi_lo), r);
+	r = copysign(r, y);
+	return select(is_nan(x) | is_nan(y), x + y, r);
+}
+
+// }}}
+// rounding and roots {{{
+
+template <typename V, if_lane<V> = 0>
+V fract(V x)
+{
+	return x - floor(x);
+}
+
+template <typename V, if_lane<V> = 0>
+V mod(V x, V y)
+{
+	return x - y * floor(x / y);
+}
+
+inline float sqrt(float x)
+{
+	return std::sqrt(x);
+}
+
+inline double sqrt(double x)
+{
+	return std::sqrt(x);
+}
+
+#if VELM_SIMD
+
+inline f32x4 sqrt(f32x4 x)
+{
+	return _mm_sqrt_ps(x.v);
+}
+
+inline f64x2 sqrt(f64x2 x)
+{
+	return _mm_sqrt_pd(x.v);
+}
+
+#endif // VELM_SIMD
+
+template <typename V, if_lane<V> = 0>
+V inversesqrt(V x)
+{
+	return V(scalar_t<V>(1)) / sqrt(x);
+}
+
+// }}}
+// estimates {{{
+
+/*
+ * The fast:: functions of fast.hpp start from the hardware reciprocal and
+ * reciprocal square root estimates (rcpss/rcpps, rsqrtss/rsqrtps), which have
+ * a relative error below 1.5 * 2^-12, and refine them with one Newton step.
+ * The estimates are table lookups which differ between CPU vendors, so the
+ * results may differ in the last bits between machines. There are no double
+ * estimates before AVX-512, so double lanes use the exact functions, as does
+ * everything without VELM_SIMD.
+ */
+
+#if VELM_SIMD
+
+inline float rsqrt_estimate(float x)
+{
+	return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+}
+
+inline f32x4 rsqrt_estimate(f32x4 x)
+{
+	return _mm_rsqrt_ps(x.v);
+}
+
+inline float rcp_estimate(float x)
+{
+	return _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ss(x)));
+}
+
+inline f32x4 rcp_estimate(f32x4 x)
+{
+	return _mm_rcp_ps(x.v);
+}
+
+#endif // VELM_SIMD
+
+template <typename V>
+using has_estimate = std::integral_constant<bool,
+	VELM_SIMD && std::is_same<scalar_t<V>, float>::value>;
+
+template <typename V>
+V fast_inversesqrt(V x, std::false_type /* estimate */)
+{
+	return inversesqrt(x);
+}
+
+template <typename V>
+V fast_inversesqrt(V x, std::true_type /* estimate */)
+{
+	const V y = rsqrt_estimate(x);
+	const V t = x * y;
+	/*
+	 * t is not finite for 0 and infinity, whose estimates (infinity and 0)
+	 * are exact, and for subnormals, which the estimate treats as 0
+	 */
+	return select(is_finite(t), y * (V(1.5f) - V(0.5f) * t * y), y);
+}
+
+template <typename V, if_lane<V> = 0>
+V fast_inversesqrt(V x)
+{
+	return fast_inversesqrt(x, has_estimate<V>());
+}
+
+/*
+ * fast_inversesqrt for positive normal x only (0 and infinity give NaN),
+ * which saves the special cases where the result is used as a scale factor
+ */
+template <typename V>
+V fast_inversesqrt_normal(V x, std::false_type /* estimate */)
+{
+	return inversesqrt(x);
+}
+
+template <typename V>
+V fast_inversesqrt_normal(V x, std::true_type /* estimate */)
+{
+	const V y = rsqrt_estimate(x);
+	return y * (V(1.5f) - V(0.5f) * (x * y) * y);
+}
+
+template <typename V, if_lane<V> = 0>
+V fast_inversesqrt_normal(V x)
+{
+	return fast_inversesqrt_normal(x, has_estimate<V>());
+}
+
+template <typename V>
+V fast_sqrt(V x, std::false_type /* estimate */)
+{
+	return sqrt(x);
+}
+
+template <typename V>
+V fast_sqrt(V x, std::true_type /* estimate */)
+{
+	const V y = rsqrt_estimate(x);
+	const V t = x * y;
+	// sqrt(x) = x for 0 and infinity, and subnormals are treated as 0
+	const V other = select(x < V(0.f), V(std::numeric_limits<float>::quiet_NaN()), x);
+	return select(is_finite(t), t * (V(1.5f) - V(0.5f) * t * y), other);
+}
+
+template <typename V, if_lane<V> = 0>
+V fast_sqrt(V x)
+{
+	return fast_sqrt(x, has_estimate<V>());
+}
+
+template <typename V>
+V fast_rcp(V x, std::false_type /* estimate */)
+{
+	return V(scalar_t<V>(1)) / x;
+}
+
+template <typename V>
+V fast_rcp(V x, std::true_type /* estimate */)
+{
+	const V y = rcp_estimate(x);
+	const V t = x * y;
+	// as for fast_inversesqrt, t is not finite for 0, subnormals and infinity
+	return select(is_finite(t), y * (V(2.f) - t), y);
+}
+
+template <typename V, if_lane<V> = 0>
+V fast_rcp(V x)
+{
+	return fast_rcp(x, has_estimate<V>());
+}
+
+// }}}
+// arrays {{{
+
+/*
+ * The widest lane type for T: an SSE register for float and double when
+ * VELM_SIMD is enabled, and T itself otherwise.
+ */
+template <typename T>
+struct reg
+{
+	using type = T;
+};
+
+#if VELM_SIMD
+
+template <>
+struct reg<float>
+{
+	using type = f32x4;
+};
+
+template <>
+struct reg<double>
+{
+	using type = f64x2;
+};
+
+#endif // VELM_SIMD
+
+template <typename T>
+using reg_t = typename reg<T>::type;
+
+// an input of map: either an array, or a single value used for every element
+template <typename T>
+struct array_source
+{
+	const T* ptr;
+
+	template <typename V>
+	V load(std::size_t i) const
+	{
+		return lane_traits<V>::load(ptr + i);
+	}
+
+	template <typename V>
+	V load_partial(std::size_t i, std::size_t n) const
+	{
+		return lane_traits<V>::load_partial(ptr + i, n);
+	}
+};
+
+template <typename T>
+struct scalar_source
+{
+	T val;
+
+	template <typename V>
+	V load(std::size_t /* i */) const
+	{
+		return V(val);
+	}
+
+	template <typename V>
+	V load_partial(std::size_t /* i */, std::size_t /* n */) const
+	{
+		return V(val);
+	}
+};
+
+template <typename T>
+array_source<T> source(const T* ptr)
+{
+	return {ptr};
+}
+
+template <typename T, std::enable_if_t<!std::is_pointer<T>::value, int> = 0>
+scalar_source<T> source(const T& val)
+{
+	return {val};
+}
+
+/**
+ * \fn map
+ * \brief apply a kernel to n elements, a register at a time
+ *
+ * out[i] = f(srcs[i]...), where f is called with reg_t<T> lanes. A final
+ * partial register is padded, so every element goes through exactly the
+ * same instructions. out may be the same array as one of the sources.
+ */
+template <typename T, typename F, typename... Srcs>
+void map(T* out, std::size_t n, F&& f, const Srcs&... srcs)
+{
+	using V = reg_t<T>;
+	constexpr std::size_t width = lane_traits<V>::width;
+
+	std::size_t i = 0;
+	for(; i + width <= n; i += width) {
+		lane_traits<V>::store(out + i, f(srcs.template load<V>(i)...));
+	}
+	if(i < n) {
+		lane_traits<V>::store_partial(out + i, f(srcs.template load_partial<V>(i, n - i)...), n - i);
+	}
+}
+
+/**
+ * \fn map_sincos
+ * \brief sin and cos of n elements, a register at a time
+ *
+ * in may be the same array as s or c.
+ */
+template <typename T>
+void map_sincos(const T* in, T* s, T* c, std::size_t n)
+{
+	using V = reg_t<T>;
+	constexpr std::size_t width = lane_traits<V>::width;
+
+	std::size_t i = 0;
+	V sv, cv;
+	for(; i + width <= n; i += width) {
+		sincos(lane_traits<V>::load(in + i), sv, cv);
+		lane_traits<V>::store(s + i, sv);
+		lane_traits<V>::store(c + i, cv);
+	}
+	if(i < n) {
+		sincos(lane_traits<V>::load_partial(in + i, n - i), sv, cv);
+		lane_traits<V>::store_partial(s + i, sv, n - i);
+		lane_traits<V>::store_partial(c + i, cv, n - i);
+	}
+}
+
+// }}}
+
+} } // namespace velm::kernels
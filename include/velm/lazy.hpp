@@ -0,0 +1,293 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+
+/**
+ * \file lazy.hpp
+ * \brief opt-in expression templates for vector arithmetic
+ *
+ * Normally every operator produces a complete velm::vector, so an expression
+ * like a * s + b * t - c creates a temporary after each operator. Wrapping an
+ * operand with velm::lazy makes the operators build an expression instead,
+ * which is only evaluated, one component at a time, when it is converted to a
+ * vector or assigned to a vector or swizzle:
+ *
+ *      velm::vector<float, 3> r = velm::lazy(a) * s + b * t - c;
+ *      a.xy = velm::lazy(a.yx) * 2.f; // all components are read before writing
+ *
+ * Expressions are tied vectors whose tie contains the computed components, so
+ * they can also be passed directly to functions (e.g. velm::dot). Once any
+ * operand is lazy, the whole expression is; other vectors and scalars are
+ * captured as leaves.
+ *
+ * Named (lvalue) operands are captured by reference and temporaries by value,
+ * so an expression can be stored with auto as long as its named operands
+ * outlive it. Use velm::eval to force evaluation.
+ */
+
+namespace velm { namespace expr {
+
+/*
+ * Each node provides:
+ *  - expression_tag, marking it as a lazy expression
+ *  - dimensions, which is 0 for broadcast scalars
+ *  - value_type, the type of each computed component
+ *  - get<I>(), computing component I
+ *  - tie(), a tuple of all computed components
+ */
+
+template <typename Derived>
+struct node_base
+{
+	using expression_tag = void;
+
+private:
+
+	const Derived& self() const
+	{
+		return static_cast<const Derived&>(*this);
+	}
+
+	template <std::size_t... Is>
+	auto tie_impl(std::index_sequence<Is...> /* seq */) const
+	{
+		return std::make_tuple(this->self().template get<Is>()...);
+	}
+
+public:
+
+	auto tie() const
+	{
+		static_assert(Derived::dimensions > 0, "Expression must contain a vector");
+		return this->tie_impl(std::make_index_sequence<Derived::dimensions>());
+	}
+
+	auto eval() const
+	{
+		using value_type = typename Derived::value_type;
+		return vector<value_type, Derived::dimensions>::from_tuple(this->tie());
+	}
+};
+
+/**
+ * \struct leaf
+ * \brief vector operand of an expression
+ *
+ * V is either a (const) reference type, for named operands, or a value type,
+ * for temporaries.
+ */
+template <typename V>
+struct leaf
+	: node_base<leaf<V>>
+{
+	using tie_type = std::decay_t<decltype(get_tie(std::declval<const std::decay_t<V>&>()))>;
+
+	static constexpr unsigned int dimensions = std::tuple_size<tie_type>::value;
+	using value_type = std::decay_t<typename utility::tuple_traits<tie_type>::common_type>;
+
+	V vec;
+
+	template <typename U>
+	explicit leaf(U&& v)
+		: vec(std::forward<U>(v))
+	{
+	}
+
+	template <std::size_t I>
+	decltype(auto) get() const
+	{
+		return std::get<I>(get_tie(vec));
+	}
+};
+
+/**
+ * \struct constant
+ * \brief scalar operand of an expression, broadcast to every component
+ */
+template <typename T>
+struct constant
+	: node_base<constant<T>>
+{
+	static constexpr unsigned int dimensions = 0;
+	using value_type = T;
+
+	T val;
+
+	template <typename U>
+	explicit constant(U&& v)
+		: val(std::forward<U>(v))
+	{
+	}
+
+	template <std::size_t I>
+	const T& get() const
+	{
+		return val;
+	}
+};
+
+template <typename Op, typename L, typename R>
+struct binary
+	: node_base<binary<Op, L, R>>
+{
+	static_assert(L::dimensions == 0 || R::dimensions == 0 || L::dimensions == R::dimensions,
+	              "Operands must have the same dimensions");
+
+	static constexpr unsigned int dimensions = L::dimensions > R::dimensions ? L::dimensions : R::dimensions;
+	using value_type = std::decay_t<decltype(Op{}(
+		std::declval<const typename L::value_type&>(), std::declval<const typename R::value_type&>()))>;
+
+	L lhs;
+	R rhs;
+
+	binary(L l, R r)
+		: lhs(std::move(l)), rhs(std::move(r))
+	{
+	}
+
+	template <std::size_t I>
+	auto get() const
+	{
+		return Op{}(lhs.template get<I>(), rhs.template get<I>());
+	}
+};
+
+template <typename E>
+struct negate
+	: node_base<negate<E>>
+{
+	static constexpr unsigned int dimensions = E::dimensions;
+	using value_type = std::decay_t<decltype(-std::declval<const typename E::value_type&>())>;
+
+	E arg;
+
+	explicit negate(E e)
+		: arg(std::move(e))
+	{
+	}
+
+	template <std::size_t I>
+	auto get() const
+	{
+		return -arg.template get<I>();
+	}
+};
+
+// operands {{{
+
+template <typename T>
+using is_node = utility::is_expression<T>;
+
+template <typename T, std::enable_if_t<is_node<T>::value, int> = 0>
+std::decay_t<T> make_operand(T&& node)
+{
+	return std::forward<T>(node);
+}
+
+// named vectors are captured by reference, temporaries by value
+template <typename T, std::enable_if_t<!is_node<T>::value && utility::is_tied_vector<T>::value
+	&& std::is_lvalue_reference<T>::value, int> = 0>
+leaf<const std::decay_t<T>&> make_operand(T&& vec)
+{
+	return leaf<const std::decay_t<T>&>(vec);
+}
+
+template <typename T, std::enable_if_t<!is_node<T>::value && utility::is_tied_vector<T>::value
+	&& !std::is_lvalue_reference<T>::value, int> = 0>
+leaf<std::decay_t<T>> make_operand(T&& vec)
+{
+	return leaf<std::decay_t<T>>(std::forward<T>(vec));
+}
+
+template <typename T, std::enable_if_t<!utility::is_tied_vector<T>::value, int> = 0>
+constant<std::decay_t<T>> make_operand(T&& val)
+{
+	return constant<std::decay_t<T>>(std::forward<T>(val));
+}
+
+template <typename T>
+using operand_t = decltype(make_operand(std::declval<T>()));
+
+template <typename Op, typename L, typename R>
+binary<Op, operand_t<L>, operand_t<R>> make_binary(L&& lhs, R&& rhs)
+{
+	return {make_operand(std::forward<L>(lhs)), make_operand(std::forward<R>(rhs))};
+}
+
+template <typename L, typename R>
+using if_lazy_operands = std::enable_if_t<is_node<L>::value || is_node<R>::value, int>;
+
+// }}}
+// operators {{{
+
+template <typename E, std::enable_if_t<is_node<E>::value, int> = 0>
+auto operator+(E&& e)
+{
+	return make_operand(std::forward<E>(e));
+}
+
+template <typename E, std::enable_if_t<is_node<E>::value, int> = 0>
+auto operator-(E&& e)
+{
+	return negate<std::decay_t<E>>(std::forward<E>(e));
+}
+
+template <typename L, typename R, if_lazy_operands<L, R> = 0>
+auto operator+(L&& lhs, R&& rhs)
+{
+	return make_binary<simd::op_add>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template <typename L, typename R, if_lazy_operands<L, R> = 0>
+auto operator-(L&& lhs, R&& rhs)
+{
+	return make_binary<simd::op_sub>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template <typename L, typename R, if_lazy_operands<L, R> = 0>
+auto operator*(L&& lhs, R&& rhs)
+{
+	return make_binary<simd::op_mul>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+template <typename L, typename R, if_lazy_operands<L, R> = 0>
+auto operator/(L&& lhs, R&& rhs)
+{
+	return make_binary<simd::op_div>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+// }}}
+
+} // namespace expr
+
+/**
+ * \fn lazy
+ * \brief start a lazy expression
+ *
+ * Wraps a vector (or swizzle, or user-provided vector) so that operators
+ * applied to it build an expression rather than evaluating immediately.
+ */
+template <typename V, std::enable_if_t<utility::is_tied_vector<V>::value, int> = 0>
+auto lazy(V&& vec)
+{
+	return expr::make_operand(std::forward<V>(vec));
+}
+
+/**
+ * \fn eval
+ * \brief evaluate a lazy expression into a vector
+ */
+template <typename E, std::enable_if_t<utility::is_expression<E>::value, int> = 0>
+auto eval(const E& e)
+{
+	return e.eval();
+}
+
+} // namespace velm
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "simd.hpp"
+
+/**
+ * \file mask.hpp
+ * \brief compact result of component-wise comparisons
+ *
+ * velm::mask<N> holds N bools as bits, and is what the relational functions
+ * (lessThan, equal, ...) return for vectors whose components compare to bool.
+ * Vectors which fill SSE/AVX registers (see simd.hpp) are compared with one
+ * packed compare and movemask per register, and all, any and none are then a
+ * single integer test rather than a loop over the components:
+ *
+ *      velm::mask<4> inside = velm::lessThan(velm::abs(p), extent);
+ *      if(velm::all(inside)) { ... }
+ *      velm::vector<float, 4> q = velm::select(inside, p, fallback);
+ *
+ * Masks convert implicitly to and from velm::vector<bool, N>, so code which
+ * stores the result of a comparison in a bool vector keeps working. Convert
+ * to a vector for swizzles and the other functions on vectors.
+ */
+
+namespace velm {
+
+template <unsigned int N>
+struct mask
+{
+	static_assert(N > 0, "Masks must have at least one component");
+
+public: // statics
+
+	using word = std::uint32_t;
+	static constexpr unsigned int word_bits = 32;
+	static constexpr unsigned int word_count = (N + word_bits - 1) / word_bits;
+
+	// the bits of word w which hold components
+	static constexpr word used_bits(unsigned int w)
+	{
+		return (w + 1 < word_count || N % word_bits == 0)
+			? ~word(0) : (word(1) << (N % word_bits)) - 1;
+	}
+
+public:
+
+	// component i is bit i % 32 of words[i / 32]; the bits past N are always 0
+	word words[word_count];
+
+	constexpr mask()
+		: words{}
+	{
+	}
+
+	explicit constexpr mask(bool val)
+		: words{}
+	{
+		for(unsigned int w = 0; w < word_count; ++w) {
+			words[w] = val ? used_bits(w) : 0;
+		}
+	}
+
+	constexpr mask(const vector<bool, N>& vec)
+		: words{}
+	{
+		for(unsigned int i = 0; i < N; ++i) {
+			words[i / word_bits] |= word(vec[i]) << (i % word_bits);
+		}
+	}
+
+	operator vector<bool, N>() const
+	{
+		vector<bool, N> out;
+		for(unsigned int i = 0; i < N; ++i) {
+			out[i] = (*this)[i];
+		}
+		return out;
+	}
+
+	constexpr bool operator[](std::size_t idx) const
+	{
+		return ((words[idx / word_bits] >> (idx % word_bits)) & 1) != 0;
+	}
+
+	constexpr void set(std::size_t idx, bool val)
+	{
+		const word bit = word(1) << (idx % word_bits);
+		words[idx / word_bits] = val ? (words[idx / word_bits] | bit) : (words[idx / word_bits] & ~bit);
+	}
+
+	constexpr mask& operator&=(const mask& other)
+	{
+		for(unsigned int w = 0; w < word_count; ++w) {
+			words[w] &= other.words[w];
+		}
+		return *this;
+	}
+
+	constexpr mask& operator|=(const mask& other)
+	{
+		for(unsigned int w = 0; w < word_count; ++w) {
+			words[w] |= other.words[w];
+		}
+		return *this;
+	}
+
+	constexpr mask& operator^=(const mask& other)
+	{
+		for(unsigned int w = 0; w < word_count; ++w) {
+			words[w] ^= other.words[w];
+		}
+		return *this;
+	}
+
+	constexpr mask operator~() const
+	{
+		mask out;
+		for(unsigned int w = 0; w < word_count; ++w) {
+			out.words[w] = ~words[w] & used_bits(w);
+		}
+		return out;
+	}
+
+	friend constexpr mask operator&(mask lhs, const mask& rhs) { return lhs &= rhs; }
+	friend constexpr mask operator|(mask lhs, const mask& rhs) { return lhs |= rhs; }
+	friend constexpr mask operator^(mask lhs, const mask& rhs) { return lhs ^= rhs; }
+
+	friend constexpr bool operator==(const mask& lhs, const mask& rhs)
+	{
+		for(unsigned int w = 0; w < word_count; ++w) {
+			if(lhs.words[w] != rhs.words[w]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	friend constexpr bool operator!=(const mask& lhs, const mask& rhs)
+	{
+		return !(lhs == rhs);
+	}
+};
+
+// logical {{{
+
+/**
+ * \fn all
+ * \brief check that all components are true
+ */
+template <unsigned int N>
+constexpr bool all(mask<N> m)
+{
+	for(unsigned int w = 0; w < mask<N>::word_count; ++w) {
+		if(m.words[w] != mask<N>::used_bits(w)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * \fn any
+ * \brief check if any components are true
+ */
+template <unsigned int N>
+constexpr bool any(mask<N> m)
+{
+	typename mask<N>::word acc = 0;
+	for(unsigned int w = 0; w < mask<N>::word_count; ++w) {
+		acc |= m.words[w];
+	}
+	return acc != 0;
+}
+
+/**
+ * \fn none
+ * \brief check that all components are false
+ */
+template <unsigned int N>
+constexpr bool none(mask<N> m)
+{
+	return !any(m);
+}
+
+/**
+ * \fn negate
+ * \brief component-wise logical not
+ */
+template <unsigned int N>
+constexpr mask<N> negate(mask<N> m)
+{
+	return ~m;
+}
+
+/**
+ * \fn equal
+ * \brief component-wise equality of two masks
+ *
+ * Masks are not vectors, so these overloads keep equal and notEqual
+ * component-wise, as for vectors of bool.
+ */
+template <unsigned int N>
+constexpr mask<N> equal(mask<N> lhs, mask<N> rhs)
+{
+	return ~(lhs ^ rhs);
+}
+
+/**
+ * \fn notEqual
+ * \brief component-wise inequality of two masks
+ */
+template <unsigned int N>
+constexpr mask<N> notEqual(mask<N> lhs, mask<N> rhs)
+{
+	return lhs ^ rhs;
+}
+
+/**
+ * \fn select
+ * \brief component-wise choice between two vectors
+ *
+ * Each component is taken from a where the mask is set, and from b elsewhere,
+ * without branches. Vectors which fill SSE/AVX registers are blended a
+ * register at a time. Scalars are broadcast.
+ */
+template <typename T, unsigned int N>
+vector<T, N> select(const mask<N>& m, const vector<T, N>& a, const vector<T, N>& b)
+{
+	return simd::select_apply(m, a, b);
+}
+
+template <typename T, unsigned int N>
+vector<T, N> select(const mask<N>& m, const vector<T, N>& a, const T& b)
+{
+	return simd::select_apply(m, a, vector<T, N>(b));
+}
+
+template <typename T, unsigned int N>
+vector<T, N> select(const mask<N>& m, const T& a, const vector<T, N>& b)
+{
+	return simd::select_apply(m, vector<T, N>(a), b);
+}
+
+// }}}
+
+} // namespace velm
@@ -0,0 +1,830 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+#include "kernels.hpp"
+
+/**
+ * \file math.hpp
+ * \brief exponential, trigonometric and rounding functions
+ *
+ * The GLSL functions exp, exp2, log, log2, pow, sin, cos, tan, atan2 (GLSL's
+ * two argument atan), sqrt, inversesqrt, floor, ceil, fract, mod, step and
+ * smoothstep, plus sincos, which computes a sine and cosine together for
+ * about the cost of one. Each works on scalars, on vectors (component-wise)
+ * and on velm::pack (lane-wise, see pack.hpp); batch.hpp has versions for
+ * whole arrays.
+ *
+ * float and double use the polynomial kernels of kernels.hpp rather than the
+ * standard library. A velm::vector of float or double is processed an SSE
+ * register at a time, padding the last register, so vector<float, 3> costs
+ * one kernel evaluation instead of three calls. Every path runs the same
+ * operations, so a value gives the same result as a scalar, a vector
+ * component, a pack lane or an array element. Other component types call the
+ * standard functions (found by argument-dependent lookup, so user-defined
+ * types can provide their own).
+ *
+ * Error bounds in ulp, from the worst errors against long double over 20
+ * million random arguments in each range checked by tests/math_ulp.cpp,
+ * plus 0.05 and rounded up to a tenth. The ranges cover exp and exp2 up to
+ * overflow and down to subnormal results, log, log2, sqrt and inversesqrt
+ * on every positive number, sin, cos and tan for |x| < 1.6e6, and atan2 on
+ * [-1, 1]^2 and on magnitudes in [2^-20, 2^20]:
+ *
+ *      function      float   double
+ *      exp           1.1     1.1
+ *      exp2          1.1     1.1
+ *      log           1.0     0.9
+ *      log2          0.6     0.9
+ *      pow           0.7     3.0 for results in [2^-16, 2^16], 160 otherwise
+ *      sin, cos      1.6     0.9
+ *      tan           3.4     2.3
+ *      atan2         2.5     1.6
+ *      sqrt          0.5     0.5
+ *      inversesqrt   1.6     1.6
+ *      floor, ceil   exact   exact
+ *
+ * The error of double pow grows with |y|, since the logarithm it multiplies
+ * by y has only about 55 correct bits: roughly 0.15 ulp per power of 2 in
+ * the result, for x near 1.
+ *
+ * sin, cos and tan are accurate up to |x| = 2^20 pi/2 (about 1.6e6), and use
+ * the standard functions beyond that. fract and mod follow the GLSL
+ * definitions, x - floor(x) and x - y floor(x / y).
+ *
+ * Special values follow C (infinities, NaN, signed zeros), except that pow
+ * does not support negative bases: pow(x, y) is NaN for x < 0 (as in GLSL),
+ * even for integer y, and -0 is treated as +0.
+ */
+
+namespace velm {
+
+namespace detail {
+
+	template <typename T>
+	using is_kernel_type = std::integral_constant<bool,
+		std::is_same<T, float>::value || std::is_same<T, double>::value>;
+
+	/*
+	 * Each function is an object with a kernel for lane types (float,
+	 * double and the SSE registers), and a fallback for everything else.
+	 */
+	struct exp_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::exp(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::exp;
+			return exp(x);
+		}
+	};
+
+	struct exp2_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::exp2(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::exp2;
+			return exp2(x);
+		}
+	};
+
+	struct log_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::log(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::log;
+			return log(x);
+		}
+	};
+
+	struct log2_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::log2(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::log2;
+			return log2(x);
+		}
+	};
+
+	struct sin_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::sin(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::sin;
+			return sin(x);
+		}
+	};
+
+	struct cos_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::cos(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::cos;
+			return cos(x);
+		}
+	};
+
+	struct tan_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::tan(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::tan;
+			return tan(x);
+		}
+	};
+
+	struct sqrt_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::sqrt(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::sqrt;
+			return sqrt(x);
+		}
+	};
+
+	struct inversesqrt_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::inversesqrt(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::sqrt;
+			return T(1) / sqrt(x);
+		}
+	};
+
+	struct floor_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::floor(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::floor;
+			return floor(x);
+		}
+	};
+
+	struct ceil_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::ceil(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::ceil;
+			return ceil(x);
+		}
+	};
+
+	struct fract_fn
+	{
+		template <typename V>
+		V operator()(V x) const
+		{
+			return kernels::fract(x);
+		}
+
+		template <typename T>
+		auto fallback(const T& x) const
+		{
+			using std::floor;
+			return x - floor(x);
+		}
+	};
+
+	struct pow_fn
+	{
+		template <typename V>
+		V operator()(V x, V y) const
+		{
+			return kernels::pow(x, y);
+		}
+
+		template <typename T>
+		auto fallback(const T& x, const T& y) const
+		{
+			using std::pow;
+			return pow(x, y);
+		}
+	};
+
+	struct atan2_fn
+	{
+		template <typename V>
+		V operator()(V x, V y) const
+		{
+			return kernels::atan2(x, y);
+		}
+
+		template <typename T>
+		auto fallback(const T& x, const T& y) const
+		{
+			using std::atan2;
+			return atan2(x, y);
+		}
+	};
+
+	struct mod_fn
+	{
+		template <typename V>
+		V operator()(V x, V y) const
+		{
+			return kernels::mod(x, y);
+		}
+
+		template <typename T>
+		auto fallback(const T& x, const T& y) const
+		{
+			using std::floor;
+			return x - y * floor(x / y);
+		}
+	};
+
+	template <typename F, typename T>
+	auto math_call(F f, const T& x, std::true_type /* kernel */)
+	{
+		return f(x);
+	}
+
+	template <typename F, typename T>
+	auto math_call(F f, const T& x, std::false_type /* kernel */)
+	{
+		return f.fallback(x);
+	}
+
+	template <typename F, typename T>
+	auto math_call(F f, const T& x, const T& y, std::true_type /* kernel */)
+	{
+		return f(x, y);
+	}
+
+	template <typename F, typename T>
+	auto math_call(F f, const T& x, const T& y, std::false_type /* kernel */)
+	{
+		return f.fallback(x, y);
+	}
+
+	template <typename T>
+	using if_math_scalar = std::enable_if_t<std::is_arithmetic<T>::value, int>;
+
+	template <typename V>
+	using if_math_vector = std::enable_if_t<utility::is_tied_vector<V>::value
+		&& !utility::is_quaternion<V>::value, int>;
+
+	template <typename A, typename B>
+	using if_math_appliable = std::enable_if_t<utility::is_appliable<A, B>::value
+		&& !utility::is_quaternion<A>::value && !utility::is_quaternion<B>::value, int>;
+
+	/*
+	 * Vectors of float and double whose storage can be read directly go
+	 * through the kernels a register at a time; swizzles are copied into a
+	 * vector first.
+	 */
+	template <typename V, typename = void>
+	struct kernel_vector
+		: std::false_type
+	{
+	};
+
+	template <typename V>
+	struct kernel_vector<V, std::enable_if_t<utility::is_direct_vector<V>::value>>
+		: is_kernel_type<typename std::decay_t<V>::value_type>
+	{
+	};
+
+	template <typename T, unsigned int N>
+	const vector<T, N>& contiguous(const vector<T, N>& vec)
+	{
+		return vec;
+	}
+
+	template <typename T, unsigned int... Is>
+	vector<T, sizeof...(Is)> contiguous(const swizzle_proxy<T, Is...>& proxy)
+	{
+		return proxy();
+	}
+
+	template <typename F, typename V, std::enable_if_t<kernel_vector<V>::value, int> = 0>
+	auto vector_call(F f, const V& vec)
+	{
+		using T = typename V::value_type;
+		constexpr auto N = utility::direct_size<V>::value;
+		const auto& in = contiguous(vec);
+		vector<T, N> out;
+		kernels::map(&out[0], N, f, kernels::source(&in[0]));
+		return out;
+	}
+
+	template <typename F, typename V, std::enable_if_t<!kernel_vector<V>::value, int> = 0>
+	auto vector_call(F f, const V& vec)
+	{
+		return utility::unary_apply(vec, [&] (const auto& x) {
+			return math_call(f, x, is_kernel_type<std::decay_t<decltype(x)>>()); });
+	}
+
+	/*
+	 * For two operands, the kernels are used when both are vectors of the
+	 * same float type and size, or one is, and the other is a scalar which
+	 * converts to that type without changing the result type.
+	 */
+	template <typename A, typename B, typename = void>
+	struct kernel_binary
+		: std::false_type
+	{
+	};
+
+	template <typename A, typename B>
+	struct kernel_binary<A, B, std::enable_if_t<kernel_vector<A>::value && kernel_vector<B>::value>>
+		: std::integral_constant<bool,
+			std::is_same<typename A::value_type, typename B::value_type>::value
+			&& utility::direct_size<A>::value == utility::direct_size<B>::value>
+	{
+	};
+
+	template <typename A, typename B>
+	struct kernel_binary<A, B, std::enable_if_t<kernel_vector<A>::value && std::is_arithmetic<B>::value>>
+		: std::is_same<std::common_type_t<typename A::value_type, B>, typename A::value_type>
+	{
+	};
+
+	template <typename A, typename B>
+	struct kernel_binary<A, B, std::enable_if_t<std::is_arithmetic<A>::value && kernel_vector<B>::value>>
+		: std::is_same<std::common_type_t<A, typename B::value_type>, typename B::value_type>
+	{
+	};
+
+	template <typename T, unsigned int N, typename V>
+	kernels::array_source<T> binary_source(const V& vec, vector<T, N>& tmp, std::true_type /* vector */)
+	{
+		// only swizzles are copied
+		tmp = vector<T, N>(vec);
+		return kernels::source(static_cast<const T*>(&tmp[0]));
+	}
+
+	template <typename T, unsigned int N>
+	kernels::array_source<T> binary_source(const vector<T, N>& vec, vector<T, N>& /* tmp */, std::true_type /* vector */)
+	{
+		return kernels::source(&vec[0]);
+	}
+
+	template <typename T, unsigned int N, typename S>
+	kernels::scalar_source<T> binary_source(const S& val, vector<T, N>& /* tmp */, std::false_type /* vector */)
+	{
+		return kernels::source(static_cast<T>(val));
+	}
+
+	template <typename A, typename B>
+	struct binary_shape
+	{
+		using vec = std::conditional_t<utility::is_tied_vector<A>::value, A, B>;
+		using type = typename vec::value_type;
+		static constexpr unsigned int size = utility::direct_size<vec>::value;
+	};
+
+	template <typename F, typename A, typename B, std::enable_if_t<kernel_binary<A, B>::value, int> = 0>
+	auto binary_call(F f, const A& a, const B& b)
+	{
+		using T = typename binary_shape<A, B>::type;
+		constexpr auto N = binary_shape<A, B>::size;
+		vector<T, N> tmp_a, tmp_b, out;
+		const auto src_a = binary_source(a, tmp_a, utility::is_tied_vector<A>());
+		const auto src_b = binary_source(b, tmp_b, utility::is_tied_vector<B>());
+		kernels::map(&out[0], N, f, src_a, src_b);
+		return out;
+	}
+
+	template <typename F, typename A, typename B, std::enable_if_t<!kernel_binary<A, B>::value, int> = 0>
+	auto binary_call(F f, const A& a, const B& b)
+	{
+		return utility::binary_apply(a, b, [&] (const auto& x, const auto& y) {
+			using C = std::common_type_t<std::decay_t<decltype(x)>, std::decay_t<decltype(y)>>;
+			return math_call(f, static_cast<C>(x), static_cast<C>(y), is_kernel_type<C>());
+		});
+	}
+
+	// scalars are converted to their common type, as the vector operators do
+	template <typename F, typename T, typename U>
+	auto scalar_binary_call(F f, const T& x, const U& y)
+	{
+		using C = std::common_type_t<T, U>;
+		return math_call(f, static_cast<C>(x), static_cast<C>(y), is_kernel_type<C>());
+	}
+
+} // namespace detail
+
+inline namespace funcs {
+
+	// exponential {{{
+
+	/**
+	 * \fn exp
+	 * \brief natural exponential, e^x
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto exp(T x)
+	{
+		return detail::math_call(detail::exp_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto exp(const V& vec)
+	{
+		return detail::vector_call(detail::exp_fn(), vec);
+	}
+
+	/**
+	 * \fn exp2
+	 * \brief base 2 exponential, 2^x
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto exp2(T x)
+	{
+		return detail::math_call(detail::exp2_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto exp2(const V& vec)
+	{
+		return detail::vector_call(detail::exp2_fn(), vec);
+	}
+
+	/**
+	 * \fn log
+	 * \brief natural logarithm
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto log(T x)
+	{
+		return detail::math_call(detail::log_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto log(const V& vec)
+	{
+		return detail::vector_call(detail::log_fn(), vec);
+	}
+
+	/**
+	 * \fn log2
+	 * \brief base 2 logarithm
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto log2(T x)
+	{
+		return detail::math_call(detail::log2_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto log2(const V& vec)
+	{
+		return detail::vector_call(detail::log2_fn(), vec);
+	}
+
+	/**
+	 * \fn pow
+	 * \brief x raised to the power y
+	 *
+	 * Either argument may be a scalar, which is used for every component.
+	 * x must not be negative (see the file documentation).
+	 */
+	template <typename T, typename U, detail::if_math_scalar<T> = 0, detail::if_math_scalar<U> = 0>
+	auto pow(T x, U y)
+	{
+		return detail::scalar_binary_call(detail::pow_fn(), x, y);
+	}
+
+	template <typename A, typename B, detail::if_math_appliable<A, B> = 0>
+	auto pow(const A& x, const B& y)
+	{
+		return detail::binary_call(detail::pow_fn(), x, y);
+	}
+
+	/**
+	 * \fn sqrt
+	 * \brief square root
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto sqrt(T x)
+	{
+		return detail::math_call(detail::sqrt_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto sqrt(const V& vec)
+	{
+		return detail::vector_call(detail::sqrt_fn(), vec);
+	}
+
+	/**
+	 * \fn inversesqrt
+	 * \brief reciprocal of the square root
+	 *
+	 * This is 1 / sqrt(x), rounded twice.
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto inversesqrt(T x)
+	{
+		return detail::math_call(detail::inversesqrt_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto inversesqrt(const V& vec)
+	{
+		return detail::vector_call(detail::inversesqrt_fn(), vec);
+	}
+
+	// }}}
+	// trigonometric {{{
+
+	/**
+	 * \fn sin
+	 * \brief sine, in radians
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto sin(T x)
+	{
+		return detail::math_call(detail::sin_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto sin(const V& vec)
+	{
+		return detail::vector_call(detail::sin_fn(), vec);
+	}
+
+	/**
+	 * \fn cos
+	 * \brief cosine, in radians
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto cos(T x)
+	{
+		return detail::math_call(detail::cos_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto cos(const V& vec)
+	{
+		return detail::vector_call(detail::cos_fn(), vec);
+	}
+
+	/**
+	 * \fn sincos
+	 * \brief sine and cosine together
+	 *
+	 * Stores sin(x) in s and cos(x) in c. The range reduction is shared,
+	 * so this is cheaper than calling both.
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	void sincos(T x, T& s, T& c)
+	{
+		s = sin(x);
+		c = cos(x);
+	}
+
+	inline void sincos(float x, float& s, float& c)
+	{
+		kernels::sincos(x, s, c);
+	}
+
+	inline void sincos(double x, double& s, double& c)
+	{
+		kernels::sincos(x, s, c);
+	}
+
+	template <typename T, unsigned int N, std::enable_if_t<detail::is_kernel_type<T>::value, int> = 0>
+	void sincos(const vector<T, N>& x, vector<T, N>& s, vector<T, N>& c)
+	{
+		kernels::map_sincos(&x[0], &s[0], &c[0], N);
+	}
+
+	template <typename T, unsigned int N, std::enable_if_t<!detail::is_kernel_type<T>::value, int> = 0>
+	void sincos(const vector<T, N>& x, vector<T, N>& s, vector<T, N>& c)
+	{
+		for(unsigned int i = 0; i < N; ++i) {
+			// x may be the same vector as s or c
+			const T val = x[i];
+			sincos(val, s[i], c[i]);
+		}
+	}
+
+	/**
+	 * \fn tan
+	 * \brief tangent, in radians
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto tan(T x)
+	{
+		return detail::math_call(detail::tan_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto tan(const V& vec)
+	{
+		return detail::vector_call(detail::tan_fn(), vec);
+	}
+
+	/**
+	 * \fn atan2
+	 * \brief arc tangent of y / x, using the signs of both for the quadrant
+	 *
+	 * This is the two argument form of the GLSL atan. The result is in
+	 * [-pi, pi].
+	 */
+	template <typename T, typename U, detail::if_math_scalar<T> = 0, detail::if_math_scalar<U> = 0>
+	auto atan2(T y, U x)
+	{
+		return detail::scalar_binary_call(detail::atan2_fn(), y, x);
+	}
+
+	template <typename A, typename B, detail::if_math_appliable<A, B> = 0>
+	auto atan2(const A& y, const B& x)
+	{
+		return detail::binary_call(detail::atan2_fn(), y, x);
+	}
+
+	// }}}
+	// rounding {{{
+
+	/**
+	 * \fn floor
+	 * \brief largest integer not greater than x
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto floor(T x)
+	{
+		return detail::math_call(detail::floor_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto floor(const V& vec)
+	{
+		return detail::vector_call(detail::floor_fn(), vec);
+	}
+
+	/**
+	 * \fn ceil
+	 * \brief smallest integer not less than x
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto ceil(T x)
+	{
+		return detail::math_call(detail::ceil_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto ceil(const V& vec)
+	{
+		return detail::vector_call(detail::ceil_fn(), vec);
+	}
+
+	/**
+	 * \fn fract
+	 * \brief fractional part, x - floor(x)
+	 */
+	template <typename T, detail::if_math_scalar<T> = 0>
+	auto fract(T x)
+	{
+		return detail::math_call(detail::fract_fn(), x, detail::is_kernel_type<T>());
+	}
+
+	template <typename V, detail::if_math_vector<V> = 0>
+	auto fract(const V& vec)
+	{
+		return detail::vector_call(detail::fract_fn(), vec);
+	}
+
+	/**
+	 * \fn mod
+	 * \brief modulus, x - y floor(x / y)
+	 *
+	 * Unlike std::fmod, the result has the sign of y.
+	 */
+	template <typename T, typename U, detail::if_math_scalar<T> = 0, detail::if_math_scalar<U> = 0>
+	auto mod(T x, U y)
+	{
+		return detail::scalar_binary_call(detail::mod_fn(), x, y);
+	}
+
+	template <typename A, typename B, detail::if_math_appliable<A, B> = 0>
+	auto mod(const A& x, const B& y)
+	{
+		return detail::binary_call(detail::mod_fn(), x, y);
+	}
+
+	/**
+	 * \fn step
+	 * \brief 0 where x < edge, and 1 otherwise
+	 *
+	 * Either argument may be a scalar, which is used for every component.
+	 */
+	template <typename E, typename X, std::enable_if_t<!utility::is_appliable<E, X>::value, int> = 0>
+	constexpr auto step(const E& edge, const X& x)
+	{
+		using R = std::common_type_t<E, X>;
+		return select(x < edge, R(0), R(1));
+	}
+
+	template <typename E, typename X, utility::if_appliable<E, X> = 0>
+	constexpr auto step(const E& edge, const X& x)
+	{
+		return utility::binary_apply(edge, x,
+			[] (auto&& e, auto&& v) { return step(e, v); });
+	}
+
+	/**
+	 * \fn smoothstep
+	 * \brief Hermite interpolation between 0 and 1
+	 *
+	 * 0 where x <= edge0, 1 where x >= edge1, and a smooth curve between,
+	 * t^2 (3 - 2t) with t = (x - edge0) / (edge1 - edge0). The edges may be
+	 * scalars or vectors.
+	 */
+	template <typename E0, typename E1, typename X>
+	constexpr auto smoothstep(const E0& edge0, const E1& edge1, const X& x)
+	{
+		const auto t = clamp((x - edge0) / (edge1 - edge0), 0, 1);
+		return t * t * (3 - 2 * t);
+	}
+
+	// }}}
+
+} // namespace funcs
+
+} // namespace velm
@@ -0,0 +1,631 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "simd.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+
+/**
+ * \file matrix.hpp
+ * \brief column-major matrices of velm::vector
+ *
+ * velm::matrix<T, R, C> stores C columns, each a velm::vector<T, R>, in the
+ * same layout as GLSL and GLM (so a matrix<float, 4, 4> can be passed to
+ * OpenGL as-is). m[c] is column c, and m[c][r] is the element in row r.
+ *
+ *      velm::matrix<float, 4, 4> proj = velm::perspective(fovy, aspect, 0.1f, 100.f);
+ *      velm::matrix<float, 4, 4> view = velm::lookAt(eye, target, up);
+ *      velm::matrix<float, 4, 4> model = velm::rotate(velm::matrix<float, 4, 4>::identity(), angle, axis);
+ *      velm::vector<float, 4> clip = proj * view * model * pos;
+ *
+ * Products follow linear algebra rather than being component-wise: m * v
+ * treats v as a column vector, v * m as a row vector, and m * n is the matrix
+ * product. Addition, subtraction and scalar multiplication and division are
+ * component-wise.
+ *
+ * When SSE is available (see simd.hpp), the product of two 4x4 float matrices
+ * and of a 4x4 float matrix and a vector keep the columns of the left matrix
+ * in registers, and multiply them by each element of the right operand
+ * broadcast across a register, which is how GLM's SIMD path works. The sums
+ * are in the same order as the generic path, so the result is identical.
+ *
+ * velm::batch::transform (in batch.hpp) applies a matrix to whole ranges of
+ * vectors.
+ */
+
+namespace velm {
+
+template <typename T, unsigned int R, unsigned int C>
+struct matrix
+{
+public: // statics
+
+	static constexpr auto rows = R;
+	static constexpr auto columns = C;
+	using value_type = T;
+	using column_type = vector<T, R>;
+	using row_type = vector<T, C>;
+
+	// excludes matrices from the component-wise vector operators
+	using matrix_tag = void;
+
+	static matrix identity()
+	{
+		return matrix(T(1));
+	}
+
+public: // variables
+
+	std::array<column_type, C> data;
+
+public: // methods
+
+	// zero matrix
+	constexpr matrix()
+		: data()
+	{
+	}
+
+	// diagonal matrix, with every other element zero
+	explicit matrix(const T& diag)
+		: data()
+	{
+		for(unsigned int i = 0; i < R && i < C; ++i) {
+			data[i][i] = diag;
+		}
+	}
+
+	// column constructors
+	template <typename... Vs,
+		typename = std::enable_if_t<(sizeof...(Vs) == C && C > 1)>>
+	constexpr matrix(const Vs&... cols)
+		: data{{column_type(cols)...}}
+	{
+	}
+
+	// converting constructor
+	template <typename U>
+	explicit matrix(const matrix<U, R, C>& other)
+		: data()
+	{
+		for(unsigned int c = 0; c < C; ++c) {
+			data[c] = other[c];
+		}
+	}
+
+	constexpr column_type& operator[](std::size_t idx)
+	{
+		return data[idx];
+	}
+
+	constexpr const column_type& operator[](std::size_t idx) const
+	{
+		return data[idx];
+	}
+
+	row_type row(std::size_t idx) const
+	{
+		row_type out;
+		for(unsigned int c = 0; c < C; ++c) {
+			out[c] = data[c][idx];
+		}
+		return out;
+	}
+
+};
+
+// simd {{{
+
+#if VELM_SIMD
+
+namespace simd {
+
+	/*
+	 * Column c of a product is a[0] * b[c][0] + a[1] * b[c][1] + ..., with
+	 * each element of b broadcast across a register by a shuffle.
+	 */
+
+	inline __m128 mat4_column(const __m128 (&a)[4], __m128 b)
+	{
+		__m128 out = _mm_mul_ps(a[0], _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+		out = _mm_add_ps(out, _mm_mul_ps(a[1], _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+		out = _mm_add_ps(out, _mm_mul_ps(a[2], _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+		out = _mm_add_ps(out, _mm_mul_ps(a[3], _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+		return out;
+	}
+
+	inline void mat4_load(const matrix<float, 4, 4>& m, __m128 (&out)[4])
+	{
+		static_assert(sizeof(matrix<float, 4, 4>) == 16 * sizeof(float), "Columns must be contiguous");
+		for(unsigned int c = 0; c < 4; ++c) {
+			out[c] = _mm_loadu_ps(m[c].data.data());
+		}
+	}
+
+#if defined(__AVX__)
+
+	// two columns of the product at a time, one in each 128-bit half
+	inline __m256 mat4_column_pair(const __m256 (&a)[4], __m256 b)
+	{
+		__m256 out = _mm256_mul_ps(a[0], _mm256_permute_ps(b, _MM_SHUFFLE(0, 0, 0, 0)));
+		out = _mm256_add_ps(out, _mm256_mul_ps(a[1], _mm256_permute_ps(b, _MM_SHUFFLE(1, 1, 1, 1))));
+		out = _mm256_add_ps(out, _mm256_mul_ps(a[2], _mm256_permute_ps(b, _MM_SHUFFLE(2, 2, 2, 2))));
+		out = _mm256_add_ps(out, _mm256_mul_ps(a[3], _mm256_permute_ps(b, _MM_SHUFFLE(3, 3, 3, 3))));
+		return out;
+	}
+
+	inline matrix<float, 4, 4> mat4_mul(const matrix<float, 4, 4>& lhs, const matrix<float, 4, 4>& rhs)
+	{
+		__m256 a[4];
+		for(unsigned int c = 0; c < 4; ++c) {
+			a[c] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs[c].data.data()));
+		}
+
+		matrix<float, 4, 4> out;
+		_mm256_storeu_ps(out[0].data.data(), mat4_column_pair(a, _mm256_loadu_ps(rhs[0].data.data())));
+		_mm256_storeu_ps(out[2].data.data(), mat4_column_pair(a, _mm256_loadu_ps(rhs[2].data.data())));
+		return out;
+	}
+
+#else
+
+	inline matrix<float, 4, 4> mat4_mul(const matrix<float, 4, 4>& lhs, const matrix<float, 4, 4>& rhs)
+	{
+		__m128 a[4];
+		mat4_load(lhs, a);
+
+		matrix<float, 4, 4> out;
+		for(unsigned int c = 0; c < 4; ++c) {
+			_mm_storeu_ps(out[c].data.data(), mat4_column(a, _mm_loadu_ps(rhs[c].data.data())));
+		}
+		return out;
+	}
+
+#endif
+
+	inline vector<float, 4> mat4_mul(const matrix<float, 4, 4>& lhs, const vector<float, 4>& rhs)
+	{
+		__m128 a[4];
+		mat4_load(lhs, a);
+
+		vector<float, 4> out;
+		_mm_storeu_ps(out.data.data(), mat4_column(a, _mm_loadu_ps(rhs.data.data())));
+		return out;
+	}
+
+} // namespace simd
+
+#endif // VELM_SIMD
+
+// }}}
+// operators {{{
+
+/*
+ * These are in namespace velm rather than global (unlike ops.hpp), as they
+ * only apply to velm::matrix, and are found through argument-dependent
+ * lookup.
+ */
+
+template <typename T, unsigned int R, unsigned int C>
+vector<T, R> operator*(const matrix<T, R, C>& lhs, const vector<T, C>& rhs)
+{
+	vector<T, R> out = lhs[0] * rhs[0];
+	for(unsigned int c = 1; c < C; ++c) {
+		out += lhs[c] * rhs[c];
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+vector<T, C> operator*(const vector<T, R>& lhs, const matrix<T, R, C>& rhs)
+{
+	vector<T, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = dot(lhs, rhs[c]);
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int K, unsigned int C>
+matrix<T, R, C> operator*(const matrix<T, R, K>& lhs, const matrix<T, K, C>& rhs)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = lhs * rhs[c];
+	}
+	return out;
+}
+
+#if VELM_SIMD
+
+inline vector<float, 4> operator*(const matrix<float, 4, 4>& lhs, const vector<float, 4>& rhs)
+{
+	return simd::mat4_mul(lhs, rhs);
+}
+
+inline matrix<float, 4, 4> operator*(const matrix<float, 4, 4>& lhs, const matrix<float, 4, 4>& rhs)
+{
+	return simd::mat4_mul(lhs, rhs);
+}
+
+#endif
+
+template <typename T, unsigned int R, unsigned int C, typename S,
+	std::enable_if_t<!utility::is_tied_vector<S>::value && !utility::is_matrix<S>::value, int> = 0>
+matrix<T, R, C> operator*(const matrix<T, R, C>& lhs, const S& rhs)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = lhs[c] * rhs;
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C, typename S,
+	std::enable_if_t<!utility::is_tied_vector<S>::value && !utility::is_matrix<S>::value, int> = 0>
+matrix<T, R, C> operator*(const S& lhs, const matrix<T, R, C>& rhs)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = lhs * rhs[c];
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C, typename S,
+	std::enable_if_t<!utility::is_tied_vector<S>::value && !utility::is_matrix<S>::value, int> = 0>
+matrix<T, R, C> operator/(const matrix<T, R, C>& lhs, const S& rhs)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = lhs[c] / rhs;
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+matrix<T, R, C> operator+(const matrix<T, R, C>& lhs, const matrix<T, R, C>& rhs)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = lhs[c] + rhs[c];
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+matrix<T, R, C> operator-(const matrix<T, R, C>& lhs, const matrix<T, R, C>& rhs)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = lhs[c] - rhs[c];
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+matrix<T, R, C> operator-(const matrix<T, R, C>& val)
+{
+	matrix<T, R, C> out;
+	for(unsigned int c = 0; c < C; ++c) {
+		out[c] = -val[c];
+	}
+	return out;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+matrix<T, R, C>& operator+=(matrix<T, R, C>& lhs, const matrix<T, R, C>& rhs)
+{
+	return lhs = lhs + rhs;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+matrix<T, R, C>& operator-=(matrix<T, R, C>& lhs, const matrix<T, R, C>& rhs)
+{
+	return lhs = lhs - rhs;
+}
+
+// only square matrices, as the product must be the same size
+template <typename T, unsigned int N, typename S,
+	std::enable_if_t<!utility::is_tied_vector<S>::value, int> = 0>
+matrix<T, N, N>& operator*=(matrix<T, N, N>& lhs, const S& rhs)
+{
+	return lhs = lhs * rhs;
+}
+
+template <typename T, unsigned int R, unsigned int C, typename S,
+	std::enable_if_t<!utility::is_tied_vector<S>::value && !utility::is_matrix<S>::value, int> = 0>
+matrix<T, R, C>& operator/=(matrix<T, R, C>& lhs, const S& rhs)
+{
+	return lhs = lhs / rhs;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+bool operator==(const matrix<T, R, C>& lhs, const matrix<T, R, C>& rhs)
+{
+	for(unsigned int c = 0; c < C; ++c) {
+		if(lhs[c] != rhs[c]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T, unsigned int R, unsigned int C>
+bool operator!=(const matrix<T, R, C>& lhs, const matrix<T, R, C>& rhs)
+{
+	return !(lhs == rhs);
+}
+
+// }}}
+
+inline namespace funcs {
+
+	// matrix {{{
+
+	/**
+	 * \fn transpose
+	 * \brief swap the rows and columns of a matrix
+	 */
+	template <typename T, unsigned int R, unsigned int C>
+	matrix<T, C, R> transpose(const matrix<T, R, C>& m)
+	{
+		matrix<T, C, R> out;
+		for(unsigned int c = 0; c < C; ++c) {
+			for(unsigned int r = 0; r < R; ++r) {
+				out[r][c] = m[c][r];
+			}
+		}
+		return out;
+	}
+
+	/**
+	 * \fn determinant
+	 * \brief determinant of a square matrix
+	 *
+	 * This is provided for 2x2, 3x3 and 4x4 matrices.
+	 */
+	template <typename T>
+	T determinant(const matrix<T, 2, 2>& m)
+	{
+		return m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	}
+
+	template <typename T>
+	T determinant(const matrix<T, 3, 3>& m)
+	{
+		return dot(m[0], cross(m[1], m[2]));
+	}
+
+	template <typename T>
+	T determinant(const matrix<T, 4, 4>& m)
+	{
+		// Laplace expansion along the first two columns
+		const T s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		const T s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		const T s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		const T s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		const T s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		const T s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+		const T c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		const T c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		const T c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		const T c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		const T c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		const T c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+		return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	}
+
+	/**
+	 * \fn inverse
+	 * \brief inverse of a square matrix
+	 *
+	 * This is provided for 2x2, 3x3 and 4x4 matrices, and is calculated
+	 * from the adjugate. As in GLSL, the result is undefined if the matrix
+	 * is singular (its determinant is 0).
+	 */
+	template <typename T>
+	matrix<T, 2, 2> inverse(const matrix<T, 2, 2>& m)
+	{
+		const T inv_det = T(1) / determinant(m);
+		return matrix<T, 2, 2>(
+			vector<T, 2>(m[1][1] * inv_det, -m[0][1] * inv_det),
+			vector<T, 2>(-m[1][0] * inv_det, m[0][0] * inv_det));
+	}
+
+	template <typename T>
+	matrix<T, 3, 3> inverse(const matrix<T, 3, 3>& m)
+	{
+		// the rows of the inverse are perpendicular to two of the columns
+		const vector<T, 3> r0 = cross(m[1], m[2]);
+		const vector<T, 3> r1 = cross(m[2], m[0]);
+		const vector<T, 3> r2 = cross(m[0], m[1]);
+		const T inv_det = T(1) / dot(m[0], r0);
+		return transpose(matrix<T, 3, 3>(r0 * inv_det, r1 * inv_det, r2 * inv_det));
+	}
+
+	template <typename T>
+	matrix<T, 4, 4> inverse(const matrix<T, 4, 4>& m)
+	{
+		/*
+		 * Cofactors from the 2x2 determinants of the first two columns (s)
+		 * and of the last two columns (c). a[i][j] is m[i][j], i.e. the
+		 * transpose of m is inverted, and the result is written transposed.
+		 */
+		const T s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		const T s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		const T s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		const T s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		const T s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		const T s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+		const T c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		const T c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		const T c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		const T c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		const T c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		const T c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+		const T inv_det = T(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+		matrix<T, 4, 4> out;
+		out[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv_det;
+		out[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv_det;
+		out[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv_det;
+		out[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv_det;
+
+		out[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv_det;
+		out[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv_det;
+		out[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv_det;
+		out[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv_det;
+
+		out[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv_det;
+		out[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv_det;
+		out[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv_det;
+		out[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv_det;
+
+		out[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv_det;
+		out[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv_det;
+		out[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv_det;
+		out[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv_det;
+		return out;
+	}
+
+	/**
+	 * \fn outerProduct
+	 * \brief matrix product of a column vector and a row vector
+	 */
+	template <typename T, unsigned int R, unsigned int C>
+	matrix<T, R, C> outerProduct(const vector<T, R>& c, const vector<T, C>& r)
+	{
+		matrix<T, R, C> out;
+		for(unsigned int i = 0; i < C; ++i) {
+			out[i] = c * r[i];
+		}
+		return out;
+	}
+
+	// }}}
+	// transform {{{
+
+	/*
+	 * These follow GLM's default conventions: right-handed coordinates, and
+	 * clip space depth from -1 to 1 (as in OpenGL). Angles are in radians.
+	 */
+
+	/**
+	 * \fn translate
+	 * \brief apply a translation to a transform
+	 *
+	 * Returns m * T, where T translates by v.
+	 */
+	template <typename T>
+	matrix<T, 4, 4> translate(const matrix<T, 4, 4>& m, const vector<T, 3>& v)
+	{
+		matrix<T, 4, 4> out = m;
+		out[3] = m[0] * v[0] + m[1] * v[1] + m[2] * v[2] + m[3];
+		return out;
+	}
+
+	/**
+	 * \fn scale
+	 * \brief apply a scale to a transform
+	 *
+	 * Returns m * S, where S scales each axis by the component of v.
+	 */
+	template <typename T>
+	matrix<T, 4, 4> scale(const matrix<T, 4, 4>& m, const vector<T, 3>& v)
+	{
+		return matrix<T, 4, 4>(m[0] * v[0], m[1] * v[1], m[2] * v[2], m[3]);
+	}
+
+	/**
+	 * \fn rotate
+	 * \brief apply a rotation to a transform
+	 *
+	 * Returns m * R, where R rotates by angle radians counter-clockwise
+	 * around axis (which need not be normalised).
+	 */
+	template <typename T>
+	matrix<T, 4, 4> rotate(const matrix<T, 4, 4>& m, T angle, const vector<T, 3>& axis)
+	{
+		using std::cos;
+		using std::sin;
+		const T c = cos(angle);
+		const T s = sin(angle);
+		const vector<T, 3> a = normalize(axis);
+		const vector<T, 3> t = a * (T(1) - c);
+
+		const vector<T, 3> r0(c + t[0] * a[0], t[0] * a[1] + s * a[2], t[0] * a[2] - s * a[1]);
+		const vector<T, 3> r1(t[1] * a[0] - s * a[2], c + t[1] * a[1], t[1] * a[2] + s * a[0]);
+		const vector<T, 3> r2(t[2] * a[0] + s * a[1], t[2] * a[1] - s * a[0], c + t[2] * a[2]);
+
+		return matrix<T, 4, 4>(
+			m[0] * r0[0] + m[1] * r0[1] + m[2] * r0[2],
+			m[0] * r1[0] + m[1] * r1[1] + m[2] * r1[2],
+			m[0] * r2[0] + m[1] * r2[1] + m[2] * r2[2],
+			m[3]);
+	}
+
+	/**
+	 * \fn lookAt
+	 * \brief view transform of a camera
+	 *
+	 * Creates a transform into the space of a camera at eye looking at
+	 * center, where the camera looks along -z and up is roughly +y.
+	 */
+	template <typename T>
+	matrix<T, 4, 4> lookAt(const vector<T, 3>& eye, const vector<T, 3>& center, const vector<T, 3>& up)
+	{
+		const vector<T, 3> f = normalize(center - eye);
+		const vector<T, 3> s = normalize(cross(f, up));
+		const vector<T, 3> u = cross(s, f);
+
+		matrix<T, 4, 4> out = matrix<T, 4, 4>::identity();
+		for(unsigned int i = 0; i < 3; ++i) {
+			out[i][0] = s[i];
+			out[i][1] = u[i];
+			out[i][2] = -f[i];
+		}
+		out[3][0] = -dot(s, eye);
+		out[3][1] = -dot(u, eye);
+		out[3][2] = dot(f, eye);
+		return out;
+	}
+
+	/**
+	 * \fn perspective
+	 * \brief perspective projection
+	 *
+	 * fovy is the vertical field of view, and aspect is width / height.
+	 * Depths between z_near and z_far are mapped to -1 to 1.
+	 */
+	template <typename T>
+	matrix<T, 4, 4> perspective(T fovy, T aspect, T z_near, T z_far)
+	{
+		using std::tan;
+		const T tan_half = tan(fovy / T(2));
+
+		matrix<T, 4, 4> out;
+		out[0][0] = T(1) / (aspect * tan_half);
+		out[1][1] = T(1) / tan_half;
+		out[2][2] = -(z_far + z_near) / (z_far - z_near);
+		out[2][3] = -T(1);
+		out[3][2] = -(T(2) * z_far * z_near) / (z_far - z_near);
+		return out;
+	}
+
+	// }}}
+
+} // namespace funcs
+
+} // namespace velm
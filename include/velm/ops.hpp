@@ -1,6 +1,9 @@
 #pragma once
 
+#include <tuple>
+
 #include "utility.hpp"
+#include "simd.hpp"
 
 /**
  * \file ops.hpp
@@ -10,53 +13,55 @@
  * component-wise, and can be used for vectors and vectors, or vectors and
  * scalars. Most arithmetic operations are provided, as well as their compound
  * assignment counterparts. Comparison is done lexicographically.
+ *
+ * Arithmetic on small float/double/int32 vectors is dispatched through
+ * simd.hpp, which uses packed instructions when the result is guaranteed to
+ * be identical to the generic (component-wise) path.
  */
 
 // unary {{{
 
 template <typename T,
-	std::enable_if_t<velm::utility::is_tied_vector<T>::value, int> = 0>
+	std::enable_if_t<velm::utility::is_tied_vector<T>::value && !velm::utility::is_expression<T>::value
+		&& !velm::utility::is_quaternion<T>::value, int> = 0>
 constexpr auto operator+(T&& vec)
 {
-	return velm::utility::vec_apply(velm::get_tie(vec), [] (auto&& x) { return +x; });
+	return velm::utility::unary_apply(vec, [] (auto&& x) { return +x; });
 }
 
 template <typename T,
-	std::enable_if_t<velm::utility::is_tied_vector<T>::value, int> = 0>
+	std::enable_if_t<velm::utility::is_tied_vector<T>::value && !velm::utility::is_expression<T>::value
+		&& !velm::utility::is_quaternion<T>::value, int> = 0>
 constexpr auto operator-(T&& vec)
 {
-	return velm::utility::vec_apply(velm::get_tie(vec), [] (auto&& x) { return -x; });
+	return velm::simd::negate_apply(std::forward<T>(vec), [] (auto&& x) { return -x; });
 }
 
 // }}}
 // arithmetic {{{
 
-template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
+template <typename L, typename R, velm::utility::if_eager_appliable<L, R> = 0>
 constexpr auto operator+(L&& lhs, R&& rhs)
 {
-	return velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
-		[] (auto&& a, auto&& b) { return a + b; });
+	return velm::simd::binary_apply(velm::simd::op_add{}, std::forward<L>(lhs), std::forward<R>(rhs));
 }
 
-template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
+template <typename L, typename R, velm::utility::if_eager_appliable<L, R> = 0>
 constexpr auto operator-(L&& lhs, R&& rhs)
 {
-	return velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
-		[] (auto&& a, auto&& b) { return a - b; });
+	return velm::simd::binary_apply(velm::simd::op_sub{}, std::forward<L>(lhs), std::forward<R>(rhs));
 }
 
-template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
+template <typename L, typename R, velm::utility::if_eager_appliable<L, R> = 0>
 constexpr auto operator*(L&& lhs, R&& rhs)
 {
-	return velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
-		[] (auto&& a, auto&& b) { return a * b; });
+	return velm::simd::binary_apply(velm::simd::op_mul{}, std::forward<L>(lhs), std::forward<R>(rhs));
 }
 
-template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
+template <typename L, typename R, velm::utility::if_eager_appliable<L, R> = 0>
 constexpr auto operator/(L&& lhs, R&& rhs)
 {
-	return velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
-		[] (auto&& a, auto&& b) { return a / b; });
+	return velm::simd::binary_apply(velm::simd::op_div{}, std::forward<L>(lhs), std::forward<R>(rhs));
 }
 
 // }}}
@@ -65,7 +70,7 @@ constexpr auto operator/(L&& lhs, R&& rhs)
 template <typename L, typename R, velm::utility::if_compound_appliable<L, R> = 0>
 constexpr auto& operator+=(L& lhs, R&& rhs)
 {
-	velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+	velm::simd::compound_apply(velm::simd::op_add{}, lhs, std::forward<R>(rhs),
 		[] (auto&& a, auto&& b) { return a += b; });
 	return lhs;
 }
@@ -73,7 +78,7 @@ constexpr auto& operator+=(L& lhs, R&& rhs)
 template <typename L, typename R, velm::utility::if_compound_appliable<L, R> = 0>
 constexpr auto& operator-=(L& lhs, R&& rhs)
 {
-	velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+	velm::simd::compound_apply(velm::simd::op_sub{}, lhs, std::forward<R>(rhs),
 		[] (auto&& a, auto&& b) { return a -= b; });
 	return lhs;
 }
@@ -81,7 +86,7 @@ constexpr auto& operator-=(L& lhs, R&& rhs)
 template <typename L, typename R, velm::utility::if_compound_appliable<L, R> = 0>
 constexpr auto& operator*=(L& lhs, R&& rhs)
 {
-	velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+	velm::simd::compound_apply(velm::simd::op_mul{}, lhs, std::forward<R>(rhs),
 		[] (auto&& a, auto&& b) { return a *= b; });
 	return lhs;
 }
@@ -89,7 +94,7 @@ constexpr auto& operator*=(L& lhs, R&& rhs)
 template <typename L, typename R, velm::utility::if_compound_appliable<L, R> = 0>
 constexpr auto& operator/=(L& lhs, R&& rhs)
 {
-	velm::utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs),
+	velm::simd::compound_apply(velm::simd::op_div{}, lhs, std::forward<R>(rhs),
 		[] (auto&& a, auto&& b) { return a /= b; });
 	return lhs;
 }
@@ -97,40 +102,71 @@ constexpr auto& operator/=(L& lhs, R&& rhs)
 // }}}
 // comparison {{{
 
+/*
+ * The ties are compared with the std::tuple operators explicitly: tuples are
+ * themselves tied vectors, so an unqualified a == b would select these
+ * operators again and recurse forever.
+ */
+
 template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
 constexpr bool operator==(L& lhs, R&& rhs)
 {
-	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return a == b; });
+	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return std::operator==(a, b); });
 }
 
 template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
 constexpr bool operator!=(L& lhs, R&& rhs)
 {
-	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return a != b; });
+	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return std::operator!=(a, b); });
 }
 
 template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
 constexpr bool operator<(L& lhs, R&& rhs)
 {
-	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return a < b; });
+	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return std::operator<(a, b); });
 }
 
 template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
 constexpr bool operator<=(L& lhs, R&& rhs)
 {
-	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return a <= b; });
+	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return std::operator<=(a, b); });
 }
 
 template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
 constexpr bool operator>(L& lhs, R&& rhs)
 {
-	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return a > b; });
+	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return std::operator>(a, b); });
 }
 
 template <typename L, typename R, velm::utility::if_appliable<L, R> = 0>
 constexpr bool operator>=(L& lhs, R&& rhs)
 {
-	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return a >= b; });
+	return velm::utility::binary_tuple_apply(lhs, rhs, [] (auto&& a, auto&& b) { return std::operator>=(a, b); });
 }
 
 // }}}
+
+/*
+ * The operators above are global so that they apply to user-provided vector
+ * types. Other velm types (e.g. vector_array, pack) define their operators in
+ * namespace velm, which would hide the global ones from code inside velm, so
+ * they are also made visible there.
+ */
+namespace velm {
+
+	using ::operator+;
+	using ::operator-;
+	using ::operator*;
+	using ::operator/;
+	using ::operator+=;
+	using ::operator-=;
+	using ::operator*=;
+	using ::operator/=;
+	using ::operator==;
+	using ::operator!=;
+	using ::operator<;
+	using ::operator<=;
+	using ::operator>;
+	using ::operator>=;
+
+} // namespace velm
@@ -0,0 +1,698 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "simd.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+#include "vector_array.hpp"
+#include "math.hpp"
+
+/**
+ * \file pack.hpp
+ * \brief SIMD lanes as a vector component type
+ *
+ * velm::pack<T, W> holds W values of T, sized and aligned to fit a SIMD
+ * register (e.g. pack<float, 8> is one AVX register). All arithmetic on a pack
+ * is lane-wise, so velm::vector<pack<float, 8>, 3> is 8 three-dimensional
+ * vectors processed at once (an AoSoA layout), using the ordinary operators
+ * and functions:
+ *
+ *      using vec3x8 = velm::vector<velm::pack<float, 8>, 3>;
+ *      vec3x8 n = velm::gather<8>(normals + i);
+ *      vec3x8 r = velm::reflect(dir, velm::normalize(n));
+ *      bool lit = velm::any(velm::all(velm::greaterThan(r, 0.f)));
+ *
+ * Comparisons produce pack<bool, W>. Since a pack of conditions cannot be used
+ * with ?:, funcs.hpp uses select() for branching functions (min, max, abs,
+ * faceforward), which blends lane by lane for packs. all, any and none reduce
+ * across the components of a vector to a pack<bool, W>, and across the lanes
+ * of a pack<bool, W> to a bool.
+ *
+ * Operations are written as fixed-length loops over the lanes, which
+ * compilers turn into single packed instructions when optimising.
+ */
+
+namespace velm {
+
+template <typename T, unsigned int W>
+struct pack
+{
+public: // statics
+
+	static constexpr auto width = W;
+	using value_type = T;
+
+	// register-sized alignment for power of two sizes, up to a cache line
+	static constexpr std::size_t alignment =
+		((sizeof(T) * W) & (sizeof(T) * W - 1)) == 0 && sizeof(T) * W <= 64
+			? sizeof(T) * W : alignof(T);
+
+public:
+
+	alignas(alignment) T lanes[W];
+
+	pack() = default;
+
+	// broadcast
+	template <typename U,
+		std::enable_if_t<std::is_convertible<U, T>::value, int> = 0>
+	constexpr pack(const U& val)
+		: lanes{}
+	{
+		for(unsigned int i = 0; i < W; ++i) {
+			lanes[i] = static_cast<T>(val);
+		}
+	}
+
+	static pack load(const T* src)
+	{
+		pack out;
+		for(unsigned int i = 0; i < W; ++i) {
+			out.lanes[i] = src[i];
+		}
+		return out;
+	}
+
+	void store(T* dst) const
+	{
+		for(unsigned int i = 0; i < W; ++i) {
+			dst[i] = lanes[i];
+		}
+	}
+
+	constexpr T& operator[](std::size_t idx)
+	{
+		return lanes[idx];
+	}
+
+	constexpr const T& operator[](std::size_t idx) const
+	{
+		return lanes[idx];
+	}
+};
+
+template <typename T>
+struct is_pack
+	: std::false_type
+{
+};
+
+template <typename T, unsigned int W>
+struct is_pack<pack<T, W>>
+	: std::true_type
+{
+};
+
+namespace utility {
+
+	/*
+	 * Lane-wise application. Arguments which are not packs are broadcast, so
+	 * these also implement the mixed pack/scalar operators.
+	 */
+	template <typename A>
+	constexpr decltype(auto) lane_of(const A& val, unsigned int /* idx */)
+	{
+		return val;
+	}
+
+	template <typename T, unsigned int W>
+	constexpr const T& lane_of(const pack<T, W>& p, unsigned int idx)
+	{
+		return p.lanes[idx];
+	}
+
+	template <unsigned int W, typename F, typename... As>
+	auto pack_apply(F&& f, const As&... args)
+	{
+		using R = std::decay_t<decltype(f(lane_of(args, 0)...))>;
+		pack<R, W> out;
+		for(unsigned int i = 0; i < W; ++i) {
+			out.lanes[i] = f(lane_of(args, i)...);
+		}
+		return out;
+	}
+
+	template <typename L, typename R>
+	struct pack_binary_width
+	{
+		static constexpr unsigned int value = 0;
+	};
+
+	template <typename T, unsigned int W, typename R>
+	struct pack_binary_width<pack<T, W>, R>
+	{
+		static constexpr unsigned int value = std::is_arithmetic<R>::value ? W : 0;
+	};
+
+	template <typename T, typename U, unsigned int W>
+	struct pack_binary_width<pack<T, W>, pack<U, W>>
+	{
+		static constexpr unsigned int value = W;
+	};
+
+	template <typename L, typename T, unsigned int W>
+	struct pack_binary_width<L, pack<T, W>>
+	{
+		static constexpr unsigned int value = std::is_arithmetic<L>::value ? W : 0;
+	};
+
+	// pack op pack, pack op scalar, scalar op pack
+	template <typename L, typename R>
+	using if_pack_operands = std::enable_if_t<(pack_binary_width<std::decay_t<L>, std::decay_t<R>>::value > 0), int>;
+
+	template <typename L, typename R>
+	using pack_width = pack_binary_width<std::decay_t<L>, std::decay_t<R>>;
+
+} // namespace utility
+
+// lane functions {{{
+
+/**
+ * \fn select
+ * \brief lane-wise choice between two values
+ *
+ * For each lane, takes the value from a where the mask is true, and from b
+ * otherwise. This is the pack equivalent of mask ? a : b. For vectors of
+ * packs, this is applied to each component.
+ */
+template <unsigned int W, typename A, typename B,
+	std::enable_if_t<!utility::is_appliable<A, B>::value, int> = 0>
+auto select(const pack<bool, W>& mask, const A& a, const B& b)
+{
+	return utility::pack_apply<W>([] (bool m, auto&& x, auto&& y) { return m ? x : y; }, mask, a, b);
+}
+
+template <unsigned int W, typename A, typename B,
+	utility::if_appliable<A, B> = 0>
+auto select(const pack<bool, W>& mask, A&& a, B&& b)
+{
+	return utility::binary_apply(std::forward<A>(a), std::forward<B>(b),
+		[&] (auto&& x, auto&& y) { return select(mask, x, y); });
+}
+
+/**
+ * \fn all
+ * \brief check that all lanes are true
+ */
+template <unsigned int W>
+bool all(const pack<bool, W>& mask)
+{
+	bool result = true;
+	for(unsigned int i = 0; i < W; ++i) {
+		result &= mask.lanes[i];
+	}
+	return result;
+}
+
+/**
+ * \fn any
+ * \brief check if any lanes are true
+ */
+template <unsigned int W>
+bool any(const pack<bool, W>& mask)
+{
+	bool result = false;
+	for(unsigned int i = 0; i < W; ++i) {
+		result |= mask.lanes[i];
+	}
+	return result;
+}
+
+/**
+ * \fn none
+ * \brief check that all lanes are false
+ */
+template <unsigned int W>
+bool none(const pack<bool, W>& mask)
+{
+	return !any(mask);
+}
+
+namespace detail {
+
+	/*
+	 * float and double lanes go through the kernels of math.hpp, a register
+	 * at a time; other lane types call the standard functions on each lane.
+	 */
+	template <typename F, typename T, unsigned int W>
+	pack<T, W> pack_call(F f, const pack<T, W>& p, std::true_type /* kernel */)
+	{
+		pack<T, W> out;
+		kernels::map(out.lanes, W, f, kernels::source(static_cast<const T*>(p.lanes)));
+		return out;
+	}
+
+	template <typename F, typename T, unsigned int W>
+	pack<T, W> pack_call(F f, const pack<T, W>& p, std::false_type /* kernel */)
+	{
+		return utility::pack_apply<W>([&] (const T& x) { return static_cast<T>(f.fallback(x)); }, p);
+	}
+
+	template <typename F, typename T, unsigned int W>
+	pack<T, W> pack_call(F f, const pack<T, W>& a, const pack<T, W>& b, std::true_type /* kernel */)
+	{
+		pack<T, W> out;
+		kernels::map(out.lanes, W, f, kernels::source(static_cast<const T*>(a.lanes)),
+			kernels::source(static_cast<const T*>(b.lanes)));
+		return out;
+	}
+
+	template <typename F, typename T, unsigned int W>
+	pack<T, W> pack_call(F f, const pack<T, W>& a, const pack<T, W>& b, std::false_type /* kernel */)
+	{
+		return utility::pack_apply<W>([&] (const T& x, const T& y) { return static_cast<T>(f.fallback(x, y)); }, a, b);
+	}
+
+} // namespace detail
+
+/**
+ * \fn sqrt
+ * \brief lane-wise square root
+ *
+ * Compilers only vectorise std::sqrt when errno is not required
+ * (-fno-math-errno), so float and double lanes use packed square root
+ * instructions directly. These are correctly rounded, so the results are the
+ * same, except that errno is not set for negative lanes.
+ *
+ * This and the functions below are the pack versions of those in math.hpp,
+ * with the same accuracy.
+ */
+template <typename T, unsigned int W>
+pack<T, W> sqrt(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::sqrt_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn inversesqrt
+ * \brief lane-wise reciprocal square root
+ */
+template <typename T, unsigned int W>
+pack<T, W> inversesqrt(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::inversesqrt_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn exp
+ * \brief lane-wise natural exponential
+ */
+template <typename T, unsigned int W>
+pack<T, W> exp(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::exp_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn exp2
+ * \brief lane-wise base 2 exponential
+ */
+template <typename T, unsigned int W>
+pack<T, W> exp2(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::exp2_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn log
+ * \brief lane-wise natural logarithm
+ */
+template <typename T, unsigned int W>
+pack<T, W> log(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::log_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn log2
+ * \brief lane-wise base 2 logarithm
+ */
+template <typename T, unsigned int W>
+pack<T, W> log2(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::log2_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn pow
+ * \brief lane-wise power
+ */
+template <typename T, unsigned int W>
+pack<T, W> pow(const pack<T, W>& x, const pack<T, W>& y)
+{
+	return detail::pack_call(detail::pow_fn(), x, y, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn sin
+ * \brief lane-wise sine
+ */
+template <typename T, unsigned int W>
+pack<T, W> sin(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::sin_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn cos
+ * \brief lane-wise cosine
+ */
+template <typename T, unsigned int W>
+pack<T, W> cos(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::cos_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn tan
+ * \brief lane-wise tangent
+ */
+template <typename T, unsigned int W>
+pack<T, W> tan(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::tan_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn atan2
+ * \brief lane-wise arc tangent of y / x
+ */
+template <typename T, unsigned int W>
+pack<T, W> atan2(const pack<T, W>& y, const pack<T, W>& x)
+{
+	return detail::pack_call(detail::atan2_fn(), y, x, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn floor
+ * \brief lane-wise floor
+ */
+template <typename T, unsigned int W>
+pack<T, W> floor(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::floor_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn ceil
+ * \brief lane-wise ceiling
+ */
+template <typename T, unsigned int W>
+pack<T, W> ceil(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::ceil_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn fract
+ * \brief lane-wise fractional part
+ */
+template <typename T, unsigned int W>
+pack<T, W> fract(const pack<T, W>& p)
+{
+	return detail::pack_call(detail::fract_fn(), p, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn mod
+ * \brief lane-wise modulus
+ */
+template <typename T, unsigned int W>
+pack<T, W> mod(const pack<T, W>& x, const pack<T, W>& y)
+{
+	return detail::pack_call(detail::mod_fn(), x, y, detail::is_kernel_type<T>());
+}
+
+/**
+ * \fn sincos
+ * \brief lane-wise sine and cosine together
+ */
+namespace detail {
+
+	template <typename T, unsigned int W>
+	void pack_sincos(const pack<T, W>& x, pack<T, W>& s, pack<T, W>& c, std::true_type /* kernel */)
+	{
+		kernels::map_sincos(static_cast<const T*>(x.lanes), s.lanes, c.lanes, W);
+	}
+
+	template <typename T, unsigned int W>
+	void pack_sincos(const pack<T, W>& x, pack<T, W>& s, pack<T, W>& c, std::false_type /* kernel */)
+	{
+		for(unsigned int i = 0; i < W; ++i) {
+			const T val = x.lanes[i];
+			sincos(val, s.lanes[i], c.lanes[i]);
+		}
+	}
+
+} // namespace detail
+
+template <typename T, unsigned int W>
+void sincos(const pack<T, W>& x, pack<T, W>& s, pack<T, W>& c)
+{
+	detail::pack_sincos(x, s, c, detail::is_kernel_type<T>());
+}
+
+// }}}
+// gather/scatter {{{
+
+/**
+ * \fn gather
+ * \brief load W vectors into a vector of packs
+ *
+ * Lane i of the result is src[i], or src[indices[i]] when indices are given.
+ */
+namespace detail {
+
+	/*
+	 * The components are filled in as separate packs, which are left
+	 * uninitialised until then, rather than in a vector, which would be
+	 * zeroed first.
+	 */
+	template <unsigned int W, typename T, unsigned int N, std::size_t... Ks>
+	vector<pack<T, W>, N> gather_impl(const vector<T, N>* src, std::index_sequence<Ks...> /* seq */)
+	{
+		pack<T, W> comps[N];
+		for(unsigned int k = 0; k < N; ++k) {
+			for(unsigned int i = 0; i < W; ++i) {
+				comps[k].lanes[i] = src[i][k];
+			}
+		}
+		return vector<pack<T, W>, N>(comps[Ks]...);
+	}
+
+} // namespace detail
+
+template <unsigned int W, typename T, unsigned int N>
+vector<pack<T, W>, N> gather(const vector<T, N>* src)
+{
+	return detail::gather_impl<W>(src, std::make_index_sequence<N>());
+}
+
+template <unsigned int W, typename T, unsigned int N, typename I>
+vector<pack<T, W>, N> gather(const vector<T, N>* src, const I* indices)
+{
+	vector<pack<T, W>, N> out;
+	for(unsigned int i = 0; i < W; ++i) {
+		const vector<T, N>& v = src[indices[i]];
+		for(unsigned int k = 0; k < N; ++k) {
+			out[k].lanes[i] = v[k];
+		}
+	}
+	return out;
+}
+
+/**
+ * \fn scatter
+ * \brief store a vector of packs as W vectors
+ *
+ * The inverse of gather: lane i is written to dst[i], or dst[indices[i]].
+ */
+template <typename T, unsigned int W, unsigned int N>
+void scatter(const vector<pack<T, W>, N>& vec, vector<T, N>* dst)
+{
+	for(unsigned int i = 0; i < W; ++i) {
+		for(unsigned int k = 0; k < N; ++k) {
+			dst[i][k] = vec[k].lanes[i];
+		}
+	}
+}
+
+template <typename T, unsigned int W, unsigned int N, typename I>
+void scatter(const vector<pack<T, W>, N>& vec, vector<T, N>* dst, const I* indices)
+{
+	for(unsigned int i = 0; i < W; ++i) {
+		vector<T, N>& v = dst[indices[i]];
+		for(unsigned int k = 0; k < N; ++k) {
+			v[k] = vec[k].lanes[i];
+		}
+	}
+}
+
+/**
+ * \fn pack_load
+ * \brief load W consecutive elements of a vector_array
+ *
+ * Since the lanes of a vector_array are contiguous, this is a plain load per
+ * component. Elements [idx, idx + W) must exist.
+ */
+template <unsigned int W, typename T, unsigned int N>
+vector<pack<T, W>, N> pack_load(const vector_array<T, N>& arr, std::size_t idx)
+{
+	vector<pack<T, W>, N> out;
+	for(unsigned int k = 0; k < N; ++k) {
+		out[k] = pack<T, W>::load(arr.lane(k) + idx);
+	}
+	return out;
+}
+
+/**
+ * \fn pack_store
+ * \brief store into W consecutive elements of a vector_array
+ */
+template <typename T, unsigned int W, unsigned int N>
+void pack_store(vector_array<T, N>& arr, std::size_t idx, const vector<pack<T, W>, N>& vec)
+{
+	for(unsigned int k = 0; k < N; ++k) {
+		vec[k].store(arr.lane(k) + idx);
+	}
+}
+
+// }}}
+
+// operators {{{
+
+template <typename T, unsigned int W>
+pack<T, W> operator+(const pack<T, W>& p)
+{
+	return p;
+}
+
+template <typename T, unsigned int W>
+pack<T, W> operator-(const pack<T, W>& p)
+{
+	return utility::pack_apply<W>([] (const T& x) { return -x; }, p);
+}
+
+template <unsigned int W>
+pack<bool, W> operator!(const pack<bool, W>& p)
+{
+	return utility::pack_apply<W>([] (bool x) { return !x; }, p);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator+(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a + b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator-(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a - b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator*(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a * b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator/(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a / b; }, lhs, rhs);
+}
+
+template <typename T, unsigned int W, typename R>
+pack<T, W>& operator+=(pack<T, W>& lhs, const R& rhs)
+{
+	return lhs = lhs + rhs;
+}
+
+template <typename T, unsigned int W, typename R>
+pack<T, W>& operator-=(pack<T, W>& lhs, const R& rhs)
+{
+	return lhs = lhs - rhs;
+}
+
+template <typename T, unsigned int W, typename R>
+pack<T, W>& operator*=(pack<T, W>& lhs, const R& rhs)
+{
+	return lhs = lhs * rhs;
+}
+
+template <typename T, unsigned int W, typename R>
+pack<T, W>& operator/=(pack<T, W>& lhs, const R& rhs)
+{
+	return lhs = lhs / rhs;
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator==(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a == b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator!=(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a != b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator<(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a < b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator<=(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a <= b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator>(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a > b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator>=(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (auto&& a, auto&& b) { return a >= b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator&&(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (bool a, bool b) { return a && b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_pack_operands<L, R> = 0>
+auto operator||(const L& lhs, const R& rhs)
+{
+	return utility::pack_apply<utility::pack_width<L, R>::value>(
+		[] (bool a, bool b) { return a || b; }, lhs, rhs);
+}
+
+// }}}
+
+} // namespace velm
@@ -0,0 +1,861 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "convert.hpp"
+#include "tie.hpp"
+#include "kernels.hpp"
+#include "pack.hpp"
+#include "vector_array.hpp"
+#include "batch.hpp"
+#include "exec.hpp"
+#include "dispatch.hpp"
+
+/**
+ * \file packed.hpp
+ * \brief compact storage formats for vectors
+ *
+ * These are formats for storing vectors (in meshes, files or GPU buffers),
+ * not for doing arithmetic in. Each converts to and from float:
+ *
+ *  - half is an IEEE 754 binary16 float.
+ *  - snorm<I> and unorm<I> are fixed point numbers in [-1, 1] and [0, 1],
+ *    stored in the 8 or 16 bit integer type I: snorm8, snorm16, unorm8 and
+ *    unorm16.
+ *  - unorm10_10_10_2 and snorm10_10_10_2 are four normalised components in
+ *    32 bits, x in the low 10 bits and w in the high 2 (the layout of
+ *    GL_UNSIGNED_INT_2_10_10_10_REV and DXGI_FORMAT_R10G10B10A2).
+ *  - oct16 and oct32 are unit vectors, mapped onto an octahedron which is
+ *    unfolded onto a square (Cigolle et al., "A Survey of Efficient
+ *    Representations for Independent Unit Vectors"), and stored as two
+ *    snorm8 or snorm16.
+ *
+ * half, snorm and unorm are component types, so velm::vector<velm::half, 3>
+ * is a vector stored in 6 bytes, which converts to and from
+ * velm::vector<float, 3> like any other vector. The packed formats plug into
+ * usr::tie and usr::converter_to, so they convert to and from vectors of
+ * float too:
+ *
+ *      velm::vector<float, 3> n = ...;
+ *      velm::oct32 packed = n;
+ *      velm::vector<float, 3> back = packed;
+ *      velm::unorm10_10_10_2 colour = velm::vector<float, 4>(1.f, 0.5f, 0.25f, 1.f);
+ *      velm::vector<velm::half, 3> pos = n;
+ *
+ * batch::encode and batch::decode convert whole ranges (or vector_arrays)
+ * between the two. Contiguous components are converted as one flat loop,
+ * which uses the F16C instructions for half when the CPU has them (see
+ * dispatch.hpp), and octahedral vectors in blocks of packs; anything else is
+ * converted one element at a time.
+ *
+ * Conversions to half round to nearest even, keep infinities and
+ * subnormals, and give a quiet NaN for NaN; the largest finite half is
+ * 65504. snorm and unorm round to nearest, clamp to their range, and encode
+ * NaN as 0. The most negative snorm decodes to -1, like the value above it.
+ * Octahedral encoding rounds each coordinate to nearest, and decoding
+ * normalises the result. The worst errors after a round trip are:
+ *
+ *      half                relative 2^-11 (normal range)
+ *      snorm<I>, unorm<I>  0.5 / max of the stored integer, plus the
+ *                          rounding of the decoded float (half an ulp)
+ *      oct16               1 degree
+ *      oct32               0.05 degrees
+ *
+ * As with the other batch functions, the AVX2 and AVX-512 loops may contract
+ * multiplies and adds into FMA, so decoded normals can differ in the last
+ * bit from those decoded one at a time.
+ */
+
+namespace velm {
+
+namespace detail {
+
+	/*
+	 * The software conversions follow F. Giesen's float_to_half_fast3_rtne
+	 * and half_to_float_fast5. Subnormal results come from adding (or
+	 * subtracting) a float whose exponent puts the rounding in the right
+	 * place, so there are no loops.
+	 */
+	inline std::uint16_t float_to_half(float val)
+	{
+		std::uint32_t f = kernels::to_bits(val);
+		const std::uint32_t sign = f & 0x80000000u;
+		f ^= sign;
+
+		std::uint32_t out;
+		if(f >= 0x47800000u) {
+			// too large for a half, infinity or NaN
+			out = f > 0x7f800000u ? 0x7e00u : 0x7c00u;
+		} else if(f < 0x38800000u) {
+			// subnormal half or zero
+			const std::uint32_t denorm_magic = ((127 - 15) + (23 - 10) + 1) << 23;
+			out = kernels::to_bits(kernels::from_bits<float>(f) + kernels::from_bits<float>(denorm_magic)) - denorm_magic;
+		} else {
+			const std::uint32_t odd = (f >> 13) & 1;
+			f += (std::uint32_t(15 - 127) << 23) + 0xfffu + odd;
+			out = f >> 13;
+		}
+		return static_cast<std::uint16_t>(out | (sign >> 16));
+	}
+
+	inline float half_to_float(std::uint16_t val)
+	{
+		const std::uint32_t shifted_exp = 0x7c00u << 13;
+		const float magic = kernels::from_bits<float>(113u << 23);
+
+		std::uint32_t out = (val & 0x7fffu) << 13;
+		const std::uint32_t exp = out & shifted_exp;
+		out += std::uint32_t(127 - 15) << 23;
+		if(exp == shifted_exp) {
+			// infinity or NaN
+			out += std::uint32_t(128 - 16) << 23;
+		} else if(exp == 0) {
+			// zero or subnormal
+			out = kernels::to_bits(kernels::from_bits<float>(out + (1u << 23)) - magic);
+		}
+		return kernels::from_bits<float>(out | (std::uint32_t(val & 0x8000u) << 16));
+	}
+
+	/*
+	 * a * scale rounded to nearest (halves away from zero), for a in [0, 1]
+	 * and scale = 2^k - 1 with k <= 16. Adding a half in float would round
+	 * values just below a half step up, so the product is found exactly, as
+	 * hi + lo = a 2^k - a (Fast2Sum, since a 2^k is exact), and only the part
+	 * after the point is compared with the half. These are all float
+	 * operations, so loops of them still vectorise.
+	 */
+	inline float round_scaled(float a, float scale)
+	{
+		const float big = a * (scale + 1.f);
+		const float hi = big - a;
+		const float lo = (big - hi) - a;
+		const float whole = static_cast<float>(static_cast<std::int32_t>(hi));
+		const float rest = (hi - whole) - 0.5f;
+		return whole + static_cast<float>(rest + lo >= 0.f);
+	}
+
+	// rounded and clamped, in a wide enough integer to shift into place
+	inline std::int32_t encode_snorm(float val, float scale)
+	{
+		float c = val > -1.f ? val : -1.f;
+		c = c < 1.f ? c : 1.f;
+		c = val == val ? c : 0.f;
+		return static_cast<std::int32_t>(std::copysign(round_scaled(std::fabs(c), scale), c));
+	}
+
+	inline std::uint32_t encode_unorm(float val, float scale)
+	{
+		float c = val > 0.f ? val : 0.f;
+		c = c < 1.f ? c : 1.f;
+		return static_cast<std::uint32_t>(static_cast<std::int32_t>(round_scaled(c, scale)));
+	}
+
+	inline float decode_snorm(std::int32_t val, float scale)
+	{
+		const float f = static_cast<float>(val) / scale;
+		return f > -1.f ? f : -1.f;
+	}
+
+	inline float decode_unorm(std::uint32_t val, float scale)
+	{
+		return static_cast<float>(val) / scale;
+	}
+
+	template <typename I>
+	constexpr float norm_scale()
+	{
+		return static_cast<float>(std::numeric_limits<I>::max());
+	}
+
+	// 1 or -1, with 1 for zeroes
+	inline float sign_not_zero(float val)
+	{
+		return val >= 0.f ? 1.f : -1.f;
+	}
+
+	/*
+	 * Octahedral coordinates of a vector, and the (unnormalised) vector back
+	 * from them, with selects rather than branches, since the signs of
+	 * normals are not predictable. A zero vector gives u = v = 0.
+	 */
+	inline void oct_fold(float x, float y, float z, float& u, float& v)
+	{
+		const float l1 = std::abs(x) + std::abs(y) + std::abs(z);
+		const float inv = 1.f / (l1 > 0.f ? l1 : 1.f);
+		const float px = x * inv;
+		const float py = y * inv;
+		// the lower half is folded out over the corners
+		const float fx = (1.f - std::abs(py)) * sign_not_zero(px);
+		const float fy = (1.f - std::abs(px)) * sign_not_zero(py);
+		u = z < 0.f ? fx : px;
+		v = z < 0.f ? fy : py;
+	}
+
+	// after R. Stubbe
+	inline float oct_unfold(float& x, float& y)
+	{
+		const float z = 1.f - std::abs(x) - std::abs(y);
+		const float t = z < 0.f ? -z : 0.f;
+		x += x >= 0.f ? -t : t;
+		y += y >= 0.f ? -t : t;
+		return z;
+	}
+
+} // namespace detail
+
+// scalar formats {{{
+
+/**
+ * \struct half
+ * \brief IEEE 754 binary16 float
+ *
+ * This is only for storage: it converts implicitly to float for arithmetic,
+ * and explicitly from float, since that rounds.
+ */
+struct half
+{
+public: // statics
+
+	static half from_bits(std::uint16_t b)
+	{
+		half h;
+		h.bits = b;
+		return h;
+	}
+
+public: // methods
+
+	std::uint16_t bits;
+
+	half() = default;
+
+	explicit half(float val)
+		: bits(detail::float_to_half(val))
+	{
+	}
+
+	operator float() const
+	{
+		return detail::half_to_float(bits);
+	}
+};
+
+/**
+ * \struct snorm
+ * \brief signed normalised fixed point number
+ *
+ * Represents [-1, 1] in steps of 1 / max, where max is the largest value of
+ * I, an integer of 8 or 16 bits. The most negative value of I is also -1.
+ */
+template <typename I>
+struct snorm
+{
+	static_assert(std::is_integral<I>::value && std::is_signed<I>::value, "snorm needs a signed integer");
+	static_assert(sizeof(I) <= 2, "snorm needs an integer of 8 or 16 bits");
+
+public: // statics
+
+	static snorm from_bits(I b)
+	{
+		snorm s;
+		s.bits = b;
+		return s;
+	}
+
+public: // methods
+
+	I bits;
+
+	snorm() = default;
+
+	explicit snorm(float val)
+		: bits(static_cast<I>(detail::encode_snorm(val, detail::norm_scale<I>())))
+	{
+	}
+
+	operator float() const
+	{
+		return detail::decode_snorm(bits, detail::norm_scale<I>());
+	}
+};
+
+/**
+ * \struct unorm
+ * \brief unsigned normalised fixed point number
+ *
+ * Represents [0, 1] in steps of 1 / max, where max is the largest value of
+ * I, an integer of 8 or 16 bits.
+ */
+template <typename I>
+struct unorm
+{
+	static_assert(std::is_integral<I>::value && std::is_unsigned<I>::value, "unorm needs an unsigned integer");
+	static_assert(sizeof(I) <= 2, "unorm needs an integer of 8 or 16 bits");
+
+public: // statics
+
+	static unorm from_bits(I b)
+	{
+		unorm u;
+		u.bits = b;
+		return u;
+	}
+
+public: // methods
+
+	I bits;
+
+	unorm() = default;
+
+	explicit unorm(float val)
+		: bits(static_cast<I>(detail::encode_unorm(val, detail::norm_scale<I>())))
+	{
+	}
+
+	operator float() const
+	{
+		return detail::decode_unorm(bits, detail::norm_scale<I>());
+	}
+};
+
+using snorm8 = snorm<std::int8_t>;
+using snorm16 = snorm<std::int16_t>;
+using unorm8 = unorm<std::uint8_t>;
+using unorm16 = unorm<std::uint16_t>;
+
+// }}}
+// packed formats {{{
+
+/**
+ * \struct packed_10_10_10_2
+ * \brief four normalised components in 32 bits
+ *
+ * x, y and z have 10 bits each and w has 2, from the lowest bits up. With
+ * Signed, the components are snorm (so w is -1, 0 or 1), otherwise unorm.
+ */
+template <bool Signed>
+struct packed_10_10_10_2
+{
+public: // statics
+
+	static packed_10_10_10_2 from_bits(std::uint32_t b)
+	{
+		packed_10_10_10_2 p;
+		p.bits = b;
+		return p;
+	}
+
+private:
+
+	static constexpr float scale(unsigned int width)
+	{
+		return static_cast<float>((1u << (Signed ? width - 1 : width)) - 1);
+	}
+
+	static std::uint32_t field(float val, unsigned int width, std::false_type /* signed */)
+	{
+		return detail::encode_unorm(val, scale(width));
+	}
+
+	static std::uint32_t field(float val, unsigned int width, std::true_type /* signed */)
+	{
+		return static_cast<std::uint32_t>(detail::encode_snorm(val, scale(width))) & ((1u << width) - 1);
+	}
+
+	float get(unsigned int shift, unsigned int width, std::false_type /* signed */) const
+	{
+		return detail::decode_unorm((bits >> shift) & ((1u << width) - 1), scale(width));
+	}
+
+	float get(unsigned int shift, unsigned int width, std::true_type /* signed */) const
+	{
+		// move the field to the top, then shift back down to sign extend it
+		const std::int32_t val = static_cast<std::int32_t>(bits << (32 - shift - width)) >> (32 - width);
+		return detail::decode_snorm(val, scale(width));
+	}
+
+public: // methods
+
+	std::uint32_t bits;
+
+	packed_10_10_10_2() = default;
+
+	packed_10_10_10_2(float x, float y, float z, float w)
+	{
+		using tag = std::integral_constant<bool, Signed>;
+		bits = field(x, 10, tag()) | field(y, 10, tag()) << 10 | field(z, 10, tag()) << 20 | field(w, 2, tag()) << 30;
+	}
+
+	std::array<float, 4> unpack() const
+	{
+		using tag = std::integral_constant<bool, Signed>;
+		return {{this->get(0, 10, tag()), this->get(10, 10, tag()), this->get(20, 10, tag()), this->get(30, 2, tag())}};
+	}
+};
+
+using unorm10_10_10_2 = packed_10_10_10_2<false>;
+using snorm10_10_10_2 = packed_10_10_10_2<true>;
+
+/**
+ * \struct octahedral
+ * \brief unit vector in two snorm<I> coordinates
+ *
+ * The vector is projected onto the octahedron |x| + |y| + |z| = 1, and the
+ * lower half is folded out over the corners of the upper half, which covers
+ * the square [-1, 1]^2 with nearly uniform precision. The vector to encode
+ * need not be normalised; a zero vector encodes as +z.
+ */
+template <typename I>
+struct octahedral
+{
+public: // methods
+
+	snorm<I> u;
+	snorm<I> v;
+
+	octahedral() = default;
+
+	octahedral(float x, float y, float z)
+	{
+		float fu, fv;
+		detail::oct_fold(x, y, z, fu, fv);
+		u = snorm<I>(fu);
+		v = snorm<I>(fv);
+	}
+
+	std::array<float, 3> unpack() const
+	{
+		float x = u;
+		float y = v;
+		const float z = detail::oct_unfold(x, y);
+		const float inv = 1.f / std::sqrt(x * x + y * y + z * z);
+		return {{x * inv, y * inv, z * inv}};
+	}
+};
+
+using oct16 = octahedral<std::int8_t>;
+using oct32 = octahedral<std::int16_t>;
+
+// }}}
+
+} // namespace velm
+
+namespace velm { namespace usr {
+
+	template <bool Signed>
+	struct tie<packed_10_10_10_2<Signed>>
+	{
+		std::array<float, 4> operator()(const packed_10_10_10_2<Signed>& p) const
+		{
+			return p.unpack();
+		}
+	};
+
+	template <bool Signed>
+	struct converter_to<packed_10_10_10_2<Signed>>
+	{
+		packed_10_10_10_2<Signed> operator()(float x, float y, float z, float w) const
+		{
+			return {x, y, z, w};
+		}
+	};
+
+	template <typename I>
+	struct tie<octahedral<I>>
+	{
+		std::array<float, 3> operator()(const octahedral<I>& o) const
+		{
+			return o.unpack();
+		}
+	};
+
+	template <typename I>
+	struct converter_to<octahedral<I>>
+	{
+		octahedral<I> operator()(float x, float y, float z) const
+		{
+			return {x, y, z};
+		}
+	};
+
+} } // namespace velm::usr
+
+namespace velm { namespace batch {
+
+namespace detail {
+
+	template <typename T>
+	struct is_storage_scalar
+		: std::is_arithmetic<T>
+	{
+	};
+
+	template <>
+	struct is_storage_scalar<half>
+		: std::true_type
+	{
+	};
+
+	template <typename I>
+	struct is_storage_scalar<snorm<I>>
+		: std::true_type
+	{
+	};
+
+	template <typename I>
+	struct is_storage_scalar<unorm<I>>
+		: std::true_type
+	{
+	};
+
+	// elements which are arrays of scalar components, like flat_traits
+	template <typename E>
+	struct codec_traits
+	{
+		static constexpr bool value = is_storage_scalar<E>::value;
+		using type = E;
+		static constexpr unsigned int size = 1;
+	};
+
+	template <typename T, unsigned int N>
+	struct codec_traits<vector<T, N>>
+	{
+		static constexpr bool value = is_storage_scalar<T>::value && sizeof(vector<T, N>) == N * sizeof(T);
+		using type = T;
+		static constexpr unsigned int size = N;
+	};
+
+	// element type of a range, or of a vector_array
+	template <typename C, typename = void>
+	struct codec_element
+	{
+		using type = typename C::value_type;
+	};
+
+	template <typename C>
+	struct codec_element<C, std::enable_if_t<is_range<C>::value>>
+	{
+		using type = std::remove_const_t<range_element<C>>;
+	};
+
+	template <typename T>
+	struct is_octahedral
+		: std::false_type
+	{
+	};
+
+	template <typename I>
+	struct is_octahedral<octahedral<I>>
+		: std::true_type
+	{
+	};
+
+	// how to convert: flat components, octahedral blocks, or one element at a time
+	struct flat_codec {};
+	struct oct_encoder {};
+	struct oct_decoder {};
+	struct element_codec {};
+
+	template <typename In, typename Out, typename = void>
+	struct codec_kind
+	{
+		using type = element_codec;
+	};
+
+	template <typename In, typename Out>
+	struct codec_kind<In, Out, std::enable_if_t<is_range<In>::value && is_range<Out>::value>>
+	{
+		using in_type = typename codec_element<In>::type;
+		using out_type = typename codec_element<Out>::type;
+		using in_traits = codec_traits<in_type>;
+		using out_traits = codec_traits<out_type>;
+
+		static constexpr bool flat = in_traits::value && out_traits::value && in_traits::size == out_traits::size;
+		static constexpr bool encoder = is_octahedral<out_type>::value
+			&& std::is_same<in_type, vector<float, 3>>::value && in_traits::value;
+		static constexpr bool decoder = is_octahedral<in_type>::value
+			&& std::is_same<out_type, vector<float, 3>>::value && out_traits::value;
+
+		using type = std::conditional_t<flat, flat_codec,
+			std::conditional_t<encoder, oct_encoder,
+			std::conditional_t<decoder, oct_decoder, element_codec>>>;
+	};
+
+	template <typename S, typename D>
+	void convert_components(const S* src, D* dst, std::size_t n)
+	{
+		dispatch::invoke([&] {
+			VELM_IVDEP
+			for(std::size_t i = 0; i < n; ++i) {
+				dst[i] = static_cast<D>(src[i]);
+			}
+		});
+	}
+
+	/*
+	 * The std::false_type versions are built for the translation unit, and
+	 * use F16C if it was built for that. The std::true_type versions are
+	 * only called from kernels which checked for F16C at run time.
+	 */
+	inline void half_range(const float* src, half* dst, std::size_t n, std::false_type /* f16c */)
+	{
+		std::size_t i = 0;
+#if defined(__F16C__)
+		for(; i + 8 <= n; i += 8) {
+			const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+		}
+#endif
+		for(; i < n; ++i) {
+			dst[i] = half(src[i]);
+		}
+	}
+
+	inline void half_range(const half* src, float* dst, std::size_t n, std::false_type /* f16c */)
+	{
+		std::size_t i = 0;
+#if defined(__F16C__)
+		for(; i + 8 <= n; i += 8) {
+			const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+		}
+#endif
+		for(; i < n; ++i) {
+			dst[i] = src[i];
+		}
+	}
+
+#if VELM_DISPATCH
+
+	VELM_TARGET_F16C inline void half_range(const float* src, half* dst, std::size_t n, std::true_type /* f16c */)
+	{
+		std::size_t i = 0;
+		for(; i + 8 <= n; i += 8) {
+			const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+		}
+		if(i < n) {
+			// the tail goes through a zero padded block, so it rounds the same way
+			alignas(32) float in[8] = {};
+			alignas(16) std::uint16_t out[8];
+			for(std::size_t j = i; j < n; ++j) {
+				in[j - i] = src[j];
+			}
+			_mm_store_si128(reinterpret_cast<__m128i*>(out), _mm256_cvtps_ph(_mm256_load_ps(in), _MM_FROUND_TO_NEAREST_INT));
+			for(std::size_t j = i; j < n; ++j) {
+				dst[j] = half::from_bits(out[j - i]);
+			}
+		}
+	}
+
+	VELM_TARGET_F16C inline void half_range(const half* src, float* dst, std::size_t n, std::true_type /* f16c */)
+	{
+		std::size_t i = 0;
+		for(; i + 8 <= n; i += 8) {
+			const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+		}
+		if(i < n) {
+			alignas(16) std::uint16_t in[8] = {};
+			alignas(32) float out[8];
+			for(std::size_t j = i; j < n; ++j) {
+				in[j - i] = src[j].bits;
+			}
+			_mm256_store_ps(out, _mm256_cvtph_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(in))));
+			for(std::size_t j = i; j < n; ++j) {
+				dst[j] = out[j - i];
+			}
+		}
+	}
+
+#endif
+
+	inline void convert_components(const float* src, half* dst, std::size_t n)
+	{
+		dispatch::invoke_half_conversion([&] (auto f16c) {
+			detail::half_range(src, dst, n, f16c);
+		});
+	}
+
+	inline void convert_components(const half* src, float* dst, std::size_t n)
+	{
+		dispatch::invoke_half_conversion([&] (auto f16c) {
+			detail::half_range(src, dst, n, f16c);
+		});
+	}
+
+	/*
+	 * Octahedral vectors are converted in blocks of width<float>, with the
+	 * division and square root done on whole packs, since compilers do not
+	 * vectorise them in a loop with the selects of oct_fold and oct_unfold.
+	 * The packed operations are correctly rounded, so the results are the
+	 * same as converting one vector at a time.
+	 */
+	template <typename I>
+	void oct_encode_range(const float* src, octahedral<I>* dst, std::size_t n)
+	{
+		constexpr unsigned int W = width<float>::value;
+		dispatch::invoke([&] {
+			std::size_t i = 0;
+			for(; i + W <= n; i += W) {
+				pack<float, W> l1;
+				for(unsigned int j = 0; j < W; ++j) {
+					const float* p = src + (i + j) * 3;
+					const float sum = std::abs(p[0]) + std::abs(p[1]) + std::abs(p[2]);
+					l1.lanes[j] = sum > 0.f ? sum : 1.f;
+				}
+				const pack<float, W> inv = pack<float, W>(1.f) / l1;
+				for(unsigned int j = 0; j < W; ++j) {
+					const float* p = src + (i + j) * 3;
+					const float px = p[0] * inv.lanes[j];
+					const float py = p[1] * inv.lanes[j];
+					const float fx = (1.f - std::abs(py)) * velm::detail::sign_not_zero(px);
+					const float fy = (1.f - std::abs(px)) * velm::detail::sign_not_zero(py);
+					dst[i + j].u = snorm<I>(p[2] < 0.f ? fx : px);
+					dst[i + j].v = snorm<I>(p[2] < 0.f ? fy : py);
+				}
+			}
+			for(; i < n; ++i) {
+				const float* p = src + i * 3;
+				dst[i] = octahedral<I>(p[0], p[1], p[2]);
+			}
+		});
+	}
+
+	template <typename I>
+	void oct_decode_range(const octahedral<I>* src, float* dst, std::size_t n)
+	{
+		constexpr unsigned int W = width<float>::value;
+		dispatch::invoke([&] {
+			std::size_t i = 0;
+			for(; i + W <= n; i += W) {
+				vector<pack<float, W>, 3> v;
+				for(unsigned int j = 0; j < W; ++j) {
+					float x = src[i + j].u;
+					float y = src[i + j].v;
+					v[2].lanes[j] = velm::detail::oct_unfold(x, y);
+					v[0].lanes[j] = x;
+					v[1].lanes[j] = y;
+				}
+				const pack<float, W> inv = pack<float, W>(1.f) / velm::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+				for(unsigned int j = 0; j < W; ++j) {
+					for(unsigned int k = 0; k < 3; ++k) {
+						dst[(i + j) * 3 + k] = v[k].lanes[j] * inv.lanes[j];
+					}
+				}
+			}
+			for(; i < n; ++i) {
+				const std::array<float, 3> v = src[i].unpack();
+				for(unsigned int k = 0; k < 3; ++k) {
+					dst[i * 3 + k] = v[k];
+				}
+			}
+		});
+	}
+
+	template <typename In, typename Out>
+	void codec_range(const In& in, Out& out, std::size_t begin, std::size_t end, oct_encoder /* kind */)
+	{
+		detail::oct_encode_range(reinterpret_cast<const float*>(in.data() + begin), out.data() + begin, end - begin);
+	}
+
+	template <typename In, typename Out>
+	void codec_range(const In& in, Out& out, std::size_t begin, std::size_t end, oct_decoder /* kind */)
+	{
+		detail::oct_decode_range(in.data() + begin, reinterpret_cast<float*>(out.data() + begin), end - begin);
+	}
+
+	template <typename In, typename Out>
+	void codec_range(const In& in, Out& out, std::size_t begin, std::size_t end, flat_codec /* kind */)
+	{
+		using in_traits = codec_traits<typename codec_element<In>::type>;
+		using out_traits = codec_traits<typename codec_element<Out>::type>;
+		const auto* src = reinterpret_cast<const typename in_traits::type*>(in.data());
+		auto* dst = reinterpret_cast<typename out_traits::type*>(out.data());
+		detail::convert_components(src + begin * in_traits::size, dst + begin * out_traits::size,
+			(end - begin) * in_traits::size);
+	}
+
+	template <typename In, typename Out>
+	void codec_range(const In& in, Out& out, std::size_t begin, std::size_t end, element_codec /* kind */)
+	{
+		using in_type = typename codec_element<In>::type;
+		using out_type = typename codec_element<Out>::type;
+		dispatch::invoke([&] {
+			for(std::size_t i = begin; i < end; ++i) {
+				const in_type val = in[i];
+				out[i] = static_cast<out_type>(val);
+			}
+		});
+	}
+
+	template <typename In, typename Out>
+	void codec(const In& in, Out& out)
+	{
+		assert(out.size() == in.size());
+		detail::codec_range(in, out, 0, in.size(), typename codec_kind<In, Out>::type());
+	}
+
+	template <typename In, typename Out>
+	void codec(const exec::policy& policy, const In& in, Out& out)
+	{
+		assert(out.size() == in.size());
+		const std::size_t bytes = sizeof(typename codec_element<In>::type) + sizeof(typename codec_element<Out>::type);
+		exec::for_each_chunk(policy.with_chunk_size(exec::chunk_size(policy, in.size(), bytes)), in.size(),
+			[&] (std::size_t begin, std::size_t end) {
+				detail::codec_range(in, out, begin, end, typename codec_kind<In, Out>::type());
+			});
+	}
+
+} // namespace detail
+
+/**
+ * \fn encode
+ * \brief convert each vector to a storage format
+ *
+ * out[i] is in[i] converted to the element type of out, e.g. from a range of
+ * velm::vector<float, 3> (or a vector_array<float, 3>) to a range of
+ * velm::vector<velm::half, 3> or velm::oct32. in and out may be ranges or
+ * vector_arrays, and must be the same size.
+ */
+template <typename In, typename Out>
+void encode(const In& in, Out&& out)
+{
+	detail::codec(in, out);
+}
+
+template <typename In, typename Out>
+void encode(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::codec(policy, in, out);
+}
+
+/**
+ * \fn decode
+ * \brief convert each vector from a storage format
+ *
+ * The reverse of encode: out[i] is in[i] converted to the element type of
+ * out, e.g. from a range of velm::unorm10_10_10_2 to a range of
+ * velm::vector<float, 4>.
+ */
+template <typename In, typename Out>
+void decode(const In& in, Out&& out)
+{
+	detail::codec(in, out);
+}
+
+template <typename In, typename Out>
+void decode(const exec::policy& policy, const In& in, Out&& out)
+{
+	detail::codec(policy, in, out);
+}
+
+} } // namespace velm::batch
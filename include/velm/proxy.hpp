@@ -2,10 +2,22 @@
 
 #include <array>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include "defs.hpp"
 #include "utility.hpp"
 
+/*
+ * Every velm::vector has up to 340 swizzle members, each of a different
+ * swizzle_proxy type, so the class body of swizzle_proxy is instantiated
+ * hundreds of times for each vector type. To keep that cheap, the class only
+ * declares what has to be a member (storage, assignment and operator()).
+ * Everything else, including the tie, is outside the class, where it is
+ * only instantiated for swizzles which are actually used. Use get_tie(p) to
+ * get the tie of a swizzle.
+ */
+
 namespace velm {
 
 template <typename T, unsigned int... N>
@@ -16,54 +28,97 @@ public: // statics
 	static constexpr auto dimensions = sizeof...(N);
 	using value_type = T;
 
-private:
+public:
 
-	std::array<T, utility::tmax<unsigned int, N...>::value + 1> underlying; // used to acess swizzles
+	// used to acess swizzles (public, since even a friend declaration adds measurably to the cost)
+	std::array<T, utility::tmax<unsigned int, N...>::value + 1> underlying;
 
-public:
+	template <typename U>
+	constexpr swizzle_proxy& operator=(U&& val);
+
+	constexpr auto operator()() const;
+};
 
-	constexpr auto tie() &
+namespace usr {
+
+	template <typename T, unsigned int... N>
+	struct tie<swizzle_proxy<T, N...>>
+	{
+		constexpr auto operator()(swizzle_proxy<T, N...>& p) const
+		{
+			return std::tie(std::get<N>(p.underlying)...);
+		}
+
+		constexpr auto operator()(const swizzle_proxy<T, N...>& p) const
+		{
+			return std::tie(std::get<N>(p.underlying)...);
+		}
+
+		constexpr auto operator()(const swizzle_proxy<T, N...>&& p) const
+		{
+			return std::make_tuple(std::get<N>(p.underlying)...);
+		}
+	};
+
+} // namespace usr
+
+namespace detail {
+
+	/*
+	 * Components are assigned in order, as tuple assignment does, so overlapping
+	 * swizzles (e.g. v.xy = v.yx) behave the same on every path.
+	 */
+	template <typename P, typename U, std::size_t... Is>
+	constexpr void swizzle_assign_direct(P& proxy, const U& vec, std::index_sequence<Is...> /* seq */)
 	{
-		return std::tie(std::get<N>(underlying)...);
+		using expand = int[];
+		(void)expand{0, (static_cast<void>(utility::direct_get<Is>(proxy) = utility::direct_get<Is>(vec)), 0)...};
 	}
 
-	constexpr auto tie() const&
+	template <typename P, typename U, std::size_t... Is>
+	constexpr void swizzle_fill(P& proxy, const U& val, std::index_sequence<Is...> /* seq */)
 	{
-		return std::tie(std::get<N>(underlying)...);
+		using expand = int[];
+		(void)expand{0, (static_cast<void>(utility::direct_get<Is>(proxy) = val), 0)...};
 	}
 
-	constexpr auto tie() const&&
+	template <typename P, typename U>
+	constexpr void swizzle_assign(P& proxy, U&& vec, std::true_type /* tied */, std::true_type /* direct */)
 	{
-		return std::make_tuple(std::get<N>(underlying)...);
+		static_assert(P::dimensions == utility::direct_size<U>::value, "Vectors must be the same size");
+		swizzle_assign_direct(proxy, vec, std::make_index_sequence<P::dimensions>());
 	}
 
-	template <typename U,
-		std::enable_if_t<utility::is_tied_vector<U>::value, int> = 0>
-	constexpr swizzle_proxy& operator=(U&& vec)
+	template <typename P, typename U>
+	constexpr void swizzle_assign(P& proxy, U&& vec, std::true_type /* tied */, std::false_type /* direct */)
 	{
-		static_assert(std::tuple_size<decltype(this->tie())>::value == std::tuple_size<decltype(get_tie(vec))>::value,
+		static_assert(P::dimensions == std::tuple_size<std::decay_t<decltype(get_tie(vec))>>::value,
 		              "Ties must be the same size");
-		this->tie() = get_tie(vec);
-		return *this;
+		get_tie(proxy) = get_tie(vec);
 	}
 
-	template <typename U,
-		std::enable_if_t<!utility::is_tied_vector<U>::value, int> = 0>
-	constexpr swizzle_proxy& operator=(U&& val)
+	template <typename P, typename U>
+	constexpr void swizzle_assign(P& proxy, U&& val, std::false_type /* tied */, std::false_type /* direct */)
 	{
-		this->tie() = utility::make_filled_tuple<dimensions>(val);
-		return *this;
+		// copied first, since val may be one of the components (e.g. v.xy = v.y)
+		const std::decay_t<U> copy = val;
+		swizzle_fill(proxy, copy, std::make_index_sequence<P::dimensions>());
 	}
 
-	constexpr vector<T, dimensions> operator()() const
-	{
-		return static_cast<vector<T, dimensions>>(*this);
-	}
+} // namespace detail
 
-	constexpr operator vector<T, dimensions>() const
-	{
-		return vector<T, dimensions>::from_tuple(this->tie());
-	}
-};
+template <typename T, unsigned int... N>
+template <typename U>
+constexpr swizzle_proxy<T, N...>& swizzle_proxy<T, N...>::operator=(U&& val)
+{
+	detail::swizzle_assign(*this, std::forward<U>(val), utility::is_tied_vector<U>(), utility::is_direct_vector<U>());
+	return *this;
+}
+
+template <typename T, unsigned int... N>
+constexpr auto swizzle_proxy<T, N...>::operator()() const
+{
+	return vector<T, sizeof...(N)>(*this);
+}
 
 }
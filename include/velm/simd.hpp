@@ -0,0 +1,721 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "utility.hpp"
+
+/**
+ * \file simd.hpp
+ * \brief SIMD fast path for component-wise operators
+ *
+ * The generic operator implementation (utility::binary_apply) calls a function
+ * on each pair of components, which compilers do not always reduce to single
+ * packed instructions. This file provides a specialised path for small vectors of
+ * float, double, int32_t and uint32_t, which loads the operands into SSE/AVX
+ * registers, applies a single packed instruction per register, and stores the
+ * result.
+ *
+ * The fast path is only taken when the result is guaranteed to be identical to
+ * the generic path: both operands must have the same value type (or be a
+ * scalar of exactly that type). It is also only taken when it is actually
+ * faster: both operands must be plain vectors (not swizzles), whose storage
+ * can be loaded directly, and the dimensions must fill whole registers (e.g.
+ * 4 floats). Assembling a partially-filled register from separate components
+ * costs more shuffles than the generic path, which compilers can also
+ * vectorise across neighbouring elements in a loop. Everything else falls
+ * back to utility::binary_apply.
+ *
+ * The path is controlled by the VELM_SIMD macro. It defaults to 1 when SSE2 is
+ * available, and can be defined to 0 before including any velm header to force
+ * the generic path.
+ */
+
+#if !defined(VELM_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define VELM_SIMD 1
+	#else
+		#define VELM_SIMD 0
+	#endif
+#endif
+
+#if VELM_SIMD
+	#include <immintrin.h>
+#endif
+
+namespace velm { namespace simd {
+
+/**
+ * \struct operand_traits
+ * \brief classify an operator argument
+ *
+ * Determines whether a (decayed) type is a velm::vector or a swizzle_proxy,
+ * along with its value type and dimensions. Other types are scalars.
+ */
+template <typename T>
+struct operand_traits
+{
+	static constexpr bool is_vector = false;
+	static constexpr bool is_swizzle = false;
+	using value_type = T;
+	static constexpr unsigned int dimensions = 1;
+};
+
+template <typename T, unsigned int N>
+struct operand_traits<vector<T, N>>
+{
+	static constexpr bool is_vector = true;
+	static constexpr bool is_swizzle = false;
+	using value_type = T;
+	static constexpr unsigned int dimensions = N;
+};
+
+template <typename T, unsigned int... Is>
+struct operand_traits<swizzle_proxy<T, Is...>>
+{
+	static constexpr bool is_vector = true;
+	static constexpr bool is_swizzle = true;
+	using value_type = T;
+	static constexpr unsigned int dimensions = sizeof...(Is);
+};
+
+/**
+ * \struct native
+ * \brief register type and primitive operations for a component type
+ *
+ * Specialisations provide the register type (reg), the number of components
+ * per register (width), and load/store/set1 along with the arithmetic
+ * operations. The supports_* flags mark which operations have an exact packed
+ * equivalent.
+ *
+ * The comparisons (lt, le, gt, ge, eq, ne) return one bit per component, as
+ * from movemask, with the same results as the scalar operators (ne is true
+ * for NaN). expand turns such bits back into a register mask for blend, which
+ * picks a where the mask is set and b elsewhere.
+ */
+template <typename T>
+struct native
+{
+	static constexpr bool supported = false;
+};
+
+#if VELM_SIMD
+
+template <>
+struct native<float>
+{
+	static constexpr bool supported = true;
+	static constexpr bool supports_mul = true;
+	static constexpr bool supports_div = true;
+
+	using reg = __m128;
+	static constexpr unsigned int width = 4;
+
+	static reg load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, reg a) { _mm_storeu_ps(p, a); }
+	static reg set1(float v) { return _mm_set1_ps(v); }
+
+	static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+	static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+	static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+	static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+	static reg neg(reg a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+
+	static int lt(reg a, reg b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+	static int le(reg a, reg b) { return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+	static int gt(reg a, reg b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+	static int ge(reg a, reg b) { return _mm_movemask_ps(_mm_cmpge_ps(a, b)); }
+	static int eq(reg a, reg b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+	static int ne(reg a, reg b) { return _mm_movemask_ps(_mm_cmpneq_ps(a, b)); }
+
+	static reg expand(int bits)
+	{
+		const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+		return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+	}
+
+	static reg blend(reg m, reg a, reg b)
+	{
+#if defined(__SSE4_1__)
+		return _mm_blendv_ps(b, a, m);
+#else
+		return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+#endif
+	}
+};
+
+/*
+ * Masks of 2 doubles, from 2 bits. Each double lane is two 32 bit lanes, which
+ * are compared against the same bit.
+ */
+inline __m128d expand_pd(int bits)
+{
+	const __m128i lanes = _mm_setr_epi32(1, 1, 2, 2);
+	return _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+}
+
+#if defined(__AVX__)
+
+template <>
+struct native<double>
+{
+	static constexpr bool supported = true;
+	static constexpr bool supports_mul = true;
+	static constexpr bool supports_div = true;
+
+	using reg = __m256d;
+	static constexpr unsigned int width = 4;
+
+	static reg load(const double* p) { return _mm256_loadu_pd(p); }
+	static void store(double* p, reg a) { _mm256_storeu_pd(p, a); }
+	static reg set1(double v) { return _mm256_set1_pd(v); }
+
+	static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+	static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+	static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+	static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+	static reg neg(reg a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+
+	static int lt(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+	static int le(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ)); }
+	static int gt(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ)); }
+	static int ge(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GE_OQ)); }
+	static int eq(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+	static int ne(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_NEQ_UQ)); }
+
+	// AVX has no 256 bit integer comparison, so each half is expanded separately
+	static reg expand(int bits)
+	{
+		return _mm256_insertf128_pd(_mm256_castpd128_pd256(expand_pd(bits)), expand_pd(bits >> 2), 1);
+	}
+
+	static reg blend(reg m, reg a, reg b) { return _mm256_blendv_pd(b, a, m); }
+};
+
+#else
+
+template <>
+struct native<double>
+{
+	static constexpr bool supported = true;
+	static constexpr bool supports_mul = true;
+	static constexpr bool supports_div = true;
+
+	using reg = __m128d;
+	static constexpr unsigned int width = 2;
+
+	static reg load(const double* p) { return _mm_loadu_pd(p); }
+	static void store(double* p, reg a) { _mm_storeu_pd(p, a); }
+	static reg set1(double v) { return _mm_set1_pd(v); }
+
+	static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+	static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+	static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+	static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+	static reg neg(reg a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+
+	static int lt(reg a, reg b) { return _mm_movemask_pd(_mm_cmplt_pd(a, b)); }
+	static int le(reg a, reg b) { return _mm_movemask_pd(_mm_cmple_pd(a, b)); }
+	static int gt(reg a, reg b) { return _mm_movemask_pd(_mm_cmpgt_pd(a, b)); }
+	static int ge(reg a, reg b) { return _mm_movemask_pd(_mm_cmpge_pd(a, b)); }
+	static int eq(reg a, reg b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+	static int ne(reg a, reg b) { return _mm_movemask_pd(_mm_cmpneq_pd(a, b)); }
+
+	static reg expand(int bits) { return expand_pd(bits); }
+
+	static reg blend(reg m, reg a, reg b)
+	{
+#if defined(__SSE4_1__)
+		return _mm_blendv_pd(b, a, m);
+#else
+		return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+#endif
+	}
+};
+
+#endif
+
+template <typename T>
+struct native_int32
+{
+	static constexpr bool supported = true;
+#if defined(__SSE4_1__)
+	static constexpr bool supports_mul = true;
+#else
+	static constexpr bool supports_mul = false;
+#endif
+	static constexpr bool supports_div = false;
+
+	using reg = __m128i;
+	static constexpr unsigned int width = 4;
+
+	static reg load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static void store(T* p, reg a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+	static reg set1(T v) { return _mm_set1_epi32(static_cast<int>(v)); }
+
+	static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+	static reg sub(reg a, reg b) { return _mm_sub_epi32(a, b); }
+#if defined(__SSE4_1__)
+	static reg mul(reg a, reg b) { return _mm_mullo_epi32(a, b); }
+#endif
+	static reg neg(reg a) { return _mm_sub_epi32(_mm_setzero_si128(), a); }
+
+	/*
+	 * SSE2 only compares signed integers, so unsigned values are offset by
+	 * 2^31 first, which maps their order onto the signed order. le, ge and ne
+	 * are the complements of gt, lt and eq.
+	 */
+	static reg ordered(reg a, std::true_type /* signed */) { return a; }
+	static reg ordered(reg a, std::false_type /* signed */) { return _mm_xor_si128(a, _mm_set1_epi32(std::numeric_limits<std::int32_t>::min())); }
+	static reg ordered(reg a) { return ordered(a, std::is_signed<T>()); }
+
+	static int movemask(reg m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+
+	static int lt(reg a, reg b) { return movemask(_mm_cmplt_epi32(ordered(a), ordered(b))); }
+	static int le(reg a, reg b) { return gt(a, b) ^ 0xf; }
+	static int gt(reg a, reg b) { return movemask(_mm_cmpgt_epi32(ordered(a), ordered(b))); }
+	static int ge(reg a, reg b) { return lt(a, b) ^ 0xf; }
+	static int eq(reg a, reg b) { return movemask(_mm_cmpeq_epi32(a, b)); }
+	static int ne(reg a, reg b) { return eq(a, b) ^ 0xf; }
+
+	static reg expand(int bits)
+	{
+		const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+		return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes);
+	}
+
+	static reg blend(reg m, reg a, reg b)
+	{
+		return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+	}
+};
+
+template <>
+struct native<std::int32_t>
+	: native_int32<std::int32_t>
+{
+};
+
+template <>
+struct native<std::uint32_t>
+	: native_int32<std::uint32_t>
+{
+};
+
+#endif // VELM_SIMD
+
+// operations {{{
+
+/*
+ * Each operation is a function object which performs the scalar operation
+ * (used by the generic path), along with a static packed version and a flag
+ * indicating whether the packed version exists for a given component type.
+ */
+
+struct op_add
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a + b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static Reg packed(Reg a, Reg b) { return Traits::add(a, b); }
+};
+
+struct op_sub
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a - b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static Reg packed(Reg a, Reg b) { return Traits::sub(a, b); }
+};
+
+struct op_mul
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a * b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported && Traits::supports_mul>;
+
+	template <typename Traits, typename Reg>
+	static Reg packed(Reg a, Reg b) { return Traits::mul(a, b); }
+};
+
+struct op_div
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a / b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported && Traits::supports_div>;
+
+	template <typename Traits, typename Reg>
+	static Reg packed(Reg a, Reg b) { return Traits::div(a, b); }
+};
+
+/*
+ * Comparisons produce a velm::mask, one bit per component. Their packed
+ * versions return the bits of one register.
+ */
+
+struct op_lt
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a < b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static int packed(Reg a, Reg b) { return Traits::lt(a, b); }
+};
+
+struct op_le
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a <= b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static int packed(Reg a, Reg b) { return Traits::le(a, b); }
+};
+
+struct op_gt
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a > b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static int packed(Reg a, Reg b) { return Traits::gt(a, b); }
+};
+
+struct op_ge
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a >= b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static int packed(Reg a, Reg b) { return Traits::ge(a, b); }
+};
+
+struct op_eq
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a == b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static int packed(Reg a, Reg b) { return Traits::eq(a, b); }
+};
+
+struct op_ne
+{
+	template <typename A, typename B>
+	constexpr auto operator()(A&& a, B&& b) const { return a != b; }
+
+	template <typename Traits>
+	using enabled = std::integral_constant<bool, Traits::supported>;
+
+	template <typename Traits, typename Reg>
+	static int packed(Reg a, Reg b) { return Traits::ne(a, b); }
+};
+
+// }}}
+// eligibility {{{
+
+template <typename Op, typename T, unsigned int N, typename = void>
+struct is_native_op
+	: std::false_type
+{
+};
+
+template <typename Op, typename T, unsigned int N>
+struct is_native_op<Op, T, N, std::enable_if_t<native<T>::supported>>
+	: std::integral_constant<bool, (N > 0 && N % native<T>::width == 0) && Op::template enabled<native<T>>::value>
+{
+};
+
+/*
+ * A binary operation is native if both operands are vectors of the same type
+ * and size, or if one is a vector and the other is a scalar of exactly the
+ * vector's value type (so promotion cannot change the result). Swizzles are
+ * not contiguous, so they take the generic path.
+ */
+template <typename Op, typename L, typename R,
+	typename LT = operand_traits<std::decay_t<L>>, typename RT = operand_traits<std::decay_t<R>>>
+using is_native_binary = std::integral_constant<bool,
+	(LT::is_vector || RT::is_vector)
+	&& !LT::is_swizzle && !RT::is_swizzle
+	&& std::is_same<typename LT::value_type, typename RT::value_type>::value
+	&& (!LT::is_vector || !RT::is_vector || LT::dimensions == RT::dimensions)
+	&& is_native_op<Op, typename LT::value_type, (LT::is_vector ? LT::dimensions : RT::dimensions)>::value>;
+
+/*
+ * Compound assignment is evaluated component by component in the generic path,
+ * so when either side is a swizzle a later component can observe an earlier
+ * write (e.g. v.zyx += v). Only plain vectors on the left and plain vectors or
+ * scalars on the right are guaranteed to give the same result.
+ */
+template <typename Op, typename L, typename R,
+	typename LT = operand_traits<std::decay_t<L>>, typename RT = operand_traits<std::decay_t<R>>>
+using is_native_compound = std::integral_constant<bool,
+	is_native_binary<Op, L, R>::value && LT::is_vector && !LT::is_swizzle && !RT::is_swizzle>;
+
+// }}}
+// load/store {{{
+
+template <typename T, unsigned int N>
+struct block
+{
+	using traits = native<T>;
+	static constexpr unsigned int width = traits::width;
+	static constexpr unsigned int count = N / width;
+
+	static_assert(N % width == 0, "Vector must fill whole registers");
+
+	typename traits::reg regs[count];
+};
+
+template <typename T, unsigned int N, typename V,
+	std::enable_if_t<operand_traits<std::decay_t<V>>::is_vector, int> = 0>
+block<T, N> load(const V& vec)
+{
+	using block_type = block<T, N>;
+	block_type out;
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		out.regs[i] = block_type::traits::load(vec.data.data() + i * block_type::width);
+	}
+	return out;
+}
+
+template <typename T, unsigned int N, typename V,
+	std::enable_if_t<!operand_traits<std::decay_t<V>>::is_vector, int> = 0>
+block<T, N> load(const V& val)
+{
+	using block_type = block<T, N>;
+	block_type out;
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		out.regs[i] = block_type::traits::set1(val);
+	}
+	return out;
+}
+
+template <typename T, unsigned int N>
+vector<T, N> store(const block<T, N>& b)
+{
+	using block_type = block<T, N>;
+	vector<T, N> out;
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		block_type::traits::store(out.data.data() + i * block_type::width, b.regs[i]);
+	}
+	return out;
+}
+
+template <typename Op, typename T, unsigned int N>
+block<T, N> packed_apply(const block<T, N>& a, const block<T, N>& b)
+{
+	using block_type = block<T, N>;
+	block_type out;
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		out.regs[i] = Op::template packed<typename block_type::traits>(a.regs[i], b.regs[i]);
+	}
+	return out;
+}
+
+// }}}
+// entry points {{{
+
+/**
+ * \fn binary_apply
+ * \brief apply an operation, using packed instructions where possible
+ *
+ * Equivalent to utility::binary_apply(lhs, rhs, Op{}), but operands which
+ * satisfy is_native_binary are evaluated with packed instructions.
+ */
+template <typename Op, typename L, typename R,
+	std::enable_if_t<!is_native_binary<Op, L, R>::value, int> = 0>
+constexpr auto binary_apply(Op op, L&& lhs, R&& rhs)
+{
+	return utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs), op);
+}
+
+template <typename Op, typename L, typename R,
+	std::enable_if_t<is_native_binary<Op, L, R>::value, int> = 0>
+auto binary_apply(Op /* op */, L&& lhs, R&& rhs)
+{
+	using LT = operand_traits<std::decay_t<L>>;
+	using RT = operand_traits<std::decay_t<R>>;
+	using T = typename LT::value_type;
+	constexpr unsigned int N = LT::is_vector ? LT::dimensions : RT::dimensions;
+
+	return store(packed_apply<Op>(load<T, N>(lhs), load<T, N>(rhs)));
+}
+
+/**
+ * \fn compound_apply
+ * \brief compound assignment, using packed instructions where possible
+ *
+ * The generic path calls f (which should perform the compound assignment) on
+ * each pair of components. Operands which satisfy is_native_compound are
+ * instead evaluated as lhs = Op(lhs, rhs) with packed instructions.
+ */
+template <typename Op, typename L, typename R, typename F,
+	std::enable_if_t<!is_native_compound<Op, L, R>::value, int> = 0>
+constexpr void compound_apply(Op /* op */, L& lhs, R&& rhs, F&& f)
+{
+	utility::binary_apply(lhs, std::forward<R>(rhs), std::forward<F>(f));
+}
+
+template <typename Op, typename L, typename R, typename F,
+	std::enable_if_t<is_native_compound<Op, L, R>::value, int> = 0>
+void compound_apply(Op /* op */, L& lhs, R&& rhs, F&& /* f */)
+{
+	using LT = operand_traits<std::decay_t<L>>;
+	using T = typename LT::value_type;
+	constexpr unsigned int N = LT::dimensions;
+
+	lhs = store(packed_apply<Op>(load<T, N>(lhs), load<T, N>(rhs)));
+}
+
+/**
+ * \fn negate_apply
+ * \brief unary minus, using packed instructions where possible
+ */
+template <typename V, typename VT = operand_traits<std::decay_t<V>>>
+using is_native_negate = std::integral_constant<bool,
+	!VT::is_swizzle && is_native_op<op_add, typename VT::value_type, VT::dimensions>::value>;
+
+template <typename V, typename F, std::enable_if_t<!is_native_negate<V>::value, int> = 0>
+constexpr auto negate_apply(V&& vec, F&& f)
+{
+	return utility::unary_apply(vec, std::forward<F>(f));
+}
+
+template <typename V, typename F, std::enable_if_t<is_native_negate<V>::value, int> = 0>
+auto negate_apply(V&& vec, F&& /* f */)
+{
+	using VT = operand_traits<std::decay_t<V>>;
+	using T = typename VT::value_type;
+	using block_type = block<T, VT::dimensions>;
+
+	block_type b = load<T, VT::dimensions>(vec);
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		b.regs[i] = block_type::traits::neg(b.regs[i]);
+	}
+	return store(b);
+}
+
+/**
+ * \fn compare_apply
+ * \brief component-wise comparison, producing a mask
+ *
+ * The generic path calls f (which should perform the comparison) on each pair
+ * of components. Where that gives bool, the result is packed into a velm::mask; other results (such as the
+ * pack<bool, W> from comparing packs) are returned as a vector. Operands which
+ * satisfy is_native_binary are compared a register at a time, straight into
+ * the bits of the mask.
+ */
+namespace detail {
+
+	template <unsigned int N>
+	constexpr mask<N> to_mask(const vector<bool, N>& vec)
+	{
+		return mask<N>(vec);
+	}
+
+	template <typename V>
+	constexpr V to_mask(V vec)
+	{
+		return vec;
+	}
+
+} // namespace detail
+
+template <typename Op, typename L, typename R, typename F,
+	std::enable_if_t<!is_native_binary<Op, L, R>::value, int> = 0>
+constexpr auto compare_apply(Op /* op */, L&& lhs, R&& rhs, F&& f)
+{
+	return detail::to_mask(utility::binary_apply(std::forward<L>(lhs), std::forward<R>(rhs), std::forward<F>(f)));
+}
+
+template <typename Op, typename L, typename R, typename F,
+	std::enable_if_t<is_native_binary<Op, L, R>::value, int> = 0>
+auto compare_apply(Op /* op */, L&& lhs, R&& rhs, F&& /* f */)
+{
+	using LT = operand_traits<std::decay_t<L>>;
+	using RT = operand_traits<std::decay_t<R>>;
+	using T = typename LT::value_type;
+	constexpr unsigned int N = LT::is_vector ? LT::dimensions : RT::dimensions;
+	using block_type = block<T, N>;
+	using word = typename mask<N>::word;
+	constexpr unsigned int word_bits = mask<N>::word_bits;
+
+	const block_type a = load<T, N>(lhs);
+	const block_type b = load<T, N>(rhs);
+	mask<N> out;
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		const unsigned int first = i * block_type::width;
+		const auto bits = Op::template packed<typename block_type::traits>(a.regs[i], b.regs[i]);
+		out.words[first / word_bits] |= static_cast<word>(bits) << (first % word_bits);
+	}
+	return out;
+}
+
+/**
+ * \fn select_apply
+ * \brief blend two vectors by a mask
+ *
+ * Vectors which fill whole registers are blended a register at a time, with
+ * the mask bits expanded into a register mask. Others are selected component
+ * by component.
+ */
+template <typename T, unsigned int N, std::enable_if_t<!is_native_op<op_eq, T, N>::value, int> = 0>
+vector<T, N> select_apply(const mask<N>& m, const vector<T, N>& a, const vector<T, N>& b)
+{
+	vector<T, N> out;
+	for(unsigned int i = 0; i < N; ++i) {
+		out[i] = m[i] ? a[i] : b[i];
+	}
+	return out;
+}
+
+template <typename T, unsigned int N, std::enable_if_t<is_native_op<op_eq, T, N>::value, int> = 0>
+vector<T, N> select_apply(const mask<N>& m, const vector<T, N>& a, const vector<T, N>& b)
+{
+	using block_type = block<T, N>;
+	using traits = typename block_type::traits;
+	constexpr unsigned int word_bits = mask<N>::word_bits;
+
+	block_type out = load<T, N>(a);
+	const block_type other = load<T, N>(b);
+	for(unsigned int i = 0; i < block_type::count; ++i) {
+		const unsigned int first = i * block_type::width;
+		const int bits = static_cast<int>(m.words[first / word_bits] >> (first % word_bits));
+		out.regs[i] = traits::blend(traits::expand(bits), out.regs[i], other.regs[i]);
+	}
+	return store(out);
+}
+
+// }}}
+
+} } // namespace velm::simd
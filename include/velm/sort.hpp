@@ -0,0 +1,441 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "vector_array.hpp"
+#include "curve.hpp"
+#include "exec.hpp"
+
+/**
+ * \file sort.hpp
+ * \brief radix sort, and reordering points along space-filling curves
+ *
+ * spatial_sort reorders the points of a vector_array or std::vector along a
+ * Morton or Hilbert curve (see curve.hpp), so that points which are close in
+ * space are close in memory, and returns the order it used, so other
+ * attributes of the points can follow with permute:
+ *
+ *      std::vector<std::uint32_t> order = velm::spatial_sort(positions);
+ *      velm::permute(colors.data(), order);
+ *
+ * Keys are sorted with an LSD radix sort, a byte per pass, which skips the
+ * passes over bytes that are the same in every key (e.g. the top byte of
+ * 63 bit keys of 3 dimensional points, or the high bytes of the keys of
+ * small point sets). Each pass is a linear scatter, so for large inputs
+ * the sort is bound by memory bandwidth rather than comparisons. Orders hold
+ * 32 bit indices, so point sets are limited to 2^32 points.
+ *
+ * Each function also takes an execution policy (see exec.hpp) as its first
+ * argument. The parallel radix sort splits the input into a block per
+ * thread, which count their keys and then scatter them to their own offsets
+ * within each bucket, so the sort stays stable.
+ */
+
+namespace velm {
+
+// sorting {{{
+
+namespace detail {
+
+	template <typename Key, typename Value>
+	struct radix_item
+	{
+		Key key;
+		Value value;
+	};
+
+	template <typename Key, typename Value>
+	const Key& radix_key(const radix_item<Key, Value>& item)
+	{
+		return item.key;
+	}
+
+	template <typename Key>
+	const Key& radix_key(const Key& key)
+	{
+		return key;
+	}
+
+	/*
+	 * LSD radix sort of keys, or of items holding a key and a value, a byte
+	 * per pass. Keys and values are kept together, so each pass writes one
+	 * stream per bucket rather than two.
+	 */
+	template <typename Key, typename Item>
+	void radix_sort_items(Item* items, std::size_t n)
+	{
+		constexpr unsigned int passes = sizeof(Key);
+		constexpr std::size_t buckets = 256;
+
+		// counts of every pass in one read of the keys
+		std::vector<std::size_t> counts(passes * buckets, 0);
+		for(std::size_t i = 0; i < n; ++i) {
+			const Key key = radix_key(items[i]);
+			for(unsigned int p = 0; p < passes; ++p) {
+				++counts[p * buckets + ((key >> (p * 8)) & 0xff)];
+			}
+		}
+
+		std::vector<Item> buf(n);
+		Item* src = items;
+		Item* dst = buf.data();
+
+		for(unsigned int p = 0; p < passes; ++p) {
+			std::size_t* offsets = counts.data() + p * buckets;
+			const unsigned int shift = p * 8;
+
+			// every key has the same byte, so this pass would keep the order
+			if(offsets[(radix_key(src[0]) >> shift) & 0xff] == n) {
+				continue;
+			}
+
+			std::size_t sum = 0;
+			for(std::size_t b = 0; b < buckets; ++b) {
+				const std::size_t c = offsets[b];
+				offsets[b] = sum;
+				sum += c;
+			}
+
+			for(std::size_t i = 0; i < n; ++i) {
+				dst[offsets[(radix_key(src[i]) >> shift) & 0xff]++] = std::move(src[i]);
+			}
+			std::swap(src, dst);
+		}
+
+		// an odd number of passes leaves the result in the buffer
+		if(src != items) {
+			std::move(src, src + n, items);
+		}
+	}
+
+	/*
+	 * As above, over blocks of items sorted by their own threads. Blocks
+	 * count each pass separately, since the previous pass reordered them,
+	 * and passes over bytes which are the same in every key are found from
+	 * the AND and OR of all keys.
+	 */
+	template <typename Key, typename Item>
+	void radix_sort_items(const exec::policy& policy, Item* items, std::size_t n)
+	{
+		constexpr unsigned int passes = sizeof(Key);
+		constexpr std::size_t buckets = 256;
+		// smaller blocks spend more time on counts than on keys
+		constexpr std::size_t min_block = 65536;
+
+		const std::size_t blocks = std::min<std::size_t>(4 * exec::threads(policy), n / min_block);
+		if(blocks < 2) {
+			radix_sort_items<Key>(items, n);
+			return;
+		}
+		const std::size_t block = (n + blocks - 1) / blocks;
+		const exec::policy each = policy.with_chunk_size(1);
+
+		using bits = std::pair<Key, Key>;
+		const bits all = exec::reduce(each, blocks, bits(Key(~Key(0)), Key(0)), [&] (std::size_t b, std::size_t) {
+			bits out(Key(~Key(0)), Key(0));
+			for(std::size_t i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+				out.first &= radix_key(items[i]);
+				out.second |= radix_key(items[i]);
+			}
+			return out;
+		}, [] (const bits& x, const bits& y) {
+			return bits(x.first & y.first, x.second | y.second);
+		});
+		const Key differ = all.first ^ all.second;
+
+		std::vector<std::size_t> offsets(blocks * buckets);
+		std::vector<Item> buf(n);
+		Item* src = items;
+		Item* dst = buf.data();
+
+		for(unsigned int p = 0; p < passes; ++p) {
+			const unsigned int shift = p * 8;
+			if(((differ >> shift) & 0xff) == 0) {
+				continue;
+			}
+
+			exec::for_each_chunk(each, blocks, [&] (std::size_t b, std::size_t) {
+				std::size_t* counts = offsets.data() + b * buckets;
+				std::fill(counts, counts + buckets, std::size_t(0));
+				for(std::size_t i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+					++counts[(radix_key(src[i]) >> shift) & 0xff];
+				}
+			});
+
+			// within each bucket, earlier blocks go first
+			std::size_t sum = 0;
+			for(std::size_t d = 0; d < buckets; ++d) {
+				for(std::size_t b = 0; b < blocks; ++b) {
+					const std::size_t c = offsets[b * buckets + d];
+					offsets[b * buckets + d] = sum;
+					sum += c;
+				}
+			}
+
+			exec::for_each_chunk(each, blocks, [&] (std::size_t b, std::size_t) {
+				std::size_t* next = offsets.data() + b * buckets;
+				for(std::size_t i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+					dst[next[(radix_key(src[i]) >> shift) & 0xff]++] = std::move(src[i]);
+				}
+			});
+			std::swap(src, dst);
+		}
+
+		if(src != items) {
+			exec::for_each_chunk(policy, n, [&] (std::size_t begin, std::size_t end) {
+				std::move(src + begin, src + end, items + begin);
+			});
+		}
+	}
+
+} // namespace detail
+
+/**
+ * \fn radix_sort
+ * \brief sort unsigned integer keys, moving values along with them
+ *
+ * The sort is stable. values may be null to sort only the keys. This
+ * allocates buffers twice as large as the input.
+ */
+template <typename Key, typename Value>
+void radix_sort(Key* keys, Value* values, std::size_t n)
+{
+	static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value, "Keys must be unsigned integers");
+
+	if(n < 2) {
+		return;
+	}
+
+	if(values == nullptr) {
+		detail::radix_sort_items<Key>(keys, n);
+		return;
+	}
+
+	using item = detail::radix_item<Key, Value>;
+	std::vector<item> items(n);
+	for(std::size_t i = 0; i < n; ++i) {
+		items[i].key = keys[i];
+		items[i].value = std::move(values[i]);
+	}
+	detail::radix_sort_items<Key>(items.data(), n);
+	for(std::size_t i = 0; i < n; ++i) {
+		keys[i] = items[i].key;
+		values[i] = std::move(items[i].value);
+	}
+}
+
+template <typename Key>
+void radix_sort(Key* keys, std::size_t n)
+{
+	radix_sort(keys, static_cast<Key*>(nullptr), n);
+}
+
+template <typename Key, typename Value>
+void radix_sort(const exec::policy& policy, Key* keys, Value* values, std::size_t n)
+{
+	static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value, "Keys must be unsigned integers");
+
+	if(n < 2) {
+		return;
+	}
+
+	if(values == nullptr) {
+		detail::radix_sort_items<Key>(policy, keys, n);
+		return;
+	}
+
+	using item = detail::radix_item<Key, Value>;
+	std::vector<item> items(n);
+	exec::for_each_chunk(policy, n, [&] (std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i) {
+			items[i].key = keys[i];
+			items[i].value = std::move(values[i]);
+		}
+	});
+	detail::radix_sort_items<Key>(policy, items.data(), n);
+	exec::for_each_chunk(policy, n, [&] (std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i) {
+			keys[i] = items[i].key;
+			values[i] = std::move(items[i].value);
+		}
+	});
+}
+
+template <typename Key>
+void radix_sort(const exec::policy& policy, Key* keys, std::size_t n)
+{
+	radix_sort(policy, keys, static_cast<Key*>(nullptr), n);
+}
+
+// }}}
+// reordering {{{
+
+/**
+ * \fn permute
+ * \brief reorder elements, so element i becomes the old element order[i]
+ *
+ * order must be a permutation of [0, n), as returned by spatial_order.
+ */
+template <typename T>
+void permute(T* data, const std::vector<std::uint32_t>& order)
+{
+	std::vector<T> moved;
+	moved.reserve(order.size());
+	for(std::uint32_t idx : order) {
+		moved.push_back(std::move(data[idx]));
+	}
+	std::move(moved.begin(), moved.end(), data);
+}
+
+template <typename T, unsigned int N>
+void permute(vector_array<T, N>& arr, const std::vector<std::uint32_t>& order)
+{
+	permute(exec::seq, arr, order);
+}
+
+template <typename T>
+void permute(const exec::policy& policy, T* data, const std::vector<std::uint32_t>& order)
+{
+	std::vector<T> moved(order.size());
+	exec::for_each_chunk(policy, order.size(), [&] (std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; ++i) {
+			moved[i] = std::move(data[order[i]]);
+		}
+	});
+	exec::for_each_chunk(policy, order.size(), [&] (std::size_t begin, std::size_t end) {
+		std::move(moved.begin() + begin, moved.begin() + end, data + begin);
+	});
+}
+
+template <typename T, unsigned int N>
+void permute(const exec::policy& policy, vector_array<T, N>& arr, const std::vector<std::uint32_t>& order)
+{
+	assert(order.size() == arr.size());
+
+	// a lane at a time, so each pass reads one lane and writes another
+	std::vector<T> lane(order.size());
+	for(unsigned int k = 0; k < N; ++k) {
+		T* const data = arr.lane(k);
+		exec::for_each_chunk(policy, order.size(), [&] (std::size_t begin, std::size_t end) {
+			for(std::size_t i = begin; i < end; ++i) {
+				lane[i] = data[order[i]];
+			}
+		});
+		exec::for_each_chunk(policy, order.size(), [&] (std::size_t begin, std::size_t end) {
+			std::copy(lane.begin() + begin, lane.begin() + end, data + begin);
+		});
+	}
+}
+
+// }}}
+// spatial order {{{
+
+/**
+ * \fn spatial_order
+ * \brief order of points along a space-filling curve
+ *
+ * points[order[0]], points[order[1]], ... follow the curve through the
+ * bounding box of the points. points can be anything curve_keys takes.
+ */
+template <typename Range>
+std::vector<std::uint32_t> spatial_order(const exec::policy& policy, const Range& points, curve kind = curve::morton)
+{
+	using V = typename Range::value_type;
+	using T = typename V::value_type;
+	constexpr unsigned int N = V::dimensions;
+
+	const std::size_t n = points.size();
+	assert(n <= std::numeric_limits<std::uint32_t>::max());
+
+	std::vector<std::uint32_t> order(n);
+	if(n == 0) {
+		return order;
+	}
+
+	using box = std::pair<V, V>;
+	const box bounds = exec::reduce(policy, points, box(points[0], points[0]), [&] (std::size_t begin, std::size_t end) {
+		V lo = points[begin];
+		V hi = points[begin];
+		for(std::size_t i = begin + 1; i < end; ++i) {
+			for(unsigned int k = 0; k < N; ++k) {
+				const T c = points[i][k];
+				lo[k] = c < lo[k] ? c : lo[k];
+				hi[k] = hi[k] < c ? c : hi[k];
+			}
+		}
+		return box(lo, hi);
+	}, [] (const box& a, const box& b) {
+		box out = a;
+		for(unsigned int k = 0; k < N; ++k) {
+			out.first[k] = b.first[k] < out.first[k] ? b.first[k] : out.first[k];
+			out.second[k] = out.second[k] < b.second[k] ? b.second[k] : out.second[k];
+		}
+		return out;
+	});
+
+	std::vector<std::uint64_t> keys(n);
+	const detail::curve_grid<N> grid(bounds.first, bounds.second);
+	exec::for_each_chunk(policy, points, [&] (std::size_t begin, std::size_t end) {
+		detail::curve_keys(points, grid, keys.data(), kind, begin, end);
+		for(std::size_t i = begin; i < end; ++i) {
+			order[i] = static_cast<std::uint32_t>(i);
+		}
+	});
+	radix_sort(policy, keys.data(), order.data(), n);
+	return order;
+}
+
+template <typename Range>
+std::vector<std::uint32_t> spatial_order(const Range& points, curve kind = curve::morton)
+{
+	return spatial_order(exec::seq, points, kind);
+}
+
+/**
+ * \fn spatial_sort
+ * \brief reorder points along a space-filling curve
+ *
+ * Returns the order, as for spatial_order.
+ */
+template <typename T, unsigned int N>
+std::vector<std::uint32_t> spatial_sort(const exec::policy& policy, vector_array<T, N>& points, curve kind = curve::morton)
+{
+	std::vector<std::uint32_t> order = spatial_order(policy, points, kind);
+	permute(policy, points, order);
+	return order;
+}
+
+template <typename T, unsigned int N, typename Alloc>
+std::vector<std::uint32_t> spatial_sort(const exec::policy& policy, std::vector<vector<T, N>, Alloc>& points,
+	curve kind = curve::morton)
+{
+	std::vector<std::uint32_t> order = spatial_order(policy, points, kind);
+	permute(policy, points.data(), order);
+	return order;
+}
+
+template <typename T, unsigned int N>
+std::vector<std::uint32_t> spatial_sort(vector_array<T, N>& points, curve kind = curve::morton)
+{
+	return spatial_sort(exec::seq, points, kind);
+}
+
+template <typename T, unsigned int N, typename Alloc>
+std::vector<std::uint32_t> spatial_sort(std::vector<vector<T, N>, Alloc>& points, curve kind = curve::morton)
+{
+	return spatial_sort(exec::seq, points, kind);
+}
+
+// }}}
+
+} // namespace velm
@@ -0,0 +1,606 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "exec.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+
+/**
+ * \file spatial_grid.hpp
+ * \brief fixed-radius neighbour search over particles
+ *
+ * velm::spatial_grid<T, N> bins 2 or 3 dimensional positions into cells as
+ * large as the search radius, so all neighbours of a particle are in the 3^N
+ * cells around it:
+ *
+ *      velm::spatial_grid<float, 3> grid(h);
+ *      grid.build(positions);
+ *      grid.for_each_pair([&] (std::uint32_t i, std::uint32_t j, float d2) {
+ *          // particles i and j are within h of each other
+ *      });
+ *
+ * Cells are unbounded, and are mapped to buckets by the low bits of the
+ * Morton key of their coordinates (see curve.hpp), with about one bucket per
+ * particle. Particles are sorted by bucket with a counting sort (one pass to
+ * count, one to scatter), into flat arrays of indices and positions, so
+ * there are no containers per cell. Since nearby cells have nearby Morton
+ * keys, this order is also spatially coherent: queries in it touch memory
+ * mostly in sequence, and order() can be used to reorder particle data to
+ * match (see permute in sort.hpp).
+ *
+ * Distant cells can share a bucket, which only costs extra distance tests.
+ * Positions must be finite.
+ *
+ * build, update, for_each_pair and pairs also take an execution policy (see
+ * exec.hpp). In parallel, the counting sort is split by ranges of buckets:
+ * particles are first grouped by range, with a count per block of particles
+ * as in radix_sort (see sort.hpp), and then each range is counted and
+ * scattered by one thread. The grid is the same as after a sequential build.
+ * for_each_pair then calls f from several threads at once, while pairs gives
+ * the same pairs in the same order as a sequential call.
+ */
+
+namespace velm {
+
+/**
+ * \struct spatial_grid
+ * \brief uniform grid of buckets for fixed-radius neighbour queries
+ */
+template <typename T, unsigned int N>
+struct spatial_grid
+{
+	static_assert(std::is_floating_point<T>::value, "spatial_grid needs floating point components");
+	static_assert(N == 2 || N == 3, "spatial_grid supports 2 and 3 dimensions");
+
+public: // statics
+
+	static constexpr auto dimensions = N;
+	// cells around (and including) the cell of a particle
+	static constexpr unsigned int stencil = N == 2 ? 9 : 27;
+
+	using value_type = vector<T, N>;
+	using component_type = T;
+	using size_type = std::size_t;
+	using cell_type = vector<std::uint32_t, N>;
+
+private:
+
+	T search_radius = 0;
+	T inv_cell = 0;
+	std::uint32_t mask = 0;
+
+	// bucket b holds the sorted particles [starts[b], starts[b + 1])
+	std::vector<std::uint32_t> starts;
+	// particle at each sorted position, and its position
+	std::vector<std::uint32_t> sorted_index;
+	std::vector<value_type> sorted_position;
+
+	// bucket and sorted position of each particle
+	std::vector<std::uint32_t> bucket;
+	std::vector<std::uint32_t> slot;
+
+	// buffers of update
+	struct move
+	{
+		std::uint32_t index;
+		std::uint32_t from;
+		std::uint32_t to;
+	};
+	std::vector<move> moved;
+	std::vector<std::vector<move>> chunk_moved;
+	std::vector<std::uint32_t> moved_from;
+	std::vector<std::uint32_t> merged_index;
+	std::vector<value_type> merged_position;
+	std::vector<std::uint32_t> merged_starts;
+
+	cell_type cell_of(const value_type& p) const
+	{
+		// beyond 2^30 cells, particles share the outermost cells
+		const T limit = T(1 << 30);
+		cell_type c;
+		for(unsigned int k = 0; k < N; ++k) {
+			T x = p[k] * inv_cell;
+			x = x < -limit ? -limit : x;
+			x = limit < x ? limit : x;
+			const std::int32_t t = static_cast<std::int32_t>(x);
+			// negative cells wrap around, consistently for neighbours
+			c[k] = static_cast<std::uint32_t>(t - (x < static_cast<T>(t)));
+		}
+		return c;
+	}
+
+	// the low bits of x, spaced out to every Nth bit of 32
+	static std::uint32_t spread(std::uint32_t x)
+	{
+		if(N == 2) {
+			x &= 0x0000ffff;
+			x = (x | (x << 8)) & 0x00ff00ff;
+			x = (x | (x << 4)) & 0x0f0f0f0f;
+			x = (x | (x << 2)) & 0x33333333;
+			x = (x | (x << 1)) & 0x55555555;
+		} else {
+			x &= 0x000003ff;
+			x = (x | (x << 16)) & 0x030000ff;
+			x = (x | (x << 8)) & 0x0300f00f;
+			x = (x | (x << 4)) & 0x030c30c3;
+			x = (x | (x << 2)) & 0x09249249;
+		}
+		return x;
+	}
+
+	// the low 32 bits of the Morton key, which is all that buckets use
+	std::uint32_t bucket_of(const cell_type& c) const
+	{
+		std::uint32_t key = 0;
+		for(unsigned int k = 0; k < N; ++k) {
+			key |= spread(c[k]) << k;
+		}
+		return key & mask;
+	}
+
+	// buckets of the stencil around c, without repeats
+	unsigned int stencil_buckets(const cell_type& c, std::uint32_t (&out)[stencil]) const
+	{
+		unsigned int n = 0;
+		for(unsigned int s = 0; s < stencil; ++s) {
+			cell_type nc = c;
+			unsigned int digits = s;
+			for(unsigned int k = 0; k < N; ++k) {
+				nc[k] += static_cast<std::uint32_t>(digits % 3) - 1;
+				digits /= 3;
+			}
+			const std::uint32_t b = this->bucket_of(nc);
+			if(std::find(out, out + n, b) == out + n) {
+				out[n++] = b;
+			}
+		}
+		return n;
+	}
+
+	// counting sort of the particles by bucket, which must be filled in
+	template <typename Range>
+	void sort_buckets(const Range& positions)
+	{
+		const size_type n = bucket.size();
+		starts.assign(size_type(mask) + 2, 0);
+		for(size_type i = 0; i < n; ++i) {
+			++starts[bucket[i] + 1];
+		}
+		for(size_type b = 0; b <= mask; ++b) {
+			starts[b + 1] += starts[b];
+		}
+
+		// starts[b] is advanced while scattering, and restored after
+		sorted_index.resize(n);
+		sorted_position.resize(n);
+		slot.resize(n);
+		for(size_type i = 0; i < n; ++i) {
+			const std::uint32_t s = starts[bucket[i]]++;
+			sorted_index[s] = static_cast<std::uint32_t>(i);
+			sorted_position[s] = positions[i];
+			slot[i] = s;
+		}
+		for(size_type b = mask + 1; b > 0; --b) {
+			starts[b] = starts[b - 1];
+		}
+		starts[0] = 0;
+	}
+
+	/*
+	 * In parallel, with a count per block of particles for each range of
+	 * buckets, rather than for each of the (about n) buckets. Within a
+	 * bucket, particles stay in the order of their index, as above.
+	 */
+	template <typename Range>
+	void sort_buckets(const exec::policy& policy, const Range& positions)
+	{
+		const size_type n = bucket.size();
+		// smaller blocks spend more time on counts than on particles
+		constexpr size_type min_block = 16384;
+
+		const size_type blocks = std::min<size_type>(4 * exec::threads(policy), n / min_block);
+		if(!policy.parallel || blocks < 2) {
+			this->sort_buckets(positions);
+			return;
+		}
+		const size_type block = (n + blocks - 1) / blocks;
+		const exec::policy each = policy.with_chunk_size(1);
+
+		// ranges are the high bits of the bucket, several per thread
+		unsigned int shift = 0;
+		while((size_type(mask) >> shift) != 0) {
+			++shift;
+		}
+		size_type ranges = 1;
+		while(ranges < 16 * exec::threads(policy) && shift > 0) {
+			ranges *= 2;
+			--shift;
+		}
+
+		std::vector<size_type> offsets(blocks * ranges);
+		exec::for_each_chunk(each, blocks, [&] (std::size_t b, std::size_t) {
+			size_type* counts = offsets.data() + b * ranges;
+			std::fill(counts, counts + ranges, size_type(0));
+			for(size_type i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+				++counts[bucket[i] >> shift];
+			}
+		});
+
+		// within each range, earlier blocks go first
+		std::vector<size_type> range_starts(ranges + 1);
+		size_type sum = 0;
+		for(size_type r = 0; r < ranges; ++r) {
+			range_starts[r] = sum;
+			for(size_type b = 0; b < blocks; ++b) {
+				const size_type c = offsets[b * ranges + r];
+				offsets[b * ranges + r] = sum;
+				sum += c;
+			}
+		}
+		range_starts[ranges] = n;
+
+		// merged_index is only used by update, so it holds the particles grouped by range
+		merged_index.resize(n);
+		exec::for_each_chunk(each, blocks, [&] (std::size_t b, std::size_t) {
+			size_type* next = offsets.data() + b * ranges;
+			for(size_type i = b * block; i < std::min(n, (b + 1) * block); ++i) {
+				merged_index[next[bucket[i] >> shift]++] = static_cast<std::uint32_t>(i);
+			}
+		});
+
+		starts.resize(size_type(mask) + 2);
+		sorted_index.resize(n);
+		sorted_position.resize(n);
+		slot.resize(n);
+		exec::for_each_chunk(each, ranges, [&] (std::size_t r, std::size_t) {
+			const size_type first = r << shift;
+			const size_type last = (r + 1) << shift;
+			std::fill(starts.begin() + first, starts.begin() + last, std::uint32_t(0));
+			for(size_type k = range_starts[r]; k < range_starts[r + 1]; ++k) {
+				++starts[bucket[merged_index[k]]];
+			}
+			std::uint32_t at = static_cast<std::uint32_t>(range_starts[r]);
+			for(size_type b = first; b < last; ++b) {
+				const std::uint32_t c = starts[b];
+				starts[b] = at;
+				at += c;
+			}
+
+			// starts[b] is advanced while scattering, and restored after
+			for(size_type k = range_starts[r]; k < range_starts[r + 1]; ++k) {
+				const std::uint32_t i = merged_index[k];
+				const std::uint32_t s = starts[bucket[i]]++;
+				sorted_index[s] = i;
+				sorted_position[s] = positions[i];
+				slot[i] = s;
+			}
+			for(size_type b = last - 1; b > first; --b) {
+				starts[b] = starts[b - 1];
+			}
+			starts[first] = static_cast<std::uint32_t>(range_starts[r]);
+		});
+		starts[size_type(mask) + 1] = static_cast<std::uint32_t>(n);
+	}
+
+	// for_each_pair over the particles at sorted positions [begin, end)
+	template <typename F>
+	void pairs_from(size_type begin, size_type end, F& f) const
+	{
+		const T r2 = search_radius * search_radius;
+
+		std::uint32_t buckets[stencil];
+		unsigned int nb = 0;
+		cell_type last_cell;
+		for(size_type s = begin; s < end; ++s) {
+			const value_type p = sorted_position[s];
+			const cell_type c = this->cell_of(p);
+			// neighbouring particles are usually in the same cell
+			if(s == begin || any(notEqual(c, last_cell))) {
+				nb = this->stencil_buckets(c, buckets);
+				last_cell = c;
+			}
+
+			for(unsigned int b = 0; b < nb; ++b) {
+				const std::uint32_t last = starts[buckets[b] + 1];
+				for(std::uint32_t t = std::max(starts[buckets[b]], static_cast<std::uint32_t>(s + 1)); t < last; ++t) {
+					const value_type d = sorted_position[t] - p;
+					const T d2 = dot(d, d);
+					if(d2 <= r2) {
+						f(sorted_index[s], sorted_index[t], d2);
+					}
+				}
+			}
+		}
+	}
+
+public: // methods
+
+	spatial_grid() = default;
+
+	/*
+	 * A grid for finding the particles within radius of each other. radius
+	 * must be positive.
+	 */
+	explicit spatial_grid(T radius)
+		: search_radius(radius), inv_cell(T(1) / radius)
+	{
+		assert(radius > 0);
+	}
+
+	T radius() const
+	{
+		return search_radius;
+	}
+
+	size_type size() const
+	{
+		return sorted_index.size();
+	}
+
+	bool empty() const
+	{
+		return sorted_index.empty();
+	}
+
+	/**
+	 * \fn order
+	 * \brief the particles in the order of the grid
+	 *
+	 * Particle data stored in this order is accessed in sequence by the
+	 * queries, e.g. after velm::permute(data, grid.order()).
+	 */
+	const std::vector<std::uint32_t>& order() const
+	{
+		return sorted_index;
+	}
+
+	/**
+	 * \fn build
+	 * \brief bin a range of positions
+	 *
+	 * positions can be a vector_array, a strided_view or a std::vector of
+	 * vectors. The grid keeps a copy of the positions.
+	 */
+	template <typename Range>
+	void build(const Range& positions)
+	{
+		this->build(exec::seq, positions);
+	}
+
+	template <typename Range>
+	void build(const exec::policy& policy, const Range& positions)
+	{
+		const size_type n = positions.size();
+		assert(n < std::numeric_limits<std::uint32_t>::max());
+
+		// up to the bits of bucket_of
+		const size_type max_buckets = size_type(1) << (N == 2 ? 31 : 30);
+		size_type buckets = 16;
+		while(buckets < n && buckets < max_buckets) {
+			buckets *= 2;
+		}
+		mask = static_cast<std::uint32_t>(buckets - 1);
+
+		bucket.resize(n);
+		exec::for_each_chunk(policy, positions, [&] (std::size_t begin, std::size_t end) {
+			for(size_type i = begin; i < end; ++i) {
+				bucket[i] = this->bucket_of(this->cell_of(positions[i]));
+			}
+		});
+		this->sort_buckets(policy, positions);
+	}
+
+	/**
+	 * \fn update
+	 * \brief move the particles to new positions
+	 *
+	 * positions holds the particles given to build, in the same order (if
+	 * their number changed, this is a full build). Particles which stay in
+	 * their bucket are updated in place, and the few which move are merged
+	 * into the order with sequential copies, rather than sorting all
+	 * particles again. If many particles moved (an eighth or more), this
+	 * falls back to a full build.
+	 */
+	template <typename Range>
+	void update(const Range& positions)
+	{
+		this->update(exec::seq, positions);
+	}
+
+	template <typename Range>
+	void update(const exec::policy& policy, const Range& positions)
+	{
+		const size_type n = positions.size();
+		if(n != this->size()) {
+			this->build(policy, positions);
+			return;
+		}
+
+		// each chunk lists its own moves, which are then joined in order
+		const std::uint32_t removed = std::numeric_limits<std::uint32_t>::max();
+		const size_type chunk = exec::chunk_size(policy, n, sizeof(value_type) + 2 * sizeof(std::uint32_t));
+		chunk_moved.resize((n + chunk - 1) / chunk);
+		exec::for_each_chunk(policy.with_chunk_size(chunk), n, [&] (std::size_t begin, std::size_t end) {
+			std::vector<move>& local = chunk_moved[begin / chunk];
+			local.clear();
+			for(size_type i = begin; i < end; ++i) {
+				const value_type p = positions[i];
+				const std::uint32_t b = this->bucket_of(this->cell_of(p));
+				if(b == bucket[i]) {
+					sorted_position[slot[i]] = p;
+				} else {
+					local.push_back({static_cast<std::uint32_t>(i), bucket[i], b});
+					sorted_index[slot[i]] = removed;
+					bucket[i] = b;
+				}
+			}
+		});
+		moved.clear();
+		for(const std::vector<move>& local : chunk_moved) {
+			moved.insert(moved.end(), local.begin(), local.end());
+		}
+		if(moved.empty()) {
+			return;
+		}
+		if(moved.size() >= n / 8) {
+			this->sort_buckets(policy, positions);
+			return;
+		}
+
+		// the particles which stayed are still in bucket order, so merge
+		std::sort(moved.begin(), moved.end(), [] (const move& x, const move& y) {
+			return x.to < y.to;
+		});
+		moved_from.resize(moved.size());
+		for(size_type k = 0; k < moved.size(); ++k) {
+			moved_from[k] = moved[k].from;
+		}
+		std::sort(moved_from.begin(), moved_from.end());
+
+		// each range of buckets is merged separately, from where its particles now start
+		merged_index.resize(n);
+		merged_position.resize(n);
+		merged_starts.resize(size_type(mask) + 2);
+		exec::for_each_chunk(policy, size_type(mask) + 1, [&] (std::size_t first, std::size_t last) {
+			const auto into = std::lower_bound(moved.begin(), moved.end(), first, [] (const move& m, std::size_t b) {
+				return m.to < b;
+			});
+			const auto out_of = std::lower_bound(moved_from.begin(), moved_from.end(), first);
+			size_type next = static_cast<size_type>(into - moved.begin());
+			size_type out = starts[first] + next - static_cast<size_type>(out_of - moved_from.begin());
+			for(size_type b = first; b < last; ++b) {
+				merged_starts[b] = static_cast<std::uint32_t>(out);
+				for(; next < moved.size() && moved[next].to == b; ++next, ++out) {
+					const std::uint32_t i = moved[next].index;
+					merged_index[out] = i;
+					merged_position[out] = positions[i];
+					slot[i] = static_cast<std::uint32_t>(out);
+				}
+				for(std::uint32_t s = starts[b]; s < starts[b + 1]; ++s) {
+					const std::uint32_t i = sorted_index[s];
+					if(i != removed) {
+						merged_index[out] = i;
+						merged_position[out] = sorted_position[s];
+						// particles only shift between the moved ones
+						if(out != s) {
+							slot[i] = static_cast<std::uint32_t>(out);
+						}
+						++out;
+					}
+				}
+			}
+		});
+		merged_starts[size_type(mask) + 1] = static_cast<std::uint32_t>(n);
+		sorted_index.swap(merged_index);
+		sorted_position.swap(merged_position);
+		starts.swap(merged_starts);
+	}
+
+	/**
+	 * \fn for_each_neighbour
+	 * \brief call f(index, distance2) for the particles within radius of p
+	 *
+	 * This includes a particle at p itself, if p is one of the positions.
+	 */
+	template <typename F>
+	void for_each_neighbour(const value_type& p, F&& f) const
+	{
+		if(this->empty()) {
+			return;
+		}
+		const T r2 = search_radius * search_radius;
+		std::uint32_t buckets[stencil];
+		const unsigned int nb = this->stencil_buckets(this->cell_of(p), buckets);
+		for(unsigned int b = 0; b < nb; ++b) {
+			for(std::uint32_t t = starts[buckets[b]]; t < starts[buckets[b] + 1]; ++t) {
+				const value_type d = sorted_position[t] - p;
+				const T d2 = dot(d, d);
+				if(d2 <= r2) {
+					f(sorted_index[t], d2);
+				}
+			}
+		}
+	}
+
+	/**
+	 * \fn for_each_pair
+	 * \brief call f(i, j, distance2) for each pair of particles within radius
+	 *
+	 * Each unordered pair is passed once, with i != j, in the order of the
+	 * grid.
+	 */
+	template <typename F>
+	void for_each_pair(F&& f) const
+	{
+		this->pairs_from(0, this->size(), f);
+	}
+
+	/*
+	 * In parallel, f is called from several threads at once, with the pairs
+	 * of each particle from one thread.
+	 */
+	template <typename F>
+	void for_each_pair(const exec::policy& policy, F&& f) const
+	{
+		exec::for_each_chunk(policy, sorted_position, [&] (std::size_t begin, std::size_t end) {
+			this->pairs_from(begin, end, f);
+		});
+	}
+
+	/**
+	 * \fn pairs
+	 * \brief all pairs of particles within radius, as for for_each_pair
+	 *
+	 * out is cleared first, so it can be reused between steps.
+	 */
+	void pairs(std::vector<std::pair<std::uint32_t, std::uint32_t>>& out) const
+	{
+		out.clear();
+		this->for_each_pair([&] (std::uint32_t i, std::uint32_t j, T /* distance2 */) {
+			out.emplace_back(i, j);
+		});
+	}
+
+	void pairs(const exec::policy& policy, std::vector<std::pair<std::uint32_t, std::uint32_t>>& out) const
+	{
+		using pair_list = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+		out.clear();
+		const size_type n = this->size();
+		if(!policy.parallel || n == 0) {
+			this->pairs(out);
+			return;
+		}
+
+		const size_type chunk = exec::chunk_size(policy, n, sizeof(value_type));
+		std::vector<pair_list> parts((n + chunk - 1) / chunk);
+		exec::for_each_chunk(policy.with_chunk_size(chunk), n, [&] (std::size_t begin, std::size_t end) {
+			pair_list& local = parts[begin / chunk];
+			auto add = [&] (std::uint32_t i, std::uint32_t j, T /* distance2 */) {
+				local.emplace_back(i, j);
+			};
+			this->pairs_from(begin, end, add);
+		});
+
+		size_type total = 0;
+		for(const pair_list& local : parts) {
+			total += local.size();
+		}
+		out.reserve(total);
+		for(const pair_list& local : parts) {
+			out.insert(out.end(), local.begin(), local.end());
+		}
+	}
+};
+
+} // namespace velm
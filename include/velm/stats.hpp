@@ -0,0 +1,532 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+#include "funcs.hpp"
+#include "matrix.hpp"
+#include "vector_array.hpp"
+#include "batch.hpp"
+#include "exec.hpp"
+
+/**
+ * \file stats.hpp
+ * \brief bounds, centroid, covariance and principal axes of point sets
+ *
+ * velm::stats finds the bounding box, the centroid and the covariance of a
+ * range of points (a vector_array, a std::vector of vectors or a
+ * strided_view) together, in a single pass:
+ *
+ *      velm::point_stats<float, 3> s = velm::stats(velm::exec::par, positions);
+ *      velm::vector<float, 3> c = s.centroid();
+ *      velm::principal_axes<float, 3> axes = velm::pca(s.covariance());
+ *      // axes.axes[0] is the direction the points are most spread along
+ *
+ * point_stats holds the number of points seen, their bounds, their mean and
+ * the sum of the outer products of their deviations from the mean (M2 in
+ * Welford's algorithm). Points are added one at a time with Welford's
+ * update, and two point_stats are merged with the pairwise update of Chan et
+ * al., so statistics of streamed or chunked input can be gathered separately
+ * and combined later, without the cancellation of summing squares directly.
+ *
+ * add_points (and so stats) works through blocks of 1024 points, summing
+ * the deviations of the points from the first point of the block and their
+ * products into batch::width<T> lanes, which is a plain vectorisable loop.
+ * The blocks are then merged in pairs with Chan's update, so for float
+ * points, stats is also more accurate than adding millions of points one at
+ * a time. Bounds follow velm::min and velm::max. Points must not be NaN.
+ *
+ * With an execution policy (see exec.hpp), chunks of points are reduced by
+ * separate threads and merged in a fixed tree, so with_deterministic() gives
+ * the same result for any number of threads, on any machine.
+ */
+
+namespace velm {
+
+namespace detail {
+
+	template <typename Range, typename T, unsigned int N, typename = void>
+	struct stats_flat
+		: std::false_type
+	{
+	};
+
+	template <typename Range, typename T, unsigned int N>
+	struct stats_flat<Range, T, N, std::enable_if_t<batch::detail::flat_range<const Range>::value>>
+		: std::is_same<std::remove_const_t<batch::detail::range_element<const Range>>, vector<T, N>>
+	{
+	};
+
+	// reads the components of points [idx, idx + W), a row per component
+	template <typename Range, typename T, unsigned int N, bool Flat = stats_flat<Range, T, N>::value>
+	struct stats_reader
+	{
+		const Range& points;
+
+		explicit stats_reader(const Range& r)
+			: points(r)
+		{
+		}
+
+		template <unsigned int W>
+		void read(std::size_t idx, T (&x)[N][W]) const
+		{
+			VELM_UNROLL
+			for(unsigned int j = 0; j < W; ++j) {
+				const vector<T, N> p = points[idx + j];
+				for(unsigned int k = 0; k < N; ++k) {
+					x[k][j] = p[k];
+				}
+			}
+		}
+	};
+
+	// contiguous vectors are read as an array of components
+	template <typename Range, typename T, unsigned int N>
+	struct stats_reader<Range, T, N, true>
+	{
+		const T* components;
+
+		explicit stats_reader(const Range& r)
+			: components(batch::detail::flat_of<Range>::components(r.data()))
+		{
+		}
+
+		template <unsigned int W>
+		void read(std::size_t idx, T (&x)[N][W]) const
+		{
+			const T* src = components + idx * N;
+			VELM_UNROLL
+			for(unsigned int j = 0; j < W; ++j) {
+				for(unsigned int k = 0; k < N; ++k) {
+					x[k][j] = src[j * N + k];
+				}
+			}
+		}
+	};
+
+	// lanes of a vector_array are loaded directly
+	template <typename T, unsigned int N>
+	struct stats_reader<vector_array<T, N>, T, N, false>
+	{
+		const T* lanes[N];
+
+		explicit stats_reader(const vector_array<T, N>& r)
+		{
+			for(unsigned int k = 0; k < N; ++k) {
+				lanes[k] = r.lane(k);
+			}
+		}
+
+		template <unsigned int W>
+		void read(std::size_t idx, T (&x)[N][W]) const
+		{
+			VELM_UNROLL
+			for(unsigned int k = 0; k < N; ++k) {
+				for(unsigned int j = 0; j < W; ++j) {
+					x[k][j] = lanes[k][idx + j];
+				}
+			}
+		}
+	};
+
+} // namespace detail
+
+/**
+ * \struct point_stats
+ * \brief count, bounds, mean and covariance of a set of points
+ */
+template <typename T, unsigned int N>
+struct point_stats
+{
+	static_assert(std::is_floating_point<T>::value, "point_stats needs floating point components");
+
+public: // statics
+
+	static constexpr auto dimensions = N;
+	// points summed before each merge
+	static constexpr std::size_t block_size = 1024;
+
+	using value_type = vector<T, N>;
+	using matrix_type = matrix<T, N, N>;
+	using size_type = std::size_t;
+
+private:
+
+	size_type n = 0;
+	value_type lo = value_type(std::numeric_limits<T>::infinity());
+	value_type hi = value_type(-std::numeric_limits<T>::infinity());
+	value_type mean = value_type(T(0));
+	matrix_type m2;
+
+	static constexpr unsigned int products = N * (N + 1) / 2;
+
+	matrix_type scaled_m2(T s) const
+	{
+		matrix_type out;
+		for(unsigned int a = 0; a < N; ++a) {
+			out[a] = m2[a] * s;
+		}
+		return out;
+	}
+
+	/*
+	 * Statistics of points [begin, end), which must not be empty. Each
+	 * accumulator is W wide, with point i going to lane i % W, so the
+	 * loop over the lanes is a SIMD instruction per accumulator, run for
+	 * the best instruction set of the CPU (see dispatch.hpp).
+	 */
+	template <typename Range>
+	static point_stats block(const Range& points, size_type begin, size_type end)
+	{
+		constexpr unsigned int W = batch::width<T>::value;
+
+		// deviations from the first point are small, and summed as they are
+		const value_type shift = points[begin];
+
+		point_stats out;
+		dispatch::invoke([&] {
+			T lo_w[N][W];
+			T hi_w[N][W];
+			T sum_w[N][W];
+			T prod_w[products][W];
+			for(unsigned int j = 0; j < W; ++j) {
+				for(unsigned int k = 0; k < N; ++k) {
+					lo_w[k][j] = shift[k];
+					hi_w[k][j] = shift[k];
+					sum_w[k][j] = T(0);
+				}
+				for(unsigned int q = 0; q < products; ++q) {
+					prod_w[q][j] = T(0);
+				}
+			}
+
+			const detail::stats_reader<Range, T, N> reader(points);
+			size_type i = begin;
+			for(; i + W <= end; i += W) {
+				T x[N][W];
+				reader.template read<W>(i, x);
+				for(unsigned int j = 0; j < W; ++j) {
+					T d[N];
+					VELM_UNROLL
+					for(unsigned int k = 0; k < N; ++k) {
+						lo_w[k][j] = min(lo_w[k][j], x[k][j]);
+						hi_w[k][j] = max(hi_w[k][j], x[k][j]);
+						d[k] = x[k][j] - shift[k];
+						sum_w[k][j] += d[k];
+					}
+					unsigned int q = 0;
+					VELM_UNROLL
+					for(unsigned int a = 0; a < N; ++a) {
+						VELM_UNROLL
+						for(unsigned int b = a; b < N; ++b) {
+							prod_w[q++][j] += d[a] * d[b];
+						}
+					}
+				}
+			}
+
+			// across the lanes, then the remaining points one at a time
+			value_type l = shift;
+			value_type h = shift;
+			value_type sum(T(0));
+			T prod[products] = {};
+			for(unsigned int j = 0; j < W; ++j) {
+				for(unsigned int k = 0; k < N; ++k) {
+					l[k] = min(l[k], lo_w[k][j]);
+					h[k] = max(h[k], hi_w[k][j]);
+					sum[k] += sum_w[k][j];
+				}
+				for(unsigned int q = 0; q < products; ++q) {
+					prod[q] += prod_w[q][j];
+				}
+			}
+			for(; i < end; ++i) {
+				const value_type x = points[i];
+				l = min(l, x);
+				h = max(h, x);
+				const value_type d = x - shift;
+				sum += d;
+				unsigned int q = 0;
+				for(unsigned int a = 0; a < N; ++a) {
+					for(unsigned int b = a; b < N; ++b) {
+						prod[q++] += d[a] * d[b];
+					}
+				}
+			}
+
+			out.n = end - begin;
+			out.lo = l;
+			out.hi = h;
+			const T count = static_cast<T>(out.n);
+			out.mean = shift + sum / count;
+			unsigned int q = 0;
+			for(unsigned int a = 0; a < N; ++a) {
+				for(unsigned int b = a; b < N; ++b) {
+					out.m2[a][b] = out.m2[b][a] = prod[q++] - sum[a] * sum[b] / count;
+				}
+			}
+		});
+		return out;
+	}
+
+	// the blocks of [begin, end) merged in pairs, so rounding errors grow with the log of their number
+	template <typename Range>
+	static point_stats blocks(const Range& points, size_type begin, size_type end)
+	{
+		if(end - begin <= block_size) {
+			return begin < end ? block(points, begin, end) : point_stats();
+		}
+		const size_type half = (end - begin + block_size) / (2 * block_size) * block_size;
+		point_stats out = blocks(points, begin, begin + half);
+		out.merge(blocks(points, begin + half, end));
+		return out;
+	}
+
+public: // methods
+
+	// no points
+	point_stats() = default;
+
+	/**
+	 * \fn add
+	 * \brief add a point, with Welford's update
+	 */
+	void add(const value_type& p)
+	{
+		++n;
+		lo = min(lo, p);
+		hi = max(hi, p);
+		const value_type before = p - mean;
+		mean += before / static_cast<T>(n);
+		const value_type after = p - mean;
+		for(unsigned int a = 0; a < N; ++a) {
+			for(unsigned int b = a; b < N; ++b) {
+				m2[a][b] += before[a] * after[b];
+				m2[b][a] = m2[a][b];
+			}
+		}
+	}
+
+	/**
+	 * \fn add_points
+	 * \brief add points [begin, end) of a range, or all of them
+	 *
+	 * This is much faster than adding the points one at a time, and more
+	 * accurate for many points, since blocks are merged in pairs.
+	 */
+	template <typename Range>
+	void add_points(const Range& points, size_type begin, size_type end)
+	{
+		this->merge(blocks(points, begin, end));
+	}
+
+	template <typename Range>
+	void add_points(const Range& points)
+	{
+		this->add_points(points, 0, points.size());
+	}
+
+	/**
+	 * \fn merge
+	 * \brief add the points of other, with Chan et al.'s update
+	 */
+	void merge(const point_stats& other)
+	{
+		if(other.n == 0) {
+			return;
+		}
+		if(n == 0) {
+			*this = other;
+			return;
+		}
+
+		const size_type total = n + other.n;
+		const value_type delta = other.mean - mean;
+		mean += delta * (static_cast<T>(other.n) / static_cast<T>(total));
+		const T weight = static_cast<T>(n) * static_cast<T>(other.n) / static_cast<T>(total);
+		for(unsigned int a = 0; a < N; ++a) {
+			for(unsigned int b = 0; b < N; ++b) {
+				m2[a][b] += other.m2[a][b] + delta[a] * delta[b] * weight;
+			}
+		}
+		lo = min(lo, other.lo);
+		hi = max(hi, other.hi);
+		n = total;
+	}
+
+	size_type count() const
+	{
+		return n;
+	}
+
+	bool empty() const
+	{
+		return n == 0;
+	}
+
+	// bounds, inverted (infinite) when empty
+	const value_type& lower() const
+	{
+		return lo;
+	}
+
+	const value_type& upper() const
+	{
+		return hi;
+	}
+
+	// the mean of the points, zero when empty
+	const value_type& centroid() const
+	{
+		return mean;
+	}
+
+	/**
+	 * \fn covariance
+	 * \brief covariance of the points, dividing by their number
+	 *
+	 * sample_covariance divides by one less, for an unbiased estimate of
+	 * the covariance of what the points were drawn from. Both are zero
+	 * without enough points.
+	 */
+	matrix_type covariance() const
+	{
+		return n == 0 ? matrix_type() : this->scaled_m2(T(1) / static_cast<T>(n));
+	}
+
+	matrix_type sample_covariance() const
+	{
+		return n < 2 ? matrix_type() : this->scaled_m2(T(1) / static_cast<T>(n - 1));
+	}
+};
+
+/**
+ * \fn stats
+ * \brief point_stats of a range of points
+ */
+template <typename Range>
+auto stats(const exec::policy& policy, const Range& points)
+{
+	using V = typename Range::value_type;
+	using result_type = point_stats<typename V::value_type, V::dimensions>;
+
+	// whole blocks per chunk, so the blocks do not depend on the chunks
+	const std::size_t blocks = (points.size() + result_type::block_size - 1) / result_type::block_size;
+	const std::size_t chunk = (exec::chunk_size(policy, points.size(), sizeof(V)) + result_type::block_size - 1) / result_type::block_size;
+	return exec::reduce(policy.with_chunk_size(chunk), blocks, result_type(), [&] (std::size_t begin, std::size_t end) {
+		result_type out;
+		out.add_points(points, begin * result_type::block_size, std::min(end * result_type::block_size, points.size()));
+		return out;
+	}, [] (result_type a, const result_type& b) {
+		a.merge(b);
+		return a;
+	});
+}
+
+template <typename Range>
+auto stats(const Range& points)
+{
+	return stats(exec::seq, points);
+}
+
+/**
+ * \struct principal_axes
+ * \brief eigenvalues and eigenvectors of a covariance matrix
+ *
+ * variances[k] is the variance along axes[k], a unit vector, with the
+ * largest first. The axes are orthogonal, and their signs are arbitrary.
+ */
+template <typename T, unsigned int N>
+struct principal_axes
+{
+	vector<T, N> variances;
+	matrix<T, N, N> axes;
+};
+
+/**
+ * \fn pca
+ * \brief principal axes of a covariance matrix
+ *
+ * The matrix must be symmetric, as from point_stats::covariance. This uses
+ * the cyclic Jacobi method, which is accurate for the small matrices here
+ * even when eigenvalues are close or repeated.
+ */
+template <typename T, unsigned int N>
+principal_axes<T, N> pca(const matrix<T, N, N>& covariance)
+{
+	matrix<T, N, N> a = covariance;
+	matrix<T, N, N> v = matrix<T, N, N>::identity();
+
+	// each sweep zeroes every off-diagonal element in turn
+	for(unsigned int sweep = 0; sweep < 32; ++sweep) {
+		T off = 0;
+		T diag = 0;
+		for(unsigned int p = 0; p < N; ++p) {
+			diag += a[p][p] * a[p][p];
+			for(unsigned int q = p + 1; q < N; ++q) {
+				off += a[p][q] * a[p][q];
+			}
+		}
+		if(!(off > diag * std::numeric_limits<T>::epsilon() * std::numeric_limits<T>::epsilon())) {
+			break;
+		}
+
+		for(unsigned int p = 0; p < N; ++p) {
+			for(unsigned int q = p + 1; q < N; ++q) {
+				if(a[p][q] == T(0)) {
+					continue;
+				}
+				// the rotation by (c, s) zeroes a[p][q] (see Numerical Recipes 11.1)
+				const T theta = (a[q][q] - a[p][p]) / (T(2) * a[p][q]);
+				const T t = (theta < T(0) ? T(-1) : T(1)) / (std::abs(theta) + std::sqrt(theta * theta + T(1)));
+				const T c = T(1) / std::sqrt(t * t + T(1));
+				const T s = t * c;
+				for(unsigned int k = 0; k < N; ++k) {
+					const T kp = a[k][p];
+					const T kq = a[k][q];
+					a[k][p] = c * kp - s * kq;
+					a[k][q] = s * kp + c * kq;
+				}
+				for(unsigned int k = 0; k < N; ++k) {
+					const T pk = a[p][k];
+					const T qk = a[q][k];
+					a[p][k] = c * pk - s * qk;
+					a[q][k] = s * pk + c * qk;
+				}
+				for(unsigned int k = 0; k < N; ++k) {
+					const T kp = v[k][p];
+					const T kq = v[k][q];
+					v[k][p] = c * kp - s * kq;
+					v[k][q] = s * kp + c * kq;
+				}
+			}
+		}
+	}
+
+	// eigenvector p is v[k][p] over k
+	unsigned int order[N];
+	for(unsigned int p = 0; p < N; ++p) {
+		order[p] = p;
+	}
+	std::sort(order, order + N, [&] (unsigned int x, unsigned int y) {
+		return a[x][x] > a[y][y];
+	});
+
+	principal_axes<T, N> out;
+	for(unsigned int j = 0; j < N; ++j) {
+		out.variances[j] = a[order[j]][order[j]];
+		for(unsigned int k = 0; k < N; ++k) {
+			out.axes[j][k] = v[k][order[j]];
+		}
+	}
+	return out;
+}
+
+} // namespace velm
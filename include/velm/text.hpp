@@ -0,0 +1,658 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "defs.hpp"
+#include "utility.hpp"
+#include "bits.hpp"
+#include "vector.hpp"
+#include "simd.hpp"
+
+/**
+ * \file text.hpp
+ * \brief parsing and formatting vectors as text
+ *
+ * velm::parse reads the components of a vector from text such as "1.0 2.5
+ * -3.25" (separated by spaces, tabs or commas), and velm::format writes
+ * them. Like std::from_chars and std::to_chars, they work on a range of
+ * characters, never allocate, and report errors through a std::errc rather
+ * than exceptions:
+ *
+ *      velm::vector<float, 3> v;
+ *      auto res = velm::parse(first, last, v);
+ *      if(res.ec != std::errc()) { ... res.ptr points at the bad component ... }
+ *
+ * parse_lines reads a whole buffer (e.g. a file read or mapped into memory)
+ * of one vector per line, such as the vertices of an OBJ file or the rows of a
+ * CSV file, and format_lines writes one:
+ *
+ *      velm::vector_array<float, 3> verts;
+ *      auto res = velm::parse_lines(buf, buf + size, verts, "v");
+ *      if(res.ec != std::errc()) { ... error at res.offset, on line res.line ... }
+ *
+ * Line ends are found with SSE2 where VELM_SIMD is enabled. Numbers are
+ * converted with std::from_chars and std::to_chars when the standard library
+ * has them for floating point (C++17, e.g. GCC 11 or later); VELM_CHARCONV is
+ * then 1. Otherwise floating point numbers are parsed exactly when they have
+ * at most 19 significant digits and a small exponent (which covers typical
+ * mesh and CSV data), and with std::strtod or std::strtof otherwise. Both of
+ * those, and the std::snprintf used to format floating point numbers without
+ * std::to_chars, use the decimal point of the C locale, so should not be used
+ * with LC_NUMERIC changed. Either way, formatted numbers read back exactly,
+ * but only std::to_chars writes the shortest form.
+ */
+
+#if !defined(VELM_CHARCONV)
+	#if (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && defined(__has_include)
+		#if __has_include(<charconv>)
+			#include <charconv>
+		#endif
+	#endif
+	#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+		#define VELM_CHARCONV 1
+	#else
+		#define VELM_CHARCONV 0
+	#endif
+#elif VELM_CHARCONV
+	#include <charconv>
+#endif
+
+namespace velm {
+
+/**
+ * \struct parse_result
+ * \brief end of the parsed text, and the error if there was one
+ *
+ * On success, ptr is one past the last character used. On failure, ptr points
+ * at the start of the component which could not be read (unlike
+ * std::from_chars, also for numbers out of range), and the output is
+ * unchanged.
+ * ec is std::errc::invalid_argument for text which is not a number (or is
+ * not followed by a separator), and std::errc::result_out_of_range for numbers
+ * which don't fit the component type.
+ */
+struct parse_result
+{
+	const char* ptr;
+	std::errc ec;
+};
+
+/**
+ * \struct format_result
+ * \brief end of the formatted text, and the error if there was one
+ *
+ * On success, ptr is one past the last character written. If the output does
+ * not fit, ec is std::errc::value_too_large, ptr is the end of the range,
+ * and the contents of the range are unspecified.
+ */
+struct format_result
+{
+	char* ptr;
+	std::errc ec;
+};
+
+namespace detail {
+
+	// blank {{{
+
+	constexpr bool is_digit(char c)
+	{
+		return static_cast<unsigned char>(c - '0') < 10;
+	}
+
+	// separators between components
+	constexpr bool is_separator(char c)
+	{
+		return c == ' ' || c == '\t' || c == ',' || c == '\r';
+	}
+
+	inline const char* skip_separators(const char* p, const char* last)
+	{
+		while(p != last && is_separator(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	/*
+	 * The first '\n' in [p, last), or last. Lines are mostly a few dozen
+	 * characters, so this looks at 16 at a time rather than calling memchr
+	 * for each line.
+	 */
+	inline const char* find_line_end(const char* p, const char* last)
+	{
+#if VELM_SIMD
+		const __m128i newline = _mm_set1_epi8('\n');
+		for(; last - p >= 16; p += 16) {
+			const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const int bits = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline));
+			if(bits != 0) {
+				return p + utility::count_trailing_zeros(static_cast<std::uint32_t>(bits));
+			}
+		}
+#endif
+		for(; p != last; ++p) {
+			if(*p == '\n') {
+				return p;
+			}
+		}
+		return last;
+	}
+
+	// }}}
+	// numbers {{{
+
+#if VELM_CHARCONV
+
+	template <typename T>
+	parse_result parse_number(const char* first, const char* last, T& out)
+	{
+		// from_chars takes no '+', but other writers (and people) do
+		const char* p = first;
+		if(p != last && *p == '+' && last - p > 1 && p[1] != '-' && p[1] != '+') {
+			++p;
+		}
+		const std::from_chars_result res = std::from_chars(p, last, out);
+		if(res.ec == std::errc::invalid_argument) {
+			return {first, res.ec};
+		}
+		return {res.ptr, res.ec};
+	}
+
+	template <typename T>
+	format_result format_number(char* first, char* last, T val)
+	{
+		const std::to_chars_result res = std::to_chars(first, last, val);
+		return {res.ptr, res.ec};
+	}
+
+#else
+
+	template <typename T>
+	parse_result parse_integer(const char* first, const char* last, T& out)
+	{
+		using U = std::make_unsigned_t<T>;
+
+		const char* p = first;
+		bool neg = false;
+		if(p != last && (*p == '-' || *p == '+')) {
+			neg = *p == '-';
+			++p;
+		}
+		if(neg && !std::is_signed<T>::value) {
+			return {first, std::errc::invalid_argument};
+		}
+
+		const std::uint64_t limit = neg
+			? std::uint64_t(U(std::numeric_limits<T>::max())) + 1
+			: std::uint64_t(std::numeric_limits<T>::max());
+		std::uint64_t acc = 0;
+		bool overflow = false;
+		const char* const digits = p;
+		for(; p != last && is_digit(*p); ++p) {
+			const unsigned int d = static_cast<unsigned int>(*p - '0');
+			if(acc > (limit - d) / 10) {
+				overflow = true;
+			} else {
+				acc = acc * 10 + d;
+			}
+		}
+
+		if(p == digits) {
+			return {first, std::errc::invalid_argument};
+		}
+		if(overflow) {
+			return {p, std::errc::result_out_of_range};
+		}
+		out = static_cast<T>(neg ? U(0) - U(acc) : U(acc));
+		return {p, std::errc()};
+	}
+
+	inline double pow10_double(int e)
+	{
+		static const double table[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+		};
+		return table[e];
+	}
+
+	inline float pow10_float(int e)
+	{
+		static const float table[] = {
+			1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+		};
+		return table[e];
+	}
+
+	/*
+	 * Clinger's fast path: the mantissa and the power of ten are both exact
+	 * in T, so a single multiplication or division rounds correctly.
+	 */
+	template <typename T>
+	bool fast_decimal(std::uint64_t, int, T&)
+	{
+		return false;
+	}
+
+	inline bool fast_decimal(std::uint64_t mant, int exp10, double& out)
+	{
+		if(mant > (std::uint64_t(1) << 53) || exp10 < -22 || exp10 > 22) {
+			return false;
+		}
+		const double m = static_cast<double>(mant);
+		out = exp10 < 0 ? m / pow10_double(-exp10) : m * pow10_double(exp10);
+		return true;
+	}
+
+	inline bool fast_decimal(std::uint64_t mant, int exp10, float& out)
+	{
+		if(mant > (std::uint64_t(1) << 24) || exp10 < -10 || exp10 > 10) {
+			return false;
+		}
+		const float m = static_cast<float>(mant);
+		out = exp10 < 0 ? m / pow10_float(-exp10) : m * pow10_float(exp10);
+		return true;
+	}
+
+	inline void strto(const char* str, char** end, double& out)
+	{
+		out = std::strtod(str, end);
+	}
+
+	inline void strto(const char* str, char** end, float& out)
+	{
+		out = std::strtof(str, end);
+	}
+
+	inline void strto(const char* str, char** end, long double& out)
+	{
+		out = std::strtold(str, end);
+	}
+
+	/*
+	 * Numbers outside the fast path, and inf and nan. strtod needs a null
+	 * terminated string, so the number is copied first; only numbers with
+	 * hundreds of digits need the heap.
+	 */
+	template <typename T>
+	parse_result parse_float_slow(const char* first, const char* last, T& out)
+	{
+		const std::size_t len = static_cast<std::size_t>(last - first);
+		char local[128];
+		std::string heap;
+		char* str = local;
+		if(len < sizeof(local)) {
+			std::memcpy(local, first, len);
+			local[len] = '\0';
+		} else {
+			heap.assign(first, last);
+			str = &heap[0];
+		}
+
+		char* end = nullptr;
+		T val;
+		errno = 0;
+		strto(str, &end, val);
+		if(end == str) {
+			return {first, std::errc::invalid_argument};
+		}
+		const char* ptr = first + (end - str);
+		// ERANGE is also set for subnormal results, which are fine
+		if(errno == ERANGE && (val == T(0) || val > std::numeric_limits<T>::max() || val < std::numeric_limits<T>::lowest())) {
+			return {ptr, std::errc::result_out_of_range};
+		}
+		out = val;
+		return {ptr, std::errc()};
+	}
+
+	template <typename T>
+	parse_result parse_float(const char* first, const char* last, T& out)
+	{
+		const char* p = first;
+		bool neg = false;
+		if(p != last && (*p == '-' || *p == '+')) {
+			neg = *p == '-';
+			++p;
+		}
+
+		// up to 19 significant digits fit in the mantissa
+		std::uint64_t mant = 0;
+		int kept = 0;
+		int exp10 = 0;
+		bool any = false;
+		bool truncated = false;
+		for(; p != last && is_digit(*p); ++p) {
+			any = true;
+			if(mant == 0 && *p == '0') {
+				continue;
+			} else if(kept < 19) {
+				mant = mant * 10 + static_cast<unsigned int>(*p - '0');
+				++kept;
+			} else {
+				truncated = true;
+				++exp10;
+			}
+		}
+		if(p != last && *p == '.') {
+			++p;
+			for(; p != last && is_digit(*p); ++p) {
+				any = true;
+				if(mant == 0 && *p == '0') {
+					--exp10;
+				} else if(kept < 19) {
+					mant = mant * 10 + static_cast<unsigned int>(*p - '0');
+					++kept;
+					--exp10;
+				} else {
+					truncated = true;
+				}
+			}
+		}
+		if(!any) {
+			// strtod also reads inf and nan, but skips whitespace and reads
+			// hex, so only give it what starts like inf or nan
+			if(p == last || (*p != 'i' && *p != 'I' && *p != 'n' && *p != 'N')) {
+				return {first, std::errc::invalid_argument};
+			}
+			return parse_float_slow(first, last - p > 16 ? p + 16 : last, out);
+		}
+
+		// as with from_chars, an 'e' without digits is not part of the number
+		if(p != last && (*p == 'e' || *p == 'E')) {
+			const char* q = p + 1;
+			bool exp_neg = false;
+			if(q != last && (*q == '-' || *q == '+')) {
+				exp_neg = *q == '-';
+				++q;
+			}
+			if(q != last && is_digit(*q)) {
+				int e = 0;
+				for(; q != last && is_digit(*q); ++q) {
+					if(e < 100000) {
+						e = e * 10 + (*q - '0');
+					}
+				}
+				exp10 += exp_neg ? -e : e;
+				p = q;
+			}
+		}
+
+		T val;
+		if(!truncated && mant == 0) {
+			val = T(0);
+		} else if(truncated || !fast_decimal(mant, exp10, val)) {
+			return parse_float_slow(first, p, out);
+		}
+		out = neg ? -val : val;
+		return {p, std::errc()};
+	}
+
+	template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+	parse_result parse_number(const char* first, const char* last, T& out)
+	{
+		return parse_integer(first, last, out);
+	}
+
+	template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+	parse_result parse_number(const char* first, const char* last, T& out)
+	{
+		return parse_float(first, last, out);
+	}
+
+	template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+	format_result format_number(char* first, char* last, T val)
+	{
+		using U = std::make_unsigned_t<T>;
+
+		char digits[24];
+		char* d = digits + sizeof(digits);
+		const bool neg = val < 0;
+		U mag = neg ? U(U(0) - U(val)) : U(val);
+		do {
+			*--d = static_cast<char>('0' + mag % 10);
+			mag /= 10;
+		} while(mag != 0);
+		if(neg) {
+			*--d = '-';
+		}
+
+		const std::size_t len = static_cast<std::size_t>(digits + sizeof(digits) - d);
+		if(static_cast<std::size_t>(last - first) < len) {
+			return {last, std::errc::value_too_large};
+		}
+		std::memcpy(first, d, len);
+		return {first + len, std::errc()};
+	}
+
+	inline int print_float(char* buf, std::size_t size, double val)
+	{
+		return std::snprintf(buf, size, "%.*g", std::numeric_limits<double>::max_digits10, val);
+	}
+
+	inline int print_float(char* buf, std::size_t size, float val)
+	{
+		return std::snprintf(buf, size, "%.*g", std::numeric_limits<float>::max_digits10, static_cast<double>(val));
+	}
+
+	inline int print_float(char* buf, std::size_t size, long double val)
+	{
+		return std::snprintf(buf, size, "%.*Lg", std::numeric_limits<long double>::max_digits10, val);
+	}
+
+	// max_digits10 significant digits, which read back exactly
+	template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+	format_result format_number(char* first, char* last, T val)
+	{
+		char buf[64];
+		const int len = print_float(buf, sizeof(buf), val);
+		if(len < 0 || last - first < len) {
+			return {last, std::errc::value_too_large};
+		}
+		std::memcpy(first, buf, static_cast<std::size_t>(len));
+		return {first + len, std::errc()};
+	}
+
+#endif
+
+	// }}}
+
+} // namespace detail
+
+// parsing {{{
+
+/**
+ * \fn parse
+ * \brief read a number, or the components of a vector
+ *
+ * Leading separators (spaces, tabs and commas) are skipped, and so are
+ * separators between components. Each number must be followed by a separator,
+ * a line end or the end of the text, so "1 2 3x" is an error rather than
+ * three components. Anything after the last component is left for the
+ * caller.
+ */
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value, int> = 0>
+parse_result parse(const char* first, const char* last, T& out)
+{
+	const char* p = detail::skip_separators(first, last);
+	T val;
+	const parse_result res = detail::parse_number(p, last, val);
+	// from_chars leaves ptr after a number which is out of range
+	if(res.ec != std::errc()) {
+		return {p, res.ec};
+	}
+	if(res.ptr != last && !detail::is_separator(*res.ptr) && *res.ptr != '\n') {
+		return {p, std::errc::invalid_argument};
+	}
+	out = val;
+	return res;
+}
+
+template <typename V, std::enable_if_t<utility::is_tied_vector<V>::value, int> = 0>
+parse_result parse(const char* first, const char* last, V&& out)
+{
+	using T = typename std::decay_t<V>::value_type;
+	constexpr unsigned int N = std::decay_t<V>::dimensions;
+
+	vector<T, N> val;
+	const char* p = first;
+	for(unsigned int k = 0; k < N; ++k) {
+		const parse_result res = velm::parse(p, last, val[k]);
+		if(res.ec != std::errc()) {
+			return res;
+		}
+		p = res.ptr;
+	}
+	out = val;
+	return {p, std::errc()};
+}
+
+/**
+ * \struct lines_result
+ * \brief outcome of parse_lines
+ *
+ * count is the number of vectors read. On failure, ptr points at the
+ * component which could not be read, offset is its distance in bytes from
+ * the start of the buffer, and line is its line number (from 1).
+ */
+struct lines_result
+{
+	const char* ptr;
+	std::errc ec;
+	std::size_t offset;
+	std::size_t line;
+	std::size_t count;
+};
+
+/**
+ * \fn parse_lines
+ * \brief read one vector per line into a container
+ *
+ * Each vector is appended to out with push_back, so out can be a vector_array
+ * or a std::vector of velm::vector. If prefix is not empty, only lines which
+ * start with prefix followed by a separator are read (e.g. "v" for the
+ * vertices of an OBJ file, which skips "vn", "f" and so on); otherwise every
+ * line is. Empty lines and lines starting with '#' are skipped, and so is
+ * anything after the last component of a line (e.g. the w of an OBJ vertex).
+ *
+ * Reading stops at the first error, leaving the vectors before it in out.
+ */
+template <typename Out>
+lines_result parse_lines(const char* first, const char* last, Out& out, const char* prefix = "")
+{
+	using V = typename Out::value_type;
+	const std::size_t prefix_len = std::strlen(prefix);
+
+	std::size_t line = 1;
+	std::size_t count = 0;
+	for(const char* p = first; p < last; ++line) {
+		const char* const eol = detail::find_line_end(p, last);
+		const char* q = detail::skip_separators(p, eol);
+		p = eol == last ? last : eol + 1;
+
+		if(q == eol || *q == '#') {
+			continue;
+		}
+		if(prefix_len != 0) {
+			if(static_cast<std::size_t>(eol - q) <= prefix_len || std::memcmp(q, prefix, prefix_len) != 0
+				|| !detail::is_separator(q[prefix_len])) {
+				continue;
+			}
+			q += prefix_len;
+		}
+
+		V val;
+		const parse_result res = velm::parse(q, eol, val);
+		if(res.ec != std::errc()) {
+			return {res.ptr, res.ec, static_cast<std::size_t>(res.ptr - first), line, count};
+		}
+		out.push_back(val);
+		++count;
+	}
+	return {last, std::errc(), static_cast<std::size_t>(last - first), line, count};
+}
+
+// }}}
+// formatting {{{
+
+/**
+ * \fn format
+ * \brief write a number, or the components of a vector
+ *
+ * Components are separated by sep. Nothing is written after the last one,
+ * and the text is not null terminated.
+ */
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value, int> = 0>
+format_result format(char* first, char* last, T val)
+{
+	return detail::format_number(first, last, val);
+}
+
+template <typename V, std::enable_if_t<utility::is_tied_vector<V>::value, int> = 0>
+format_result format(char* first, char* last, const V& vec, char sep = ' ')
+{
+	using T = typename V::value_type;
+	constexpr unsigned int N = V::dimensions;
+
+	char* p = first;
+	for(unsigned int k = 0; k < N; ++k) {
+		if(k != 0) {
+			if(p == last) {
+				return {last, std::errc::value_too_large};
+			}
+			*p++ = sep;
+		}
+		const format_result res = detail::format_number(p, last, static_cast<T>(vec[k]));
+		if(res.ec != std::errc()) {
+			return res;
+		}
+		p = res.ptr;
+	}
+	return {p, std::errc()};
+}
+
+/**
+ * \fn format_lines
+ * \brief write one vector per line
+ *
+ * Each line is prefix (if not empty) and a space, the components separated
+ * by spaces, and '\n'. vecs can be any range of vectors, e.g. a vector_array
+ * or a strided_view.
+ */
+template <typename Range>
+format_result format_lines(char* first, char* last, const Range& vecs, const char* prefix = "")
+{
+	const std::size_t prefix_len = std::strlen(prefix);
+
+	char* p = first;
+	for(auto&& vec : vecs) {
+		if(prefix_len != 0) {
+			if(static_cast<std::size_t>(last - p) < prefix_len + 1) {
+				return {last, std::errc::value_too_large};
+			}
+			std::memcpy(p, prefix, prefix_len);
+			p += prefix_len;
+			*p++ = ' ';
+		}
+		const format_result res = velm::format(p, last, vec);
+		if(res.ec != std::errc() || res.ptr == last) {
+			return {last, std::errc::value_too_large};
+		}
+		p = res.ptr;
+		*p++ = '\n';
+	}
+	return {p, std::errc()};
+}
+
+// }}}
+
+} // namespace velm
@@ -132,6 +132,47 @@ struct tuple_traits
 	using common_type = subtype_apply<std::common_type_t>;
 };
 
+/*
+ * \fn tuple_fold
+ * \brief Combine tuple elements from left to right
+ *
+ * Calls f(acc, element) for each element of a tuple-like, where acc starts as
+ * init and is replaced by the result of each call. The type of acc may change
+ * between calls.
+ *
+ *      // example
+ *      auto sum = tuple_fold(std::make_tuple(1, 2.5), 0, [] (auto a, auto x) { return a + x; });
+ *      // sum == 3.5
+ */
+
+template <std::size_t I, std::size_t N>
+struct tuple_folder
+{
+	template <typename T, typename Acc, typename F>
+	static constexpr auto fold(T&& tup, Acc&& acc, F& f)
+	{
+		return tuple_folder<I + 1, N>::fold(std::forward<T>(tup),
+			f(std::forward<Acc>(acc), std::get<I>(std::forward<T>(tup))), f);
+	}
+};
+
+template <std::size_t N>
+struct tuple_folder<N, N>
+{
+	template <typename T, typename Acc, typename F>
+	static constexpr auto fold(T&& /* tup */, Acc&& acc, F& /* f */)
+	{
+		return std::forward<Acc>(acc);
+	}
+};
+
+template <typename T, typename Acc, typename F>
+constexpr auto tuple_fold(T&& tup, Acc&& init, F&& f)
+{
+	return tuple_folder<0, std::tuple_size<std::decay_t<T>>::value>::fold(
+		std::forward<T>(tup), std::forward<Acc>(init), f);
+}
+
 template <typename T, std::size_t>
 using idx_dependent = T;
 
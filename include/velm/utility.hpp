@@ -116,22 +116,90 @@ using tie_detect = decltype(usr::tie<std::decay_t<T>>{}(std::declval<T>()));
 template <typename T>
 using is_tied_vector = typename detect<tie_detect, T>::value_t;
 
+/**
+ * \struct is_direct_vector
+ * \brief checks if a type is a velm::vector or a swizzle_proxy
+ *
+ * The components of these types (and types derived from them, such as
+ * quaternions) are read straight from their storage with direct_get, rather
+ * than through a tie. This avoids building tuples, which is what dominates
+ * operations on vectors in unoptimised (-O0/-Og) builds. Other tied vectors
+ * (i.e. user types) still go through usr::tie.
+ *
+ * direct_size is the number of components, or 0 for other types.
+ */
+namespace detail {
+
+	template <typename T, unsigned int N>
+	std::integral_constant<unsigned int, N> direct_size(const vector<T, N>*);
+
+	template <typename T, unsigned int... Is>
+	std::integral_constant<unsigned int, sizeof...(Is)> direct_size(const swizzle_proxy<T, Is...>*);
+
+	std::integral_constant<unsigned int, 0> direct_size(const void*);
+
+	template <unsigned int... Is>
+	constexpr std::size_t index_at(std::size_t i)
+	{
+		const std::size_t indices[] = {Is...};
+		return indices[i];
+	}
+
+} // namespace detail
+
+template <typename T>
+using direct_size = decltype(detail::direct_size(std::declval<std::decay_t<T>*>()));
+
+template <typename T>
+using is_direct_vector = std::integral_constant<bool, (direct_size<T>::value > 0)>;
+
+/**
+ * \fn direct_get
+ * \brief component I of a vector or swizzle, without a tie
+ */
+template <std::size_t I, typename T, unsigned int N>
+constexpr T& direct_get(vector<T, N>& vec)
+{
+	return std::get<I>(vec.data);
+}
+
+template <std::size_t I, typename T, unsigned int N>
+constexpr const T& direct_get(const vector<T, N>& vec)
+{
+	return std::get<I>(vec.data);
+}
+
+template <std::size_t I, typename T, unsigned int... Is>
+constexpr T& direct_get(swizzle_proxy<T, Is...>& proxy)
+{
+	return std::get<detail::index_at<Is...>(I)>(proxy.underlying);
+}
+
+template <std::size_t I, typename T, unsigned int... Is>
+constexpr const T& direct_get(const swizzle_proxy<T, Is...>& proxy)
+{
+	return std::get<detail::index_at<Is...>(I)>(proxy.underlying);
+}
+
 /**
  * \fn vec_apply
  * \brief call function on every element of a tuple
  *
  * This calls a given function f on every element of a tuple, and constructs a
- * new vector from the returned values. Essentially a wrapper around
- * tuple_visit.
+ * new vector from the returned values. The function is called on the elements
+ * in order.
  */
+template <typename T, typename F, std::size_t... Is>
+constexpr auto vec_apply(T&& vec, F&& f, std::index_sequence<Is...> /* seq */)
+{
+	using ret_type = std::common_type_t<std::decay_t<decltype(f(std::get<Is>(vec)))>...>;
+	return vector<ret_type, sizeof...(Is)>{f(std::get<Is>(vec))...};
+}
+
 template <typename T, typename F>
 constexpr auto vec_apply(T&& vec, F&& f)
 {
-	using applied_tuple = decltype(tuple_visit(vec, std::forward<F>(f)));
-	using traits = tuple_traits<applied_tuple>;
-	using ret_vec = vector<typename traits::common_type, traits::size>;
-
-	return ret_vec::from_tuple(tuple_visit(vec, std::forward<F>(f)));
+	return vec_apply(vec, f, std::make_index_sequence<std::tuple_size<std::decay_t<T>>::value>());
 }
 
 /**
@@ -139,16 +207,46 @@ constexpr auto vec_apply(T&& vec, F&& f)
  * \brief apply function over 2 tuples
  *
  * Similar to vec_apply, but takes 2 tuples, and calls the given function on
- * each pair of values. This requires that the 2 tuples are of the same size.
+ * each pair of values. The second tuple must be at least as large as the
+ * first, and any extra elements are ignored.
  */
+template <typename T1, typename T2, typename F, std::size_t... Is>
+constexpr auto vec_apply2(T1&& vec1, T2&& vec2, F&& f, std::index_sequence<Is...> /* seq */)
+{
+	using ret_type = std::common_type_t<std::decay_t<decltype(f(std::get<Is>(vec1), std::get<Is>(vec2)))>...>;
+	return vector<ret_type, sizeof...(Is)>{f(std::get<Is>(vec1), std::get<Is>(vec2))...};
+}
+
 template <typename T1, typename T2, typename F>
 constexpr auto vec_apply2(T1&& vec1, T2&& vec2, F&& f)
 {
-	auto apply_wrapper = [&] (auto&& t) -> decltype(auto) {
-		return f(std::get<0>(t), std::get<1>(t));
-	};
+	return vec_apply2(vec1, vec2, f, std::make_index_sequence<std::tuple_size<std::decay_t<T1>>::value>());
+}
 
-	return vec_apply(transpose_union(vec1, vec2), apply_wrapper);
+/**
+ * \fn unary_apply
+ * \brief call function on every component of a vector
+ *
+ * Equivalent to vec_apply(get_tie(vec), f), but velm::vector and swizzle_proxy
+ * are read directly.
+ */
+template <typename V, typename F, std::size_t... Is>
+constexpr auto unary_apply(V& vec, F& f, std::index_sequence<Is...> /* seq */)
+{
+	using ret_type = std::common_type_t<std::decay_t<decltype(f(direct_get<Is>(vec)))>...>;
+	return vector<ret_type, sizeof...(Is)>{f(direct_get<Is>(vec))...};
+}
+
+template <typename V, typename F, std::enable_if_t<is_direct_vector<V>::value, int> = 0>
+constexpr auto unary_apply(V&& vec, F&& f)
+{
+	return unary_apply(vec, f, std::make_index_sequence<direct_size<V>::value>());
+}
+
+template <typename V, typename F, std::enable_if_t<!is_direct_vector<V>::value, int> = 0>
+constexpr auto unary_apply(V&& vec, F&& f)
+{
+	return vec_apply(get_tie(vec), f);
 }
 
 /**
@@ -190,14 +288,82 @@ template <typename T1, typename T2, typename F, std::enable_if_t<
 	, int> = 0>
 constexpr decltype(auto) binary_tuple_apply(T1&& vec1, T2&& val2, F&& f) = delete;
 
+/*
+ * Operands of the direct path of binary_apply: vectors and swizzles are used in
+ * place, while values are copied once and used for every component, as the
+ * filled tuple of binary_tuple_apply would be. The copy matters when the value
+ * refers to a component being assigned to, e.g. v += v.x.
+ */
+namespace detail {
+
+	template <typename T>
+	constexpr T& direct_operand(T& vec, std::true_type /* direct */)
+	{
+		return vec;
+	}
+
+	template <typename T>
+	constexpr std::decay_t<T> direct_operand(T& val, std::false_type /* direct */)
+	{
+		return val;
+	}
+
+	template <std::size_t I, typename T>
+	constexpr decltype(auto) direct_component(T& vec, std::true_type /* direct */)
+	{
+		return direct_get<I>(vec);
+	}
+
+	template <std::size_t I, typename T>
+	constexpr T& direct_component(T& val, std::false_type /* direct */)
+	{
+		return val;
+	}
+
+	template <typename T1, typename T2, typename F, std::size_t... Is>
+	constexpr auto direct_binary_apply(T1& lhs, T2& rhs, F& f, std::index_sequence<Is...> /* seq */)
+	{
+		using d1 = is_direct_vector<T1>;
+		using d2 = is_direct_vector<T2>;
+		using ret_type = std::common_type_t<std::decay_t<decltype(
+			f(direct_component<Is>(lhs, d1()), direct_component<Is>(rhs, d2())))>...>;
+		return vector<ret_type, sizeof...(Is)>{
+			f(direct_component<Is>(lhs, d1()), direct_component<Is>(rhs, d2()))...};
+	}
+
+} // namespace detail
+
+template <typename T1, typename T2>
+using is_direct_appliable = std::integral_constant<bool,
+	(is_direct_vector<T1>::value || !is_tied_vector<T1>::value)
+	&& (is_direct_vector<T2>::value || !is_tied_vector<T2>::value)
+	&& (is_direct_vector<T1>::value || is_direct_vector<T2>::value)>;
+
 /**
  * \fn binary_apply
  * \brief apply function over arguments
  *
  * This combines the functionality of binary_tuple_apply and vec_apply2,
- * calling a function over each pair of values.
+ * calling a function over each pair of values, in order. When every operand is
+ * a velm::vector, a swizzle or a value, the components are read directly
+ * instead.
  */
-template <typename T1, typename T2, typename F>
+template <typename T1, typename T2, typename F, std::enable_if_t<is_direct_appliable<T1, T2>::value, int> = 0>
+constexpr auto binary_apply(T1&& lhs, T2&& rhs, F&& f)
+{
+	using d1 = is_direct_vector<T1>;
+	using d2 = is_direct_vector<T2>;
+	// as with vec_apply2, the size is that of the first vector
+	static_assert(!d1::value || !d2::value || direct_size<T1>::value <= direct_size<T2>::value,
+	              "The second vector must have at least as many components as the first");
+	constexpr auto size = d1::value ? direct_size<T1>::value : direct_size<T2>::value;
+
+	auto&& l = detail::direct_operand(lhs, d1());
+	auto&& r = detail::direct_operand(rhs, d2());
+	return detail::direct_binary_apply(l, r, f, std::make_index_sequence<size>());
+}
+
+template <typename T1, typename T2, typename F, std::enable_if_t<!is_direct_appliable<T1, T2>::value, int> = 0>
 constexpr decltype(auto) binary_apply(T1&& lhs, T2&& rhs, F&& f)
 {
 	auto apply_wrapper = [&] (auto&& lhs, auto&& rhs) {
@@ -206,13 +372,63 @@ constexpr decltype(auto) binary_apply(T1&& lhs, T2&& rhs, F&& f)
 	return binary_tuple_apply(std::forward<T1>(lhs), std::forward<T2>(rhs), apply_wrapper);
 }
 
+/**
+ * \struct is_matrix
+ * \brief checks if a type is a matrix
+ *
+ * Matrices (see matrix.hpp) are not tied vectors, so the component-wise
+ * operators would otherwise take them as a scalar operand. They are marked
+ * with a member type matrix_tag, and provide their own operators instead.
+ */
+template <typename T>
+using matrix_detect = typename std::decay_t<T>::matrix_tag;
+
+template <typename T>
+using is_matrix = typename detect<matrix_detect, T>::value_t;
+
+/**
+ * \struct is_quaternion
+ * \brief checks if a type is a quaternion
+ *
+ * Quaternions (see quaternion.hpp) are tied vectors, so functions such as
+ * dot, length and mix treat them as 4 dimensional vectors. Their products
+ * are not component-wise though, so they are marked with a member type
+ * quaternion_tag, and excluded from the eager operators.
+ */
+template <typename T>
+using quaternion_detect = typename std::decay_t<T>::quaternion_tag;
+
+template <typename T>
+using is_quaternion = typename detect<quaternion_detect, T>::value_t;
+
 template <typename T1, typename T2>
-using is_appliable = std::integral_constant<bool, is_tied_vector<T1>::value || is_tied_vector<T2>::value>;
+using is_appliable = std::integral_constant<bool, (is_tied_vector<T1>::value || is_tied_vector<T2>::value)
+	&& !is_matrix<T1>::value && !is_matrix<T2>::value>;
 
 template <typename T1, typename T2>
 using if_appliable = std::enable_if_t<is_appliable<T1, T2>::value, int>;
 
 template <typename T1, typename T2>
-using if_compound_appliable = std::enable_if_t<is_tied_vector<T1>::value, int>;
+using if_compound_appliable = std::enable_if_t<is_tied_vector<T1>::value && !is_matrix<T2>::value
+	&& !is_quaternion<T1>::value && !is_quaternion<T2>::value, int>;
+
+/**
+ * \struct is_expression
+ * \brief checks if a type is a lazy expression
+ *
+ * Lazy expressions (see lazy.hpp) are tied vectors, but provide their own
+ * arithmetic operators which build larger expressions. They are marked with a
+ * member type expression_tag, and are excluded from the eager operators.
+ */
+template <typename T>
+using expression_detect = typename std::decay_t<T>::expression_tag;
+
+template <typename T>
+using is_expression = typename detect<expression_detect, T>::value_t;
+
+template <typename T1, typename T2>
+using if_eager_appliable = std::enable_if_t<
+	is_appliable<T1, T2>::value && !is_expression<T1>::value && !is_expression<T2>::value
+	&& !is_quaternion<T1>::value && !is_quaternion<T2>::value, int>;
 
 } } // namespace velm::utility
@@ -23,16 +23,54 @@ public: // statics
 		using tup_size = std::tuple_size<std::decay_t<Tup>>;
 		static_assert(tup_size::value == N, "Tuple must have an element for each dimension");
 
-		auto constructor = [] (auto&&... args) {
-			return vector<T, N>(std::forward<decltype(args)>(args)...);
-		};
-		return utility::apply(constructor, std::forward<Tup>(t));
+		return vector<T, N>(tuple_tag(), std::forward<Tup>(t), std::make_index_sequence<N>());
 	}
 
 private: // internal methods
 
 	using base_type = vec_base<T, N, swizzle_proxy>;
 
+	// tags for the index_sequence constructors below
+	struct fill_tag {};
+	struct direct_tag {};
+	struct tuple_tag {};
+
+	/*
+	 * These initialise the storage directly, rather than building a tuple and
+	 * unpacking it into the dimension constructor, which is what makes
+	 * construction slow in unoptimised builds.
+	 */
+	template <typename U, std::size_t... Is>
+	constexpr vector(fill_tag /* tag */, const U& val, std::index_sequence<Is...> /* seq */)
+		: base_type{{{{(static_cast<void>(Is), static_cast<T>(val))...}}}}
+	{
+	}
+
+	template <typename V, std::size_t... Is>
+	constexpr vector(direct_tag /* tag */, const V& vec, std::index_sequence<Is...> /* seq */)
+		: base_type{{{{static_cast<T>(utility::direct_get<Is>(vec))...}}}}
+	{
+	}
+
+	template <typename Tup, std::size_t... Is>
+	constexpr vector(tuple_tag /* tag */, Tup&& t, std::index_sequence<Is...> /* seq */)
+		: base_type{{{{static_cast<T>(std::get<Is>(std::forward<Tup>(t)))...}}}}
+	{
+	}
+
+	// vec_base<T, 0> has no union, so needs different braces
+	template <typename U>
+	constexpr vector(fill_tag /* tag */, const U& /* val */, std::index_sequence<> /* seq */)
+		: base_type()
+	{
+	}
+
+	template <typename Tup>
+	constexpr vector(tuple_tag /* tag */, Tup&& /* t */, std::index_sequence<> /* seq */)
+		: base_type()
+	{
+	}
+
 	constexpr base_type& as_base()
 	{
 		return static_cast<base_type&>(*this);
@@ -72,13 +110,21 @@ public: // methods
 	template <typename U,
 	         std::enable_if_t<(!utility::is_tied_vector<std::decay_t<U>>::value), int> = 0>
 	constexpr vector(const U& val)
-		: vector(from_tuple(utility::make_filled_tuple<N>(val)))
+		: vector(fill_tag(), val, std::make_index_sequence<N>())
 	{
 	}
 
 	// vector converters
 	template <typename V,
-		std::enable_if_t<(utility::is_tied_vector<std::decay_t<V>>::value), int> = 0>
+		std::enable_if_t<(utility::is_direct_vector<V>::value), int> = 0>
+	constexpr vector(const V& vec)
+		: vector(direct_tag(), vec, std::make_index_sequence<N>())
+	{
+		static_assert(utility::direct_size<V>::value == N, "Vectors must be the same size");
+	}
+
+	template <typename V,
+		std::enable_if_t<(utility::is_tied_vector<std::decay_t<V>>::value && !utility::is_direct_vector<V>::value), int> = 0>
 	constexpr vector(const V& vec)
 		: vector(from_tuple(get_tie(vec)))
 	{
@@ -0,0 +1,718 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <initializer_list>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "defs.hpp"
+#include "base.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+#include "view.hpp"
+#include "ops.hpp"
+#include "allocator.hpp"
+#include "dispatch.hpp"
+
+/**
+ * \file vector_array.hpp
+ * \brief structure-of-arrays container for vectors
+ *
+ * velm::vector_array<T, N> stores a sequence of N-dimensional vectors with
+ * each component in its own contiguous, cache line aligned lane. Elements are
+ * accessed through soa_element, a proxy which behaves like a velm::vector
+ * (including swizzles such as .x and .xy) but refers to the lanes.
+ *
+ * Whole-array expressions are evaluated with array_apply or array_transform,
+ * which call a function on every element. Since each component is a separate
+ * stream, the loop vectorises across elements rather than within a vector.
+ *
+ *      velm::vector_array<float, 3> pos(1000), vel(1000);
+ *      pos += vel * dt;
+ *      auto len = velm::array_apply([] (auto&& p) { return velm::length(p); }, pos);
+ *      pos[0].xy = pos[1].yx;
+ */
+
+/*
+ * VELM_IVDEP tells the compiler that iterations of the following loop are
+ * independent, so it can vectorise without run-time alias checks between the
+ * lanes of each array.
+ */
+#if defined(__clang__)
+	#define VELM_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+	#define VELM_IVDEP _Pragma("GCC ivdep")
+#elif defined(_MSC_VER)
+	#define VELM_IVDEP __pragma(loop(ivdep))
+#else
+	#define VELM_IVDEP
+#endif
+
+/*
+ * VELM_UNROLL fully unrolls the following loop over the components of a
+ * vector. GCC only vectorises a loop which has no loops inside it, so loops
+ * over components inside a loop over lanes must be unrolled first.
+ */
+#if defined(__clang__)
+	#define VELM_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+	#define VELM_UNROLL _Pragma("GCC unroll 16")
+#else
+	#define VELM_UNROLL
+#endif
+
+namespace velm {
+
+/**
+ * \struct soa_element
+ * \brief proxy for a single element of a vector_array
+ *
+ * This behaves like a velm::vector<T, N> which refers to components stored in
+ * separate lanes. It is a tied vector, so all operators and functions work
+ * with it, and it provides the same swizzle members as velm::vector.
+ *
+ * Assigning to an element (or one of its swizzles) first converts the source
+ * to a vector, so aliasing assignments such as e.xy = e.yx behave as they
+ * would for values.
+ */
+template <typename T, unsigned int N>
+struct soa_element
+	: public vec_base<lane_ref<T>, N, lane_swizzle>
+{
+public: // statics
+
+	static constexpr auto dimensions = N;
+	using value_type = std::remove_const_t<T>;
+
+private: // internal methods
+
+	using base_type = vec_base<lane_ref<T>, N, lane_swizzle>;
+
+	template <typename P, std::size_t... Is>
+	constexpr soa_element(P lanes, std::size_t idx, std::index_sequence<Is...> /* seq */)
+		: base_type{{{{lane_ref<T>{lanes[Is] + idx}...}}}}
+	{
+	}
+
+	template <std::size_t... Is>
+	constexpr auto tie_impl(std::index_sequence<Is...> /* seq */) const
+	{
+		return std::tie(std::get<Is>(this->data).get()...);
+	}
+
+public: // methods
+
+	/*
+	 * Construct from an array of lane pointers, referring to element idx of
+	 * each lane.
+	 */
+	template <typename P>
+	constexpr soa_element(P lanes, std::size_t idx)
+		: soa_element(lanes, idx, std::make_index_sequence<N>())
+	{
+	}
+
+	constexpr soa_element(const soa_element& other)
+		: base_type(other)
+	{
+	}
+
+	soa_element& operator=(const soa_element& other)
+	{
+		this->tie() = vector<value_type, N>(other).tie();
+		return *this;
+	}
+
+	template <typename V,
+		std::enable_if_t<utility::is_tied_vector<V>::value, int> = 0>
+	soa_element& operator=(V&& vec)
+	{
+		this->tie() = vector<value_type, N>(vec).tie();
+		return *this;
+	}
+
+	template <typename U,
+		std::enable_if_t<!utility::is_tied_vector<U>::value, int> = 0>
+	soa_element& operator=(U&& val)
+	{
+		this->tie() = utility::make_filled_tuple<N>(val);
+		return *this;
+	}
+
+	constexpr auto tie() const
+	{
+		return this->tie_impl(std::make_index_sequence<N>());
+	}
+
+	constexpr T& operator[](std::size_t idx) const
+	{
+		return this->data[idx].get();
+	}
+
+	constexpr vector<value_type, N> operator()() const
+	{
+		return static_cast<vector<value_type, N>>(*this);
+	}
+
+	constexpr operator vector<value_type, N>() const
+	{
+		return vector<value_type, N>::from_tuple(this->tie());
+	}
+};
+
+/**
+ * \struct vector_array
+ * \brief structure-of-arrays container of vectors
+ *
+ * Each of the N components is stored in its own lane. All lanes are aligned
+ * to alignment bytes and have the same capacity, so lane k is the contiguous
+ * range [lane(k), lane(k) + size()).
+ */
+template <typename T, unsigned int N>
+struct vector_array
+{
+public: // statics
+
+	static constexpr auto dimensions = N;
+	static constexpr std::size_t alignment = 64;
+
+	using value_type = vector<T, N>;
+	using component_type = T;
+	using reference = soa_element<T, N>;
+	using const_reference = soa_element<const T, N>;
+	using size_type = std::size_t;
+
+	template <bool Const>
+	struct basic_iterator
+	{
+		using R = std::conditional_t<Const, soa_element<const T, N>, soa_element<T, N>>;
+		using array_type = std::conditional_t<Const, const vector_array, vector_array>;
+
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = vector<T, N>;
+		using difference_type = std::ptrdiff_t;
+		using reference = R;
+		using pointer = void;
+
+		array_type* arr;
+		size_type idx;
+
+		R operator*() const
+		{
+			return (*arr)[idx];
+		}
+
+		basic_iterator& operator++()
+		{
+			++idx;
+			return *this;
+		}
+
+		basic_iterator operator++(int)
+		{
+			auto copy = *this;
+			++idx;
+			return copy;
+		}
+
+		bool operator==(const basic_iterator& other) const
+		{
+			return idx == other.idx;
+		}
+
+		bool operator!=(const basic_iterator& other) const
+		{
+			return idx != other.idx;
+		}
+	};
+
+private:
+
+	// lane capacity is rounded so every lane starts on an alignment boundary
+	static constexpr size_type lane_granularity = (alignment % sizeof(T) == 0) ? alignment / sizeof(T) : 1;
+
+	std::vector<T, utility::aligned_allocator<T, alignment>> storage;
+	size_type count = 0;
+	size_type stride = 0;
+
+	static constexpr size_type round_stride(size_type n)
+	{
+		return (n + lane_granularity - 1) / lane_granularity * lane_granularity;
+	}
+
+	void relayout(size_type new_stride)
+	{
+		decltype(storage) next(new_stride * N);
+		for(unsigned int k = 0; k < N; ++k) {
+			for(size_type i = 0; i < count; ++i) {
+				next[k * new_stride + i] = std::move(storage[k * stride + i]);
+			}
+		}
+		storage = std::move(next);
+		stride = new_stride;
+	}
+
+public: // methods
+
+	vector_array() = default;
+
+	explicit vector_array(size_type n, const value_type& fill = value_type())
+	{
+		this->resize(n, fill);
+	}
+
+	vector_array(std::initializer_list<value_type> vals)
+	{
+		this->reserve(vals.size());
+		for(auto&& v : vals) {
+			this->push_back(v);
+		}
+	}
+
+	size_type size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	size_type capacity() const
+	{
+		return stride;
+	}
+
+	void reserve(size_type n)
+	{
+		if(n > stride) {
+			this->relayout(round_stride(n));
+		}
+	}
+
+	void resize(size_type n, const value_type& fill = value_type())
+	{
+		if(n > count) {
+			this->reserve(n);
+			for(unsigned int k = 0; k < N; ++k) {
+				std::fill(this->lane(k) + count, this->lane(k) + n, fill[k]);
+			}
+		}
+		count = n;
+	}
+
+	void clear()
+	{
+		count = 0;
+	}
+
+	template <typename V>
+	void push_back(const V& vec)
+	{
+		// vec may refer into this array, so read it before relayout frees it
+		const value_type val(vec);
+		if(count == stride) {
+			this->relayout(round_stride(stride == 0 ? lane_granularity : stride * 2));
+		}
+		++count;
+		(*this)[count - 1] = val;
+	}
+
+	T* lane(unsigned int k)
+	{
+		return storage.data() + k * stride;
+	}
+
+	const T* lane(unsigned int k) const
+	{
+		return storage.data() + k * stride;
+	}
+
+	std::array<T*, N> lanes()
+	{
+		std::array<T*, N> out;
+		for(unsigned int k = 0; k < N; ++k) {
+			out[k] = this->lane(k);
+		}
+		return out;
+	}
+
+	std::array<const T*, N> lanes() const
+	{
+		std::array<const T*, N> out;
+		for(unsigned int k = 0; k < N; ++k) {
+			out[k] = this->lane(k);
+		}
+		return out;
+	}
+
+	reference operator[](size_type idx)
+	{
+		assert(idx < count);
+		return reference(this->lanes(), idx);
+	}
+
+	const_reference operator[](size_type idx) const
+	{
+		assert(idx < count);
+		return const_reference(this->lanes(), idx);
+	}
+
+	reference front()
+	{
+		return (*this)[0];
+	}
+
+	reference back()
+	{
+		return (*this)[count - 1];
+	}
+
+	basic_iterator<false> begin()
+	{
+		return {this, 0};
+	}
+
+	basic_iterator<false> end()
+	{
+		return {this, count};
+	}
+
+	basic_iterator<true> begin() const
+	{
+		return {this, 0};
+	}
+
+	basic_iterator<true> end() const
+	{
+		return {this, count};
+	}
+};
+
+namespace utility {
+
+	template <typename T>
+	struct is_vector_array
+		: std::false_type
+	{
+	};
+
+	template <typename T, unsigned int N>
+	struct is_vector_array<vector_array<T, N>>
+		: std::true_type
+	{
+	};
+
+	template <typename L, typename R>
+	using if_array_operands = std::enable_if_t<
+		is_vector_array<std::decay_t<L>>::value || is_vector_array<std::decay_t<R>>::value, int>;
+
+	/*
+	 * Per-element access for array_apply arguments. Arrays are indexed
+	 * through their lane pointers, which are read once before the loop.
+	 * Everything else is copied once and broadcast, so the loop body cannot
+	 * observe writes to it through the output.
+	 */
+	template <typename A>
+	struct array_cursor
+	{
+		std::decay_t<A> val;
+
+		array_cursor(const A& a)
+			: val(a)
+		{
+		}
+
+		const std::decay_t<A>& operator[](std::size_t /* idx */) const
+		{
+			return val;
+		}
+	};
+
+	template <typename T, unsigned int N>
+	struct array_cursor<vector_array<T, N>>
+	{
+		std::array<T*, N> lanes;
+
+		array_cursor(vector_array<T, N>& arr)
+			: lanes(arr.lanes())
+		{
+		}
+
+		soa_element<T, N> operator[](std::size_t idx) const
+		{
+			return soa_element<T, N>(lanes, idx);
+		}
+	};
+
+	template <typename T, unsigned int N>
+	struct array_cursor<const vector_array<T, N>>
+	{
+		std::array<const T*, N> lanes;
+
+		array_cursor(const vector_array<T, N>& arr)
+			: lanes(arr.lanes())
+		{
+		}
+
+		soa_element<const T, N> operator[](std::size_t idx) const
+		{
+			return soa_element<const T, N>(lanes, idx);
+		}
+	};
+
+	template <typename T, typename Alloc>
+	struct array_cursor<std::vector<T, Alloc>>
+	{
+		T* ptr;
+
+		array_cursor(std::vector<T, Alloc>& arr)
+			: ptr(arr.data())
+		{
+		}
+
+		T& operator[](std::size_t idx) const
+		{
+			return ptr[idx];
+		}
+	};
+
+	template <typename T, typename Alloc>
+	struct array_cursor<const std::vector<T, Alloc>>
+	{
+		const T* ptr;
+
+		array_cursor(const std::vector<T, Alloc>& arr)
+			: ptr(arr.data())
+		{
+		}
+
+		const T& operator[](std::size_t idx) const
+		{
+			return ptr[idx];
+		}
+	};
+
+	template <typename T, unsigned int N>
+	struct array_cursor<strided_view<T, N>>
+	{
+		strided_view<T, N> view;
+
+		array_cursor(const strided_view<T, N>& v)
+			: view(v)
+		{
+		}
+
+		vector_ref<T, N> operator[](std::size_t idx) const
+		{
+			return view[idx];
+		}
+	};
+
+	// views refer to the buffer rather than own it, so const views can still be written through
+	template <typename T, unsigned int N>
+	struct array_cursor<const strided_view<T, N>>
+		: array_cursor<strided_view<T, N>>
+	{
+		using array_cursor<strided_view<T, N>>::array_cursor;
+	};
+
+	template <typename A>
+	using array_cursor_for = array_cursor<std::remove_reference_t<A>>;
+
+	// the overloads taking an execution policy are in exec.hpp
+	template <typename T>
+	using if_not_policy = std::enable_if_t<!std::is_same<std::decay_t<T>, exec::policy>::value, int>;
+
+	template <typename A, std::enable_if_t<is_vector_array<std::decay_t<A>>::value, int> = 0>
+	std::size_t array_size(const A& arr, std::size_t prev)
+	{
+		assert(prev == std::size_t(-1) || prev == arr.size());
+		(void)prev;
+		return arr.size();
+	}
+
+	template <typename T, typename Alloc>
+	std::size_t array_size(const std::vector<T, Alloc>& arr, std::size_t prev)
+	{
+		assert(prev == std::size_t(-1) || prev == arr.size());
+		(void)prev;
+		return arr.size();
+	}
+
+	template <typename T, unsigned int N>
+	std::size_t array_size(const strided_view<T, N>& view, std::size_t prev)
+	{
+		assert(prev == std::size_t(-1) || prev == view.size());
+		(void)prev;
+		return view.size();
+	}
+
+	template <typename A, std::enable_if_t<!is_vector_array<std::decay_t<A>>::value, int> = 0>
+	std::size_t array_size(const A& /* val */, std::size_t prev)
+	{
+		return prev;
+	}
+
+	template <typename... As>
+	std::size_t common_array_size(const As&... args)
+	{
+		std::size_t size = std::size_t(-1);
+		(void)std::initializer_list<int>{ (size = array_size(args, size), 0)... };
+		return size;
+	}
+
+	/*
+	 * Result container for array_apply: vector results are collected into a
+	 * vector_array, scalar results into a std::vector.
+	 */
+	template <typename R, typename = void>
+	struct array_result
+	{
+		using type = std::vector<std::decay_t<R>>;
+	};
+
+	template <typename R>
+	struct array_result<R, std::enable_if_t<is_tied_vector<R>::value>>
+	{
+		using tie_type = std::decay_t<tie_detect<R>>;
+		using type = vector_array<
+			std::decay_t<typename tuple_traits<tie_type>::common_type>,
+			tuple_traits<tie_type>::size>;
+	};
+
+} // namespace utility
+
+/**
+ * \fn array_transform
+ * \brief apply a function to every element, writing into an existing array
+ *
+ * For each index i, this stores f(args[i]...) into out[i]. vector_array,
+ * std::vector and strided_view arguments are indexed (and must all have the
+ * same size as out), any other argument is passed unchanged to every call. out
+ * may also be one of the arguments, for in-place updates. Views of the same
+ * buffer may be combined as long as they do not overlap, e.g. the positions
+ * and normals of interleaved vertices.
+ *
+ * f must only depend on its arguments, since iterations are assumed to be
+ * independent. The loop vectorises best when f works on the elements
+ * directly: intermediate velm::vector values which fill a register (e.g. 4
+ * floats) use the packed operators from simd.hpp, which the compiler cannot
+ * vectorise across elements. Note that std::sqrt (e.g. in length and
+ * normalize) only vectorises when errno is not required (-fno-math-errno).
+ */
+template <typename Out, typename F, utility::if_not_policy<Out> = 0, typename... Args>
+Out& array_transform(Out& out, F&& f, Args&&... args)
+{
+	const std::size_t size = out.size();
+	assert(utility::common_array_size(args...) == std::size_t(-1)
+		|| utility::common_array_size(args...) == size);
+
+	utility::array_cursor<Out> dst(out);
+	auto run = [&] (auto... srcs) {
+		// elements are independent, and out may only alias an input at the same index
+		VELM_IVDEP
+		for(std::size_t i = 0; i < size; ++i) {
+			dst[i] = f(srcs[i]...);
+		}
+	};
+	dispatch::invoke([&] {
+		run(utility::array_cursor_for<Args>(args)...);
+	});
+	return out;
+}
+
+/**
+ * \fn array_apply
+ * \brief apply a function to every element, collecting the results
+ *
+ * Similar to array_transform, but allocates the output. If f returns a
+ * vector, the result is a vector_array; otherwise it is a std::vector.
+ *
+ *      auto n = velm::array_apply([] (auto&& p) { return velm::normalize(p); }, points);
+ *      auto d = velm::array_apply([] (auto&& a, auto&& b) { return velm::dot(a, b); }, p, q);
+ */
+template <typename F, utility::if_not_policy<F> = 0, typename... Args>
+auto array_apply(F&& f, Args&&... args)
+{
+	using result_type = decltype(f(std::declval<utility::array_cursor_for<Args>&>()[0]...));
+	using out_type = typename utility::array_result<result_type>::type;
+
+	const std::size_t size = utility::common_array_size(args...);
+	static_assert(sizeof...(Args) > 0, "At least one argument is required");
+	assert(size != std::size_t(-1) && "At least one argument must be an array");
+
+	out_type out(size);
+	return array_transform(out, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+// operators {{{
+
+/*
+ * Arithmetic on whole arrays. At least one operand must be a vector_array; the
+ * other may be an array of the same size, a vector, or a scalar.
+ */
+
+template <typename L, typename R, utility::if_array_operands<L, R> = 0>
+auto operator+(const L& lhs, const R& rhs)
+{
+	return array_apply([] (auto&& a, auto&& b) { return a + b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_array_operands<L, R> = 0>
+auto operator-(const L& lhs, const R& rhs)
+{
+	return array_apply([] (auto&& a, auto&& b) { return a - b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_array_operands<L, R> = 0>
+auto operator*(const L& lhs, const R& rhs)
+{
+	return array_apply([] (auto&& a, auto&& b) { return a * b; }, lhs, rhs);
+}
+
+template <typename L, typename R, utility::if_array_operands<L, R> = 0>
+auto operator/(const L& lhs, const R& rhs)
+{
+	return array_apply([] (auto&& a, auto&& b) { return a / b; }, lhs, rhs);
+}
+
+template <typename T, unsigned int N>
+auto operator-(const vector_array<T, N>& arr)
+{
+	return array_apply([] (auto&& a) { return -a; }, arr);
+}
+
+template <typename T, unsigned int N, typename R>
+vector_array<T, N>& operator+=(vector_array<T, N>& lhs, const R& rhs)
+{
+	return array_transform(lhs, [] (auto&& a, auto&& b) { return a + b; }, lhs, rhs);
+}
+
+template <typename T, unsigned int N, typename R>
+vector_array<T, N>& operator-=(vector_array<T, N>& lhs, const R& rhs)
+{
+	return array_transform(lhs, [] (auto&& a, auto&& b) { return a - b; }, lhs, rhs);
+}
+
+template <typename T, unsigned int N, typename R>
+vector_array<T, N>& operator*=(vector_array<T, N>& lhs, const R& rhs)
+{
+	return array_transform(lhs, [] (auto&& a, auto&& b) { return a * b; }, lhs, rhs);
+}
+
+template <typename T, unsigned int N, typename R>
+vector_array<T, N>& operator/=(vector_array<T, N>& lhs, const R& rhs)
+{
+	return array_transform(lhs, [] (auto&& a, auto&& b) { return a / b; }, lhs, rhs);
+}
+
+// }}}
+
+} // namespace velm
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "defs.hpp"
+#include "base.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+#include "ops.hpp"
+
+/**
+ * \file view.hpp
+ * \brief vectors over storage owned by someone else
+ *
+ * velm::vector_ref<T, N> refers to N consecutive components in memory that
+ * velm does not own, such as a vertex buffer from a file loader or a mapped
+ * file. Like the elements of a vector_array, it is a tied vector with the
+ * same swizzle members as velm::vector, so every operator and function works
+ * on it, and assigning to it (or to a swizzle) writes through.
+ *
+ * velm::strided_view<T, N> is a range of vector_refs into an interleaved
+ * buffer, given the address of the buffer, the number of vectors, the
+ * distance in bytes between consecutive vectors (the stride) and the offset
+ * in bytes of the first vector, as for the vertex attributes of a graphics
+ * API. array_transform and array_apply (see vector_array.hpp) accept views,
+ * so attributes can be processed in place:
+ *
+ *      struct vertex { float pos[3]; float normal[3]; float uv[2]; };
+ *      velm::strided_view<float, 3> normals(verts, count, sizeof(vertex), offsetof(vertex, normal));
+ *      velm::array_transform(normals, [] (auto&& n) { return velm::normalize(n); }, normals);
+ *      normals[0].xy = normals[1].yx;
+ *
+ * The buffer must hold objects of type T (e.g. floats read into a float
+ * array, or an array of structs with float members), suitably aligned.
+ * Views with a const component type are read-only. Views do not own or
+ * track the buffer, so they must not outlive it.
+ */
+
+namespace velm {
+
+/**
+ * \struct lane_ref
+ * \brief reference to a single component in a lane
+ *
+ * This is the component type of soa_element and vector_ref. It converts to a
+ * reference to the component, and assignment writes through instead of
+ * rebinding.
+ */
+template <typename T>
+struct lane_ref
+{
+	T* ptr;
+
+	constexpr T& get() const
+	{
+		return *ptr;
+	}
+
+	constexpr operator T&() const
+	{
+		return *ptr;
+	}
+
+	const lane_ref& operator=(const lane_ref& other) const
+	{
+		*ptr = *other.ptr;
+		return *this;
+	}
+
+	template <typename U>
+	const lane_ref& operator=(U&& val) const
+	{
+		*ptr = std::forward<U>(val);
+		return *this;
+	}
+};
+
+/**
+ * \struct lane_swizzle
+ * \brief swizzle over lane references
+ *
+ * Equivalent of swizzle_proxy for soa_element and vector_ref. The underlying
+ * storage is an array of lane_ref rather than of values, so the tie refers
+ * directly to the lanes. As with swizzle_proxy, only the members which must be
+ * in the class are declared there, to keep instantiating all the swizzles
+ * cheap.
+ */
+template <typename R, unsigned int... N>
+struct lane_swizzle
+{
+public: // statics
+
+	static constexpr auto dimensions = sizeof...(N);
+	using value_type = std::remove_const_t<std::remove_reference_t<decltype(std::declval<R>().get())>>;
+
+public:
+
+	std::array<R, utility::tmax<unsigned int, N...>::value + 1> underlying;
+
+	lane_swizzle& operator=(const lane_swizzle& other);
+
+	template <typename U>
+	lane_swizzle& operator=(U&& val);
+
+	constexpr auto operator()() const;
+};
+
+namespace usr {
+
+	template <typename R, unsigned int... N>
+	struct tie<lane_swizzle<R, N...>>
+	{
+		constexpr auto operator()(const lane_swizzle<R, N...>& p) const
+		{
+			return std::tie(std::get<N>(p.underlying).get()...);
+		}
+	};
+
+} // namespace usr
+
+namespace detail {
+
+	template <typename P, typename U>
+	void lane_swizzle_assign(P& proxy, U&& vec, std::true_type /* tied */)
+	{
+		static_assert(P::dimensions == std::tuple_size<std::decay_t<decltype(get_tie(vec))>>::value,
+		              "Ties must be the same size");
+		get_tie(proxy) = vector<typename P::value_type, P::dimensions>(vec).tie();
+	}
+
+	template <typename P, typename U>
+	void lane_swizzle_assign(P& proxy, U&& val, std::false_type /* tied */)
+	{
+		get_tie(proxy) = utility::make_filled_tuple<P::dimensions>(val);
+	}
+
+} // namespace detail
+
+template <typename R, unsigned int... N>
+lane_swizzle<R, N...>& lane_swizzle<R, N...>::operator=(const lane_swizzle& other)
+{
+	get_tie(*this) = vector<value_type, dimensions>(other).tie();
+	return *this;
+}
+
+template <typename R, unsigned int... N>
+template <typename U>
+lane_swizzle<R, N...>& lane_swizzle<R, N...>::operator=(U&& val)
+{
+	detail::lane_swizzle_assign(*this, std::forward<U>(val), utility::is_tied_vector<U>());
+	return *this;
+}
+
+template <typename R, unsigned int... N>
+constexpr auto lane_swizzle<R, N...>::operator()() const
+{
+	return vector<value_type, dimensions>::from_tuple(get_tie(*this));
+}
+
+
+/**
+ * \struct vector_ref
+ * \brief non-owning reference to a vector in memory
+ *
+ * This behaves like a velm::vector<T, N> whose components are the N values
+ * starting at a pointer. As with soa_element, assigning to it first converts
+ * the source to a vector, so aliasing assignments such as r.xy = r.yx behave
+ * as they would for values. Use a const T for read-only references.
+ */
+template <typename T, unsigned int N>
+struct vector_ref
+	: public vec_base<lane_ref<T>, N, lane_swizzle>
+{
+public: // statics
+
+	static constexpr auto dimensions = N;
+	using value_type = std::remove_const_t<T>;
+
+private: // internal methods
+
+	using base_type = vec_base<lane_ref<T>, N, lane_swizzle>;
+
+	template <std::size_t... Is>
+	constexpr vector_ref(T* ptr, std::index_sequence<Is...> /* seq */)
+		: base_type{{{{lane_ref<T>{ptr + Is}...}}}}
+	{
+	}
+
+	template <std::size_t... Is>
+	constexpr auto tie_impl(std::index_sequence<Is...> /* seq */) const
+	{
+		return std::tie(std::get<Is>(this->data).get()...);
+	}
+
+public: // methods
+
+	// refer to ptr[0] to ptr[N - 1]
+	explicit constexpr vector_ref(T* ptr)
+		: vector_ref(ptr, std::make_index_sequence<N>())
+	{
+	}
+
+	// refer to the components of a vector
+	constexpr vector_ref(vector<value_type, N>& vec)
+		: vector_ref(vec.data.data())
+	{
+	}
+
+	template <typename U = T, std::enable_if_t<std::is_const<U>::value, int> = 0>
+	constexpr vector_ref(const vector<value_type, N>& vec)
+		: vector_ref(vec.data.data())
+	{
+	}
+
+	// a temporary would be gone before the reference is used
+	vector_ref(vector<value_type, N>&& vec) = delete;
+
+	// read-only reference to the same components
+	template <typename U = T, std::enable_if_t<std::is_const<U>::value, int> = 0>
+	constexpr vector_ref(const vector_ref<value_type, N>& other)
+		: vector_ref(&other[0])
+	{
+	}
+
+	constexpr vector_ref(const vector_ref& other)
+		: base_type(other)
+	{
+	}
+
+	vector_ref& operator=(const vector_ref& other)
+	{
+		this->tie() = vector<value_type, N>(other).tie();
+		return *this;
+	}
+
+	template <typename V,
+		std::enable_if_t<utility::is_tied_vector<V>::value, int> = 0>
+	vector_ref& operator=(V&& vec)
+	{
+		this->tie() = vector<value_type, N>(vec).tie();
+		return *this;
+	}
+
+	template <typename U,
+		std::enable_if_t<!utility::is_tied_vector<U>::value, int> = 0>
+	vector_ref& operator=(U&& val)
+	{
+		this->tie() = utility::make_filled_tuple<N>(val);
+		return *this;
+	}
+
+	constexpr auto tie() const
+	{
+		return this->tie_impl(std::make_index_sequence<N>());
+	}
+
+	constexpr T& operator[](std::size_t idx) const
+	{
+		return this->data[idx].get();
+	}
+
+	constexpr vector<value_type, N> operator()() const
+	{
+		return static_cast<vector<value_type, N>>(*this);
+	}
+
+	constexpr operator vector<value_type, N>() const
+	{
+		return vector<value_type, N>::from_tuple(this->tie());
+	}
+};
+
+/*
+ * References from a view are usually temporaries (e.g. view[i] += v), which
+ * the compound operators of ops.hpp do not take, as they modify an lvalue.
+ * Assigning through the temporary still modifies the buffer, so allow it.
+ */
+template <typename T, unsigned int N, typename R>
+vector_ref<T, N> operator+=(vector_ref<T, N>&& lhs, R&& rhs)
+{
+	lhs += std::forward<R>(rhs);
+	return lhs;
+}
+
+template <typename T, unsigned int N, typename R>
+vector_ref<T, N> operator-=(vector_ref<T, N>&& lhs, R&& rhs)
+{
+	lhs -= std::forward<R>(rhs);
+	return lhs;
+}
+
+template <typename T, unsigned int N, typename R>
+vector_ref<T, N> operator*=(vector_ref<T, N>&& lhs, R&& rhs)
+{
+	lhs *= std::forward<R>(rhs);
+	return lhs;
+}
+
+template <typename T, unsigned int N, typename R>
+vector_ref<T, N> operator/=(vector_ref<T, N>&& lhs, R&& rhs)
+{
+	lhs /= std::forward<R>(rhs);
+	return lhs;
+}
+
+/**
+ * \struct strided_view
+ * \brief range of vectors in an interleaved buffer
+ *
+ * Vector i of the view is the vector_ref to the N components at byte
+ * offset + i * stride of the buffer. The stride defaults to that of tightly
+ * packed vectors, so an array of velm::vector<T, N> (which has no padding)
+ * can also be viewed. Like a pointer, a view is cheap to copy, and copies
+ * refer to the same buffer.
+ */
+template <typename T, unsigned int N>
+struct strided_view
+{
+public: // statics
+
+	static constexpr auto dimensions = N;
+
+	using value_type = vector<std::remove_const_t<T>, N>;
+	using component_type = T;
+	using reference = vector_ref<T, N>;
+	using size_type = std::size_t;
+	using pointer_type = std::conditional_t<std::is_const<T>::value, const void*, void*>;
+	using byte_type = std::conditional_t<std::is_const<T>::value, const unsigned char, unsigned char>;
+
+	struct iterator
+	{
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = strided_view::value_type;
+		using difference_type = std::ptrdiff_t;
+		using reference = strided_view::reference;
+		using pointer = void;
+
+		byte_type* pos;
+		size_type step;
+
+		reference operator*() const
+		{
+			return reference(reinterpret_cast<T*>(pos));
+		}
+
+		iterator& operator++()
+		{
+			pos += step;
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			auto copy = *this;
+			pos += step;
+			return copy;
+		}
+
+		bool operator==(const iterator& other) const
+		{
+			return pos == other.pos;
+		}
+
+		bool operator!=(const iterator& other) const
+		{
+			return pos != other.pos;
+		}
+	};
+
+private:
+
+	byte_type* first = nullptr;
+	size_type count = 0;
+	size_type step = 0;
+
+public: // methods
+
+	strided_view() = default;
+
+	strided_view(pointer_type data, size_type size, size_type stride = sizeof(T) * N, size_type offset = 0)
+		: first(static_cast<byte_type*>(data) + offset), count(size), step(stride)
+	{
+		assert(reinterpret_cast<std::uintptr_t>(first) % alignof(T) == 0 && "Components must be aligned");
+		assert(stride % alignof(T) == 0 && "Components must be aligned");
+	}
+
+	// read-only view of the same vectors
+	template <typename U = T, std::enable_if_t<std::is_const<U>::value, int> = 0>
+	strided_view(const strided_view<std::remove_const_t<T>, N>& other)
+		: strided_view(other.data(), other.size(), other.stride())
+	{
+	}
+
+	size_type size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	// distance in bytes between consecutive vectors
+	size_type stride() const
+	{
+		return step;
+	}
+
+	// address of the first vector
+	pointer_type data() const
+	{
+		return first;
+	}
+
+	reference operator[](size_type idx) const
+	{
+		assert(idx < count);
+		return reference(reinterpret_cast<T*>(first + idx * step));
+	}
+
+	reference front() const
+	{
+		return (*this)[0];
+	}
+
+	reference back() const
+	{
+		return (*this)[count - 1];
+	}
+
+	iterator begin() const
+	{
+		return {first, step};
+	}
+
+	iterator end() const
+	{
+		return {first + count * step, step};
+	}
+};
+
+} // namespace velm
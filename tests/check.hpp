@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+/*
+ * Minimal checks for the tests: each failure is printed with its location,
+ * and report() gives the exit code. Tests keep going after a failure, so one
+ * run shows every case which is off.
+ */
+
+namespace check {
+
+inline int& failures()
+{
+	static int count = 0;
+	return count;
+}
+
+// prints the message only for the first few failures of a test
+inline bool fail(const char* file, int line, const char* fmt, ...)
+{
+	if(++failures() <= 20) {
+		std::fprintf(stderr, "%s:%d: ", file, line);
+		va_list args;
+		va_start(args, fmt);
+		std::vfprintf(stderr, fmt, args);
+		va_end(args);
+		std::fputc('\n', stderr);
+	}
+	return false;
+}
+
+inline int report(const char* name)
+{
+	if(failures() > 0) {
+		std::fprintf(stderr, "%s: %d failures\n", name, failures());
+		return 1;
+	}
+	std::printf("%s: ok\n", name);
+	return 0;
+}
+
+// exit code which ctest reports as skipped (see SKIP_RETURN_CODE)
+constexpr int skipped = 77;
+
+} // namespace check
+
+#define CHECK(cond) \
+	((cond) ? true : check::fail(__FILE__, __LINE__, "check failed: %s", #cond))
+
+#define CHECK_MSG(cond, ...) \
+	((cond) ? true : check::fail(__FILE__, __LINE__, __VA_ARGS__))
@@ -0,0 +1,310 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "velm.hpp"
+#include "velm/io.hpp"
+
+/*
+ * Files of velm/io.hpp: round trips in both layouts, with and without
+ * checksums, and headers crafted to point outside the file, which must throw
+ * io::error rather than be read.
+ *
+ * This file is also built with VELM_MMAP=0 and AddressSanitizer, where files
+ * are read into a heap buffer, so a read past the end of a file is reported.
+ */
+
+namespace {
+
+using vec3 = velm::vector<float, 3>;
+
+const char* const path = "io_format_test.velm";
+
+using bytes = std::vector<char>;
+
+bytes read_file(const char* name)
+{
+	std::ifstream file(name, std::ios::binary);
+	return bytes(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void write_file(const char* name, const bytes& data)
+{
+	std::ofstream file(name, std::ios::binary | std::ios::trunc);
+	file.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+velm::io::header get_header(const bytes& data)
+{
+	velm::io::header h;
+	std::memcpy(&h, data.data(), sizeof(h));
+	return h;
+}
+
+void set_header(bytes& data, const velm::io::header& h)
+{
+	std::memcpy(data.data(), &h, sizeof(h));
+}
+
+vec3 value(std::size_t i)
+{
+	return vec3(float(i), float(i) * 0.5f, -float(i));
+}
+
+bool same(const vec3& a, const vec3& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+std::vector<vec3> values(std::size_t n)
+{
+	std::vector<vec3> out(n);
+	for(std::size_t i = 0; i < n; ++i) {
+		out[i] = value(i);
+	}
+	return out;
+}
+
+const char* layout_name(velm::io::layout l)
+{
+	return l == velm::io::layout::aos ? "aos" : "soa";
+}
+
+// round trips {{{
+
+void round_trip(velm::io::layout layout, std::uint64_t chunk, std::size_t n)
+{
+	const std::vector<vec3> in = values(n);
+	velm::io::options opts;
+	opts.layout = layout;
+	opts.chunk = chunk;
+	velm::io::save(path, in.data(), in.size(), opts);
+
+	const velm::io::header info = velm::io::inspect(path);
+	CHECK(info.count == n && info.layout == layout && info.chunk == chunk);
+
+	const velm::io::mapped_array<float, 3> arr(path);
+	CHECK_MSG(arr.size() == n, "%s, chunk %llu, %zu vectors: size %zu", layout_name(layout),
+		static_cast<unsigned long long>(chunk), n, arr.size());
+	CHECK(arr.layout() == layout);
+	CHECK(arr.has_checksums() == (chunk != 0));
+	try {
+		arr.verify();
+	} catch(const velm::io::error& e) {
+		CHECK_MSG(false, "%s, chunk %llu, %zu vectors: %s", layout_name(layout),
+			static_cast<unsigned long long>(chunk), n, e.what());
+	}
+	for(std::size_t i = 0; i < n && i < arr.size(); ++i) {
+		CHECK_MSG(same(arr.element(i), in[i]), "%s, chunk %llu: element %zu differs", layout_name(layout),
+			static_cast<unsigned long long>(chunk), i);
+		if(layout == velm::io::layout::aos) {
+			CHECK(same(arr.vectors()[i], in[i]));
+		} else {
+			CHECK(arr.lane(0)[i] == in[i].x && arr.lane(1)[i] == in[i].y && arr.lane(2)[i] == in[i].z);
+		}
+	}
+}
+
+void round_trips()
+{
+	for(velm::io::layout layout : {velm::io::layout::aos, velm::io::layout::soa}) {
+		for(std::uint64_t chunk : {std::uint64_t(0), std::uint64_t(7), std::uint64_t(1000)}) {
+			for(std::size_t n : {std::size_t(0), std::size_t(1), std::size_t(100), std::size_t(70000)}) {
+				round_trip(layout, chunk, n);
+			}
+		}
+	}
+
+	// vector_array, and other component types
+	velm::vector_array<std::int16_t, 2> arr;
+	for(int i = 0; i < 300; ++i) {
+		arr.push_back(velm::vector<std::int16_t, 2>(std::int16_t(i), std::int16_t(-i)));
+	}
+	velm::io::save(path, arr, velm::io::options{velm::io::layout::soa, 16, 0});
+	const velm::io::mapped_array<std::int16_t, 2> back(path);
+	back.verify();
+	CHECK(back.size() == arr.size());
+	for(std::size_t i = 0; i < arr.size() && i < back.size(); ++i) {
+		CHECK(back.lane(0)[i] == arr[i].x && back.lane(1)[i] == arr[i].y);
+	}
+}
+
+// }}}
+// invalid files {{{
+
+// whether opening the file, and verifying it, throws io::error
+template <typename T = float, unsigned int N = 3>
+bool rejected(const bytes& data)
+{
+	write_file(path, data);
+	try {
+		const velm::io::mapped_array<T, N> arr(path);
+		arr.verify();
+	} catch(const velm::io::error&) {
+		return true;
+	}
+	return false;
+}
+
+bool inspect_rejects(const bytes& data)
+{
+	write_file(path, data);
+	try {
+		velm::io::inspect(path);
+	} catch(const velm::io::error&) {
+		return true;
+	}
+	return false;
+}
+
+bytes valid_file(velm::io::layout layout, std::uint64_t chunk)
+{
+	const std::vector<vec3> in = values(100);
+	velm::io::options opts;
+	opts.layout = layout;
+	opts.chunk = chunk;
+	velm::io::save(path, in.data(), in.size(), opts);
+	return read_file(path);
+}
+
+void invalid_headers()
+{
+	for(velm::io::layout layout : {velm::io::layout::aos, velm::io::layout::soa}) {
+		const char* name = layout_name(layout);
+		const bytes good = valid_file(layout, 7);
+		CHECK_MSG(!rejected(good), "%s: valid file rejected", name);
+		const velm::io::header h = get_header(good);
+
+		// shorter than the header
+		CHECK_MSG(rejected(bytes(good.begin(), good.begin() + 100)), "%s: partial header accepted", name);
+
+		// payload or checksum table cut short
+		for(std::size_t cut : {std::size_t(8), std::size_t(8 * 15), good.size() - h.payload - 4}) {
+			CHECK_MSG(rejected(bytes(good.begin(), good.end() - static_cast<std::ptrdiff_t>(cut))),
+				"%s: file cut by %zu bytes accepted", name, cut);
+		}
+
+		bytes data = good;
+		velm::io::header bad = h;
+		/*
+		 * Headers which stay inside the file, but are wrong, may only be
+		 * found by verify(), so inspect need not reject them.
+		 */
+		const auto reject = [&] (const char* what, bool by_inspect = true) {
+			set_header(data, bad);
+			CHECK_MSG(rejected(data), "%s: %s accepted", name, what);
+			CHECK_MSG(!by_inspect || inspect_rejects(data), "%s: %s passed inspect", name, what);
+			bad = h;
+		};
+
+		bad.magic[0] = 'x';
+		reject("bad signature");
+		bad.version = 0;
+		reject("version 0");
+		bad.byte_order = 0x04030201;
+		reject("other byte order");
+		bad.payload += 8;
+		reject("misaligned payload");
+		bad.count += 1;
+		reject("one vector too many", false);
+		bad.count = ~std::uint64_t(0) / 4;
+		reject("huge count");
+		bad.layout = static_cast<velm::io::layout>(7);
+		reject("unknown layout");
+		bad.checksums = good.size();
+		reject("checksums at the end of the file");
+		bad.checksums = ~std::uint64_t(0) - 7;
+		reject("checksums past the end of the file");
+		bad.checksums += 4;
+		reject("misaligned checksums");
+		bad.chunk = 1;
+		reject("more chunks than checksums");
+		// one chunk of every vector, which the table has room for, but whose checksum is wrong
+		bad.chunk = ~std::uint64_t(0);
+		reject("huge chunk", false);
+		if(layout == velm::io::layout::soa) {
+			bad.lane_stride += 4;
+			reject("misaligned lane_stride");
+			bad.lane_stride = 64;
+			reject("lanes shorter than count");
+			bad.lane_stride = ~std::uint64_t(0) & ~std::uint64_t(63);
+			reject("huge lane_stride");
+		}
+
+		// the wrong component type or dimensions
+		const bool as_double = rejected<double, 3>(good);
+		const bool as_int = rejected<std::int32_t, 3>(good);
+		const bool as_2d = rejected<float, 2>(good);
+		const bool as_4d = rejected<float, 4>(good);
+		CHECK_MSG(as_double && as_int, "%s: opened float file with another component type", name);
+		CHECK_MSG(as_2d && as_4d, "%s: opened 3 dimensional file with other dimensions", name);
+	}
+}
+
+// }}}
+// checksums {{{
+
+void flipped_bytes()
+{
+	for(velm::io::layout layout : {velm::io::layout::aos, velm::io::layout::soa}) {
+		const char* name = layout_name(layout);
+		const bytes good = valid_file(layout, 7);
+		const velm::io::header h = get_header(good);
+
+		// a byte of vector 50 (in chunk 7), in its last component
+		const std::uint64_t at = layout == velm::io::layout::aos
+			? h.payload + (50 * 3 + 2) * sizeof(float) + 1
+			: h.payload + 2 * h.lane_stride + 50 * sizeof(float) + 1;
+		bytes data = good;
+		data[at] ^= 0x10;
+		write_file(path, data);
+
+		const velm::io::mapped_array<float, 3> arr(path);
+		bool thrown = false;
+		try {
+			// chunks 0 to 6 and 8 to 14 are intact
+			arr.verify(0, 49);
+			arr.verify(56, 44);
+		} catch(const velm::io::error& e) {
+			CHECK_MSG(false, "%s: intact chunks fail: %s", name, e.what());
+		}
+		try {
+			arr.verify(50, 1);
+		} catch(const velm::io::error&) {
+			thrown = true;
+		}
+		CHECK_MSG(thrown, "%s: flipped byte not found by verify(50, 1)", name);
+
+		thrown = false;
+		try {
+			arr.verify();
+		} catch(const velm::io::error&) {
+			thrown = true;
+		}
+		CHECK_MSG(thrown, "%s: flipped byte not found by verify()", name);
+
+		// a flipped checksum is a mismatch too
+		data = good;
+		data[h.checksums + 3 * sizeof(std::uint64_t)] ^= 1;
+		CHECK_MSG(rejected(data), "%s: flipped checksum accepted", name);
+	}
+}
+
+// }}}
+
+} // namespace
+
+int main()
+{
+	round_trips();
+	invalid_headers();
+	flipped_bytes();
+	std::remove(path);
+
+	return check::report("io_format");
+}
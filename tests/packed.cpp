@@ -0,0 +1,344 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "check.hpp"
+#include "velm.hpp"
+#include "velm/packed.hpp"
+
+/*
+ * The storage formats of packed.hpp against their documented round trip
+ * errors, converting both one element at a time and with batch::encode and
+ * batch::decode:
+ *
+ *  - every half bit pattern, and floats around every rounding boundary,
+ *    against the F16C instructions when the CPU has them;
+ *  - every snorm8, snorm16, unorm8 and unorm16 code, and the floats just
+ *    below and above the half step after it;
+ *  - the worst angle of oct16 and oct32 over random and near-axis normals.
+ *
+ * Run at the best level, where batch half conversions use F16C, and with
+ * VELM_ISA=baseline, where they use the software conversions. Decoded normals
+ * must match the scalar ones bit for bit only at the baseline, since the
+ * AVX2 loops may contract into FMA.
+ */
+
+namespace {
+
+using vec3 = velm::vector<float, 3>;
+
+std::uint32_t float_bits(float f)
+{
+	std::uint32_t b;
+	std::memcpy(&b, &f, sizeof(b));
+	return b;
+}
+
+float bits_float(std::uint32_t b)
+{
+	float f;
+	std::memcpy(&f, &b, sizeof(f));
+	return f;
+}
+
+bool is_nan_half(std::uint16_t h)
+{
+	return (h & 0x7c00u) == 0x7c00u && (h & 0x3ffu) != 0;
+}
+
+// equal, or both NaN, which may have different payloads
+bool same_half(std::uint16_t a, std::uint16_t b)
+{
+	return a == b || (is_nan_half(a) && is_nan_half(b));
+}
+
+bool same_float(float a, float b)
+{
+	return float_bits(a) == float_bits(b) || (a != a && b != b);
+}
+
+#if VELM_DISPATCH
+
+bool have_f16c()
+{
+	return __builtin_cpu_supports("f16c");
+}
+
+__attribute__((target("f16c"))) std::uint16_t f16c_from_float(float f)
+{
+	return static_cast<std::uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+}
+
+__attribute__((target("f16c"))) float f16c_to_float(std::uint16_t h)
+{
+	return _cvtsh_ss(h);
+}
+
+#else
+
+bool have_f16c()
+{
+	return false;
+}
+
+std::uint16_t f16c_from_float(float /* f */)
+{
+	return 0;
+}
+
+float f16c_to_float(std::uint16_t /* h */)
+{
+	return 0.f;
+}
+
+#endif
+
+// half {{{
+
+void check_half()
+{
+	const bool f16c = have_f16c();
+
+	// every half, to float and back
+	std::vector<velm::half> codes(65536);
+	for(std::uint32_t b = 0; b < 65536; ++b) {
+		codes[b] = velm::half::from_bits(static_cast<std::uint16_t>(b));
+	}
+	std::vector<float> wide(codes.size());
+	velm::batch::decode(codes, wide);
+	std::vector<velm::half> narrow(codes.size());
+	velm::batch::encode(wide, narrow);
+	for(std::uint32_t b = 0; b < 65536; ++b) {
+		const std::uint16_t h = static_cast<std::uint16_t>(b);
+		const float f = codes[b];
+		CHECK_MSG(same_float(wide[b], f), "half %04x: batch decode differs from the scalar one", b);
+		CHECK_MSG(!f16c || same_float(f, f16c_to_float(h)), "half %04x: decodes differently from F16C", b);
+		const std::uint16_t back = velm::half(f).bits;
+		CHECK_MSG(is_nan_half(h) ? is_nan_half(back) && (back & 0x200u) != 0 : back == h,
+			"half %04x: round trip gives %04x", b, back);
+		CHECK_MSG(same_half(narrow[b].bits, back), "half %04x: batch encode differs from the scalar one", b);
+	}
+
+	/*
+	 * Floats at and either side of the midpoint between each pair of
+	 * adjacent halves, where the rounding decides, and a sweep of all
+	 * magnitudes up to and past infinity.
+	 */
+	std::vector<float> in;
+	for(std::uint32_t b = 0; b < 0x7c00u; ++b) {
+		const float lo = velm::half::from_bits(static_cast<std::uint16_t>(b));
+		const float hi = velm::half::from_bits(static_cast<std::uint16_t>(b + 1));
+		const float mid = static_cast<float>((double(lo) + double(hi)) / 2);
+		for(float f : {mid, std::nextafter(mid, 0.f), std::nextafter(mid, 1e10f)}) {
+			in.push_back(f);
+			in.push_back(-f);
+		}
+	}
+	for(std::uint32_t b = 0; b < 0x80000000u; b += 0x3f1u) {
+		in.push_back(bits_float(b));
+		in.push_back(-bits_float(b));
+	}
+	narrow.resize(in.size());
+	velm::batch::encode(in, narrow);
+
+	// relative error bound in the normal range, with the largest finite half
+	const float smallest_normal = std::ldexp(1.f, -14);
+	const float largest = 65504.f;
+	const float overflow = 65520.f;
+	double worst = 0;
+	for(std::size_t i = 0; i < in.size(); ++i) {
+		const float f = in[i];
+		const std::uint16_t h = velm::half(f).bits;
+		CHECK_MSG(same_half(narrow[i].bits, h), "%a: batch encode %04x differs from the scalar %04x", f, narrow[i].bits, h);
+		CHECK_MSG(!f16c || same_half(h, f16c_from_float(f)), "%a: encodes to %04x, F16C to %04x", f, h, f16c_from_float(f));
+		const float a = std::fabs(f);
+		if(a != a) {
+			CHECK_MSG(is_nan_half(h), "%a: NaN encodes to %04x", f, h);
+		} else if(a >= overflow) {
+			CHECK_MSG((h & 0x7fffu) == 0x7c00u, "%a: encodes to %04x, not infinity", f, h);
+		} else if(a >= smallest_normal) {
+			const double err = std::fabs(double(float(velm::half::from_bits(h))) - f) / a;
+			worst = std::fmax(worst, err);
+			CHECK_MSG(err <= std::ldexp(1.0, -11), "%a: relative error %.3g", f, err);
+			CHECK_MSG(a > largest || (h & 0x7fffu) != 0x7c00u, "%a: finite value encodes to infinity", f);
+		}
+	}
+	std::printf("half: max relative error %.3g (bound %.3g), %s\n", worst, std::ldexp(1.0, -11),
+		f16c ? "checked against F16C" : "no F16C");
+}
+
+// }}}
+// snorm and unorm {{{
+
+template <typename N>
+void check_norm(const char* name)
+{
+	using I = decltype(N::from_bits(0).bits);
+	constexpr bool is_signed = std::is_signed<I>::value;
+	const double max = std::numeric_limits<I>::max();
+	const long lowest = is_signed ? -long(std::numeric_limits<I>::max()) : 0;
+	const long highest = long(std::numeric_limits<I>::max());
+
+	/*
+	 * For each code c, the float nearest c / max, and the floats just below
+	 * and just above the half step (c + 0.5) / max, with the code each must
+	 * encode to. Halves round away from zero.
+	 */
+	std::vector<float> in;
+	std::vector<long> want;
+	for(long c = lowest; c <= highest; ++c) {
+		in.push_back(static_cast<float>(c / max));
+		want.push_back(c);
+		if(c == highest) {
+			break;
+		}
+		const double step = (c + 0.5) / max;
+		const float mid = static_cast<float>(step);
+		const float below = double(mid) < step ? mid : std::nextafter(mid, -2.f);
+		const float above = double(mid) > step ? mid : std::nextafter(mid, 2.f);
+		in.push_back(below);
+		want.push_back(c);
+		in.push_back(above);
+		want.push_back(c + 1);
+		if(double(mid) == step) {
+			// exactly half a step, which rounds away from zero
+			in.push_back(mid);
+			want.push_back(c < 0 ? c : c + 1);
+		}
+	}
+	// clamping and NaN
+	for(float f : {2.f, 1e30f, std::numeric_limits<float>::infinity()}) {
+		in.push_back(f);
+		want.push_back(highest);
+		in.push_back(-f);
+		want.push_back(lowest);
+	}
+	in.push_back(std::numeric_limits<float>::quiet_NaN());
+	want.push_back(0);
+
+	std::vector<N> packed(in.size());
+	velm::batch::encode(in, packed);
+	std::vector<float> out(in.size());
+	velm::batch::decode(packed, out);
+
+	const double step_bound = 0.5 / max;
+	double worst = 0;
+	for(std::size_t i = 0; i < in.size(); ++i) {
+		const float f = in[i];
+		const N scalar(f);
+		CHECK_MSG(scalar.bits == want[i], "%s %a: encodes to %ld, not %ld", name, f, long(scalar.bits), want[i]);
+		CHECK_MSG(packed[i].bits == scalar.bits, "%s %a: batch encode differs from the scalar one", name, f);
+		const float back = scalar;
+		CHECK_MSG(float_bits(out[i]) == float_bits(back), "%s %a: batch decode differs from the scalar one", name, f);
+		// the decoded float is c / max correctly rounded
+		CHECK_MSG(back == static_cast<float>(double(scalar.bits) / max), "%s code %ld: decodes to %a", name, long(scalar.bits), back);
+		if(f == f && std::fabs(f) <= 1.f && (is_signed || f >= 0.f)) {
+			const double err = std::fabs(double(back) - f);
+			const double ulp = std::ldexp(1.0, std::ilogb(back == 0.f ? std::ldexp(1.f, -126) : back) - 23);
+			worst = std::fmax(worst, err * max);
+			CHECK_MSG(err <= step_bound + ulp / 2, "%s %a: round trip error %.3g steps", name, f, err * max);
+		}
+	}
+	if(is_signed) {
+		const N most_negative = N::from_bits(std::numeric_limits<I>::min());
+		CHECK_MSG(float(most_negative) == -1.f, "%s: most negative code decodes to %a", name, float(most_negative));
+	}
+	std::printf("%s: max round trip error %.3g steps (bound 0.5 and half an ulp)\n", name, worst);
+}
+
+// }}}
+// octahedral {{{
+
+double angle_degrees(const vec3& a, const vec3& b)
+{
+	const double ax = a.x, ay = a.y, az = a.z;
+	const double bx = b.x, by = b.y, bz = b.z;
+	const double cx = ay * bz - az * by;
+	const double cy = az * bx - ax * bz;
+	const double cz = ax * by - ay * bx;
+	const double cross = std::sqrt(cx * cx + cy * cy + cz * cz);
+	const double dot = ax * bx + ay * by + az * bz;
+	return std::atan2(cross, dot) * 180 / 3.14159265358979323846;
+}
+
+template <typename O>
+void check_oct(const char* name, double bound, const std::vector<vec3>& normals)
+{
+	const bool exact = velm::dispatch::active() == velm::dispatch::level::baseline;
+
+	std::vector<O> packed(normals.size());
+	velm::batch::encode(normals, packed);
+	std::vector<vec3> out(normals.size());
+	velm::batch::decode(packed, out);
+
+	double worst = 0;
+	std::size_t differ = 0;
+	for(std::size_t i = 0; i < normals.size(); ++i) {
+		const vec3& n = normals[i];
+		const O scalar(n.x, n.y, n.z);
+		CHECK_MSG(packed[i].u.bits == scalar.u.bits && packed[i].v.bits == scalar.v.bits,
+			"%s[%zu]: batch encode differs from the scalar one", name, i);
+		const std::array<float, 3> back = scalar.unpack();
+		const vec3 scalar_out(back[0], back[1], back[2]);
+		const bool identical = std::memcmp(&scalar_out, &out[i], sizeof(vec3)) == 0;
+		CHECK_MSG(!exact || identical, "%s[%zu]: batch decode differs from the scalar one", name, i);
+		differ += identical ? 0 : 1;
+
+		const double batch_err = angle_degrees(n, out[i]);
+		const double scalar_err = angle_degrees(n, scalar_out);
+		worst = std::fmax(worst, std::fmax(batch_err, scalar_err));
+		CHECK_MSG(batch_err <= bound && scalar_err <= bound, "%s[%zu]: error %.3g degrees > %.3g", name, i,
+			std::fmax(batch_err, scalar_err), bound);
+	}
+	std::printf("%s: max error %.3g degrees (bound %.3g), %zu of %zu decoded differently from the scalar function\n",
+		name, worst, bound, differ, normals.size());
+}
+
+std::vector<vec3> test_normals()
+{
+	std::vector<vec3> normals;
+	std::mt19937 rng(12345);
+	std::normal_distribution<float> normal;
+	for(int i = 0; i < 1000000; ++i) {
+		normals.push_back(velm::normalize(vec3(normal(rng), normal(rng), normal(rng))));
+	}
+	// the axes, the fold at z = 0 and the corners, where the error is largest
+	std::uniform_real_distribution<float> tiny(-1e-3f, 1e-3f);
+	for(int i = 0; i < 200000; ++i) {
+		const float t = std::uniform_real_distribution<float>(0.f, 6.2831853f)(rng);
+		normals.push_back(velm::normalize(vec3(std::cos(t), std::sin(t), tiny(rng))));
+		const unsigned int axis = i % 3;
+		vec3 v(tiny(rng), tiny(rng), tiny(rng));
+		v[axis] = i % 2 ? 1.f : -1.f;
+		normals.push_back(velm::normalize(v));
+	}
+	return normals;
+}
+
+// }}}
+
+} // namespace
+
+int main()
+{
+	std::printf("packed: %s kernels, %s half conversions\n", velm::dispatch::name(velm::dispatch::active()),
+		velm::dispatch::fast_half_conversion() ? "F16C" : "software");
+
+	check_half();
+
+	check_norm<velm::snorm8>("snorm8");
+	check_norm<velm::snorm16>("snorm16");
+	check_norm<velm::unorm8>("unorm8");
+	check_norm<velm::unorm16>("unorm16");
+
+	const std::vector<vec3> normals = test_normals();
+	check_oct<velm::oct16>("oct16", 1.0, normals);
+	check_oct<velm::oct32>("oct32", 0.05, normals);
+
+	return check::report("packed");
+}
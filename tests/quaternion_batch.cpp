@@ -0,0 +1,220 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "velm.hpp"
+#include "velm/dispatch.hpp"
+
+/*
+ * batch::rotate, nlerp and slerp against a double precision reference, and
+ * against the scalar functions.
+ *
+ * The batch loops are dispatched to AVX2 and AVX-512 at run time, and there
+ * the compiler may contract multiplies and adds into FMA instructions
+ * (-ffp-contract=fast, GCC's default outside strict ISO modes), which the
+ * scalar functions of an SSE2 translation unit cannot use. So batch results
+ * are only bit-identical to the scalar ones when contraction is off, or when
+ * the baseline kernels run (VELM_ISA=baseline). Otherwise they must be within
+ * the same error bounds of the reference.
+ *
+ * This file is built with -ffp-contract=fast and run at the best level and at
+ * the baseline, and built again with -ffp-contract=off (which defines
+ * VELM_TEST_NO_CONTRACT) and run at the best level.
+ */
+
+namespace {
+
+using quat = velm::quaternion<float>;
+using vec3 = velm::vector<float, 3>;
+
+// documented error bounds, in units of the magnitude of the result
+constexpr double rotate_bound = 4e-7;
+constexpr double nlerp_bound = 2e-7;
+constexpr double slerp_bound = 3e-7;
+
+struct dquat
+{
+	double x, y, z, w;
+};
+
+dquat widen(const quat& q)
+{
+	return {q.x, q.y, q.z, q.w};
+}
+
+double dot(const dquat& a, const dquat& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+dquat combine(const dquat& a, double wa, const dquat& b, double wb)
+{
+	return {a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb};
+}
+
+// the formula of operator*(q, v), in double on the same inputs
+void ref_rotate(const quat& qf, const vec3& vf, double out[3])
+{
+	const dquat q = widen(qf);
+	const double v[3] = {vf.x, vf.y, vf.z};
+	// t = 2 (u x v), v' = v + w t + u x t
+	const double t[3] = {
+		2 * (q.y * v[2] - q.z * v[1]),
+		2 * (q.z * v[0] - q.x * v[2]),
+		2 * (q.x * v[1] - q.y * v[0]),
+	};
+	out[0] = v[0] + q.w * t[0] + (q.y * t[2] - q.z * t[1]);
+	out[1] = v[1] + q.w * t[1] + (q.z * t[0] - q.x * t[2]);
+	out[2] = v[2] + q.w * t[2] + (q.x * t[1] - q.y * t[0]);
+}
+
+dquat ref_closer(const dquat& a, const dquat& b)
+{
+	return dot(a, b) < 0 ? combine(b, -1, b, 0) : b;
+}
+
+dquat ref_nlerp(const quat& af, const quat& bf, float t)
+{
+	const dquat a = widen(af);
+	const dquat b = ref_closer(a, widen(bf));
+	const dquat m = combine(a, 1 - double(t), b, t);
+	return combine(m, 1 / std::sqrt(dot(m, m)), m, 0);
+}
+
+dquat ref_slerp(const quat& af, const quat& bf, float t)
+{
+	const dquat a = widen(af);
+	const dquat b = ref_closer(a, widen(bf));
+	const dquat d = combine(a, 1, b, -1);
+	const dquat s = combine(a, 1, b, 1);
+	const double theta = 2 * std::atan2(std::sqrt(dot(d, d)), std::sqrt(dot(s, s)));
+	if(theta == 0) {
+		return a;
+	}
+	return combine(a, std::sin((1 - double(t)) * theta) / std::sin(theta), b, std::sin(t * theta) / std::sin(theta));
+}
+
+double error(const dquat& ref, const quat& q)
+{
+	const double d = std::fmax(std::fmax(std::fabs(ref.x - q.x), std::fabs(ref.y - q.y)),
+		std::fmax(std::fabs(ref.z - q.z), std::fabs(ref.w - q.w)));
+	return d / std::sqrt(dot(ref, ref));
+}
+
+double error(const double ref[3], const vec3& v)
+{
+	const double d = std::fmax(std::fmax(std::fabs(ref[0] - v.x), std::fabs(ref[1] - v.y)), std::fabs(ref[2] - v.z));
+	return d / std::sqrt(ref[0] * ref[0] + ref[1] * ref[1] + ref[2] * ref[2]);
+}
+
+template <typename V>
+bool same_bits(const V& a, const V& b)
+{
+	return std::memcmp(&a, &b, sizeof(V)) == 0;
+}
+
+struct tally
+{
+	const char* name;
+	double bound;
+	double worst = 0;
+	std::size_t differ = 0;
+	std::size_t count = 0;
+
+	tally(const char* n, double b)
+		: name(n), bound(b)
+	{
+	}
+
+	// errors of the batch and scalar results of element i
+	void add(double batch, double scalar, bool identical, std::size_t i)
+	{
+		CHECK_MSG(batch <= this->bound, "%s[%zu]: batch error %.3g > %.3g", this->name, i, batch, this->bound);
+		CHECK_MSG(scalar <= this->bound, "%s[%zu]: scalar error %.3g > %.3g", this->name, i, scalar, this->bound);
+		this->worst = std::fmax(this->worst, std::fmax(batch, scalar));
+		this->differ += identical ? 0 : 1;
+		++this->count;
+	}
+
+	void print() const
+	{
+		std::printf("%s: max error %.3g (bound %.3g), %zu of %zu differ from the scalar function\n",
+			this->name, this->worst, this->bound, this->differ, this->count);
+	}
+};
+
+quat random_rotation(std::mt19937& rng)
+{
+	std::normal_distribution<float> normal;
+	quat q(normal(rng), normal(rng), normal(rng), normal(rng));
+	return quat(velm::normalize(q));
+}
+
+} // namespace
+
+int main()
+{
+	const velm::dispatch::level level = velm::dispatch::active();
+#if defined(VELM_TEST_NO_CONTRACT)
+	const bool exact = true;
+#else
+	const bool exact = level == velm::dispatch::level::baseline;
+#endif
+	std::printf("quaternion_batch: %s kernels, batch %s the scalar functions\n",
+		velm::dispatch::name(level), exact ? "must match" : "may differ from");
+
+	const std::size_t n = 100000;
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<float> coord(-100.f, 100.f);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+	std::vector<quat> a(n), b(n), out(n);
+	std::vector<vec3> v(n), rotated(n);
+	std::vector<float> t(n);
+	for(std::size_t i = 0; i < n; ++i) {
+		a[i] = random_rotation(rng);
+		// half of the pairs close together, where slerp is most delicate
+		b[i] = i % 2 ? random_rotation(rng) : quat(velm::normalize(a[i] + random_rotation(rng) * 1e-3f));
+		v[i] = vec3(coord(rng), coord(rng), coord(rng));
+		t[i] = unit(rng);
+	}
+
+	tally rotate("rotate", rotate_bound);
+	velm::batch::rotate(a, v, rotated);
+	for(std::size_t i = 0; i < n; ++i) {
+		const vec3 scalar = a[i] * v[i];
+		double ref[3];
+		ref_rotate(a[i], v[i], ref);
+		const bool identical = same_bits(scalar, rotated[i]);
+		CHECK_MSG(!exact || identical, "rotate[%zu]: batch differs from q * v", i);
+		rotate.add(error(ref, rotated[i]), error(ref, scalar), identical, i);
+	}
+	rotate.print();
+
+	tally nlerp("nlerp", nlerp_bound);
+	velm::batch::nlerp(a, b, t, out);
+	for(std::size_t i = 0; i < n; ++i) {
+		const quat scalar = velm::nlerp(a[i], b[i], t[i]);
+		const bool identical = same_bits(scalar, out[i]);
+		CHECK_MSG(!exact || identical, "nlerp[%zu]: batch differs from velm::nlerp", i);
+		const dquat ref = ref_nlerp(a[i], b[i], t[i]);
+		nlerp.add(error(ref, out[i]), error(ref, scalar), identical, i);
+	}
+	nlerp.print();
+
+	tally slerp("slerp", slerp_bound);
+	velm::batch::slerp(a, b, t, out);
+	for(std::size_t i = 0; i < n; ++i) {
+		const quat scalar = velm::slerp(a[i], b[i], t[i]);
+		const bool identical = same_bits(scalar, out[i]);
+		CHECK_MSG(!exact || identical, "slerp[%zu]: batch differs from velm::slerp", i);
+		const dquat ref = ref_slerp(a[i], b[i], t[i]);
+		slerp.add(error(ref, out[i]), error(ref, scalar), identical, i);
+	}
+	slerp.print();
+
+	return check::report("quaternion_batch");
+}
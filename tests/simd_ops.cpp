@@ -0,0 +1,302 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "velm.hpp"
+
+/*
+ * The SIMD operators of simd.hpp must give bit-identical results to the
+ * generic path. This file is built once with VELM_SIMD=0, which writes the
+ * results of every case to a file, and again with VELM_SIMD=1 for each
+ * instruction set (SSE2, SSE4.1, AVX2), which computes the same cases and
+ * compares them bit for bit. Both are built with -fwrapv, so that integer
+ * overflow is defined in the generic path too.
+ *
+ * Each case combines vectors of float, double, int32_t and uint32_t with
+ * N = 2, 3, 4 and 8, drawn from a table of values including NaN, signed
+ * zeroes, infinities, subnormals and integers which overflow, so the first
+ * components of the operands go through every pair of values. The payload
+ * and sign of NaN results are not compared (see recorder::bits).
+ */
+
+namespace {
+
+template <typename T>
+struct values;
+
+template <>
+struct values<float>
+{
+	static constexpr const char* name = "float";
+
+	static std::vector<float> get()
+	{
+		using lim = std::numeric_limits<float>;
+		return {0.f, -0.f, 1.f, -1.5f, 0.1f, -7.f, 3.0e38f, -2.5e38f, 1e-40f, lim::min(),
+			lim::infinity(), -lim::infinity(), lim::quiet_NaN(), -lim::quiet_NaN()};
+	}
+};
+
+template <>
+struct values<double>
+{
+	static constexpr const char* name = "double";
+
+	static std::vector<double> get()
+	{
+		using lim = std::numeric_limits<double>;
+		return {0.0, -0.0, 1.0, -1.5, 0.1, -7.0, 1.5e308, -1.2e308, 1e-310, lim::min(),
+			lim::infinity(), -lim::infinity(), lim::quiet_NaN(), -lim::quiet_NaN()};
+	}
+};
+
+template <>
+struct values<std::int32_t>
+{
+	static constexpr const char* name = "int32";
+
+	static std::vector<std::int32_t> get()
+	{
+		using lim = std::numeric_limits<std::int32_t>;
+		return {0, 1, -1, 7, -123456, 46341, -65536, lim::max(), lim::min(), lim::min() + 1};
+	}
+};
+
+template <>
+struct values<std::uint32_t>
+{
+	static constexpr const char* name = "uint32";
+
+	static std::vector<std::uint32_t> get()
+	{
+		return {0u, 1u, 7u, 46341u, 65536u, 123456789u, 0x7fffffffu, 0x80000000u, 0xfffffffeu, 0xffffffffu};
+	}
+};
+
+struct recorder
+{
+	std::vector<std::string> lines;
+	std::string prefix;
+
+	/*
+	 * Results are compared bit for bit, except for NaNs: which operand's NaN
+	 * an addition or multiplication returns depends on the order the
+	 * compiler puts the operands in, which it may swap for either path.
+	 */
+	template <typename T>
+	static std::string bits(T val)
+	{
+		if(val != val) {
+			return " nan";
+		}
+		std::uint64_t out = 0;
+		std::memcpy(&out, &val, sizeof(val));
+		char buf[24];
+		std::snprintf(buf, sizeof(buf), " %llx", static_cast<unsigned long long>(out));
+		return buf;
+	}
+
+	template <typename T, unsigned int N>
+	void add(const char* what, const velm::vector<T, N>& v)
+	{
+		std::string line = prefix + what;
+		for(unsigned int i = 0; i < N; ++i) {
+			line += bits(v[i]);
+		}
+		lines.push_back(line);
+	}
+
+	template <unsigned int N>
+	void add(const char* what, const velm::mask<N>& m)
+	{
+		std::string line = prefix + what + " ";
+		for(unsigned int i = 0; i < N; ++i) {
+			line += m[i] ? '1' : '0';
+		}
+		lines.push_back(line);
+	}
+};
+
+// the components of v in reverse order, as a swizzle
+template <typename V, std::size_t... Is>
+decltype(auto) reversed(V& v, std::index_sequence<Is...> /* seq */)
+{
+	return v.template swizzle<static_cast<unsigned int>(sizeof...(Is) - 1 - Is)...>();
+}
+
+template <typename T, unsigned int N>
+decltype(auto) reversed(velm::vector<T, N>& v)
+{
+	return reversed(v, std::make_index_sequence<N>());
+}
+
+template <typename T, unsigned int N>
+void divide(recorder& r, const velm::vector<T, N>& a, const velm::vector<T, N>& b, T s, std::true_type /* floating */)
+{
+	r.add("a/b", a / b);
+	r.add("a/s", a / s);
+	r.add("s/a", s / a);
+	velm::vector<T, N> c = a;
+	c /= b;
+	r.add("c/=b", c);
+	c /= s;
+	r.add("c/=s", c);
+}
+
+// integer division is never packed, and would trap on zero
+template <typename T, unsigned int N>
+void divide(recorder& /* r */, const velm::vector<T, N>& /* a */, const velm::vector<T, N>& /* b */, T /* s */, std::false_type /* floating */)
+{
+}
+
+template <typename T, unsigned int N>
+void run_cases(recorder& r)
+{
+	const std::vector<T> vals = values<T>::get();
+	const std::size_t m = vals.size();
+
+	for(std::size_t k = 0; k < m * m; ++k) {
+		velm::vector<T, N> a;
+		velm::vector<T, N> b;
+		for(unsigned int i = 0; i < N; ++i) {
+			a[i] = vals[(k + i) % m];
+			b[i] = vals[(k / m + 2 * i) % m];
+		}
+		const T s = vals[(k * 7 + 3) % m];
+		r.prefix = std::string(values<T>::name) + "/" + std::to_string(N) + "/" + std::to_string(k) + " ";
+
+		r.add("a+b", a + b);
+		r.add("a-b", a - b);
+		r.add("a*b", a * b);
+		r.add("-a", -a);
+		r.add("a+s", a + s);
+		r.add("s+a", s + a);
+		r.add("a-s", a - s);
+		r.add("s-a", s - a);
+		r.add("a*s", a * s);
+		r.add("s*a", s * a);
+		divide(r, a, b, s, std::is_floating_point<T>());
+
+		velm::vector<T, N> c = a;
+		c += b;
+		r.add("c+=b", c);
+		c -= s;
+		r.add("c-=s", c);
+		c *= b;
+		r.add("c*=b", c);
+		c += s;
+		r.add("c+=s", c);
+
+		const velm::mask<N> lt = velm::lessThan(a, b);
+		r.add("a<b", lt);
+		r.add("a<=b", velm::lessThanEqual(a, b));
+		r.add("a>b", velm::greaterThan(a, b));
+		r.add("a>=b", velm::greaterThanEqual(a, b));
+		r.add("a==b", velm::equal(a, b));
+		r.add("a!=b", velm::notEqual(a, b));
+		r.add("a<s", velm::lessThan(a, s));
+		r.add("s<a", velm::lessThan(s, a));
+		r.add("a!=s", velm::notEqual(a, s));
+		r.add("sel(a,b)", velm::select(lt, a, b));
+		r.add("sel(a,s)", velm::select(lt, a, s));
+		r.add("sel(s,b)", velm::select(lt, s, b));
+
+		// swizzles take the generic path, but must still agree
+		r.add("rev(a)+b", reversed(a) + b);
+		r.add("a*rev(b)", a * reversed(b));
+		r.add("rev(a)-s", reversed(a) - s);
+		r.add("-rev(a)", -reversed(a));
+		r.add("rev(a)<b", velm::lessThan(reversed(a), b));
+		c = a;
+		c += reversed(b);
+		r.add("c+=rev(b)", c);
+		c = a;
+		reversed(c) *= b;
+		r.add("rev(c)*=b", c);
+		c = a;
+		reversed(c) -= c;
+		r.add("rev(c)-=c", c);
+	}
+}
+
+template <typename T>
+void run_type(recorder& r)
+{
+	run_cases<T, 2>(r);
+	run_cases<T, 3>(r);
+	run_cases<T, 4>(r);
+	run_cases<T, 8>(r);
+}
+
+// whether the CPU can run the instructions this file was built for
+bool cpu_supported()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	#if defined(__AVX2__)
+	if(!__builtin_cpu_supports("avx2")) {
+		return false;
+	}
+	#endif
+	#if defined(__SSE4_1__)
+	if(!__builtin_cpu_supports("sse4.1")) {
+		return false;
+	}
+	#endif
+#endif
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if(argc != 2) {
+		std::fprintf(stderr, "usage: %s <reference file>\n", argv[0]);
+		return 2;
+	}
+	if(!cpu_supported()) {
+		std::printf("simd_ops: instruction set not supported, skipped\n");
+		return check::skipped;
+	}
+
+	recorder r;
+	run_type<float>(r);
+	run_type<double>(r);
+	run_type<std::int32_t>(r);
+	run_type<std::uint32_t>(r);
+
+#if !VELM_SIMD
+	std::ofstream out(argv[1]);
+	for(const std::string& line : r.lines) {
+		out << line << '\n';
+	}
+	if(!CHECK_MSG(out.good(), "cannot write %s", argv[1])) {
+		return 1;
+	}
+	std::printf("simd_ops: wrote %zu reference results\n", r.lines.size());
+	return 0;
+#else
+	// the packed path must actually be taken for full registers
+	static_assert(velm::simd::is_native_binary<velm::simd::op_add, velm::vector<float, 4>, velm::vector<float, 4>>::value,
+		"float vectors of 4 should use the SIMD path");
+
+	std::ifstream in(argv[1]);
+	std::vector<std::string> expected;
+	for(std::string line; std::getline(in, line);) {
+		expected.push_back(line);
+	}
+	CHECK_MSG(expected.size() == r.lines.size(), "%zu reference results, %zu computed", expected.size(), r.lines.size());
+	for(std::size_t i = 0; i < expected.size() && i < r.lines.size(); ++i) {
+		CHECK_MSG(expected[i] == r.lines[i], "generic: %s\n  simd:    %s", expected[i].c_str(), r.lines[i].c_str());
+	}
+	return check::report("simd_ops");
+#endif
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "velm.hpp"
+#include "velm/exec.hpp"
+#include "velm/spatial_grid.hpp"
+
+/*
+ * spatial_grid built and updated in parallel must be the same grid as
+ * sequentially: the same order, and the same pairs in the same order. For
+ * small inputs, the pairs are also checked against testing every pair.
+ * Inputs are large enough for the parallel counting sort, and include
+ * clustered particles, which fall unevenly into the ranges of buckets.
+ */
+
+namespace {
+
+using pair_list = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+template <unsigned int N>
+pair_list brute_force(const std::vector<velm::vector<float, N>>& pts, float r)
+{
+	pair_list out;
+	for(std::uint32_t i = 0; i < pts.size(); ++i) {
+		for(std::uint32_t j = i + 1; j < pts.size(); ++j) {
+			const velm::vector<float, N> d = pts[j] - pts[i];
+			if(velm::dot(d, d) <= r * r) {
+				out.emplace_back(i, j);
+			}
+		}
+	}
+	return out;
+}
+
+pair_list normalised(pair_list pairs)
+{
+	for(auto& p : pairs) {
+		if(p.first > p.second) {
+			std::swap(p.first, p.second);
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+template <unsigned int N>
+void run(const char* name, std::size_t n, float size, bool clustered, const velm::exec::policy& par)
+{
+	using vec = velm::vector<float, N>;
+	std::mt19937 rng(static_cast<std::uint32_t>(n + N));
+	std::normal_distribution<float> cluster(0.f, size / 4);
+	std::uniform_real_distribution<float> uniform(0.f, size);
+
+	std::vector<vec> pts(n);
+	for(vec& p : pts) {
+		for(unsigned int k = 0; k < N; ++k) {
+			p[k] = clustered ? cluster(rng) : uniform(rng);
+		}
+	}
+
+	const float r = 0.02f;
+	velm::spatial_grid<float, N> seq(r);
+	velm::spatial_grid<float, N> par_grid(r);
+	seq.build(pts);
+	par_grid.build(par, pts);
+
+	// small moves are merged, and large ones sort again
+	const float moves[] = {0.f, 0.1f, 0.1f, 2.f, 0.05f};
+	for(unsigned int step = 0; step < sizeof(moves) / sizeof(moves[0]); ++step) {
+		if(step > 0) {
+			std::uniform_real_distribution<float> jitter(-r * moves[step], r * moves[step]);
+			for(vec& p : pts) {
+				for(unsigned int k = 0; k < N; ++k) {
+					p[k] += jitter(rng);
+				}
+			}
+			seq.update(pts);
+			par_grid.update(par, pts);
+		}
+
+		pair_list a;
+		pair_list b;
+		seq.pairs(a);
+		par_grid.pairs(par, b);
+		CHECK_MSG(seq.order() == par_grid.order(), "%s, %zu points, step %u: order differs", name, n, step);
+		CHECK_MSG(a == b, "%s, %zu points, step %u: pairs differ", name, n, step);
+		if(n <= 5000) {
+			CHECK_MSG(normalised(a) == brute_force(pts, r), "%s, %zu points, step %u: wrong pairs", name, n, step);
+		}
+	}
+}
+
+} // namespace
+
+int main()
+{
+	velm::exec::thread_pool pool(4);
+	const velm::exec::policy par = velm::exec::par.with_pool(pool);
+
+	for(std::size_t n : {std::size_t(0), std::size_t(7), std::size_t(3000), std::size_t(200000)}) {
+		run<3>("3D uniform", n, 1.f, false, par);
+		run<2>("2D uniform", n, 4.f, false, par);
+	}
+	run<3>("3D clustered", 200000, 1.f, true, par);
+	run<2>("2D clustered", 200000, 4.f, true, par);
+
+	return check::report("spatial_grid");
+}
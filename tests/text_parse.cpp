@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include "check.hpp"
+#include "velm.hpp"
+#include "velm/text.hpp"
+
+/*
+ * Where velm::parse and parse_lines leave ptr: one past the text used on
+ * success, and at the start of the offending component on failure, for text
+ * which is not a number and for numbers out of range alike. Built once as
+ * C++14, which uses velm's own number parser, and once as C++17, which uses
+ * std::from_chars where the standard library has it.
+ */
+
+namespace {
+
+template <typename V>
+void expect(const char* text, std::errc ec, std::size_t offset)
+{
+	const char* const last = text + std::strlen(text);
+	V val(typename V::value_type(7));
+	const V before = val;
+	const velm::parse_result res = velm::parse(text, last, val);
+	CHECK_MSG(res.ec == ec, "\"%s\": error %d, expected %d", text, static_cast<int>(res.ec), static_cast<int>(ec));
+	CHECK_MSG(res.ptr == text + offset, "\"%s\": ptr at %td, expected %zu", text, res.ptr - text, offset);
+	if(ec != std::errc()) {
+		CHECK_MSG(velm::all(velm::equal(val, before)), "\"%s\": output changed on failure", text);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	using vec3 = velm::vector<float, 3>;
+	using dvec2 = velm::vector<double, 2>;
+	using ivec3 = velm::vector<std::int32_t, 3>;
+	using bvec2 = velm::vector<std::int8_t, 2>;
+	using uvec2 = velm::vector<std::uint32_t, 2>;
+
+	std::printf("text_parse: VELM_CHARCONV=%d\n", VELM_CHARCONV);
+
+	expect<vec3>("  1.5, -2 +3e2 rest", std::errc(), 14);
+	expect<ivec3>("1\t-2,3", std::errc(), 6);
+	expect<bvec2>("-128 127", std::errc(), 8);
+
+	// not numbers: ptr at the component
+	expect<vec3>("1 2x 3", std::errc::invalid_argument, 2);
+	expect<vec3>("1 2", std::errc::invalid_argument, 3);
+	expect<vec3>("1, abc, 3", std::errc::invalid_argument, 3);
+	expect<uvec2>("4294967295 -1", std::errc::invalid_argument, 11);
+
+	// out of range: also at the start of the component, not after it
+	expect<vec3>("1 1e400 2", std::errc::result_out_of_range, 2);
+	expect<vec3>("1,  -3e39,2", std::errc::result_out_of_range, 4);
+	expect<dvec2>("1e999 0", std::errc::result_out_of_range, 0);
+	expect<dvec2>("0, -1e-999", std::errc::result_out_of_range, 3);
+	expect<ivec3>("1 2 2147483648", std::errc::result_out_of_range, 4);
+	expect<ivec3>(" -2147483649 0 0", std::errc::result_out_of_range, 1);
+	expect<bvec2>("100 -129", std::errc::result_out_of_range, 4);
+	expect<uvec2>("4294967296 0", std::errc::result_out_of_range, 0);
+
+	// parse_lines reports the same position as an offset and a line
+	const char text[] = "v 1 2 3\nv 4 5 6\nv 7 1e99 9\nv 1 1 1\n";
+	std::vector<vec3> out;
+	const velm::lines_result res = velm::parse_lines(text, text + std::strlen(text), out, "v");
+	CHECK(res.ec == std::errc::result_out_of_range);
+	CHECK_MSG(res.offset == 20, "parse_lines: offset %zu, expected 20", res.offset);
+	CHECK(res.ptr == text + res.offset);
+	CHECK(res.line == 3);
+	CHECK(res.count == 2 && out.size() == 2);
+
+	return check::report("text_parse");
+}
@@ -0,0 +1,88 @@
+#include <cstddef>
+
+#include "check.hpp"
+#include "velm.hpp"
+
+/*
+ * Growing and shrinking a vector_array, and push_back of one of its own
+ * elements when it is full. Built with AddressSanitizer where the compiler
+ * has it, since the failures here are reads and writes outside the lanes.
+ */
+
+namespace {
+
+using vec3 = velm::vector<float, 3>;
+using array3 = velm::vector_array<float, 3>;
+
+vec3 value(std::size_t i)
+{
+	return vec3(float(i), float(i) + 0.25f, float(i) + 0.5f);
+}
+
+bool same(const vec3& a, const vec3& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+void resize_shrink_grow()
+{
+	array3 arr(10, vec3(1.f, 2.f, 3.f));
+	for(std::size_t i = 0; i < arr.size(); ++i) {
+		arr[i] = value(i);
+	}
+
+	arr.resize(3);
+	CHECK(arr.size() == 3);
+	for(std::size_t i = 0; i < arr.size(); ++i) {
+		CHECK_MSG(same(arr[i], value(i)), "shrink: element %zu changed", i);
+	}
+
+	// grows past the old size and the capacity, so both the lanes kept and
+	// the relayout are filled
+	const vec3 fill(-1.f, -2.f, -3.f);
+	const std::size_t n = arr.capacity() + 5;
+	arr.resize(n, fill);
+	CHECK(arr.size() == n);
+	for(std::size_t i = 0; i < 3; ++i) {
+		CHECK_MSG(same(arr[i], value(i)), "grow: element %zu changed", i);
+	}
+	for(std::size_t i = 3; i < n; ++i) {
+		CHECK_MSG(same(arr[i], fill), "grow: element %zu not filled", i);
+	}
+
+	arr.resize(0);
+	CHECK(arr.empty());
+	arr.resize(2, fill);
+	CHECK(same(arr[0], fill));
+	CHECK(same(arr[1], fill));
+}
+
+void push_back_own_element()
+{
+	array3 arr;
+	for(std::size_t i = 0; arr.size() < arr.capacity() || arr.size() == 0; ++i) {
+		arr.push_back(value(i));
+	}
+
+	// full, so this push_back moves the lanes which its argument refers to
+	const std::size_t n = arr.size();
+	const std::size_t cap = arr.capacity();
+	arr.push_back(arr[1]);
+	CHECK(arr.capacity() > cap);
+	CHECK(arr.size() == n + 1);
+	CHECK_MSG(same(arr[n], value(1)), "push_back of own element at capacity");
+
+	const array3& carr = arr;
+	arr.push_back(carr[n]);
+	CHECK(same(arr[n + 1], value(1)));
+}
+
+} // namespace
+
+int main()
+{
+	resize_shrink_grow();
+	push_back_own_element();
+
+	return check::report("vector_array");
+}